@@ -0,0 +1,27 @@
+#
+# Writes the shaders in SHADER_DIR to OUTPUT as a C++ source file, so that they can be
+# compiled into the executable. Run with cmake -DSHADER_DIR=... -DOUTPUT=... -P embedShaders.cmake
+#
+file (GLOB SHADERS ${SHADER_DIR}/*.comp
+                   ${SHADER_DIR}/*.frag
+                   ${SHADER_DIR}/*.geom
+                   ${SHADER_DIR}/*.tcs
+                   ${SHADER_DIR}/*.tes
+                   ${SHADER_DIR}/*.vert)
+# An array of no shaders would not compile, and would be no use
+if (NOT SHADERS)
+  message (FATAL_ERROR "There are no shaders to embed in ${SHADER_DIR}")
+endif ()
+
+set (CONTENT "// Generated by embedShaders.cmake from the shaders in ${SHADER_DIR}\n\n")
+set (CONTENT "${CONTENT}#include \"shaderCache.hpp\"\n\n")
+set (CONTENT "${CONTENT}EmbeddedShader const embeddedShaders[] = {\n")
+foreach (SHADER ${SHADERS})
+  get_filename_component (NAME ${SHADER} NAME)
+  file (READ ${SHADER} SOURCE)
+  set (CONTENT "${CONTENT}    { \"${NAME}\", R\"gloom_shader(${SOURCE})gloom_shader\" },\n")
+endforeach ()
+set (CONTENT "${CONTENT}};\n\n")
+set (CONTENT "${CONTENT}size_t const embeddedShaderCount = sizeof(embeddedShaders) / sizeof(embeddedShaders[0]);\n")
+
+file (WRITE ${OUTPUT} "${CONTENT}")
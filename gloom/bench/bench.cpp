@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include "bench.hpp"
+#include "parallel.hpp"
+#include "toolbox.hpp"
+
+static BenchmarkSettings settings;
+static std::string currentSuite;
+static std::vector<BenchmarkResult> results;
+
+BenchmarkSettings &getBenchmarkSettings() {
+    return settings;
+}
+
+void setBenchmarkSuite(std::string const &suite) {
+    currentSuite = suite;
+}
+
+std::vector<BenchmarkResult> const &getBenchmarkResults() {
+    return results;
+}
+
+static double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    size_t middle = values.size() / 2;
+    return (values.size() % 2 == 1) ? values[middle] : 0.5 * (values[middle - 1] + values[middle]);
+}
+
+void runBenchmark(std::string const &name, unsigned int repetitions, double itemsPerRun,
+                  std::function<void()> const &function) {
+    runBenchmark(name, repetitions, itemsPerRun, 0.0, function);
+}
+
+void runBenchmark(std::string const &name, unsigned int repetitions, double itemsPerRun, double bytesPerRun,
+                  std::function<void()> const &function) {
+    for (unsigned int run = 0; run < settings.warmupRuns; run++) {
+        function();
+    }
+
+    unsigned int timedRuns = std::max(1u, unsigned(std::lround(repetitions * settings.repetitionScale)));
+    Clock clock(name);
+    std::vector<double> times(timedRuns);
+    for (double &seconds : times) {
+        clock.reset();
+        function();
+        seconds = clock.getTimeDeltaSeconds();
+    }
+
+    BenchmarkResult result;
+    result.suite = currentSuite;
+    result.name = name;
+    result.repetitions = timedRuns;
+    result.threadCount = getThreadCount();
+    result.medianSeconds = median(times);
+    std::vector<double> deviations(times.size());
+    for (size_t i = 0; i < times.size(); i++) {
+        deviations[i] = std::abs(times[i] - result.medianSeconds);
+    }
+    result.madSeconds = median(deviations);
+    result.fastestSeconds = *std::min_element(times.begin(), times.end());
+    for (double seconds : times) {
+        result.meanSeconds += seconds / timedRuns;
+    }
+    result.itemsPerSecond = itemsPerRun / result.medianSeconds;
+    result.bytesPerSecond = bytesPerRun / result.medianSeconds;
+    results.push_back(result);
+
+    // Slow benchmarks, such as whole path searches, are shown in thousands of items per second
+    bool isSlow = result.itemsPerSecond < 1e5;
+    printf("%-48s %10.3f ms +- %7.3f (fastest %10.3f) %12.3f %s items/s",
+           name.c_str(), 1000.0 * result.medianSeconds, 1000.0 * result.madSeconds, 1000.0 * result.fastestSeconds,
+           result.itemsPerSecond / (isSlow ? 1e3 : 1e6), isSlow ? "k" : "M");
+    if (bytesPerRun > 0.0) {
+        printf(" %10.1f MB/s", result.bytesPerSecond / 1e6);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+static void writeJsonString(FILE* file, std::string const &text) {
+    fputc('"', file);
+    for (char character : text) {
+        if (character == '"' || character == '\\') {
+            fputc('\\', file);
+            fputc(character, file);
+        } else if ((unsigned char) character < 0x20) {
+            fprintf(file, "\\u%04x", (unsigned int) (unsigned char) character);
+        } else {
+            fputc(character, file);
+        }
+    }
+    fputc('"', file);
+}
+
+bool writeBenchmarkReport(std::string const &path) {
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "{\n  \"warmupRuns\": %u,\n  \"results\": [", settings.warmupRuns);
+    for (size_t i = 0; i < results.size(); i++) {
+        BenchmarkResult const &result = results[i];
+        fprintf(file, "%s\n    {\"suite\": ", (i == 0) ? "" : ",");
+        writeJsonString(file, result.suite);
+        fprintf(file, ", \"name\": ");
+        writeJsonString(file, result.name);
+        fprintf(file, ", \"repetitions\": %u, \"threads\": %u, \"medianSeconds\": %.9g, \"madSeconds\": %.9g, "
+                      "\"fastestSeconds\": %.9g, \"meanSeconds\": %.9g, \"itemsPerSecond\": %.9g, \"bytesPerSecond\": %.9g}",
+                result.repetitions, result.threadCount, result.medianSeconds, result.madSeconds,
+                result.fastestSeconds, result.meanSeconds, result.itemsPerSecond, result.bytesPerSecond);
+    }
+    fprintf(file, "\n  ]\n}\n");
+    bool isWritten = !ferror(file);
+    return (fclose(file) == 0) && isWritten;
+}
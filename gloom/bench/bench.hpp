@@ -0,0 +1,65 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Settings taken from the command line, shared by every suite
+struct BenchmarkSettings {
+    // Untimed runs before the timed ones, to warm up caches and the allocator
+    unsigned int warmupRuns = 1;
+    // Multiplies the number of timed runs each benchmark asks for. At least one run is always timed.
+    double repetitionScale = 1.0;
+    // Number of faces in the OBJ files written for the wavefront suite
+    unsigned int objFaceCount = 200000;
+};
+
+BenchmarkSettings &getBenchmarkSettings();
+
+// The outcome of one benchmark, as written to the JSON report
+struct BenchmarkResult {
+    std::string suite;
+    std::string name;
+    unsigned int repetitions = 0;
+    unsigned int threadCount = 0;
+    double medianSeconds = 0.0;
+    // Median absolute deviation from the median, a spread which ignores the odd slow run
+    double madSeconds = 0.0;
+    double fastestSeconds = 0.0;
+    double meanSeconds = 0.0;
+    double itemsPerSecond = 0.0;
+    // Zero unless the benchmark says how many bytes one run processes
+    double bytesPerSecond = 0.0;
+};
+
+// Names the suite the results of the following benchmarks belong to
+void setBenchmarkSuite(std::string const &suite);
+
+// Runs a function a number of times after the warm-up runs, and prints the median time and its
+// spread along with the throughput, given how many items (and bytes) one run processes.
+void runBenchmark(std::string const &name, unsigned int repetitions, double itemsPerRun,
+                  std::function<void()> const &function);
+void runBenchmark(std::string const &name, unsigned int repetitions, double itemsPerRun, double bytesPerRun,
+                  std::function<void()> const &function);
+
+std::vector<BenchmarkResult> const &getBenchmarkResults();
+
+// Writes every result so far as JSON. Returns false if the file cannot be written.
+bool writeBenchmarkReport(std::string const &path);
+
+// The benchmark suites. Each one runs all its benchmarks and prints the results.
+void benchmarkNormals();
+void benchmarkAgents();
+void benchmarkPathfinding();
+void benchmarkPaths();
+void benchmarkChessboard();
+void benchmarkStreaming();
+void benchmarkStaticBatching();
+void benchmarkSkinning();
+void benchmarkTextures();
+void benchmarkScheduler();
+void benchmarkSceneFiles();
+void benchmarkRandom();
+void benchmarkFloats();
+void benchmarkWavefront();
+void benchmarkTransforms();
@@ -0,0 +1,61 @@
+#include <random>
+#include <string>
+#include <vector>
+#include "agents.hpp"
+#include "bench.hpp"
+#include "parallel.hpp"
+#include "spatialGrid.hpp"
+
+static const unsigned int agentCount = 100000;
+static const float tileWidth = 20.0f;
+// About four agents per tile
+static const int boardTiles = 158;
+
+void benchmarkAgents() {
+    std::mt19937 generator(1234);
+    std::uniform_real_distribution<float> coordinate(-0.5f * tileWidth, (boardTiles - 0.5f) * tileWidth);
+
+    std::vector<Agent> agents(agentCount);
+    std::vector<float2> positions(agentCount);
+    for (unsigned int i = 0; i < agentCount; i++) {
+        agents[i].position = float2(coordinate(generator), coordinate(generator));
+        agents[i].velocity = float2(0, 0);
+        agents[i].waypoint = i % 4;
+        positions[i] = agents[i].position;
+    }
+
+    SpatialGrid grid(tileWidth);
+    runBenchmark("grid rebuild, 100k agents", 20, agentCount, [&]() {
+        grid.rebuild(positions);
+    });
+
+    SteeringParameters steering;
+    std::vector<Neighbour> neighbours;
+    runBenchmark("radius queries, 100k agents", 5, agentCount, [&]() {
+        for (unsigned int i = 0; i < agentCount; i++) {
+            grid.queryRadius(positions[i], steering.separationRadius, neighbours, i);
+        }
+    });
+    runBenchmark("8 nearest queries, 100k agents", 5, agentCount, [&]() {
+        for (unsigned int i = 0; i < agentCount; i++) {
+            grid.queryNearest(positions[i], steering.maxNeighbours, neighbours, i);
+        }
+    });
+
+    // A square path around the board
+    std::vector<int2> corners = { { 0, 0 }, { boardTiles - 1, 0 }, { boardTiles - 1, boardTiles - 1 }, { 0, boardTiles - 1 } };
+    Path path(corners);
+
+    unsigned int defaultThreadCount = getThreadCount();
+    unsigned int threadCounts[2] = { 1, defaultThreadCount };
+    for (unsigned int threads : threadCounts) {
+        setThreadCount(threads);
+        std::vector<Agent> simulated = agents;
+        runBenchmark("steering tick, 100k agents, " + std::to_string(threads) + " thread(s)", 5, agentCount, [&]() {
+            updateAgents(simulated, path, grid, steering, 1.0 / 60.0);
+        });
+
+        if (threads == defaultThreadCount) break;
+    }
+    setThreadCount(defaultThreadCount);
+}
@@ -0,0 +1,57 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "bench.hpp"
+#include "chessboard.hpp"
+#include "parallel.hpp"
+#include "toolbox.hpp"
+
+static const unsigned int boardTiles = 1024;
+static const unsigned int chunkSize = 64;
+
+static size_t getMeshBytes(Mesh const &mesh) {
+    return mesh.vertices.size() * sizeof(float4) + mesh.colours.size() * sizeof(float4) +
+           mesh.normals.size() * sizeof(float3) + mesh.indices.size() * sizeof(unsigned int);
+}
+
+void benchmarkChessboard() {
+    double tileCount = double(boardTiles) * boardTiles;
+    float4 white(1, 1, 1, 1);
+    float4 grey(0.2, 0.2, 0.2, 1);
+    size_t bytes = 0;
+
+    for (unsigned int tiles : { 64u, 256u, boardTiles }) {
+        std::string size = std::to_string(tiles) + "x" + std::to_string(tiles);
+        runBenchmark("generateChessboard, " + size + " tiles", (tiles < boardTiles) ? 20 : 3, double(tiles) * tiles, [&]() {
+            Mesh mesh = generateChessboard(tiles, tiles, 20.0f, white, grey);
+            bytes = getMeshBytes(mesh);
+        });
+    }
+    printf("%-48s %10.1f bytes per tile\n", "generateChessboard", bytes / tileCount);
+
+    unsigned int defaultThreadCount = getThreadCount();
+    unsigned int threadCounts[2] = { 1, defaultThreadCount };
+    for (unsigned int threads : threadCounts) {
+        setThreadCount(threads);
+        std::string suffix = ", " + std::to_string(threads) + " thread(s)";
+
+        runBenchmark("shared vertex grid, 1024x1024 tiles" + suffix, 3, tileCount, [&]() {
+            Mesh mesh = generateChessboardGrid(boardTiles, boardTiles, 20.0f, white, grey);
+            bytes = getMeshBytes(mesh);
+        });
+        runBenchmark("64x64 tile chunks, 1024x1024 tiles" + suffix, 3, tileCount, [&]() {
+            std::vector<ChessboardChunk> chunks = generateChessboardChunks(boardTiles, boardTiles, chunkSize, 20.0f, white, grey);
+            bytes = 0;
+            for (ChessboardChunk const &chunk : chunks) {
+                bytes += getMeshBytes(chunk.mesh);
+            }
+        });
+
+        if (threads == defaultThreadCount) break;
+    }
+    setThreadCount(defaultThreadCount);
+
+    Mesh grid = generateChessboardGrid(boardTiles, boardTiles, 20.0f, white, grey);
+    printf("%-48s %10.1f bytes per tile\n", "generateChessboardGrid", getMeshBytes(grid) / tileCount);
+    printf("%-48s %10.1f bytes per tile\n", "generateChessboardChunks", bytes / tileCount);
+}
@@ -0,0 +1,90 @@
+#include <cstdio>
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+#include "bench.hpp"
+#include "floats.hpp"
+#include "random.hpp"
+
+static const size_t elementCount = 1 << 20;
+
+// Keeps the compiler from dropping work whose results are never looked at
+static volatile float sink;
+
+static void consume(float value) {
+    sink = value;
+}
+
+void benchmarkFloats() {
+    RandomStream random(1234);
+    std::vector<float3> a(elementCount);
+    std::vector<float3> b(elementCount);
+    std::vector<float3> result(elementCount);
+    std::vector<float4> points(elementCount);
+    std::vector<float4> transformed(elementCount);
+    for (size_t i = 0; i < elementCount; i++) {
+        a[i] = float3(random.nextFloat(-1, 1), random.nextFloat(-1, 1), random.nextFloat(-1, 1));
+        b[i] = float3(random.nextFloat(-1, 1), random.nextFloat(-1, 1), random.nextFloat(-1, 1));
+        points[i] = float4(a[i], 1.0f);
+    }
+    double float3Bytes = double(elementCount) * 3 * sizeof(float3);
+
+    runBenchmark("float3 a + b", 20, elementCount, float3Bytes, [&]() {
+        for (size_t i = 0; i < elementCount; i++) {
+            result[i] = a[i] + b[i];
+        }
+    });
+
+    runBenchmark("float3 a * b + a", 20, elementCount, float3Bytes, [&]() {
+        for (size_t i = 0; i < elementCount; i++) {
+            result[i] = a[i] * b[i] + a[i];
+        }
+    });
+
+    runBenchmark("float3 dot", 20, elementCount, [&]() {
+        float sum = 0.0f;
+        for (size_t i = 0; i < elementCount; i++) {
+            sum += a[i].dot(b[i]);
+        }
+        consume(sum);
+    });
+
+    runBenchmark("float3 cross", 20, elementCount, float3Bytes, [&]() {
+        for (size_t i = 0; i < elementCount; i++) {
+            result[i] = a[i].cross(b[i]);
+        }
+    });
+
+    runBenchmark("float3 normalize", 20, elementCount, [&]() {
+        for (size_t i = 0; i < elementCount; i++) {
+            result[i] = a[i];
+            result[i].normalize();
+        }
+    });
+
+    runBenchmark("float3 distance", 20, elementCount, [&]() {
+        float sum = 0.0f;
+        for (size_t i = 0; i < elementCount; i++) {
+            sum += a[i].distance(b[i]);
+        }
+        consume(sum);
+    });
+
+    runBenchmark("float4 clamp", 20, elementCount, [&]() {
+        float4 low(-0.5f, -0.5f, -0.5f, 0.0f);
+        float4 high(0.5f, 0.5f, 0.5f, 1.0f);
+        for (size_t i = 0; i < elementCount; i++) {
+            transformed[i] = points[i].clamp(low, high);
+        }
+    });
+
+    // Points through a matrix the way the scene graph and skinning do it, by way of glm
+    glm::mat4 matrix(1.0f);
+    matrix[3] = glm::vec4(1, 2, 3, 1);
+    runBenchmark("mat4 * float4 through glm", 20, elementCount, [&]() {
+        for (size_t i = 0; i < elementCount; i++) {
+            transformed[i] = matrix * glm::vec4(points[i]);
+        }
+    });
+    consume(transformed[elementCount / 2].x + result[elementCount / 2].y);
+}
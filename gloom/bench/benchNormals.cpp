@@ -0,0 +1,74 @@
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <cstdio>
+#include <string>
+#include "bench.hpp"
+#include "meshNormals.hpp"
+#include "parallel.hpp"
+
+// A UV sphere with 2 * rings * segments triangles. If indexed, neighbouring triangles share
+// vertices; otherwise every triangle has its own, like meshes from loadWavefront().
+static Mesh generateSphere(unsigned int rings, unsigned int segments, bool indexed) {
+    Mesh mesh("sphere");
+
+    auto position = [&](unsigned int ring, unsigned int segment) {
+        float theta = float(M_PI) * ring / rings;
+        float phi = 2.0f * float(M_PI) * (segment % segments) / segments;
+        return float4(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi), 1.0f);
+    };
+
+    if (indexed) {
+        for (unsigned int ring = 0; ring <= rings; ring++) {
+            for (unsigned int segment = 0; segment <= segments; segment++) {
+                mesh.vertices.push_back(position(ring, segment));
+            }
+        }
+        for (unsigned int ring = 0; ring < rings; ring++) {
+            for (unsigned int segment = 0; segment < segments; segment++) {
+                unsigned int a = ring * (segments + 1) + segment;
+                unsigned int b = a + segments + 1;
+                unsigned int quad[6] = { a, b, b + 1, a, b + 1, a + 1 };
+                mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+            }
+        }
+    } else {
+        for (unsigned int ring = 0; ring < rings; ring++) {
+            for (unsigned int segment = 0; segment < segments; segment++) {
+                float4 corners[6] = {
+                    position(ring, segment), position(ring + 1, segment), position(ring + 1, segment + 1),
+                    position(ring, segment), position(ring + 1, segment + 1), position(ring, segment + 1)
+                };
+                for (float4 const &corner : corners) {
+                    mesh.indices.push_back(unsigned(mesh.vertices.size()));
+                    mesh.vertices.push_back(corner);
+                }
+            }
+        }
+    }
+    return mesh;
+}
+
+void benchmarkNormals() {
+    unsigned int defaultThreadCount = getThreadCount();
+    unsigned int threadCounts[2] = { 1, defaultThreadCount };
+
+    for (bool indexed : { true, false }) {
+        // About two million triangles
+        Mesh sphere = generateSphere(1000, 1000, indexed);
+        double triangleCount = double(sphere.indices.size() / 3);
+
+        for (unsigned int threads : threadCounts) {
+            setThreadCount(threads);
+            std::string name = std::string("smooth normals, ") + (indexed ? "indexed" : "non-indexed") +
+                               ", " + std::to_string(threads) + " thread(s)";
+            runBenchmark(name, 3, triangleCount, [&]() {
+                Mesh copy = sphere;
+                generateSmoothNormals(copy);
+            });
+
+            if (threads == defaultThreadCount) break;
+        }
+    }
+
+    setThreadCount(defaultThreadCount);
+}
@@ -0,0 +1,97 @@
+#include <random>
+#include <vector>
+#include "agents.hpp"
+#include "bench.hpp"
+#include "flowField.hpp"
+#include "pathfinding.hpp"
+#include "spatialGrid.hpp"
+
+static const unsigned int boardTiles = 1024;
+static const unsigned int queryCount = 200;
+static const float tileWidth = 20.0f;
+
+// A board scattered with walls of random length, which blocks about a fifth of the tiles
+static NavigationGrid generateBoard(std::mt19937 &generator) {
+    NavigationGrid grid(boardTiles, boardTiles);
+    std::uniform_int_distribution<int> coordinate(0, boardTiles - 1);
+    std::uniform_int_distribution<int> wallLength(2, 24);
+    unsigned int wallCount = boardTiles * boardTiles / 64;
+    for (unsigned int wall = 0; wall < wallCount; wall++) {
+        int2 tile = { coordinate(generator), coordinate(generator) };
+        bool isHorizontal = (generator() & 1) == 0;
+        int length = wallLength(generator);
+        for (int i = 0; i < length; i++) {
+            grid.setBlocked(tile, true);
+            (isHorizontal ? tile.x : tile.y)++;
+        }
+    }
+    return grid;
+}
+
+static int2 randomWalkableTile(NavigationGrid const &grid, std::mt19937 &generator) {
+    std::uniform_int_distribution<int> coordinate(0, boardTiles - 1);
+    int2 tile;
+    do {
+        tile.x = coordinate(generator);
+        tile.y = coordinate(generator);
+    } while (!grid.isWalkable(tile));
+    return tile;
+}
+
+void benchmarkPathfinding() {
+    std::mt19937 generator(1234);
+    NavigationGrid grid = generateBoard(generator);
+
+    std::vector<int2> starts(queryCount);
+    std::vector<int2> goals(queryCount);
+    for (unsigned int i = 0; i < queryCount; i++) {
+        starts[i] = randomWalkableTile(grid, generator);
+        goals[i] = randomWalkableTile(grid, generator);
+    }
+
+    Pathfinder pathfinder(grid);
+    std::vector<int2> path;
+    runBenchmark("JPS path queries, 1024x1024 tiles", 3, queryCount, [&]() {
+        for (unsigned int i = 0; i < queryCount; i++) {
+            pathfinder.findPath(starts[i], goals[i], path);
+        }
+    });
+
+    double tileCount = double(boardTiles) * boardTiles;
+    runBenchmark("flow field build, 1024x1024 tiles", 5, tileCount, [&]() {
+        FlowField field(grid, goals[0]);
+    });
+
+    // Block and unblock tiles with eight goals in the cache, which repairs all eight fields each time
+    FlowFieldCache cache(grid, 8);
+    for (unsigned int i = 0; i < 8; i++) {
+        cache.getFlowField(goals[i]);
+    }
+    std::vector<int2> changedTiles(100);
+    for (int2 &tile : changedTiles) {
+        tile = randomWalkableTile(grid, generator);
+    }
+    runBenchmark("flow field repair, 8 cached fields", 3, 2.0 * changedTiles.size(), [&]() {
+        for (int2 tile : changedTiles) {
+            cache.setBlocked(tile, true);
+        }
+        for (int2 tile : changedTiles) {
+            cache.setBlocked(tile, false);
+        }
+    });
+
+    // Many agents sharing one goal, each only looking up its tile in the field
+    std::vector<Agent> agents(100000);
+    for (Agent &agent : agents) {
+        int2 tile = randomWalkableTile(grid, generator);
+        agent.position = float2(tile.x * tileWidth, tile.y * tileWidth);
+        agent.velocity = float2(0, 0);
+        agent.waypoint = 0;
+    }
+    FlowField const &field = cache.getFlowField(goals[0]);
+    SpatialGrid spatialGrid(tileWidth);
+    SteeringParameters steering;
+    runBenchmark("flow field steering tick, 100k agents", 5, double(agents.size()), [&]() {
+        updateAgents(agents, field, spatialGrid, steering, 1.0 / 60.0);
+    });
+}
@@ -0,0 +1,96 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "bench.hpp"
+#include "compiledPath.hpp"
+#include "parallel.hpp"
+
+static const unsigned int agentCount = 1000000;
+static const float tileWidth = 20.0f;
+static const unsigned int queryCount = 1000000;
+static const unsigned int fileWaypointCount = 100000;
+
+void benchmarkPaths() {
+    // A winding loop over a board of 16 by 16 tiles
+    std::vector<int2> waypoints = {
+        { 0, 0 }, { 15, 0 }, { 15, 5 }, { 3, 5 }, { 3, 10 }, { 15, 10 }, { 15, 15 }, { 0, 15 }
+    };
+    Path path(waypoints);
+
+    // Each character walking on its own, the way Path is meant to be used
+    std::vector<float2> positions(agentCount, float2(0, 0));
+    std::vector<unsigned int> currentWaypoints(agentCount, 1);
+    float step = 20.0f / 60.0f;
+    runBenchmark("waypoint stepping, 1M agents", 5, agentCount, [&]() {
+        for (unsigned int i = 0; i < agentCount; i++) {
+            float2 toWaypoint = path.getWaypoint(currentWaypoints[i], tileWidth) - positions[i];
+            float distance = std::sqrt(toWaypoint.x * toWaypoint.x + toWaypoint.y * toWaypoint.y);
+            positions[i] += toWaypoint * (step / distance);
+            float2 remaining = path.getWaypoint(currentWaypoints[i], tileWidth) - positions[i];
+            if (std::sqrt(remaining.x * remaining.x + remaining.y * remaining.y) < tileWidth / 10.0f) {
+                currentWaypoints[i] = (currentWaypoints[i] + 1) % path.getWaypointCount();
+            }
+        }
+    });
+
+    // A single character asking its path where to go, as program.cpp does every frame. It carries
+    // on from one run to the next, and the waypoints it reaches are counted for the last run.
+    float2 position(0, 0);
+    unsigned int reachedCount = 0;
+    runBenchmark("Path queries, 1M", 10, queryCount, [&]() {
+        reachedCount = 0;
+        for (unsigned int i = 0; i < queryCount; i++) {
+            float2 target = path.getCurrentWaypoint(tileWidth);
+            position += (target - position) * 0.25f;
+            if (path.hasWaypointBeenReached(position, tileWidth)) {
+                path.advanceToNextWaypoint();
+                reachedCount++;
+            }
+        }
+    });
+
+    // Reading a long coordinates file in the format of coordinates_0.txt
+    std::string coordinatesPath = "bench-coordinates.txt";
+    {
+        std::ofstream file(coordinatesPath);
+        file << fileWaypointCount << "\n";
+        for (unsigned int i = 0; i < fileWaypointCount; i++) {
+            file << (i % 97) << " " << (i % 89) << "\n";
+        }
+    }
+    unsigned int loadedWaypoints = 0;
+    runBenchmark("Path from file, 100k waypoints", 5, fileWaypointCount, [&]() {
+        Path loaded(coordinatesPath);
+        loadedWaypoints = loaded.getWaypointCount();
+    });
+    std::remove(coordinatesPath.c_str());
+    printf("%-48s %10u (%u loaded)\n", "waypoints reached in 1M queries", reachedCount, loadedWaypoints);
+
+    CompiledPath compiledPath(path, tileWidth);
+    runBenchmark("compile path", 100, 1, [&]() {
+        CompiledPath compiled(path, tileWidth);
+    });
+
+    // Characters spread out along the path, walking at slightly different speeds
+    std::vector<PathCursor> cursors(agentCount);
+    std::vector<float> speeds(agentCount);
+    for (unsigned int i = 0; i < agentCount; i++) {
+        cursors[i] = compiledPath.getCursor(compiledPath.getLength() * i / agentCount);
+        speeds[i] = 18.0f + 4.0f * (i % 16) / 16.0f;
+    }
+    std::vector<float2> headings;
+
+    unsigned int defaultThreadCount = getThreadCount();
+    unsigned int threadCounts[2] = { 1, defaultThreadCount };
+    for (unsigned int threads : threadCounts) {
+        setThreadCount(threads);
+        runBenchmark("compiled path advance, 1M agents, " + std::to_string(threads) + " thread(s)", 5, agentCount, [&]() {
+            compiledPath.advance(cursors, speeds, 1.0f / 60.0f, positions, headings);
+        });
+
+        if (threads == defaultThreadCount) break;
+    }
+    setThreadCount(defaultThreadCount);
+}
@@ -0,0 +1,74 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "bench.hpp"
+#include "parallel.hpp"
+#include "random.hpp"
+#include "toolbox.hpp"
+
+static const size_t floatCount = 1 << 22;
+static const size_t parallelFloatCount = 1 << 24;
+static const size_t floatsPerPiece = 1 << 16;
+
+// What randomUniformFloat() used to do
+static float randomFloatFromRand() {
+    return static_cast <float> (rand()) / static_cast <float>(RAND_MAX);
+}
+
+static double sum(std::vector<float> const &values) {
+    double total = 0.0;
+    for (float value : values) {
+        total += value;
+    }
+    return total;
+}
+
+void benchmarkRandom() {
+    std::vector<float> values(floatCount);
+
+    srand(1234);
+    runBenchmark("rand() / RAND_MAX", 10, floatCount, [&]() {
+        for (float &value : values) {
+            value = randomFloatFromRand();
+        }
+    });
+
+    seedRandom(1234);
+    runBenchmark("randomUniformFloat()", 10, floatCount, [&]() {
+        for (float &value : values) {
+            value = randomUniformFloat();
+        }
+    });
+
+    RandomStream stream(1234);
+    runBenchmark("RandomStream::nextFloat()", 10, floatCount, [&]() {
+        for (float &value : values) {
+            value = stream.nextFloat();
+        }
+    });
+
+    WideRandomStream wideStream(1234);
+    runBenchmark("WideRandomStream::fillUniform()", 10, floatCount, [&]() {
+        wideStream.fillUniform(values.data(), values.size());
+    });
+    printf("%-48s %10.6f\n", "mean of the last batch", sum(values) / values.size());
+
+    // One stream per piece, so the numbers do not depend on the number of threads
+    unsigned int defaultThreadCount = getThreadCount();
+    std::vector<float> parallelValues(parallelFloatCount);
+    for (unsigned int threads : { 1u, defaultThreadCount }) {
+        setThreadCount(threads);
+        runBenchmark("fillUniform per piece, " + std::to_string(threads) + " thread(s)", 10, parallelFloatCount, [&]() {
+            parallelFor(0, parallelValues.size(), floatsPerPiece, [&](size_t first, size_t last) {
+                WideRandomStream pieceStream(1234, first / floatsPerPiece);
+                pieceStream.fillUniform(&parallelValues[first], last - first);
+            });
+        });
+        printf("%-48s %10.3f\n", "sum", sum(parallelValues));
+        if (threads == defaultThreadCount) {
+            break;
+        }
+    }
+    setThreadCount(defaultThreadCount);
+}
@@ -0,0 +1,124 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "bench.hpp"
+#include "sceneFile.hpp"
+#include "sceneGraph.hpp"
+
+// A million nodes: groups of a parent with its children, like the parts of a character
+static const unsigned int groupCount = 10000;
+static const unsigned int groupSize = 100;
+// The text format is slower to read, so less of it is converted
+static const unsigned int textGroupCount = 1000;
+
+static SceneDescription createDescription(unsigned int groups) {
+    SceneDescription scene;
+    scene.meshSources.push_back("steve.obj:torso");
+    scene.meshSources.push_back("steve.obj:head");
+    scene.nodes.reserve(size_t(groups) * groupSize);
+
+    for (unsigned int group = 0; group < groups; group++) {
+        SceneDescriptionNode parent;
+        parent.name = "group" + std::to_string(group);
+        parent.mesh = 0;
+        parent.position = float3(float(group % 100) * 20, 0, float(group / 100) * 20);
+        parent.isStatic = (group % 2) == 0;
+        uint32_t parentIndex = uint32_t(scene.nodes.size());
+        scene.nodes.push_back(parent);
+
+        for (unsigned int i = 1; i < groupSize; i++) {
+            SceneDescriptionNode child;
+            child.name = parent.name + "_" + std::to_string(i);
+            child.parent = parentIndex;
+            child.mesh = 1;
+            child.referencePoint = float3(0, 24, 0);
+            child.rotation = float3(0, 0.01f * i, 0);
+            scene.nodes.push_back(child);
+        }
+    }
+    return scene;
+}
+
+static void writeDescriptionText(std::string const &path, SceneDescription const &scene) {
+    std::ofstream file(path);
+    for (size_t i = 0; i < scene.meshSources.size(); i++) {
+        file << "mesh mesh" << i << " " << scene.meshSources[i] << "\n";
+    }
+    for (SceneDescriptionNode const &node : scene.nodes) {
+        file << "node " << node.name;
+        if (node.parent != sceneFileNone) {
+            file << " parent " << scene.nodes[node.parent].name;
+        }
+        file << " mesh mesh" << node.mesh;
+        file << " position " << node.position.x << " " << node.position.y << " " << node.position.z;
+        file << " rotation " << node.rotation.x << " " << node.rotation.y << " " << node.rotation.z;
+        file << " reference " << node.referencePoint.x << " " << node.referencePoint.y << " " << node.referencePoint.z;
+        file << (node.isStatic ? " static\n" : "\n");
+    }
+}
+
+void benchmarkSceneFiles() {
+    std::string binaryPath = "bench-scene.scene";
+    std::string textPath = "bench-scene.txt";
+    SceneDescription scene = createDescription(groupCount);
+    double nodeCount = double(scene.nodes.size());
+    std::string size = std::to_string(scene.nodes.size() / 1000) + "k nodes";
+
+    runBenchmark("write binary, " + size, 3, nodeCount, [&]() {
+        writeSceneFile(binaryPath, scene);
+    });
+
+    SceneFile file;
+    runBenchmark("map and validate, " + size, 10, nodeCount, [&]() {
+        file.open(binaryPath);
+    });
+
+    size_t meshReferences = 0;
+    runBenchmark("instantiate, " + size, 10, nodeCount, [&]() {
+        meshReferences = 0;
+        SceneInstance instance = instantiateScene(file, [&](SceneNode*, uint32_t) {
+            meshReferences++;
+        });
+    });
+
+    double bytesPerNode = file.getSizeBytes() / nodeCount;
+
+    // The same graph built the way createScene() builds its nodes, one allocation each
+    runBenchmark("createSceneNode + addChild, " + size, 10, nodeCount, [&]() {
+        std::vector<SceneNode*> nodes(file.getNodeCount());
+        std::vector<SceneNode*> roots;
+        for (uint32_t i = 0; i < file.getNodeCount(); i++) {
+            SceneFileNode const &record = file.getNode(i);
+            SceneNode* node = createSceneNode();
+            node->position = float3(record.position[0], record.position[1], record.position[2]);
+            node->rotation = float3(record.rotation[0], record.rotation[1], record.rotation[2]);
+            node->referencePoint = float3(record.referencePoint[0], record.referencePoint[1], record.referencePoint[2]);
+            node->isStatic = (record.flags & SCENE_FILE_NODE_STATIC) != 0;
+            nodes[i] = node;
+            if (record.parent == sceneFileNone) {
+                roots.push_back(node);
+            } else {
+                addChild(nodes[record.parent], node);
+            }
+        }
+        for (SceneNode* root : roots) {
+            deleteSceneNode(root);
+        }
+    });
+
+    SceneDescription textScene = createDescription(textGroupCount);
+    writeDescriptionText(textPath, textScene);
+    runBenchmark("convert text, " + std::to_string(textScene.nodes.size() / 1000) + "k nodes", 3, double(textScene.nodes.size()), [&]() {
+        writeSceneFile(binaryPath, parseSceneText(textPath));
+    });
+
+    file.open(binaryPath);
+    printf("%-48s %10.1f bytes per node\n", "scene file", bytesPerNode);
+    printf("%-48s %10u\n", "nodes after converting the text", file.getNodeCount());
+    printf("%-48s %10zu\n", "mesh references", meshReferences);
+
+    file.close();
+    std::remove(binaryPath.c_str());
+    std::remove(textPath.c_str());
+}
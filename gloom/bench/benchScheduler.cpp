@@ -0,0 +1,133 @@
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "bench.hpp"
+#include "parallel.hpp"
+#include "sceneGraph.hpp"
+#include "toolbox.hpp"
+
+static const unsigned int jobCount = 100000;
+static const unsigned int chainLength = 10000;
+static const size_t workElementCount = 1 << 22;
+static const unsigned int sceneGroupCount = 1000;
+static const unsigned int sceneGroupSize = 100;
+
+// Some arithmetic which does not touch memory, so that it scales with the number of cores alone
+static float spinWork(size_t element) {
+    float value = float(element & 1023);
+    for (int i = 0; i < 32; i++) {
+        value = std::sqrt(value * 1.0001f + 1.0f);
+    }
+    return value;
+}
+
+// 1, 2, 4, ... up to the number of hardware threads, which is always included
+static std::vector<unsigned int> getScalingThreadCounts(unsigned int maxThreadCount) {
+    std::vector<unsigned int> counts;
+    for (unsigned int count = 1; count < maxThreadCount; count *= 2) {
+        counts.push_back(count);
+    }
+    counts.push_back(maxThreadCount);
+    return counts;
+}
+
+void benchmarkScheduler() {
+    unsigned int defaultThreadCount = getThreadCount();
+    std::atomic<unsigned int> counter(0);
+
+    // The cost of the scheduler itself, with jobs which do next to nothing
+    std::vector<unsigned int> overheadThreadCounts(1, 1);
+    if (defaultThreadCount > 1) {
+        overheadThreadCounts.push_back(defaultThreadCount);
+    }
+    for (unsigned int threads : overheadThreadCounts) {
+        setThreadCount(threads);
+        JobSystem &jobSystem = getJobSystem();
+        std::string suffix = ", " + std::to_string(threads) + " thread(s)";
+
+        std::vector<JobHandle> jobs(jobCount);
+        runBenchmark("run + wait, empty jobs" + suffix, 10, jobCount, [&]() {
+            for (JobHandle &job : jobs) {
+                job = jobSystem.run([&counter]() { counter.fetch_add(1, std::memory_order_relaxed); });
+            }
+            for (JobHandle const &job : jobs) {
+                jobSystem.wait(job);
+            }
+        });
+
+        runBenchmark("chain of continuations" + suffix, 10, chainLength, [&]() {
+            JobHandle last = jobSystem.run([&counter]() { counter++; });
+            for (unsigned int i = 1; i < chainLength; i++) {
+                last = jobSystem.runAfter(last, [&counter]() { counter++; });
+            }
+            jobSystem.wait(last);
+        });
+
+        runBenchmark("parallelFor, 1 element pieces" + suffix, 10, jobCount, [&]() {
+            parallelFor(0, jobCount, 1, [&counter](size_t, size_t) {
+                counter.fetch_add(1, std::memory_order_relaxed);
+            });
+        });
+
+        // Every outer piece waits for an inner parallelFor, which only works out if waiting
+        // threads keep running jobs
+        runBenchmark("nested parallelFor, 100 x 1000 elements" + suffix, 10, jobCount, [&]() {
+            parallelFor(0, 100, 1, [&counter](size_t, size_t) {
+                parallelFor(0, 1000, 10, [&counter](size_t first, size_t last) {
+                    counter.fetch_add(unsigned(last - first), std::memory_order_relaxed);
+                });
+            });
+        });
+    }
+
+    // Scaling of work which is worth spreading out
+    std::vector<float> results(workElementCount);
+    std::vector<unsigned int> threadCounts = getScalingThreadCounts(defaultThreadCount);
+    for (unsigned int threads : threadCounts) {
+        setThreadCount(threads);
+        runBenchmark("arithmetic, 4M elements, " + std::to_string(threads) + " thread(s)", 5, workElementCount, [&]() {
+            parallelFor(0, workElementCount, 4096, [&](size_t first, size_t last) {
+                for (size_t i = first; i < last; i++) {
+                    results[i] = spinWork(i);
+                }
+            });
+        });
+    }
+
+    // The scene transform pass, over groups like the crowd's characters
+    SceneNode* root = createSceneNode();
+    for (unsigned int group = 0; group < sceneGroupCount; group++) {
+        SceneNode* groupNode = createSceneNode();
+        groupNode->position = float3(float(group % 32) * 20, 0, float(group / 32) * 20);
+        addChild(root, groupNode);
+        for (unsigned int i = 0; i < sceneGroupSize; i++) {
+            SceneNode* node = createSceneNode();
+            node->position = float3(float(i), 1, 0);
+            node->rotation = float3(0, 0.01f * i, 0);
+            addChild(groupNode, node);
+        }
+    }
+    double sceneNodeCount = double(sceneGroupCount) * (sceneGroupSize + 1) + 1;
+    for (unsigned int threads : threadCounts) {
+        setThreadCount(threads);
+        runBenchmark("scene transforms, 100k nodes, " + std::to_string(threads) + " thread(s)", 20, sceneNodeCount, [&]() {
+            updateNodeTransformations(root, glm::mat4(1));
+        });
+    }
+    deleteSceneNode(root);
+
+    float4 white(1, 1, 1, 1);
+    float4 grey(0.2, 0.2, 0.2, 1);
+    for (unsigned int threads : threadCounts) {
+        setThreadCount(threads);
+        runBenchmark("generateChessboard, 1024x1024 tiles, " + std::to_string(threads) + " thread(s)", 3, 1024.0 * 1024.0, [&]() {
+            generateChessboard(1024, 1024, 20.0f, white, grey);
+        });
+    }
+    setThreadCount(defaultThreadCount);
+
+    printf("%-48s %10u\n", "hardware threads", defaultThreadCount);
+    printf("%-48s %10u\n", "checksum", counter.load() + unsigned(results[workElementCount / 3]));
+}
@@ -0,0 +1,87 @@
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bench.hpp"
+#include "parallel.hpp"
+#include "sceneGraph.hpp"
+#include "skinning.hpp"
+
+static const unsigned int characterCount = 10000;
+
+// Swings the limbs of a character, like animateLimbs() in program.cpp
+static void swingLimbs(float3 &armL, float3 &armR, float3 &legL, float3 &legR, double time) {
+    float swing = float(std::sin(3.3 * time));
+    armR.x = 0.7f * swing;
+    armL.x = -0.7f * swing;
+    legR.x = -0.9f * swing;
+    legL.x = 0.9f * swing;
+}
+
+void benchmarkSkinning() {
+    MinecraftCharacter steve;
+    try {
+        steve = loadMinecraftCharacterModel(std::string(PROJECT_SOURCE_DIR) + "/build/steve.obj");
+    } catch (std::runtime_error const &error) {
+        printf("Skipped, steve.obj could not be loaded: %s\n", error.what());
+        return;
+    }
+    Skeleton skeleton = createCharacterSkeleton();
+    SkinnedMesh skinnedSteve = createSkinnedCharacter(steve);
+    double time = 0.0;
+
+    // A node for each part of each character, as drawn without skinning
+    SceneNode* root = createSceneNode();
+    for (unsigned int i = 0; i < characterCount; i++) {
+        SceneNode* torso = createSceneNode();
+        torso->position = float3(float(i % 100) * 20, 0, float(i / 100) * 20);
+        addChild(root, torso);
+        for (unsigned int bone = 1; bone < CHARACTER_BONE_COUNT; bone++) {
+            SceneNode* part = createSceneNode();
+            part->referencePoint = skeleton.bones[bone].referencePoint;
+            addChild(torso, part);
+        }
+    }
+
+    runBenchmark("scene graph, 10000 characters", 20, characterCount, [&]() {
+        time += 0.016;
+        for (unsigned int i = 0; i < characterCount; i++) {
+            auto &limbs = root->children[i]->children;
+            swingLimbs(limbs[1]->rotation, limbs[2]->rotation, limbs[3]->rotation, limbs[4]->rotation, time + 0.37 * i);
+        }
+        updateNodeTransformations(root, glm::mat4(1));
+    });
+
+    std::vector<BonePose> poses(characterCount * CHARACTER_BONE_COUNT);
+    std::vector<glm::mat4> palettes;
+    unsigned int defaultThreadCount = getThreadCount();
+    unsigned int threadCounts[2] = { 1, defaultThreadCount };
+    for (unsigned int threads : threadCounts) {
+        setThreadCount(threads);
+        runBenchmark("bone palettes, 10000 characters, " + std::to_string(threads) + " thread(s)", 20, characterCount, [&]() {
+            time += 0.016;
+            for (unsigned int i = 0; i < characterCount; i++) {
+                BonePose* pose = &poses[i * CHARACTER_BONE_COUNT];
+                swingLimbs(pose[CHARACTER_BONE_LEFT_ARM].rotation, pose[CHARACTER_BONE_RIGHT_ARM].rotation,
+                           pose[CHARACTER_BONE_LEFT_LEG].rotation, pose[CHARACTER_BONE_RIGHT_LEG].rotation, time + 0.37 * i);
+            }
+            computeBonePalettes(skeleton, poses, palettes);
+        });
+
+        if (threads == defaultThreadCount) break;
+    }
+    setThreadCount(defaultThreadCount);
+
+    Mesh skinned("CPU skinned mesh");
+    runBenchmark("CPU skinning, 10000 characters", 5, characterCount, [&]() {
+        for (unsigned int i = 0; i < characterCount; i++) {
+            skinMesh(skinnedSteve, &palettes[i * CHARACTER_BONE_COUNT], skinned);
+        }
+    });
+
+    printf("%-48s %10u\n", "draws per character, scene graph", unsigned(CHARACTER_BONE_COUNT));
+    printf("%-48s %10u\n", "draws per character, skinned", 1u);
+    printf("%-48s %10u\n", "vertices per character", unsigned(skinnedSteve.mesh.vertices.size()));
+    deleteSceneNode(root);
+}
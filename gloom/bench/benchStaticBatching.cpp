@@ -0,0 +1,61 @@
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "bench.hpp"
+#include "sceneGraph.hpp"
+#include "staticBatching.hpp"
+#include "toolbox.hpp"
+
+static const unsigned int groupCount = 100;
+static const unsigned int nodesPerGroup = 100;
+
+// A scene of groups of small boards scattered around, each group placed and rotated as a whole
+static SceneNode* createStaticScene(std::shared_ptr<Mesh> const &mesh) {
+    seedRandom(39);
+    SceneNode* root = createSceneNode();
+    for (unsigned int group = 0; group < groupCount; group++) {
+        SceneNode* groupNode = createSceneNode();
+        groupNode->isStatic = true;
+        groupNode->position = float3(randomUniformFloat() * 2000, 0, randomUniformFloat() * 2000);
+        groupNode->rotation = float3(0, randomUniformFloat() * 6.28f, 0);
+        addChild(root, groupNode);
+
+        for (unsigned int i = 0; i < nodesPerGroup; i++) {
+            SceneNode* node = createSceneNode();
+            node->isStatic = true;
+            node->staticMesh = mesh;
+            node->position = float3(randomUniformFloat() * 200, randomUniformFloat() * 10, randomUniformFloat() * 200);
+            node->rotation = float3(randomUniformFloat(), randomUniformFloat() * 6.28f, 0);
+            node->referencePoint = float3(20, 0, 20);
+            addChild(groupNode, node);
+        }
+    }
+    return root;
+}
+
+void benchmarkStaticBatching() {
+    std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(generateChessboard(2, 2, 20.0f, float4(1, 1, 1, 1), float4(0.2, 0.2, 0.2, 1)));
+    SceneNode* root = createStaticScene(mesh);
+    double nodeCount = double(groupCount) * nodesPerGroup;
+
+    std::vector<StaticInstance> instances;
+    std::vector<StaticBatch> batches;
+    runBenchmark("collect static nodes, 10000 nodes", 10, nodeCount, [&]() {
+        instances = collectStaticInstances(root);
+    });
+    runBenchmark("build static batches, 10000 nodes", 10, nodeCount, [&]() {
+        batches = buildStaticBatches(instances);
+    });
+
+    // The placement of each node as the scene graph itself computes it
+    updateNodeTransformations(root, glm::mat4(1));
+    std::vector<StaticInstance> placedInstances = instances;
+    for (StaticInstance &instance : placedInstances) {
+        instance.modelMatrix = instance.node->currentTransformationMatrix;
+    }
+
+    printf("%-48s %10u\n", "static instances", unsigned(instances.size()));
+    printf("%-48s %10u\n", "static batches", unsigned(batches.size()));
+    printf("%-48s %10g\n", "largest vertex error", measureStaticBatchError(batches, placedInstances));
+    deleteSceneNode(root);
+}
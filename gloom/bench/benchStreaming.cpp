@@ -0,0 +1,54 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include "bench.hpp"
+#include "terrainStreaming.hpp"
+
+// Flies a camera across a board of 4096 by 4096 tiles, updating the streamer at 60 frames per
+// second without drawing anything, and reports how long chunks took to arrive
+void benchmarkStreaming() {
+    TerrainStreamingSettings settings;
+    settings.boardWidth = 4096;
+    settings.boardHeight = 4096;
+    settings.memoryBudgetBytes = 2 << 20;
+
+    size_t uploadedBytes = 0;
+    unsigned int evictedChunks = 0;
+    TerrainStreamer streamer(settings, [&](uint64_t, ChessboardChunk &chunk) {
+        uploadedBytes += chunk.mesh.vertices.size() * 2 * sizeof(float4) + chunk.mesh.indices.size() * sizeof(unsigned int);
+    }, [&](uint64_t) {
+        evictedChunks++;
+    });
+
+    // A fast diagonal flight, at 3000 units per second, with a budget which only fits the chunks
+    // around the camera and a few more
+    const double frameSeconds = 1.0 / 60.0;
+    const unsigned int frameCount = 600;
+    float2 camera(0, 0);
+    unsigned int maxResidentChunks = 0;
+    double maxUpdateSeconds = 0.0;
+    std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+
+    for (unsigned int frame = 0; frame < frameCount; frame++) {
+        std::chrono::steady_clock::time_point updateStart = std::chrono::steady_clock::now();
+        streamer.update(camera);
+        double updateSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - updateStart).count();
+        maxUpdateSeconds = std::max(maxUpdateSeconds, updateSeconds);
+        maxResidentChunks = std::max(maxResidentChunks, streamer.getResidentChunkCount());
+
+        camera += float2(1, 1) * float(3000.0 * frameSeconds / std::sqrt(2.0));
+        frameStart += std::chrono::microseconds(long(frameSeconds * 1e6));
+        std::this_thread::sleep_until(frameStart);
+    }
+
+    printf("%-48s %10u chunks (max resident %u, %u evicted)\n", "streamed over 600 frames",
+           streamer.getStreamedChunkCount(), maxResidentChunks, evictedChunks);
+    printf("%-48s %10.1f MB (budget %.1f MB)\n", "resident at the end",
+           streamer.getResidentBytes() / (1024.0 * 1024.0), settings.memoryBudgetBytes / (1024.0 * 1024.0));
+    printf("%-48s %10.3f ms (p95 %.3f ms, max %.3f ms)\n", "latency from request to upload, mean",
+           1000.0 * streamer.getMeanLatencySeconds(), 1000.0 * streamer.getLatencyPercentileSeconds(0.95),
+           1000.0 * streamer.getMaxLatencySeconds());
+    printf("%-48s %10.3f ms\n", "slowest update() call", 1000.0 * maxUpdateSeconds);
+}
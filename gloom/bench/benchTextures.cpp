@@ -0,0 +1,136 @@
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bench.hpp"
+#include "parallel.hpp"
+#include "texture.hpp"
+#include "toolbox.hpp"
+
+// The implementation is compiled into frameEncoder.cpp
+#include <stb_image_write.h>
+
+static const unsigned int largeTextureCount = 32;
+static const unsigned int largeTextureSize = 512;
+static const unsigned int smallTextureCount = 256;
+static const unsigned int smallTextureSize = 32;
+
+// Writes a PNG of smooth gradients with some noise on top, which compresses about as well as
+// a real texture, and returns its path
+static std::string writeTestImage(unsigned int index, unsigned int size) {
+    std::vector<unsigned char> pixels(size_t(size) * size * 4);
+    float frequency = 0.01f + 0.002f * (index % 16);
+    for (unsigned int y = 0; y < size; y++) {
+        for (unsigned int x = 0; x < size; x++) {
+            unsigned char *pixel = &pixels[(size_t(y) * size + x) * 4];
+            float noise = 32.0f * randomUniformFloat();
+            pixel[0] = (unsigned char) (110 + 100 * std::sin(frequency * x) + noise);
+            pixel[1] = (unsigned char) (110 + 100 * std::cos(frequency * (x + y)) + noise);
+            pixel[2] = (unsigned char) (110 + 100 * std::sin(frequency * y * 1.7f) + noise);
+            pixel[3] = 255;
+        }
+    }
+    std::string path = "bench-texture-" + std::to_string(index) + ".png";
+    stbi_write_png(path.c_str(), int(size), int(size), 4, pixels.data(), int(size) * 4);
+    return path;
+}
+
+static double getFirstLevelBytes(std::vector<Texture> const &textures) {
+    double bytes = 0.0;
+    for (Texture const &texture : textures) {
+        bytes += double(texture.levels[0].size);
+    }
+    return bytes;
+}
+
+void benchmarkTextures() {
+    seedRandom(43);
+    std::vector<std::string> largePaths;
+    std::vector<std::string> allPaths;
+    for (unsigned int i = 0; i < largeTextureCount; i++) {
+        largePaths.push_back(writeTestImage(i, largeTextureSize));
+    }
+    allPaths = largePaths;
+    for (unsigned int i = 0; i < smallTextureCount; i++) {
+        allPaths.push_back(writeTestImage(largeTextureCount + i, smallTextureSize));
+    }
+
+    // Throughputs are in bytes of decoded RGBA8 pixels, so M items/s are MB/s
+    std::vector<Texture> textures = decodeTextures(largePaths);
+    double bytes = getFirstLevelBytes(textures);
+    std::string size = std::to_string(largeTextureCount) + " x " + std::to_string(largeTextureSize) + "^2";
+
+    unsigned int defaultThreadCount = getThreadCount();
+    unsigned int threadCounts[2] = { 1, defaultThreadCount };
+    for (unsigned int threads : threadCounts) {
+        setThreadCount(threads);
+        std::string suffix = ", " + std::to_string(threads) + " thread(s)";
+
+        runBenchmark("decode, " + size + suffix, 5, bytes, [&]() {
+            textures = decodeTextures(largePaths);
+        });
+        runBenchmark("box mips, " + size + suffix, 5, bytes, [&]() {
+            generateMipChains(textures, MipFilter::BOX);
+        });
+        runBenchmark("Kaiser mips, " + size + suffix, 5, bytes, [&]() {
+            generateMipChains(textures, MipFilter::KAISER);
+        });
+
+        TexturePipelineSettings settings;
+        settings.atlases.maxPackedSize = 0;
+        runBenchmark("decode + Kaiser mips, " + size + suffix, 5, bytes, [&]() {
+            processTextures(largePaths, settings);
+        });
+
+        if (threads == defaultThreadCount) break;
+    }
+    setThreadCount(defaultThreadCount);
+
+    runBenchmark("BC1 compression, " + size, 3, bytes, [&]() {
+        for (Texture const &texture : textures) {
+            compressTextureBC1(texture);
+        }
+    });
+
+    // The small textures go into atlases, and everything into a cache file
+    TexturePipelineSettings settings;
+    settings.compress = true;
+    std::string cachePath = "bench-textures.cache";
+    std::remove(cachePath.c_str());
+
+    TextureAtlasSet atlasSet;
+    runBenchmark("whole pipeline, " + std::to_string(allPaths.size()) + " textures", 3, double(allPaths.size()), [&]() {
+        atlasSet = processTextures(allPaths, settings);
+    });
+    writeTextureCache(cachePath, allPaths, settings, atlasSet);
+
+    TextureCache cache;
+    unsigned int checksum = 0;
+    runBenchmark("loading from the cache, " + std::to_string(allPaths.size()) + " textures", 20, double(allPaths.size()), [&]() {
+        if (!cache.open(cachePath) || !cache.isUpToDate(allPaths, settings)) {
+            throw std::runtime_error("The texture cache could not be used");
+        }
+        // Touch every level, as uploading them would
+        for (size_t i = 0; i < cache.getTextureCount(); i++) {
+            TextureView view = cache.getTexture(i);
+            for (size_t level = 0; level < view.levels.size(); level++) {
+                unsigned char const *data = view.getLevelData(level);
+                for (size_t offset = 0; offset < view.levels[level].size; offset += 4096) {
+                    checksum += data[offset];
+                }
+            }
+        }
+    });
+
+    printf("%-48s %10zu\n", "textures after packing", cache.getTextureCount());
+    printf("%-48s %10zu\n", "  of which atlases", atlasSet.textures.size() - atlasSet.firstAtlas);
+    printf("%-48s %10.2f MB\n", "cache file size", cache.getSizeBytes() / 1e6);
+    printf("%-48s %10u\n", "checksum", checksum);
+
+    cache.close();
+    std::remove(cachePath.c_str());
+    for (std::string const &path : allPaths) {
+        std::remove(path.c_str());
+    }
+}
@@ -0,0 +1,108 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "bench.hpp"
+#include "parallel.hpp"
+#include "sceneGraph.hpp"
+
+static const unsigned int wideNodeCount = 100000;
+static const unsigned int chainLength = 2000;
+static const unsigned int characterCount = 20000;
+
+static unsigned int countNodes(SceneNode* node) {
+    unsigned int count = 1;
+    for (SceneNode* child : node->children) {
+        count += countNodes(child);
+    }
+    return count;
+}
+
+// One parent with every node directly below it, like a crowd
+static SceneNode* createWideScene() {
+    SceneNode* root = createSceneNode();
+    for (unsigned int i = 0; i < wideNodeCount; i++) {
+        SceneNode* node = createSceneNode();
+        node->position = float3(float(i % 300) * 10, 0, float(i / 300) * 10);
+        node->rotation = float3(0, 0.001f * i, 0);
+        addChild(root, node);
+    }
+    return root;
+}
+
+// A single long chain, where nothing can be done in parallel
+static SceneNode* createDeepScene() {
+    SceneNode* root = createSceneNode();
+    SceneNode* parent = root;
+    for (unsigned int i = 0; i < chainLength; i++) {
+        SceneNode* node = createSceneNode();
+        node->position = float3(0, 1, 0);
+        node->rotation = float3(0.001f, 0, 0);
+        addChild(parent, node);
+        parent = node;
+    }
+    return root;
+}
+
+// Characters put together like Steve: a torso with a head, two arms and two legs
+static SceneNode* createCharacterScene() {
+    SceneNode* root = createSceneNode();
+    for (unsigned int i = 0; i < characterCount; i++) {
+        SceneNode* torso = createSceneNode();
+        torso->position = float3(float(i % 150) * 20, 0, float(i / 150) * 20);
+        torso->rotation = float3(0, 0.01f * i, 0);
+        addChild(root, torso);
+        for (unsigned int part = 0; part < 5; part++) {
+            SceneNode* limb = createSceneNode();
+            limb->position = float3(float(part) - 2, 12, 0);
+            limb->rotation = float3(0.1f * part, 0, 0);
+            limb->referencePoint = float3(0, 12, 0);
+            addChild(torso, limb);
+        }
+    }
+    return root;
+}
+
+void benchmarkTransforms() {
+    struct Scene {
+        char const *name;
+        SceneNode* root;
+    };
+    Scene scenes[3] = {
+        { "wide", createWideScene() },
+        { "deep", createDeepScene() },
+        { "characters", createCharacterScene() },
+    };
+
+    SceneNode* characters = scenes[2].root;
+    double characterNodes = countNodes(characters);
+    runBenchmark("computeLocalTransformation, characters", 10, characterNodes, [&]() {
+        for (SceneNode* torso : characters->children) {
+            torso->currentTransformationMatrix = computeLocalTransformation(torso);
+            for (SceneNode* limb : torso->children) {
+                limb->currentTransformationMatrix = computeLocalTransformation(limb);
+            }
+        }
+    });
+
+    unsigned int defaultThreadCount = getThreadCount();
+    for (unsigned int threads : { 1u, defaultThreadCount }) {
+        setThreadCount(threads);
+        for (Scene const &scene : scenes) {
+            double nodeCount = countNodes(scene.root);
+            std::string name = "updateNodeTransformations, " + std::string(scene.name) + ", " +
+                               std::to_string(unsigned(nodeCount) / 1000) + "k nodes, " + std::to_string(threads) + " thread(s)";
+            runBenchmark(name, 20, nodeCount, [&]() {
+                updateNodeTransformations(scene.root, glm::mat4(1));
+            });
+        }
+        if (threads == defaultThreadCount) {
+            break;
+        }
+    }
+    setThreadCount(defaultThreadCount);
+
+    printf("%-48s %016llx\n", "checksum", (unsigned long long) computeTransformationChecksum(characters));
+    for (Scene const &scene : scenes) {
+        deleteSceneNode(scene.root);
+    }
+}
@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "bench.hpp"
+#include "OBJLoader.hpp"
+
+static const unsigned int facesPerObject = 1000;
+static const size_t streamingBudgetBytes = 1 << 20;
+
+// Writes an OBJ file of objects made of strips of quads, each object with vertices of its own
+// and one shared normal, and returns its contents
+static std::string writeTestObject(std::string const &path, unsigned int faceCount) {
+    std::ostringstream contents;
+    contents << "# " << faceCount << " faces written by gloom_bench\n";
+    contents << "vn 0 1 0\n";
+    unsigned int vertexCount = 0;
+    for (unsigned int first = 0, object = 0; first < faceCount; first += facesPerObject, object++) {
+        unsigned int quads = std::min(facesPerObject, faceCount - first);
+        contents << "o strip" << object << "\n";
+        for (unsigned int i = 0; i <= quads; i++) {
+            float x = 0.5f * i;
+            float z = 2.0f * object;
+            contents << "v " << x << " 0 " << z << "\n";
+            contents << "v " << x << " 0 " << (z + 1.0f) << "\n";
+        }
+        for (unsigned int i = 0; i < quads; i++) {
+            unsigned int a = vertexCount + 2 * i + 1;
+            contents << "f " << a << "//1 " << (a + 1) << "//1 " << (a + 3) << "//1 " << (a + 2) << "//1\n";
+        }
+        vertexCount += 2 * (quads + 1);
+    }
+
+    std::string text = contents.str();
+    std::ofstream file(path, std::ios::binary);
+    file << text;
+    return text;
+}
+
+void benchmarkWavefront() {
+    unsigned int faceCount = getBenchmarkSettings().objFaceCount;
+    std::string path = "bench-wavefront.obj";
+    std::string text = writeTestObject(path, faceCount);
+    double fileBytes = double(text.size());
+    std::string size = std::to_string(faceCount / 1000) + "k faces";
+
+    std::vector<std::string> lines;
+    std::istringstream stream(text);
+    for (std::string line; std::getline(stream, line);) {
+        lines.push_back(line);
+    }
+
+    size_t partCount = 0;
+    runBenchmark("split lines, " + size, 5, double(lines.size()), fileBytes, [&]() {
+        partCount = 0;
+        for (std::string const &line : lines) {
+            partCount += split(line, " ").size();
+        }
+    });
+
+    size_t triangleCount = 0;
+    runBenchmark("loadWavefront, " + size, 3, faceCount, fileBytes, [&]() {
+        std::vector<Mesh> meshes = loadWavefront(path);
+        triangleCount = 0;
+        for (Mesh &mesh : meshes) {
+            triangleCount += mesh.faceCount();
+        }
+    });
+
+    size_t streamedMeshes = 0;
+    runBenchmark("streamWavefront, 1 MB budget, " + size, 3, faceCount, fileBytes, [&]() {
+        streamedMeshes = 0;
+        streamWavefront(path, [&](Mesh &) { streamedMeshes++; }, streamingBudgetBytes);
+    });
+
+    printf("%-48s %10.1f MB, %zu lines\n", "file", fileBytes / 1e6, lines.size());
+    printf("%-48s %10zu\n", "triangles loaded", triangleCount);
+    printf("%-48s %10zu\n", "meshes streamed", streamedMeshes);
+    std::remove(path.c_str());
+}
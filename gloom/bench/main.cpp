@@ -0,0 +1,140 @@
+// Headless benchmarks for the parts of gloom which do not need OpenGL.
+// Run without arguments to run every suite, or name the suites to run.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "bench.hpp"
+#include "memoryTracking.hpp"
+
+struct BenchmarkSuite {
+    char const *name;
+    void (*run)();
+};
+
+static const BenchmarkSuite suites[] = {
+    { "floats", benchmarkFloats },
+    { "wavefront", benchmarkWavefront },
+    { "transforms", benchmarkTransforms },
+    { "normals", benchmarkNormals },
+    { "agents", benchmarkAgents },
+    { "pathfinding", benchmarkPathfinding },
+    { "paths", benchmarkPaths },
+    { "chessboard", benchmarkChessboard },
+    { "streaming", benchmarkStreaming },
+    { "batching", benchmarkStaticBatching },
+    { "skinning", benchmarkSkinning },
+    { "textures", benchmarkTextures },
+    { "scheduler", benchmarkScheduler },
+    { "scenes", benchmarkSceneFiles },
+    { "random", benchmarkRandom },
+};
+
+static void printUsage(char const *programName) {
+    printf(
+        "Usage: %s [options] [suite...]\n"
+        "\n"
+        "Runs the named suites, or all of them.\n"
+        "\n"
+        "Options:\n"
+        "  --json <path>                 Also write the results to a JSON file\n"
+        "  --warmup <runs>               Untimed runs before each benchmark (default 1)\n"
+        "  --repetitions <factor>        Scale the number of timed runs (default 1)\n"
+        "  --obj-faces <count>           Faces in the OBJ files of the wavefront suite (default 200000)\n"
+        "  --list                        List the suites\n"
+        "  --help                        Show this message\n",
+        programName);
+}
+
+// Returns the value following an option, or exits if there is none
+static char const* requireValue(int argc, char* argv[], int &index) {
+    if (index + 1 >= argc) {
+        fprintf(stderr, "Missing value for option %s\n", argv[index]);
+        printUsage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    index++;
+    return argv[index];
+}
+
+static double requireNumber(int argc, char* argv[], int &index, bool allowZero) {
+    char const *option = argv[index];
+    char const *value = requireValue(argc, argv, index);
+    char *end;
+    double number = strtod(value, &end);
+    if (*end != '\0' || !(number > 0.0 || (allowZero && number == 0.0))) {
+        fprintf(stderr, "Option %s expects a %s number, got \"%s\"\n", option, allowZero ? "non-negative" : "positive", value);
+        exit(EXIT_FAILURE);
+    }
+    return number;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchmarkSettings &settings = getBenchmarkSettings();
+    std::string reportPath;
+    std::vector<std::string> selectedSuites;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--json") {
+            reportPath = requireValue(argc, argv, i);
+        } else if (argument == "--warmup") {
+            settings.warmupRuns = (unsigned int) requireNumber(argc, argv, i, true);
+        } else if (argument == "--repetitions") {
+            settings.repetitionScale = requireNumber(argc, argv, i, false);
+        } else if (argument == "--obj-faces") {
+            settings.objFaceCount = (unsigned int) requireNumber(argc, argv, i, false);
+        } else if (argument == "--list") {
+            for (BenchmarkSuite const &suite : suites) {
+                printf("%s\n", suite.name);
+            }
+            return EXIT_SUCCESS;
+        } else if (argument == "--help" || argument == "-h") {
+            printUsage(argv[0]);
+            return EXIT_SUCCESS;
+        } else if (argument.compare(0, 2, "--") == 0) {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        } else {
+            bool isKnown = false;
+            for (BenchmarkSuite const &suite : suites) {
+                isKnown = isKnown || argument == suite.name;
+            }
+            if (!isKnown) {
+                fprintf(stderr, "Unknown suite %s, see --list\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            selectedSuites.push_back(argument);
+        }
+    }
+
+    for (BenchmarkSuite const &suite : suites) {
+        bool selected = selectedSuites.empty();
+        for (std::string const &name : selectedSuites) {
+            selected = selected || name == suite.name;
+        }
+
+        if (selected) {
+            printf("== %s ==\n", suite.name);
+            setBenchmarkSuite(suite.name);
+            suite.run();
+        }
+    }
+
+    // Only prints anything when memory tracking is built in
+    printMemoryReport();
+
+    if (!reportPath.empty()) {
+        if (!writeBenchmarkReport(reportPath)) {
+            fprintf(stderr, "Could not write the benchmark report to %s\n", reportPath.c_str());
+            return EXIT_FAILURE;
+        }
+        printf("Wrote %zu results to %s\n", getBenchmarkResults().size(), reportPath.c_str());
+    }
+
+    return EXIT_SUCCESS;
+}
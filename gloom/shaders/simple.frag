@@ -1,7 +1,7 @@
 #version 430 core
 
 out vec4 color;
-in vec4 fragmentColor;
+flat in vec4 fragmentColor;
 
 void main()
 {
@@ -2,13 +2,34 @@
 
 in vec4 position;
 in vec4 vertexColor;
-out vec4 fragmentColor;
+// The bones moving the vertex of a skinned mesh, and how much each of them moves it
+in vec4 boneIndices;
+in vec4 boneWeights;
+// Colours are not interpolated, so each triangle has the colour of its last vertex. This lets
+// neighbouring chessboard tiles share vertices while keeping sharp edges between them.
+flat out vec4 fragmentColor;
 
 uniform mat4x4 transformMatrix;
 
+// The transformations of the bones of a skinned mesh, relative to the mesh. The size matches
+// maxBoneCount in skinning.hpp.
+uniform bool isSkinned;
+uniform mat4x4 bonePalette[16];
+
 
 void main()
 {
 	fragmentColor = vertexColor;
-    gl_Position = transformMatrix * position;
+
+	vec4 skinnedPosition = position;
+	if (isSkinned)
+	{
+		mat4x4 skinning = bonePalette[int(boneIndices.x)] * boneWeights.x +
+		                  bonePalette[int(boneIndices.y)] * boneWeights.y +
+		                  bonePalette[int(boneIndices.z)] * boneWeights.z +
+		                  bonePalette[int(boneIndices.w)] * boneWeights.w;
+		skinnedPosition = skinning * position;
+	}
+
+    gl_Position = transformMatrix * skinnedPosition;
 }
@@ -1,6 +1,12 @@
 #include "OBJLoader.hpp"
 #include <algorithm>
+#include <deque>
 #include <exception>
+#include <iterator>
+#include <stdexcept>
+#include "memoryTracking.hpp"
+#include "meshNormals.hpp"
+#include "parallel.hpp"
 #include "sceneGraph.hpp"
 #include "toolbox.hpp"
 
@@ -16,12 +22,101 @@ std::vector<std::string> split(std::string target, std::string delimiter)
 	return res;
 }
 
-std::vector<Mesh> loadWavefront(std::string const srcFile, bool quiet)
+// Number of bytes of working memory used by a mesh which is being built
+static size_t meshBytes(Mesh const &mesh) {
+	return mesh.vertices.size() * sizeof(float4) +
+	       mesh.colours.size() * sizeof(float4) +
+	       mesh.normals.size() * sizeof(float3) +
+	       mesh.textureCoordinates.size() * sizeof(float2) +
+	       mesh.indices.size() * sizeof(unsigned int);
+}
+
+// Does the work of streamWavefront(). Generating the missing normals may be left to the caller,
+// so that it can do so in parallel with reading the next objects.
+static void readWavefront(std::string const srcFile, MeshCallback onMeshLoaded, size_t memoryBudgetBytes, bool quiet, bool generateNormals)
 {
-	std::vector<Mesh> meshes;
+	// The lines, their parts and the vertices read so far are counted as loader memory, while the
+	// caller goes on counting under its own tag
+	MemoryTag callerTag = getCurrentMemoryTag();
+	MemoryTagScope loaderScope(MEMORY_TAG_LOADER);
+
 	std::ifstream objFile(srcFile);
+
+	// The vertices, normals and texture coordinates read so far. Entries are only kept from the index
+	// vertexBase/normalBase/texcoordBase onwards; older ones may be discarded to stay within the memory budget.
 	std::vector<float4> vertices;
 	std::vector<float3> normals;
+	std::vector<float2> texcoords;
+	size_t vertexBase = 0;
+	size_t normalBase = 0;
+	size_t texcoordBase = 0;
+
+	// The object currently being read, and the number of vertices, normals and texture
+	// coordinates which had been read when it started
+	Mesh mesh("noname");
+	bool hasMesh = false;
+	size_t meshVertexStart = 0;
+	size_t meshNormalStart = 0;
+	size_t meshTexcoordStart = 0;
+	bool meshWasSplit = false;
+	bool budgetWarningShown = false;
+
+	// Hands the current mesh over to the caller, who is free to move it out.
+	// Objects without normals get smooth ones generated, instead of the zero placeholders, unless
+	// that was left to the caller.
+	// The placeholder texture coordinates of objects without any are dropped.
+	auto finishMesh = [&]() {
+		if (!mesh.hasTextureCoordinates) {
+			mesh.textureCoordinates.clear();
+		}
+		if (generateNormals && !mesh.hasNormals && !mesh.indices.empty()) {
+			generateSmoothNormals(mesh);
+		}
+		std::string name = mesh.name;
+		{
+			MemoryTagScope callerScope(callerTag);
+			onMeshLoaded(mesh);
+		}
+		mesh = Mesh(name);
+	};
+
+	// Discards data to get back below the memory budget. Vertices and normals of objects which
+	// have been completed go first, since faces usually only refer to those of their own object.
+	// If that is not enough, the current object is passed on in several pieces.
+	auto readBytes = [&]() {
+		return vertices.size() * sizeof(float4) + normals.size() * sizeof(float3) + texcoords.size() * sizeof(float2);
+	};
+	auto enforceMemoryBudget = [&]() {
+		if (memoryBudgetBytes == 0) {
+			return;
+		}
+
+		size_t workingBytes = readBytes() + meshBytes(mesh);
+		if (workingBytes <= memoryBudgetBytes) {
+			return;
+		}
+
+		if (meshVertexStart > vertexBase || meshNormalStart > normalBase || meshTexcoordStart > texcoordBase) {
+			vertices.erase(vertices.begin(), vertices.begin() + (meshVertexStart - vertexBase));
+			normals.erase(normals.begin(), normals.begin() + (meshNormalStart - normalBase));
+			texcoords.erase(texcoords.begin(), texcoords.begin() + (meshTexcoordStart - texcoordBase));
+			vertexBase = meshVertexStart;
+			normalBase = meshNormalStart;
+			texcoordBase = meshTexcoordStart;
+			workingBytes = readBytes() + meshBytes(mesh);
+		}
+
+		if (workingBytes > memoryBudgetBytes && !mesh.indices.empty()) {
+			finishMesh();
+			meshWasSplit = true;
+			workingBytes = readBytes();
+		}
+
+		if (workingBytes > memoryBudgetBytes && !budgetWarningShown && !quiet) {
+			std::cout << "[WARNING] object " << mesh.name << " alone needs more memory than the budget of " << memoryBudgetBytes << " bytes" << std::endl;
+			budgetWarningShown = true;
+		}
+	};
 
 	if (objFile.is_open()) {
 		std::string line;
@@ -31,7 +126,16 @@ std::vector<Mesh> loadWavefront(std::string const srcFile, bool quiet)
 			if (parts.size() > 0) {
 				// New Mesh object
 				if (parts.at(0) == "o" && parts.size() >= 2) {
-					meshes.emplace_back(parts.at(1));
+					if (hasMesh && !(meshWasSplit && mesh.indices.empty())) {
+						finishMesh();
+					}
+					mesh = Mesh(parts.at(1));
+					hasMesh = true;
+					meshWasSplit = false;
+					meshVertexStart = vertexBase + vertices.size();
+					meshNormalStart = normalBase + normals.size();
+					meshTexcoordStart = texcoordBase + texcoords.size();
+					enforceMemoryBudget();
 				} else if (parts.at(0) == "v" && parts.size() >= 4) {
 					vertices.emplace_back(
 						std::stof(parts.at(1)),
@@ -39,24 +143,30 @@ std::vector<Mesh> loadWavefront(std::string const srcFile, bool quiet)
 						std::stof(parts.at(3)),
 						(parts.size() >= 5) ? std::stof(parts.at(4)) : 1.0f
 					);
+					enforceMemoryBudget();
 				} else if (parts.at(0) == "vn" && parts.size() >= 4) {
 				   normals.emplace_back(
 					   std::stof(parts.at(1)),
 					   std::stof(parts.at(2)),
 					   std::stof(parts.at(3))
 				   );
+				   enforceMemoryBudget();
+			   } else if (parts.at(0) == "vt" && parts.size() >= 3) {
+				   texcoords.emplace_back(
+					   std::stof(parts.at(1)),
+					   std::stof(parts.at(2))
+				   );
+				   enforceMemoryBudget();
 			   } else if (parts.at(0) == "f" && parts.size() >= 4) {
-				   if (meshes.size() == 0) {
+				   if (!hasMesh) {
 					   if (!quiet) {
 						   	std::cout << "[WARNING] face definition found, but no object" << std::endl;
 							std::cout << "[WARNING] creating object 'noname'" << std::endl;
 					   }
-					   meshes.emplace_back("noname");
+					   hasMesh = true;
 					   //continue;
 				   }
 
-				   	Mesh &mesh = meshes.back();
-
 					bool quadruple = parts.size() >= 5;
 
 					std::vector<std::string> parts1 = split(parts.at(1),"/");
@@ -74,9 +184,12 @@ std::vector<Mesh> loadWavefront(std::string const srcFile, bool quiet)
 					}
 
 					mesh.hasNormals = parts1.size() >= 3;
+					// Faces given as "v//vn" have an empty texture coordinate index
+					bool hasTexcoords = parts1.size() >= 2 && !parts1.at(1).empty();
 					
-					size_t n1_index, n2_index, n3_index, n4_index;
-					size_t v4_index;
+					size_t n1_index = 0, n2_index = 0, n3_index = 0, n4_index = 0;
+					size_t t1_index = 0, t2_index = 0, t3_index = 0, t4_index = 0;
+					size_t v4_index = 0;
 					size_t v1_index = std::stoi(parts1.at(0)) - 1;
 					size_t v2_index = std::stoi(parts2.at(0)) - 1;
 					size_t v3_index = std::stoi(parts3.at(0)) - 1;
@@ -85,10 +198,11 @@ std::vector<Mesh> loadWavefront(std::string const srcFile, bool quiet)
 						v4_index = std::stoi(parts4.at(0)) - 1;
 					}
 
-					if (v1_index >= vertices.size() ||
-						v2_index >= vertices.size() ||
-						v3_index >= vertices.size() ||
-						(quadruple && v4_index >= vertices.size())) {
+					size_t vertexEnd = vertexBase + vertices.size();
+					if (v1_index >= vertexEnd ||
+						v2_index >= vertexEnd ||
+						v3_index >= vertexEnd ||
+						(quadruple && v4_index >= vertexEnd)) {
 								if (!quiet) {
 									std::cout << "[WARNING] Mesh " << mesh.name << " faces vertices(" << v1_index << ", " << v2_index << ", " << v3_index;
 									if (quadruple)
@@ -98,6 +212,16 @@ std::vector<Mesh> loadWavefront(std::string const srcFile, bool quiet)
 								continue;
 					}
 
+					if (v1_index < vertexBase ||
+						v2_index < vertexBase ||
+						v3_index < vertexBase ||
+						(quadruple && v4_index < vertexBase)) {
+								if (!quiet) {
+									std::cout << "[WARNING] Mesh " << mesh.name << " refers to vertices which were discarded to stay within the memory budget" << std::endl;
+								}
+								continue;
+					}
+
 
 					if (mesh.hasNormals) {
 						n1_index = std::stoi(parts1.at(2)) - 1;
@@ -106,10 +230,11 @@ std::vector<Mesh> loadWavefront(std::string const srcFile, bool quiet)
 						if (quadruple) {
 							n4_index = std::stoi(parts4.at(2)) - 1;
 						}
-						if (n1_index >= normals.size() ||
-							n2_index >= normals.size() ||
-							n3_index >= normals.size() ||
-							(quadruple && n4_index >= normals.size())) {
+						size_t normalEnd = normalBase + normals.size();
+						if (n1_index >= normalEnd ||
+							n2_index >= normalEnd ||
+							n3_index >= normalEnd ||
+							(quadruple && n4_index >= normalEnd)) {
 									if (!quiet) {
 										std::cout << "[WARNING] Mesh " << mesh.name << " faces normals(" << n1_index << ", " << n2_index << ", " << n3_index;
 										if (quadruple)
@@ -118,19 +243,68 @@ std::vector<Mesh> loadWavefront(std::string const srcFile, bool quiet)
 									}
 									continue;
 						}
+						if (n1_index < normalBase ||
+							n2_index < normalBase ||
+							n3_index < normalBase ||
+							(quadruple && n4_index < normalBase)) {
+									if (!quiet) {
+										std::cout << "[WARNING] Mesh " << mesh.name << " refers to normals which were discarded to stay within the memory budget" << std::endl;
+									}
+									continue;
+						}
+					}
+
+					if (hasTexcoords) {
+						t1_index = std::stoi(parts1.at(1)) - 1;
+						t2_index = std::stoi(parts2.at(1)) - 1;
+						t3_index = std::stoi(parts3.at(1)) - 1;
+						if (quadruple) {
+							t4_index = std::stoi(parts4.at(1)) - 1;
+						}
+						size_t texcoordEnd = texcoordBase + texcoords.size();
+						if (t1_index >= texcoordEnd ||
+							t2_index >= texcoordEnd ||
+							t3_index >= texcoordEnd ||
+							(quadruple && t4_index >= texcoordEnd)) {
+									if (!quiet) {
+										std::cout << "[WARNING] Mesh " << mesh.name << " faces texture coordinates(" << t1_index << ", " << t2_index << ", " << t3_index;
+										if (quadruple)
+											std::cout << ", " << t4_index;
+										std::cout << ") do not exist!" << std::endl;
+									}
+									continue;
+						}
+						if (t1_index < texcoordBase ||
+							t2_index < texcoordBase ||
+							t3_index < texcoordBase ||
+							(quadruple && t4_index < texcoordBase)) {
+									if (!quiet) {
+										std::cout << "[WARNING] Mesh " << mesh.name << " refers to texture coordinates which were discarded to stay within the memory budget" << std::endl;
+									}
+									continue;
+						}
+						mesh.hasTextureCoordinates = true;
 					}
 
 					if (quadruple) {
-						mesh.vertices.push_back(vertices.at(v1_index));
-						mesh.vertices.push_back(vertices.at(v3_index));
-						mesh.vertices.push_back(vertices.at(v4_index));
+						mesh.vertices.push_back(vertices.at(v1_index - vertexBase));
+						mesh.vertices.push_back(vertices.at(v3_index - vertexBase));
+						mesh.vertices.push_back(vertices.at(v4_index - vertexBase));
 						
 						if (mesh.hasNormals) {
-							mesh.normals.push_back(normals.at(n1_index));
-							mesh.normals.push_back(normals.at(n3_index));
-							mesh.normals.push_back(normals.at(n4_index));
+							mesh.normals.push_back(normals.at(n1_index - normalBase));
+							mesh.normals.push_back(normals.at(n3_index - normalBase));
+							mesh.normals.push_back(normals.at(n4_index - normalBase));
 						} else {
-							mesh.normals.insert(mesh.normals.end(), { 0.0f, 0.0f, 0.0f });
+							mesh.normals.insert(mesh.normals.end(), 3, float3(0.0f, 0.0f, 0.0f));
+						}
+
+						if (hasTexcoords) {
+							mesh.textureCoordinates.push_back(texcoords.at(t1_index - texcoordBase));
+							mesh.textureCoordinates.push_back(texcoords.at(t3_index - texcoordBase));
+							mesh.textureCoordinates.push_back(texcoords.at(t4_index - texcoordBase));
+						} else {
+							mesh.textureCoordinates.insert(mesh.textureCoordinates.end(), 3, float2(0.0f, 0.0f));
 						}
 
 						mesh.indices.push_back(unsigned(mesh.indices.size()));
@@ -138,28 +312,78 @@ std::vector<Mesh> loadWavefront(std::string const srcFile, bool quiet)
 						mesh.indices.push_back(unsigned(mesh.indices.size()));
 					}
 
-					mesh.vertices.push_back(vertices.at(v1_index));
-					mesh.vertices.push_back(vertices.at(v2_index));
-					mesh.vertices.push_back(vertices.at(v3_index));
+					mesh.vertices.push_back(vertices.at(v1_index - vertexBase));
+					mesh.vertices.push_back(vertices.at(v2_index - vertexBase));
+					mesh.vertices.push_back(vertices.at(v3_index - vertexBase));
 					if (mesh.hasNormals){
-						mesh.normals.push_back(normals.at(n1_index));
-						mesh.normals.push_back(normals.at(n2_index));
-						mesh.normals.push_back(normals.at(n3_index));
+						mesh.normals.push_back(normals.at(n1_index - normalBase));
+						mesh.normals.push_back(normals.at(n2_index - normalBase));
+						mesh.normals.push_back(normals.at(n3_index - normalBase));
+					} else {
+						mesh.normals.insert(mesh.normals.end(), 3, float3(0.0f, 0.0f, 0.0f));
+					}
+					if (hasTexcoords) {
+						mesh.textureCoordinates.push_back(texcoords.at(t1_index - texcoordBase));
+						mesh.textureCoordinates.push_back(texcoords.at(t2_index - texcoordBase));
+						mesh.textureCoordinates.push_back(texcoords.at(t3_index - texcoordBase));
 					} else {
-						mesh.normals.insert(mesh.normals.end(), { 0.0f, 0.0f, 0.0f });
+						mesh.textureCoordinates.insert(mesh.textureCoordinates.end(), 3, float2(0.0f, 0.0f));
 					}
 
 					mesh.indices.push_back(unsigned(mesh.indices.size()));
 					mesh.indices.push_back(unsigned(mesh.indices.size()));
 					mesh.indices.push_back(unsigned(mesh.indices.size()));
+
+					enforceMemoryBudget();
 				}
 			}
 		}
+
+		// The last piece of a split object may turn out to be empty
+		if (hasMesh && !(meshWasSplit && mesh.indices.empty())) {
+			finishMesh();
+		}
 	} else {
 		throw std::runtime_error("Reading OBJ file failed. This is usually because the operating system can't find it. Check if the relative path (to your terminal's working directory) is correct.");
 	}
+}
 
-	return meshes;
+void streamWavefront(std::string const srcFile, MeshCallback onMeshLoaded, size_t memoryBudgetBytes, bool quiet)
+{
+	readWavefront(srcFile, onMeshLoaded, memoryBudgetBytes, quiet, true);
+}
+
+std::vector<Mesh> loadWavefront(std::string const srcFile, bool quiet)
+{
+	// The normals of each object are generated by a job of its own while the next objects are
+	// being read. A deque keeps the meshes in place as more are added.
+	JobSystem &jobSystem = getJobSystem();
+	std::deque<Mesh> meshes;
+	std::vector<JobHandle> normalJobs;
+	auto waitForNormals = [&]() {
+		for (JobHandle const &job : normalJobs) {
+			jobSystem.wait(job);
+		}
+	};
+
+	try {
+		readWavefront(srcFile, [&](Mesh &mesh) {
+			meshes.push_back(std::move(mesh));
+			Mesh *loaded = &meshes.back();
+			if (!loaded->hasNormals && !loaded->indices.empty()) {
+				normalJobs.push_back(jobSystem.run([loaded]() {
+					generateSmoothNormals(*loaded);
+				}));
+			}
+		}, 0, quiet, false);
+	} catch (...) {
+		// The jobs still refer to the meshes
+		waitForNormals();
+		throw;
+	}
+
+	waitForNormals();
+	return std::vector<Mesh>(std::make_move_iterator(meshes.begin()), std::make_move_iterator(meshes.end()));
 }
 
 // This function assumes a mesh with rectangular sides (pairs of triangles), and assigns each side random colours.
@@ -169,22 +393,25 @@ void colourFaces(Mesh &mesh) {
 	int sides = mesh.faceCount() / 2;
 
 	// Allocate capacity
-	mesh.colours.resize(mesh.vertices.size(), 0);
+	mesh.colours.resize(mesh.vertices.size(), float4(0));
 
-	for(int side = 0; side < sides; side++) {
-		float rand_red = randomUniformFloat();
-		float rand_green = randomUniformFloat();
-		float rand_blue = randomUniformFloat();
-
-		float4 randomColour(rand_red, rand_green, rand_blue, 1.0);
-
-		mesh.colours.at(side * 6 + 0) = randomColour;
-		mesh.colours.at(side * 6 + 1) = randomColour;
-		mesh.colours.at(side * 6 + 2) = randomColour;
-		mesh.colours.at(side * 6 + 3) = randomColour;
-		mesh.colours.at(side * 6 + 4) = randomColour;
-		mesh.colours.at(side * 6 + 5) = randomColour;
+	if (mesh.colours.size() < size_t(sides) * 6) {
+		throw std::out_of_range("colourFaces() expects every side to have six vertices of its own");
 	}
+
+	// Each piece of sides draws its colours from a stream of its own, picked by the index of the piece.
+	// The colours then only depend on the seed, however many threads share the work.
+	static const size_t sidesPerPiece = 4096;
+	uint64_t seed = getThreadRandomStream().nextUint64();
+	parallelFor(0, sides, sidesPerPiece, [&](size_t first, size_t last) {
+		RandomStream random(seed, first / sidesPerPiece);
+		for (size_t side = first; side < last; side++) {
+			float rand_red = random.nextFloat();
+			float rand_green = random.nextFloat();
+			float rand_blue = random.nextFloat();
+			std::fill(&mesh.colours[side * 6], &mesh.colours[side * 6] + 6, float4(rand_red, rand_green, rand_blue, 1.0));
+		}
+	});
 }
 
 MinecraftCharacter loadMinecraftCharacterModel(std::string const srcFile) {
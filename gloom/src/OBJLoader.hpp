@@ -7,6 +7,7 @@
 #include <fstream>
 #include <sstream>
 #include <limits>
+#include <functional>
 #include "floats.hpp"
 #include "mesh.hpp"
 
@@ -21,4 +22,22 @@ struct MinecraftCharacter {
 
 MinecraftCharacter loadMinecraftCharacterModel(std::string const srcFile); 
 
-std::vector<Mesh> loadWavefront(std::string const srcFile, bool quiet = true);
\ No newline at end of file
+// Called by streamWavefront() for each object as soon as it has been read completely.
+// The mesh may be moved out of the reference, for instance to upload it and free the memory.
+typedef std::function<void(Mesh &mesh)> MeshCallback;
+
+// Splits a string at every occurrence of the delimiter. Used to read the lines of OBJ files.
+std::vector<std::string> split(std::string target, std::string delimiter);
+
+// Reads an OBJ file object by object, handing each one to a callback rather than keeping them all.
+// If memoryBudgetBytes is nonzero, the loader keeps its working memory (vertices and normals read so far,
+// plus the object being built) below that size. It does this by discarding the vertices and normals of
+// earlier objects, and if that is not enough, by passing a large object on in several meshes with the same name.
+// Faces which refer to discarded vertices are skipped with a warning.
+void streamWavefront(std::string const srcFile, MeshCallback onMeshLoaded, size_t memoryBudgetBytes = 0, bool quiet = true);
+
+// Reads all objects in an OBJ file at once.
+std::vector<Mesh> loadWavefront(std::string const srcFile, bool quiet = true);
+
+// Gives each side (pair of triangles) of a mesh with unshared vertices a random colour
+void colourFaces(Mesh &mesh);
\ No newline at end of file
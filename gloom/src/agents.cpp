@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <cmath>
+#include "agents.hpp"
+#include "parallel.hpp"
+
+// Number of agents each thread handles at a time
+static const size_t grainSize = 1024;
+
+// Scratch space kept from one update to the next, so that updating allocates nothing once the
+// crowd has stopped growing. Each thread updating agents has its own. The neighbour lists are
+// filled on the job system's threads, one list for each piece of the crowd, and are all sized by
+// the updating thread, so the workers never allocate.
+static thread_local std::vector<float2> scratchPositions;
+static thread_local std::vector<float2> scratchVelocities;
+static thread_local std::vector<std::vector<Neighbour>> scratchNeighbourLists;
+static thread_local std::vector<float> scratchSpeeds;
+static thread_local std::vector<float2> scratchTargets;
+static thread_local std::vector<float2> scratchHeadings;
+
+static float length(float2 v) {
+    return std::sqrt(v.x * v.x + v.y * v.y);
+}
+
+// Shortens a vector to at most the given length
+static float2 truncate(float2 v, float maximumLength) {
+    float vectorLength = length(v);
+    if (vectorLength > maximumLength) {
+        v *= maximumLength / vectorLength;
+    }
+    return v;
+}
+
+// Runs the steering pass shared by both ways of updating agents: each agent wants to move at
+// the velocity given by desiredVelocity(agent, index), while keeping its distance from the others.
+// Leaves the agents' new velocities in velocities and their positions in positions.
+template <typename DesiredVelocity>
+static void steerAgents(std::vector<Agent> const &agents, SpatialGrid &grid, SteeringParameters const &parameters,
+                        float timeStep, DesiredVelocity const &desiredVelocity,
+                        std::vector<float2> &positions, std::vector<float2> &velocities) {
+    size_t agentCount = agents.size();
+    positions.resize(agentCount);
+    for (size_t agent = 0; agent < agentCount; agent++) {
+        positions[agent] = agents[agent].position;
+    }
+    grid.rebuild(positions);
+
+    velocities.resize(agentCount);
+    float separationRadiusSquared = parameters.separationRadius * parameters.separationRadius;
+
+    // Only ever holds the nearest maxNeighbours, so that is all the room a list needs
+    std::vector<std::vector<Neighbour>> &neighbourLists = scratchNeighbourLists;
+    neighbourLists.resize(std::max(neighbourLists.size(), (agentCount + grainSize - 1) / grainSize));
+    for (std::vector<Neighbour> &neighbours : neighbourLists) {
+        neighbours.reserve(parameters.maxNeighbours);
+    }
+
+    parallelFor(0, agentCount, grainSize, [&](size_t first, size_t last) {
+        std::vector<Neighbour> &neighbours = neighbourLists[first / grainSize];
+
+        for (size_t index = first; index < last; index++) {
+            Agent const &agent = agents[index];
+            float2 steering = desiredVelocity(agent, index) - agent.velocity;
+
+            // Separation: move away from the nearest agents which are too close. The search stops
+            // at the separation radius, and leaves the agent itself out, so it takes no place.
+            float2 separation(0, 0);
+            grid.queryNearest(agent.position, parameters.maxNeighbours, neighbours, unsigned(index),
+                              parameters.separationRadius);
+            for (Neighbour const &neighbour : neighbours) {
+                if (neighbour.distanceSquared >= separationRadiusSquared) {
+                    continue;
+                }
+                float neighbourDistance = std::sqrt(neighbour.distanceSquared);
+                float strength = 1.0f - neighbourDistance / parameters.separationRadius;
+                if (neighbourDistance > 0.0f) {
+                    separation += (agent.position - positions[neighbour.id]) * (strength / neighbourDistance);
+                } else {
+                    // Agents in exactly the same place are pushed apart in opposite directions
+                    separation += float2(index < neighbour.id ? strength : -strength, 0.0f);
+                }
+            }
+            steering += separation * (parameters.maxSpeed * parameters.separationWeight);
+
+            steering = truncate(steering, parameters.maxAcceleration);
+            velocities[index] = truncate(agent.velocity + steering * timeStep, parameters.maxSpeed);
+        }
+    });
+}
+
+// Seek: head straight for a point at full speed
+static float2 seek(float2 position, float2 target, float maxSpeed) {
+    float2 toTarget = target - position;
+    float distance = length(toTarget);
+    if (distance > 0.0f) {
+        return toTarget * (maxSpeed / distance);
+    }
+    return float2(0, 0);
+}
+
+void updateAgents(std::vector<Agent> &agents, Path const &path, SpatialGrid &grid,
+                  SteeringParameters const &parameters, double deltaTime) {
+    size_t agentCount = agents.size();
+    if (agentCount == 0 || path.getWaypointCount() == 0) {
+        return;
+    }
+    float tileWidth = grid.getTileWidth();
+    float timeStep = float(deltaTime);
+
+    std::vector<float2> &positions = scratchPositions;
+    std::vector<float2> &velocities = scratchVelocities;
+    steerAgents(agents, grid, parameters, timeStep, [&](Agent const &agent, size_t) {
+        return seek(agent.position, path.getWaypoint(agent.waypoint, tileWidth), parameters.maxSpeed);
+    }, positions, velocities);
+
+    float waypointRadius = parameters.waypointRadiusInTiles * tileWidth;
+    unsigned int waypointCount = path.getWaypointCount();
+
+    parallelFor(0, agentCount, grainSize, [&](size_t first, size_t last) {
+        for (size_t index = first; index < last; index++) {
+            Agent &agent = agents[index];
+            agent.velocity = velocities[index];
+            agent.position += agent.velocity * timeStep;
+
+            if (length(path.getWaypoint(agent.waypoint, tileWidth) - agent.position) < waypointRadius) {
+                agent.waypoint = (agent.waypoint + 1) % waypointCount;
+            }
+        }
+    });
+}
+
+void updateAgents(std::vector<Agent> &agents, CompiledPath const &path, std::vector<PathCursor> &cursors,
+                  SpatialGrid &grid, SteeringParameters const &parameters, double deltaTime) {
+    size_t agentCount = agents.size();
+    if (agentCount == 0) {
+        return;
+    }
+    float timeStep = float(deltaTime);
+    float lead = parameters.pathLeadInTiles * grid.getTileWidth();
+
+    // The points of the agents which have fallen behind wait for them
+    std::vector<float> &speeds = scratchSpeeds;
+    speeds.resize(agentCount);
+    parallelFor(0, agentCount, grainSize, [&](size_t first, size_t last) {
+        for (size_t index = first; index < last; index++) {
+            float2 target;
+            float2 heading;
+            path.sample(cursors[index], target, heading);
+            speeds[index] = length(target - agents[index].position) < lead ? parameters.maxSpeed : 0.0f;
+        }
+    });
+    std::vector<float2> &targets = scratchTargets;
+    path.advance(cursors, speeds, timeStep, targets, scratchHeadings);
+
+    std::vector<float2> &positions = scratchPositions;
+    std::vector<float2> &velocities = scratchVelocities;
+    steerAgents(agents, grid, parameters, timeStep, [&](Agent const &agent, size_t index) {
+        return seek(agent.position, targets[index], parameters.maxSpeed);
+    }, positions, velocities);
+
+    parallelFor(0, agentCount, grainSize, [&](size_t first, size_t last) {
+        for (size_t index = first; index < last; index++) {
+            agents[index].velocity = velocities[index];
+            agents[index].position += velocities[index] * timeStep;
+        }
+    });
+}
+
+void updateAgents(std::vector<Agent> &agents, FlowField const &flowField, SpatialGrid &grid,
+                  SteeringParameters const &parameters, double deltaTime) {
+    size_t agentCount = agents.size();
+    if (agentCount == 0) {
+        return;
+    }
+    float tileWidth = grid.getTileWidth();
+    float timeStep = float(deltaTime);
+    int2 goal = flowField.getGoal();
+    float2 goalPosition(goal.x * tileWidth, goal.y * tileWidth);
+
+    std::vector<float2> &positions = scratchPositions;
+    std::vector<float2> &velocities = scratchVelocities;
+    steerAgents(agents, grid, parameters, timeStep, [&](Agent const &agent, size_t) {
+        // The field stops at the goal tile, from where agents head for its middle
+        float2 direction = flowField.getDirection(agent.position, tileWidth);
+        int2 tile = grid.getTile(agent.position);
+        if (direction.x == 0.0f && direction.y == 0.0f && tile.x == goal.x && tile.y == goal.y) {
+            return seek(agent.position, goalPosition, parameters.maxSpeed);
+        }
+        return direction * parameters.maxSpeed;
+    }, positions, velocities);
+
+    parallelFor(0, agentCount, grainSize, [&](size_t first, size_t last) {
+        for (size_t index = first; index < last; index++) {
+            agents[index].velocity = velocities[index];
+            agents[index].position += velocities[index] * timeStep;
+        }
+    });
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include "compiledPath.hpp"
+#include "floats.hpp"
+#include "flowField.hpp"
+#include "spatialGrid.hpp"
+#include "toolbox.hpp"
+
+// A character walking along a path on the chessboard.
+struct Agent {
+    float2 position;
+    float2 velocity;
+    // The index of the waypoint the agent is walking towards, when following a Path
+    unsigned int waypoint;
+};
+
+struct SteeringParameters {
+    // In units per second, and units per second squared
+    float maxSpeed = 20.0f;
+    float maxAcceleration = 80.0f;
+
+    // Agents closer to each other than separationRadius push each other apart, harder the
+    // closer they are. Only the maxNeighbours nearest agents are taken into account.
+    float separationRadius = 6.0f;
+    float separationWeight = 2.0f;
+    unsigned int maxNeighbours = 8;
+
+    // How close to a waypoint an agent has to come before moving on to the next one, in tiles.
+    // Agents walking in a group can not all reach the same point, so this is fairly large.
+    float waypointRadiusInTiles = 0.5f;
+
+    // How far ahead of an agent its point on a CompiledPath may run, in tiles. The point waits
+    // for agents which fall further behind, such as those held up by the crowd.
+    float pathLeadInTiles = 1.0f;
+};
+
+// Moves a group of agents one time step along a path. Each agent steers towards its
+// waypoint while keeping its distance from the agents around it.
+//
+// The neighbours are found with the grid, which is rebuilt from the agents' positions first,
+// so the cost grows with the number of agents rather than its square. The agents are updated
+// on several threads, each reading only the state from before the step, so the result is the
+// same regardless of the number of threads. The working space is kept between updates, so once
+// the crowd has stopped growing, updating it allocates no memory.
+void updateAgents(std::vector<Agent> &agents, Path const &path, SpatialGrid &grid,
+                  SteeringParameters const &parameters, double deltaTime);
+
+// Same as above, except that the agents follow the smooth curve of a CompiledPath. Each agent
+// chases a point of its own along the curve, at cursors[i], which CompiledPath::advance()
+// moves on at the agents' top speed while the agent keeps up with it. The cursors have to be
+// as many as the agents, and can start out anywhere along the path.
+void updateAgents(std::vector<Agent> &agents, CompiledPath const &path, std::vector<PathCursor> &cursors,
+                  SpatialGrid &grid, SteeringParameters const &parameters, double deltaTime);
+
+// Same as above, except that the agents follow a flow field towards its goal instead of a path.
+// Agents on tiles from which the goal can not be reached stop.
+void updateAgents(std::vector<Agent> &agents, FlowField const &flowField, SpatialGrid &grid,
+                  SteeringParameters const &parameters, double deltaTime);
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include "chessboard.hpp"
+#include "parallel.hpp"
+
+// Roughly how many vertices each thread generates at a time
+static const size_t verticesPerPiece = 16384;
+
+// Allocates the storage for a grid of width by height tiles without filling it in
+static void allocateGrid(Mesh &mesh, unsigned int width, unsigned int height) {
+    size_t vertexCount = size_t(width + 1) * (height + 1);
+    mesh.vertices.resize(vertexCount);
+    mesh.colours.resize(vertexCount);
+    mesh.indices.resize(size_t(width) * height * 6);
+    mesh.hasNormals = false;
+}
+
+// Fills in rows [firstRow, lastRow) of vertices of a grid allocated by allocateGrid(), along
+// with the row of tiles above each of them. Different rows can be filled at the same time.
+static void fillGridRows(Mesh &mesh, int2 firstTile, unsigned int width, unsigned int height,
+                         unsigned int firstRow, unsigned int lastRow,
+                         float tileWidth, float4 tileColour1, float4 tileColour2) {
+    unsigned int rowLength = width + 1;
+
+    for (unsigned int row = firstRow; row < lastRow; row++) {
+        int y = firstTile.y + int(row);
+        float z = (float(y) - 0.5f) * tileWidth;
+
+        // Each vertex is the corner with the lowest coordinates of tile (x, y), and has its colour
+        size_t vertexIndex = size_t(row) * rowLength;
+        for (unsigned int column = 0; column < rowLength; column++, vertexIndex++) {
+            int x = firstTile.x + int(column);
+            bool tileColourType = ((x ^ y) & 1) == 1;
+            mesh.vertices[vertexIndex] = float4((float(x) - 0.5f) * tileWidth, 0, z, 1);
+            mesh.colours[vertexIndex] = tileColourType ? tileColour1 : tileColour2;
+        }
+
+        if (row == height) {
+            continue;
+        }
+
+        // The tile's own corner comes last in both triangles, since that is the vertex the
+        // colour of a flat shaded triangle is taken from
+        unsigned int *indices = &mesh.indices[size_t(row) * width * 6];
+        for (unsigned int column = 0; column < width; column++) {
+            unsigned int bottomLeft = unsigned(size_t(row) * rowLength + column);
+            unsigned int bottomRight = bottomLeft + 1;
+            unsigned int topLeft = bottomLeft + rowLength;
+            unsigned int topRight = topLeft + 1;
+
+            *indices++ = topRight;
+            *indices++ = bottomRight;
+            *indices++ = bottomLeft;
+            *indices++ = topLeft;
+            *indices++ = topRight;
+            *indices++ = bottomLeft;
+        }
+    }
+}
+
+Mesh generateChessboardGrid(unsigned int width, unsigned int height, float tileWidth, float4 tileColour1, float4 tileColour2) {
+    Mesh mesh("Chessboard terrain");
+    if (width == 0 || height == 0) {
+        return mesh;
+    }
+    allocateGrid(mesh, width, height);
+
+    int2 firstTile = { 0, 0 };
+    size_t rowsPerPiece = std::max<size_t>(1, verticesPerPiece / (width + 1));
+    parallelFor(0, height + 1, rowsPerPiece, [&](size_t firstRow, size_t lastRow) {
+        fillGridRows(mesh, firstTile, width, height, unsigned(firstRow), unsigned(lastRow),
+                     tileWidth, tileColour1, tileColour2);
+    });
+
+    return mesh;
+}
+
+// Creates a chunk with its storage allocated, but not filled in
+static ChessboardChunk allocateChunk(int2 firstTile, unsigned int width, unsigned int height, float tileWidth) {
+    ChessboardChunk chunk = {
+        firstTile, width, height,
+        Mesh("Chessboard chunk " + std::to_string(firstTile.x) + "," + std::to_string(firstTile.y)),
+        BoundingSphere()
+    };
+
+    float2 minimum((float(firstTile.x) - 0.5f) * tileWidth, (float(firstTile.y) - 0.5f) * tileWidth);
+    float2 size(width * tileWidth, height * tileWidth);
+    chunk.bounds.centre = float3(minimum.x + 0.5f * size.x, 0, minimum.y + 0.5f * size.y);
+    chunk.bounds.radius = 0.5f * std::sqrt(size.x * size.x + size.y * size.y);
+
+    allocateGrid(chunk.mesh, width, height);
+    return chunk;
+}
+
+ChessboardChunk generateChessboardChunk(int2 firstTile, unsigned int width, unsigned int height,
+                                        float tileWidth, float4 tileColour1, float4 tileColour2) {
+    ChessboardChunk chunk = allocateChunk(firstTile, width, height, tileWidth);
+    fillGridRows(chunk.mesh, firstTile, width, height, 0, height + 1, tileWidth, tileColour1, tileColour2);
+    return chunk;
+}
+
+std::vector<ChessboardChunk> generateChessboardChunks(unsigned int width, unsigned int height, unsigned int chunkSize,
+                                                      float tileWidth, float4 tileColour1, float4 tileColour2) {
+    std::vector<ChessboardChunk> chunks;
+    chunkSize = std::max(1u, chunkSize);
+
+    for (unsigned int y = 0; y < height; y += chunkSize) {
+        for (unsigned int x = 0; x < width; x += chunkSize) {
+            int2 firstTile = { int(x), int(y) };
+            chunks.push_back(allocateChunk(firstTile, std::min(chunkSize, width - x), std::min(chunkSize, height - y), tileWidth));
+        }
+    }
+
+    // Each chunk is small enough to be filled in by a single thread
+    parallelFor(0, chunks.size(), 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            ChessboardChunk &chunk = chunks[i];
+            fillGridRows(chunk.mesh, chunk.firstTile, chunk.width, chunk.height, 0, chunk.height + 1,
+                         tileWidth, tileColour1, tileColour2);
+        }
+    });
+
+    return chunks;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include "mesh.hpp"
+#include "toolbox.hpp"
+
+// Generates the same chessboard as generateChessboard(), for boards of millions of tiles.
+//
+// Neighbouring tiles share their corner vertices, which makes for about one vertex per tile
+// instead of four. A vertex can only have one colour, so each tile takes its colour from its
+// corner with the lowest coordinates, which is the last vertex of both its triangles. This
+// relies on the shader not interpolating colours (the "flat" qualifier in simple.vert).
+//
+// The mesh is built on several threads, each writing a band of rows straight into the
+// mesh's preallocated storage.
+Mesh generateChessboardGrid(unsigned int width, unsigned int height, float tileWidth, float4 tileColour1, float4 tileColour2);
+
+// A rectangular piece of a chessboard, covering the tiles from firstTile up to but not
+// including firstTile + (width, height).
+struct ChessboardChunk {
+    int2 firstTile;
+    unsigned int width;
+    unsigned int height;
+    Mesh mesh;
+    // Encloses the chunk, in the same coordinate space as the mesh
+    BoundingSphere bounds;
+};
+
+// Generates a single chunk of a chessboard, covering width by height tiles from firstTile.
+// Runs on the calling thread only, so that many chunks can be generated at once.
+ChessboardChunk generateChessboardChunk(int2 firstTile, unsigned int width, unsigned int height,
+                                        float tileWidth, float4 tileColour1, float4 tileColour2);
+
+// Generates a chessboard as chunks of chunkSize by chunkSize tiles, so that they can be culled
+// and streamed separately. Chunks along the far edges are smaller if the board does not divide
+// evenly. Each chunk is a mesh like the ones generated by generateChessboardGrid(), placed
+// where it lies on the whole board. Chunks are generated in parallel.
+std::vector<ChessboardChunk> generateChessboardChunks(unsigned int width, unsigned int height, unsigned int chunkSize,
+                                                      float tileWidth, float4 tileColour1, float4 tileColour2);
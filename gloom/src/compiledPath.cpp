@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "compiledPath.hpp"
+#include "parallel.hpp"
+
+// Number of characters each thread moves at a time
+static const size_t grainSize = 4096;
+
+static float length(float2 v) {
+    return std::sqrt(v.x * v.x + v.y * v.y);
+}
+
+// A point on the Catmull-Rom spline between p1 (t = 0) and p2 (t = 1)
+static float2 catmullRom(float2 p0, float2 p1, float2 p2, float2 p3, float t) {
+    float t2 = t * t;
+    float t3 = t2 * t;
+    return (p1 * 2.0f + (p2 - p0) * t + (p0 * 2.0f - p1 * 5.0f + p2 * 4.0f - p3) * t2 +
+            (p1 * 3.0f - p0 - p2 * 3.0f + p3) * t3) * 0.5f;
+}
+
+CompiledPath::CompiledPath(Path const &path, float tileWidth, unsigned int segmentsPerWaypoint) {
+    // Waypoints repeating the previous one would make segments of length 0
+    std::vector<float2> waypoints;
+    for (unsigned int i = 0; i < path.getWaypointCount(); i++) {
+        float2 waypoint = path.getWaypoint(i, tileWidth);
+        if (waypoints.empty() || waypoint != waypoints.back()) {
+            waypoints.push_back(waypoint);
+        }
+    }
+    while (waypoints.size() > 1 && waypoints.back() == waypoints.front()) {
+        waypoints.pop_back();
+    }
+    if (waypoints.size() < 2) {
+        throw std::runtime_error("A path needs at least two different waypoints to be followed");
+    }
+
+    size_t waypointCount = waypoints.size();
+    segmentsPerWaypoint = std::max(1u, segmentsPerWaypoint);
+    for (size_t i = 0; i < waypointCount; i++) {
+        float2 p0 = waypoints[(i + waypointCount - 1) % waypointCount];
+        float2 p1 = waypoints[i];
+        float2 p2 = waypoints[(i + 1) % waypointCount];
+        float2 p3 = waypoints[(i + 2) % waypointCount];
+        for (unsigned int step = 0; step < segmentsPerWaypoint; step++) {
+            points.push_back(catmullRom(p0, p1, p2, p3, float(step) / segmentsPerWaypoint));
+        }
+    }
+    points.push_back(points.front());
+
+    size_t segmentCount = points.size() - 1;
+    directions.resize(segmentCount);
+    distances.resize(segmentCount + 1);
+    distances[0] = 0.0f;
+    for (size_t i = 0; i < segmentCount; i++) {
+        float2 segment = points[i + 1] - points[i];
+        float segmentLength = length(segment);
+        directions[i] = segmentLength > 0.0f ? segment / segmentLength : float2(0, 0);
+        distances[i + 1] = distances[i] + segmentLength;
+    }
+
+    pointHeadings.resize(segmentCount + 1);
+    for (size_t i = 0; i < segmentCount; i++) {
+        float2 heading = directions[(i + segmentCount - 1) % segmentCount] + directions[i];
+        float headingLength = length(heading);
+        pointHeadings[i] = headingLength > 0.0f ? heading / headingLength : directions[i];
+    }
+    pointHeadings[segmentCount] = pointHeadings[0];
+}
+
+PathCursor CompiledPath::getCursor(float distance) const {
+    PathCursor cursor;
+    cursor.distance = distance - getLength() * std::floor(distance / getLength());
+    // The last distance is the length of the whole loop, which no cursor reaches
+    auto segmentEnd = std::upper_bound(distances.begin(), distances.end() - 1, cursor.distance);
+    cursor.segment = unsigned(segmentEnd - distances.begin()) - 1;
+    return cursor;
+}
+
+void CompiledPath::sample(PathCursor cursor, float2 &position, float2 &heading) const {
+    unsigned int segment = cursor.segment;
+    float along = cursor.distance - distances[segment];
+    float segmentLength = distances[segment + 1] - distances[segment];
+    float fraction = segmentLength > 0.0f ? along / segmentLength : 0.0f;
+
+    position = points[segment] + directions[segment] * along;
+    heading = pointHeadings[segment] + (pointHeadings[segment + 1] - pointHeadings[segment]) * fraction;
+}
+
+void CompiledPath::advance(std::vector<PathCursor> &cursors, std::vector<float> const &speeds, float deltaTime,
+                           std::vector<float2> &positions, std::vector<float2> &headings) const {
+    size_t count = cursors.size();
+    positions.resize(count);
+    headings.resize(count);
+    float pathLength = getLength();
+    unsigned int lastSegment = unsigned(directions.size()) - 1;
+
+    parallelFor(0, count, grainSize, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            PathCursor cursor = cursors[i];
+            cursor.distance += speeds[i] * deltaTime;
+
+            if (cursor.distance >= pathLength) {
+                cursor = getCursor(cursor.distance);
+            } else {
+                // Characters rarely move further than one segment per step
+                while (cursor.segment < lastSegment && cursor.distance >= distances[cursor.segment + 1]) {
+                    cursor.segment++;
+                }
+            }
+
+            cursors[i] = cursor;
+            sample(cursor, positions[i], headings[i]);
+        }
+    });
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include "floats.hpp"
+#include "toolbox.hpp"
+
+// Where a character is along a CompiledPath.
+struct PathCursor {
+    // How far the character has walked along the path, between 0 and the path's length
+    float distance;
+    // The segment containing that distance, kept so it does not have to be searched for every time
+    unsigned int segment;
+};
+
+// A looping Path turned into a smooth curve, measured by the distance walked along it.
+// Characters following it move at a constant speed and turn gradually instead of snapping
+// to face each new waypoint.
+//
+// The curve is a Catmull-Rom spline through the waypoints, stored as many short straight
+// segments along with the distance at which each starts. Moving a character along it only
+// takes a few multiplications, so large numbers of characters can share one path.
+class CompiledPath {
+public:
+    // Throws a std::runtime_error if the path has fewer than two different waypoints.
+    // A higher number of segments per waypoint gives a smoother curve.
+    CompiledPath(Path const &path, float tileWidth, unsigned int segmentsPerWaypoint = 8);
+
+    // The length of one loop along the path
+    float getLength() const { return distances.back(); }
+
+    // Returns the cursor for a distance along the path, which may be more than one loop
+    PathCursor getCursor(float distance) const;
+
+    // Finds where a cursor is. The heading points in the direction of travel, and its length
+    // is close to but not exactly 1.
+    void sample(PathCursor cursor, float2 &position, float2 &heading) const;
+
+    // Moves each character speeds[i] * deltaTime further along the path, and writes its new
+    // position and heading to positions[i] and headings[i]. Speeds may not be negative.
+    void advance(std::vector<PathCursor> &cursors, std::vector<float> const &speeds, float deltaTime,
+                 std::vector<float2> &positions, std::vector<float2> &headings) const;
+
+private:
+    // Segment i runs from points[i] to points[i + 1], in direction directions[i], and covers
+    // the distances from distances[i] to distances[i + 1]. The last point is the first one
+    // again, closing the loop.
+    std::vector<float2> points;
+    std::vector<float2> directions;
+    std::vector<float> distances;
+    // The heading at each point, halfway between the directions of the segments meeting there
+    std::vector<float2> pointHeadings;
+};
@@ -1,289 +1,270 @@
 #pragma once
 
 #include <cmath>
+#include <cstddef>
 #include <ostream>
 #include <algorithm>
+#include <type_traits>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+// Small vectors of N components of type T. float2, float3 and float4 are the names used throughout
+// gloom. The components are plain members (x, y, z and w), so the vectors are trivially copyable
+// and laid out like arrays, and like glm's vectors, which they convert to and from implicitly.
+//
+// Every operator is written as a single expression over the components, which lets the compiler
+// see straight through it, and lets it run at compile time (constexpr).
+
+// The components, as named members
+template <size_t N, typename T>
+struct vecComponents;
+
+template <typename T>
+struct vecComponents<2, T> {
+	T x;
+	T y;
+
+	constexpr vecComponents(T vx, T vy) : x(vx), y(vy) {}
+	constexpr T get(size_t i) const { return i == 0 ? x : y; }
+	T &get(size_t i) { return i == 0 ? x : y; }
+};
 
-class float2 {
-public:
-	float x;
-	float y;
-
-	float2() : x(0.0f), y(0.0f) {}
-	float2(float const vx, float const vy) : x(vx), y(vy) {}
-
-	template <class T>
-	float2(T val) : x(val), y(val) {}
-
-	float2& operator= (float2 const other) {
-		x = other.x;
-		y = other.y;
-		return *this;
-	}
-
-	template <class T>
-	float2& operator=(T const other) {
-		*this = float2(other);
-		return *this;
-	}
-
-	float2& operator+= (float2 const other) {
-		x += other.x;
-		y += other.y;
-		return *this;
-	}
-
-	float2& operator-= (float2 const other) {
-		x -= other.x;
-		y -= other.y;
-		return *this;
-	}
-
-	float2& operator*= (float2 const other) {
-		x *= other.x;
-		y *= other.y;
-		return *this;
-	}
-
-	float2& operator/= (float2 const other) {
-		x /= other.x;
-		y /= other.y;
-		return *this;
-	}
-
-	friend float2 operator+ (float2 lhs, float2 const &rhs) { lhs += rhs; return lhs; }
-	friend float2 operator- (float2 lhs, float2 const &rhs) { lhs -= rhs; return lhs; }
-	friend float2 operator* (float2 lhs, float2 const &rhs) { lhs *= rhs; return lhs; }
-	friend float2 operator/ (float2 lhs, float2 const &rhs) { lhs /= rhs; return lhs; }
-
-	bool operator== (float2 const other) const {
-		return (x == other.x) && (y == other.y);
-	}
+template <typename T>
+struct vecComponents<3, T> {
+	T x;
+	T y;
+	T z;
 
-	bool operator!= (float2 const other) const {
-		return (x != other.x) || (y != other.y);
-	}
+	constexpr vecComponents(T vx, T vy, T vz) : x(vx), y(vy), z(vz) {}
+	constexpr T get(size_t i) const { return i == 0 ? x : (i == 1 ? y : z); }
+	T &get(size_t i) { return i == 0 ? x : (i == 1 ? y : z); }
+};
 
-	float2 clamp(float2 const &lo, float2 const &hi) {
-		return float2(
-			std::max(std::min(x, hi.x),lo.x),
-			std::max(std::min(y, hi.y),lo.y)
-		);
-	}
+template <typename T>
+struct vecComponents<4, T> {
+	T x;
+	T y;
+	T z;
+	T w;
 
-	friend std::ostream & operator << (std::ostream &os, float2 const &v) {
-        os << "[" << v.x << "," << v.y << "]";
-        return os;
-    }
+	constexpr vecComponents(T vx, T vy, T vz, T vw) : x(vx), y(vy), z(vz), w(vw) {}
+	constexpr T get(size_t i) const { return i == 0 ? x : (i == 1 ? y : (i == 2 ? z : w)); }
+	T &get(size_t i) { return i == 0 ? x : (i == 1 ? y : (i == 2 ? z : w)); }
 };
 
+// The indices 0 to N - 1 as a parameter pack, to write operations over all components at once
+template <size_t... I>
+struct vecIndices {};
 
-class float3 {
-public:
-	float x;
-	float y;
-	float z;
+template <size_t N, size_t... I>
+struct vecIndexSequence : vecIndexSequence<N - 1, N - 1, I...> {};
 
-	float3() : x(0.0f), y(0.0f), z(0.0f) {}
-	float3(float2 const v, float vz) : x(v.x), y(v.y), z(vz) {}
-	float3(float const vx, float const vy, float const vz) : x(vx), y(vy), z(vz) {}
+template <size_t... I>
+struct vecIndexSequence<0, I...> {
+	typedef vecIndices<I...> type;
+};
 
-	template <class T>
-	float3(T val) : x(val), y(val), z(val) {}
+// Whether every type is a number, which keeps the constructor taking components from accepting anything else
+template <typename... U>
+struct vecAllArithmetic : std::true_type {};
 
-	float3& operator= (float3 const other) {
-		this->x = other.x;
-		this->y = other.y;
-		this->z = other.z;
-		return *this;
-	}
+template <typename First, typename... Rest>
+struct vecAllArithmetic<First, Rest...>
+	: std::integral_constant<bool, std::is_arithmetic<First>::value && vecAllArithmetic<Rest...>::value> {};
 
-	template <class T>
-	float3& operator=(T other) {
-		*this = float3(other);
-		return *this;
-	}
+// The glm vector a vector converts to and from. Vectors without one get a type nothing converts to.
+template <size_t N, typename T>
+struct vecGlmType {
+	struct none {};
+	typedef none type;
+};
 
-	float3& operator+= (float3 const other) {
-		x += other.x;
-		y += other.y;
-		z += other.z;
-		return *this;
-	}
+template <> struct vecGlmType<2, float> { typedef glm::vec2 type; };
+template <> struct vecGlmType<3, float> { typedef glm::vec3 type; };
+template <> struct vecGlmType<4, float> { typedef glm::vec4 type; };
 
-	float3& operator-= (float3 const other) {
-		x -= other.x;
-		y -= other.y;
-		z -= other.z;
-		return *this;
-	}
+template <size_t N, typename T>
+struct vec : vecComponents<N, T> {
+private:
+	typedef typename vecIndexSequence<N>::type Indices;
+	typedef typename vecGlmType<N, T>::type GlmType;
 
-	float3& operator*= (float3 const other) {
-		x *= other.x;
-		y *= other.y;
-		z *= other.z;
-		return *this;
-	}
+	template <size_t... I>
+	constexpr vec(vecIndices<I...>, T value) : vecComponents<N, T>(((void) I, value)...) {}
 
-	float3& operator/= (float3 const other) {
-	    x /= other.x;
-        y /= other.y;
-        z /= other.z;
-        return *this;
-	}
+	template <typename Source, size_t... I>
+	constexpr vec(Source const &source, vecIndices<I...>) : vecComponents<N, T>(T(source[I])...) {}
 
-	friend float3 operator+ (float3 lhs, float3 const &rhs) { lhs += rhs; return lhs; }
-	friend float3 operator- (float3 lhs, float3 const &rhs) { lhs -= rhs; return lhs; }
-	friend float3 operator* (float3 lhs, float3 const &rhs) { lhs *= rhs; return lhs; }
-	friend float3 operator/ (float3 lhs, float3 const &rhs) { lhs /= rhs; return lhs; }
+	template <size_t M, size_t... I>
+	constexpr vec(vec<M, T> const &v, T last, vecIndices<I...>) : vecComponents<N, T>(v[I]..., last) {}
 
-	float3 cross(float3 const &v) const {
-		return float3(y * v.z - z * v.y, z * v.x - x * v.z, x * v.y - y * v.x);
+	template <typename Operation, size_t... I>
+	static constexpr vec apply(vec const &a, vec const &b, vecIndices<I...>) {
+		return vec(Operation::apply(a[I], b[I])...);
 	}
 
-	float dot(float3 const &v) const {
-		return (x * v.x + y * v.y + z * v.z);
+	template <typename Operation, size_t... I>
+	static constexpr bool all(vec const &a, vec const &b, vecIndices<I...>) {
+		return allOf(Operation::apply(a[I], b[I])...);
 	}
 
-	float distance(float3 const &v) const {
-		return std::sqrt(std::pow(x - v.x, 2) + std::pow(y - v.y, 2) + std::pow(z - v.z,2));
-	}
+	static constexpr bool allOf() { return true; }
+	template <typename... Rest>
+	static constexpr bool allOf(bool first, Rest... rest) { return first && allOf(rest...); }
 
-	float3& normalize() {
-        float n = x * x + y * y + z * z;
-        if (n > 0) {
-			(*this) *= 1 / std::sqrt(n);
-        }
-        return *this;
-    }
-
-	bool operator== (float3 const other) const {
-		return
-			(x == other.x) &&
-			(y == other.y) &&
-			(z == other.z);
-	}
-
-	bool operator!= (float3 const other) const {
-		return
-			(x != other.x) ||
-			(y != other.y) ||
-			(z != other.z);
+	template <size_t... I>
+	constexpr T sumOfProducts(vec const &v, vecIndices<I...>) const {
+		return sum((*this)[I] * v[I]...);
 	}
 
-	float3 clamp(float3 const &lo, float3 const &hi) {
-		return float3(
-			std::max(std::min(x, hi.x),lo.x),
-			std::max(std::min(y, hi.y),lo.y),
-			std::max(std::min(z, hi.z),lo.z)
-		);
-	}
+	// Adds from left to right, like x * x + y * y + z * z written out
+	static constexpr T sum(T value) { return value; }
+	template <typename... Rest>
+	static constexpr T sum(T first, T second, Rest... rest) { return sum(first + second, rest...); }
 
-	float2 toFloat2() const {
-		return float2(x,y);
+	template <size_t... I>
+	GlmType toGlm(vecIndices<I...>) const {
+		return GlmType((*this)[I]...);
 	}
 
-	friend std::ostream & operator << (std::ostream &os, float3 const &v) {
-        os << "[" << v.x << "," << v.y << "," << v.z << "]";
-        return os;
-    }
-};
+	struct add { static constexpr T apply(T a, T b) { return a + b; } };
+	struct subtract { static constexpr T apply(T a, T b) { return a - b; } };
+	struct multiply { static constexpr T apply(T a, T b) { return a * b; } };
+	struct divide { static constexpr T apply(T a, T b) { return a / b; } };
+	struct equal { static constexpr bool apply(T a, T b) { return a == b; } };
 
-class float4 {
 public:
-	float x;
-	float y;
-	float z;
-	float w;
-
-	float4() : x(0.0f), y(0.0f), z(0.0f), w(0.0f) {}
-	float4(float3 const v, float vw) : x(v.x), y(v.y), z(v.z), w(vw) {}
-	float4(float const vx, float const vy, float const vz, float const vw) : x(vx), y(vy), z(vz), w(vw) {}
-
-	template <class T>
-	float4(T val) : x(val), y(val), z(val), w(val) {}
-
-	float4& operator= (float4 other) {
-		x = other.x;
-		y = other.y;
-		z = other.z;
-		w = other.w;
-		return *this;
-	}
-
-	template <class T>
-	float4& operator=(T other) {
-		*this = float4(other);
-		return *this;
-	}
-
-	float4& operator+= (float4 other) {
-		x += other.x;
-		y += other.y;
-		z += other.z;
-		w += other.w;
+	typedef T value_type;
+
+	// All components zero
+	constexpr vec() : vec(Indices(), T(0)) {}
+	// All components the same
+	explicit constexpr vec(T value) : vec(Indices(), value) {}
+	// One value for each component, of any type which converts to T
+	template <typename... U, typename = typename std::enable_if<sizeof...(U) == N && vecAllArithmetic<U...>::value>::type>
+	constexpr vec(U... components) : vecComponents<N, T>(T(components)...) {}
+	// A vector with one more component, such as float4(position, 1)
+	template <size_t M, typename = typename std::enable_if<M + 1 == N>::type>
+	constexpr vec(vec<M, T> const &v, T last) : vec(v, last, typename vecIndexSequence<M>::type()) {}
+	// The same vector with components of another type
+	template <typename U>
+	explicit constexpr vec(vec<N, U> const &v) : vec(v, Indices()) {}
+
+	vec(GlmType const &v) : vec(v, Indices()) {}
+	operator GlmType() const { return toGlm(Indices()); }
+
+	constexpr T operator[](size_t i) const { return this->get(i); }
+	T &operator[](size_t i) { return this->get(i); }
+
+	friend constexpr vec operator+ (vec const &a, vec const &b) { return apply<add>(a, b, Indices()); }
+	friend constexpr vec operator- (vec const &a, vec const &b) { return apply<subtract>(a, b, Indices()); }
+	friend constexpr vec operator* (vec const &a, vec const &b) { return apply<multiply>(a, b, Indices()); }
+	friend constexpr vec operator/ (vec const &a, vec const &b) { return apply<divide>(a, b, Indices()); }
+
+	friend constexpr vec operator+ (vec const &a, T b) { return a + vec(b); }
+	friend constexpr vec operator- (vec const &a, T b) { return a - vec(b); }
+	friend constexpr vec operator* (vec const &a, T b) { return a * vec(b); }
+	friend constexpr vec operator/ (vec const &a, T b) { return a / vec(b); }
+	friend constexpr vec operator+ (T a, vec const &b) { return vec(a) + b; }
+	friend constexpr vec operator- (T a, vec const &b) { return vec(a) - b; }
+	friend constexpr vec operator* (T a, vec const &b) { return vec(a) * b; }
+	friend constexpr vec operator/ (T a, vec const &b) { return vec(a) / b; }
+
+	friend constexpr vec operator- (vec const &v) { return vec() - v; }
+
+	vec &operator+= (vec const &other) { return *this = *this + other; }
+	vec &operator-= (vec const &other) { return *this = *this - other; }
+	vec &operator*= (vec const &other) { return *this = *this * other; }
+	vec &operator/= (vec const &other) { return *this = *this / other; }
+	vec &operator+= (T other) { return *this = *this + other; }
+	vec &operator-= (T other) { return *this = *this - other; }
+	vec &operator*= (T other) { return *this = *this * other; }
+	vec &operator/= (T other) { return *this = *this / other; }
+
+	friend constexpr bool operator== (vec const &a, vec const &b) { return all<equal>(a, b, Indices()); }
+	friend constexpr bool operator!= (vec const &a, vec const &b) { return !(a == b); }
+
+	constexpr T dot(vec const &v) const {
+		return sumOfProducts(v, Indices());
+	}
+
+	// Only for vectors of three components
+	constexpr vec cross(vec const &v) const {
+		return vec(this->y * v.z - this->z * v.y, this->z * v.x - this->x * v.z, this->x * v.y - this->y * v.x);
+	}
+
+	T distance(vec const &v) const {
+		vec difference = *this - v;
+		return std::sqrt(difference.dot(difference));
+	}
+
+	// Scales the vector to a length of 1, unless it is all zero, and returns it
+	vec &normalize() {
+		T n = dot(*this);
+		if (n > 0) {
+			(*this) *= 1 / std::sqrt(n);
+		}
 		return *this;
 	}
 
-	float4& operator-= (float4 other) {
-		x -= other.x;
-		y -= other.y;
-		z -= other.z;
-		w -= other.w;
-		return *this;
+	constexpr vec clamp(vec const &lo, vec const &hi) const {
+		return clampComponents(lo, hi, Indices());
 	}
 
-	float4& operator*= (float4 other) {
-		x *= other.x;
-		y *= other.y;
-		z *= other.z;
-		w *= other.w;
-		return *this;
+	constexpr vec<2, T> toFloat2() const {
+		return vec<2, T>(this->x, this->y);
 	}
 
-	float4& operator/= (float4 other) {
-		x /= other.x;
-		y /= other.y;
-		z /= other.z;
-		w /= other.w;
-		return *this;
+	// Only for vectors of four components
+	constexpr vec<3, T> toFloat3() const {
+		return vec<3, T>(this->x, this->y, this->z);
 	}
 
-	float4 clamp(float4 const &lo, float4 const &hi) {
-		return float4(
-			std::max(std::min(x, hi.x),lo.x),
-			std::max(std::min(y, hi.y),lo.y),
-			std::max(std::min(z, hi.z),lo.z),
-			std::max(std::min(w, hi.w),lo.w)
-		);
+	friend std::ostream &operator<< (std::ostream &os, vec const &v) {
+		os << "[";
+		for (size_t i = 0; i < N; i++) {
+			os << (i == 0 ? "" : ",") << v[i];
+		}
+		os << "]";
+		return os;
 	}
 
-	friend float4 operator+ (float4 lhs, float4 const &rhs) { lhs += rhs; return lhs; }
-	friend float4 operator- (float4 lhs, float4 const &rhs) { lhs -= rhs; return lhs; }
-	friend float4 operator* (float4 lhs, float4 const &rhs) { lhs *= rhs; return lhs; }
-	friend float4 operator/ (float4 lhs, float4 const &rhs) { lhs /= rhs; return lhs; }
-
-	bool operator!= (float4 other) {
-		return (x != other.x) || (y != other.y) || (z != other.z) || (w != other.w);
+private:
+	template <size_t... I>
+	constexpr vec clampComponents(vec const &lo, vec const &hi, vecIndices<I...>) const {
+		return vec(std::max(std::min((*this)[I], hi[I]), lo[I])...);
 	}
+};
 
-	bool operator== (float4 other) {
-		return (x == other.x) && (y == other.y) && (z == other.z) && (w == other.w);
-	}
+// Vectors are aligned to their size rounded up to a power of two, but to no more than 16 bytes
+constexpr size_t vecPaddedBytes(size_t componentCount, size_t componentBytes) {
+	return (componentCount == 3 ? 4 : componentCount) * componentBytes;
+}
+
+constexpr size_t vecAlignment(size_t componentCount, size_t componentBytes) {
+	return vecPaddedBytes(componentCount, componentBytes) > 16 ? 16 : vecPaddedBytes(componentCount, componentBytes);
+}
+
+// Vectors aligned for SIMD loads and stores. alignedVec<3, float> takes 16 bytes rather than 12.
+template <size_t N, typename T>
+struct alignas(vecAlignment(N, sizeof(T))) alignedVec : vec<N, T> {
+	using vec<N, T>::vec;
+	constexpr alignedVec() : vec<N, T>() {}
+	constexpr alignedVec(vec<N, T> const &v) : vec<N, T>(v) {}
+};
 
-	float3 toFloat3() {
-		return float3(x,y,z);
-	}
+typedef vec<2, float> float2;
+typedef vec<3, float> float3;
+typedef vec<4, float> float4;
+typedef alignedVec<3, float> alignedFloat3;
+typedef alignedVec<4, float> alignedFloat4;
 
-	friend std::ostream & operator << (std::ostream &os, const float4 &v)
-	{
-		os << "[" << v.x << "," << v.y << "," << v.z << "," << v.w << "]";
-		return os;
-	}
-};
+static_assert(sizeof(float3) == 3 * sizeof(float), "float3 has to be laid out like an array");
+static_assert(sizeof(float4) == sizeof(glm::vec4), "float4 has to be laid out like glm::vec4");
+static_assert(sizeof(alignedFloat3) == 16 && alignof(alignedFloat3) == 16, "alignedFloat3 has to fill an SSE register");
+static_assert(std::is_trivially_copyable<float4>::value, "Vectors have to be trivially copyable");
 
 // In a way cheating.. These are not really floats.
 // Just move along.
-struct int2 {
-    int x, y;
-};
\ No newline at end of file
+typedef vec<2, int> int2;
@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <cmath>
+#include "flowField.hpp"
+
+// The eight neighbours of a tile. The opposite of direction d is (d + 4) % 8.
+static const int2 steps[8] = { { 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 }, { -1, 0 }, { -1, -1 }, { 0, -1 }, { 1, -1 } };
+static const unsigned char noDirection = 8;
+// Marks tiles which have already been found to be affected by a change during repair()
+static const unsigned char affectedMark = 9;
+
+static unsigned int getStepCost(unsigned int direction) {
+    return (direction & 1) ? diagonalStepCost : straightStepCost;
+}
+
+static int2 getNeighbour(int2 tile, unsigned int direction) {
+    int2 neighbour = { tile.x + steps[direction].x, tile.y + steps[direction].y };
+    return neighbour;
+}
+
+// Orders the open list so the closest tile ends up on top of the heap, ties broken by tile
+struct IsFartherTile {
+    template <typename Tile>
+    bool operator()(Tile const &a, Tile const &b) const {
+        return a.distance > b.distance || (a.distance == b.distance && a.index > b.index);
+    }
+};
+
+FlowField::FlowField(NavigationGrid const &grid, int2 goal) {
+    rebuild(grid, goal);
+}
+
+void FlowField::rebuild(NavigationGrid const &grid, int2 newGoal) {
+    goal = newGoal;
+    width = grid.getWidth();
+    height = grid.getHeight();
+    size_t tileCount = size_t(width) * height;
+    openTiles.clear();
+    distances.assign(tileCount, unreachableDistance);
+    directions.assign(tileCount, noDirection);
+
+    if (grid.isWalkable(goal)) {
+        unsigned int goalIndex = unsigned(grid.getIndex(goal));
+        distances[goalIndex] = 0;
+        OpenTile start = { 0, goalIndex };
+        openTiles.push_back(start);
+        propagate(grid);
+    }
+}
+
+void FlowField::propagate(NavigationGrid const &grid) {
+    while (!openTiles.empty()) {
+        std::pop_heap(openTiles.begin(), openTiles.end(), IsFartherTile());
+        OpenTile current = openTiles.back();
+        openTiles.pop_back();
+
+        // Tiles can be in the open list several times, only the shortest distance counts
+        if (current.distance != distances[current.index]) {
+            continue;
+        }
+
+        // Every neighbour which can step onto this tile might have a shorter path through it.
+        // Steps are symmetric, so that is every neighbour this tile can step onto.
+        int2 tile = grid.getTile(current.index);
+        for (unsigned int direction = 0; direction < 8; direction++) {
+            if (!grid.canStep(tile, steps[direction].x, steps[direction].y)) {
+                continue;
+            }
+            unsigned int neighbourIndex = unsigned(grid.getIndex(getNeighbour(tile, direction)));
+            unsigned int distance = current.distance + getStepCost(direction);
+            if (distance < distances[neighbourIndex]) {
+                distances[neighbourIndex] = distance;
+                directions[neighbourIndex] = (direction + 4) % 8;
+                OpenTile next = { distance, neighbourIndex };
+                openTiles.push_back(next);
+                std::push_heap(openTiles.begin(), openTiles.end(), IsFartherTile());
+            }
+        }
+    }
+}
+
+void FlowField::relax(NavigationGrid const &grid, int2 tile, int dx, int dy) {
+    if (!grid.isWalkable(tile) || !grid.canStep(tile, dx, dy)) {
+        return;
+    }
+    int2 neighbour = { tile.x + dx, tile.y + dy };
+    unsigned int neighbourDistance = distances[grid.getIndex(neighbour)];
+    if (neighbourDistance == unreachableDistance) {
+        return;
+    }
+
+    unsigned int direction = 0;
+    while (steps[direction].x != dx || steps[direction].y != dy) {
+        direction++;
+    }
+    unsigned int index = unsigned(grid.getIndex(tile));
+    unsigned int distance = neighbourDistance + getStepCost(direction);
+    if (distance < distances[index]) {
+        distances[index] = distance;
+        directions[index] = (unsigned char) direction;
+        OpenTile open = { distance, index };
+        openTiles.push_back(open);
+        std::push_heap(openTiles.begin(), openTiles.end(), IsFartherTile());
+    }
+}
+
+void FlowField::repair(NavigationGrid const &grid, int2 changedTile) {
+    if (!grid.contains(changedTile)) {
+        return;
+    }
+
+    if (grid.isWalkable(changedTile)) {
+        // Unblocking a tile can only make paths shorter. Every new step starts and ends
+        // within the tiles around it, so shorter paths spread out from there.
+        if (changedTile.x == goal.x && changedTile.y == goal.y) {
+            unsigned int goalIndex = unsigned(grid.getIndex(goal));
+            distances[goalIndex] = 0;
+            directions[goalIndex] = noDirection;
+            OpenTile start = { 0, goalIndex };
+            openTiles.push_back(start);
+            std::push_heap(openTiles.begin(), openTiles.end(), IsFartherTile());
+        }
+        for (int y = changedTile.y - 1; y <= changedTile.y + 1; y++) {
+            for (int x = changedTile.x - 1; x <= changedTile.x + 1; x++) {
+                int2 tile = { x, y };
+                for (unsigned int direction = 0; direction < 8; direction++) {
+                    relax(grid, tile, steps[direction].x, steps[direction].y);
+                }
+            }
+        }
+        propagate(grid);
+        return;
+    }
+
+    // Blocking a tile can only make paths longer, and only for the tiles whose path used a step
+    // which is no longer possible: the ones stepping onto the tile, and diagonal steps around
+    // its corners. Those tiles, and all tiles whose paths lead through them, lose their paths.
+    std::vector<unsigned int> affected;
+    for (int y = changedTile.y - 1; y <= changedTile.y + 1; y++) {
+        for (int x = changedTile.x - 1; x <= changedTile.x + 1; x++) {
+            int2 tile = { x, y };
+            if (!grid.contains(tile)) {
+                continue;
+            }
+            unsigned int index = unsigned(grid.getIndex(tile));
+            bool isChangedTile = (x == changedTile.x && y == changedTile.y);
+            bool hasLostStep = directions[index] < noDirection &&
+                               !grid.canStep(tile, steps[directions[index]].x, steps[directions[index]].y);
+            if ((isChangedTile && distances[index] != unreachableDistance) || hasLostStep) {
+                directions[index] = affectedMark;
+                affected.push_back(index);
+            }
+        }
+    }
+    for (size_t i = 0; i < affected.size(); i++) {
+        int2 tile = grid.getTile(affected[i]);
+        for (unsigned int direction = 0; direction < 8; direction++) {
+            int2 neighbour = getNeighbour(tile, direction);
+            if (!grid.contains(neighbour)) {
+                continue;
+            }
+            unsigned int neighbourIndex = unsigned(grid.getIndex(neighbour));
+            if (directions[neighbourIndex] == (direction + 4) % 8) {
+                directions[neighbourIndex] = affectedMark;
+                affected.push_back(neighbourIndex);
+            }
+        }
+    }
+
+    for (unsigned int index : affected) {
+        distances[index] = unreachableDistance;
+        directions[index] = noDirection;
+    }
+
+    // The affected tiles find new paths through the unaffected tiles around them, whose
+    // paths are still as short as they can be
+    for (unsigned int index : affected) {
+        int2 tile = grid.getTile(index);
+        for (unsigned int direction = 0; direction < 8; direction++) {
+            relax(grid, tile, steps[direction].x, steps[direction].y);
+        }
+    }
+    propagate(grid);
+}
+
+unsigned int FlowField::getDistance(int2 tile) const {
+    if (tile.x < 0 || tile.y < 0 || unsigned(tile.x) >= width || unsigned(tile.y) >= height) {
+        return unreachableDistance;
+    }
+    return distances[size_t(tile.y) * width + tile.x];
+}
+
+int2 FlowField::getNextTile(int2 tile) const {
+    if (getDistance(tile) == unreachableDistance) {
+        return tile;
+    }
+    unsigned char direction = directions[size_t(tile.y) * width + tile.x];
+    return direction == noDirection ? tile : getNeighbour(tile, direction);
+}
+
+float2 FlowField::getDirection(float2 position, float tileWidth) const {
+    int2 tile = { int(std::floor(position.x / tileWidth + 0.5f)), int(std::floor(position.y / tileWidth + 0.5f)) };
+    int2 next = getNextTile(tile);
+    if (next.x == tile.x && next.y == tile.y) {
+        return float2(0, 0);
+    }
+
+    // Heading for the middle of the next tile rather than along the step keeps characters
+    // away from the edges of blocked tiles
+    float2 toNext = float2(next.x * tileWidth, next.y * tileWidth) - position;
+    float length = std::sqrt(toNext.x * toNext.x + toNext.y * toNext.y);
+    return toNext * (1.0f / length);
+}
+
+FlowFieldCache::FlowFieldCache(NavigationGrid &grid, size_t capacity)
+    : grid(grid), capacity(std::max<size_t>(1, capacity)) {
+    fields.reserve(this->capacity);
+}
+
+FlowField const &FlowFieldCache::getFlowField(int2 goal) {
+    useCounter++;
+    for (Entry &entry : fields) {
+        int2 fieldGoal = entry.field->getGoal();
+        if (fieldGoal.x == goal.x && fieldGoal.y == goal.y) {
+            entry.lastUse = useCounter;
+            return *entry.field;
+        }
+    }
+
+    buildCount++;
+    if (fields.size() < capacity) {
+        Entry entry;
+        entry.field.reset(new FlowField(grid, goal));
+        entry.lastUse = useCounter;
+        fields.push_back(std::move(entry));
+        return *fields.back().field;
+    }
+
+    auto leastRecentlyUsed = std::min_element(fields.begin(), fields.end(), [](Entry const &a, Entry const &b) {
+        return a.lastUse < b.lastUse;
+    });
+    leastRecentlyUsed->field->rebuild(grid, goal);
+    leastRecentlyUsed->lastUse = useCounter;
+    return *leastRecentlyUsed->field;
+}
+
+void FlowFieldCache::setBlocked(int2 tile, bool isBlocked) {
+    if (!grid.contains(tile) || grid.isWalkable(tile) != isBlocked) {
+        return;
+    }
+    grid.setBlocked(tile, isBlocked);
+    for (Entry &entry : fields) {
+        entry.field->repair(grid, tile);
+    }
+}
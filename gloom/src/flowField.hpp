@@ -0,0 +1,91 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "floats.hpp"
+#include "pathfinding.hpp"
+
+// For every tile of a NavigationGrid, the length of the shortest path to one goal tile and the
+// neighbouring tile to step to in order to follow it. Any number of characters heading for
+// the same goal can find their way by looking up the tile they are on, instead of each
+// searching for a path of their own.
+class FlowField {
+public:
+    // Finds the shortest paths from every tile to the goal
+    FlowField(NavigationGrid const &grid, int2 goal);
+
+    // Finds the paths to another goal, reusing the field's memory if the grid is the same size
+    void rebuild(NavigationGrid const &grid, int2 newGoal);
+
+    // Updates the paths after a tile has been blocked or unblocked on the grid. Only the tiles
+    // whose paths are affected are visited, which is usually a small part of the grid.
+    void repair(NavigationGrid const &grid, int2 changedTile);
+
+    int2 getGoal() const { return goal; }
+
+    bool isReachable(int2 tile) const { return getDistance(tile) != unreachableDistance; }
+
+    // The length of the shortest path from a tile to the goal in thousandths of a tile,
+    // or unreachableDistance if there is none
+    unsigned int getDistance(int2 tile) const;
+
+    // The tile to step to from a tile. Returns the tile itself on the goal or if the goal can not be reached.
+    int2 getNextTile(int2 tile) const;
+
+    // The direction to walk in from a position in the coordinate space of the terrain, as a
+    // vector of length 1. It is zero where getNextTile() stays put.
+    float2 getDirection(float2 position, float tileWidth) const;
+
+private:
+    // Settles tiles in order of distance, starting from the tiles in the open list
+    void propagate(NavigationGrid const &grid);
+    // Lowers the distance of a tile if the step to its neighbour in direction (dx, dy) makes for a shorter path
+    void relax(NavigationGrid const &grid, int2 tile, int dx, int dy);
+
+    struct OpenTile {
+        unsigned int distance;
+        unsigned int index;
+    };
+
+    int2 goal;
+    unsigned int width;
+    unsigned int height;
+    std::vector<unsigned int> distances;
+    // Which of the eight neighbours each tile steps to, or noDirection
+    std::vector<unsigned char> directions;
+
+    std::vector<OpenTile> openTiles;
+};
+
+// Keeps the flow fields of the goals used most recently. The grid's tiles should only be
+// blocked and unblocked through the cache, so that it can repair its fields instead of
+// building them again. Once the cache is full, fields are built in the memory of the ones
+// they replace, so only filling the cache allocates.
+class FlowFieldCache {
+public:
+    FlowFieldCache(NavigationGrid &grid, size_t capacity);
+
+    // Returns the flow field for a goal, building it if it is not in the cache. This evicts the
+    // least recently used field once the cache is full. The reference stays valid until the next
+    // call to getFlowField().
+    FlowField const &getFlowField(int2 goal);
+
+    // Blocks or unblocks a tile, and repairs every cached field
+    void setBlocked(int2 tile, bool isBlocked);
+
+    size_t getFieldCount() const { return fields.size(); }
+    // How many fields have been built, as opposed to found in the cache
+    unsigned long long getBuildCount() const { return buildCount; }
+
+private:
+    struct Entry {
+        std::unique_ptr<FlowField> field;
+        unsigned long long lastUse;
+    };
+
+    NavigationGrid &grid;
+    size_t capacity;
+    std::vector<Entry> fields;
+    unsigned long long useCounter = 0;
+    unsigned long long buildCount = 0;
+};
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <cstring>
+#include "frameCapture.hpp"
+#include "memoryTracking.hpp"
+
+FrameCapture::FrameCapture(GLStateCache &state, FrameEncoder &encoder, unsigned int width, unsigned int height,
+                           unsigned int ringSize)
+    : state(state), encoder(encoder), width(width), height(height), frameBytes(size_t(width) * height * 4) {
+    ring.resize(std::max(1u, ringSize));
+    for (Readback &readback : ring) {
+        glGenBuffers(1, &readback.buffer);
+        state.bindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(frameBytes), nullptr, GL_STREAM_READ);
+        recordGpuBuffer(readback.buffer, frameBytes);
+        readback.fence = nullptr;
+        readback.frameNumber = 0;
+    }
+    state.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+}
+
+FrameCapture::~FrameCapture() {
+    for (Readback &readback : ring) {
+        if (readback.fence) {
+            glDeleteSync(readback.fence);
+        }
+        glDeleteBuffers(1, &readback.buffer);
+        state.forgetBuffer(readback.buffer);
+        forgetGpuBuffer(readback.buffer);
+    }
+}
+
+void FrameCapture::collect(Readback &readback) {
+    glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+
+    unsigned char *destination = encoder.acquireBuffer();
+    if (!destination) {
+        droppedEncoderCount++;
+        droppedThisFrame++;
+        return;
+    }
+
+    state.bindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    void const *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(frameBytes), GL_MAP_READ_BIT);
+    if (pixels) {
+        std::memcpy(destination, pixels, frameBytes);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    state.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    // A buffer which cannot be mapped loses its frame, as if it had never been read back
+    if (!pixels) {
+        encoder.releaseBuffer(destination);
+        droppedInFlightCount++;
+        droppedThisFrame++;
+        return;
+    }
+    encoder.submit(destination, readback.frameNumber);
+
+    capturedCount++;
+    latencies.addSample(std::chrono::duration<double>(std::chrono::steady_clock::now() - readback.startTime).count());
+}
+
+void FrameCapture::captureFrame() {
+    droppedThisFrame = 0;
+
+    // Readbacks finish in order, so collecting stops at the first one still in flight
+    while (inFlightCount > 0) {
+        Readback &oldest = ring[ringStart];
+        GLenum status = glClientWaitSync(oldest.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+        collect(oldest);
+        ringStart = (ringStart + 1) % ring.size();
+        inFlightCount--;
+    }
+
+    unsigned int frameNumber = frameCount++;
+    if (inFlightCount == ring.size()) {
+        droppedInFlightCount++;
+        droppedThisFrame++;
+        return;
+    }
+
+    Readback &readback = ring[(ringStart + inFlightCount) % ring.size()];
+    state.bindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    glReadPixels(0, 0, GLsizei(width), GLsizei(height), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    state.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.frameNumber = frameNumber;
+    readback.startTime = std::chrono::steady_clock::now();
+    inFlightCount++;
+}
+
+void FrameCapture::finish() {
+    while (inFlightCount > 0) {
+        Readback &oldest = ring[ringStart];
+        glClientWaitSync(oldest.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000));
+        collect(oldest);
+        ringStart = (ringStart + 1) % ring.size();
+        inFlightCount--;
+    }
+}
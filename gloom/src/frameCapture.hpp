@@ -0,0 +1,76 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <chrono>
+#include <vector>
+#include "frameEncoder.hpp"
+#include "frameStats.hpp"
+#include "glState.hpp"
+
+// Reads rendered frames back from the GPU without waiting for them, and hands them to a
+// FrameEncoder.
+//
+// Each frame is read into one of a ring of pixel buffer objects, and a fence is placed after
+// it. Later frames collect the readbacks whose fences have passed. If every buffer in the
+// ring is still in flight, or every encoder buffer is still waiting to be encoded, the frame
+// is dropped rather than stalling rendering.
+class FrameCapture {
+public:
+    FrameCapture(GLStateCache &state, FrameEncoder &encoder, unsigned int width, unsigned int height,
+                 unsigned int ringSize = 3);
+    ~FrameCapture();
+
+    // Collects the readbacks which have finished, then starts reading back the frame just
+    // rendered into the back buffer. Should be called before swapping buffers.
+    void captureFrame();
+    // Waits for the readbacks still in flight, and hands them to the encoder
+    void finish();
+
+    // Frames counted by captureFrame(), and how many of them were handed to the encoder
+    unsigned int getFrameCount() const { return frameCount; }
+    unsigned int getCapturedCount() const { return capturedCount; }
+    // Frames dropped because the ring of buffers was full, and because the encoders were behind
+    unsigned int getDroppedInFlightCount() const { return droppedInFlightCount; }
+    unsigned int getDroppedEncoderCount() const { return droppedEncoderCount; }
+    unsigned int getDroppedCount() const { return droppedInFlightCount + droppedEncoderCount; }
+    // Dropped in the last call to captureFrame()
+    unsigned int getDroppedThisFrame() const { return droppedThisFrame; }
+
+    // Times from starting a readback until its pixels were handed over, in seconds. They are
+    // kept in a histogram of frame times, so the percentiles are rounded to its buckets.
+    double getMeanLatencySeconds() const { return latencies.getMeanSeconds(); }
+    double getMaxLatencySeconds() const { return latencies.getMaxSeconds(); }
+    double getLatencyPercentileSeconds(double fraction) const { return latencies.getPercentileSeconds(fraction); }
+
+private:
+    FrameCapture(FrameCapture const &) = delete;
+    FrameCapture & operator =(FrameCapture const &) = delete;
+
+    struct Readback {
+        GLuint buffer;
+        GLsync fence;
+        unsigned int frameNumber;
+        std::chrono::steady_clock::time_point startTime;
+    };
+
+    // Hands over the oldest readback, whose fence has passed
+    void collect(Readback &readback);
+
+    GLStateCache &state;
+    FrameEncoder &encoder;
+    unsigned int width;
+    unsigned int height;
+    size_t frameBytes;
+
+    // Readbacks in flight are the ones with a fence, oldest first from ringStart
+    std::vector<Readback> ring;
+    size_t ringStart = 0;
+    size_t inFlightCount = 0;
+
+    unsigned int frameCount = 0;
+    unsigned int capturedCount = 0;
+    unsigned int droppedInFlightCount = 0;
+    unsigned int droppedEncoderCount = 0;
+    unsigned int droppedThisFrame = 0;
+    FrameTimeHistogram latencies;
+};
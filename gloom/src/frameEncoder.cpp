@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+#include "frameEncoder.hpp"
+#include "memoryTracking.hpp"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+// Identifies raw capture files, and the version of their layout
+static const uint32_t rawFileMagic = 0x57415247; // "GRAW"
+static const uint32_t rawFileVersion = 1;
+// Bytes before the pixels in each slot of a raw file
+static const size_t rawSlotHeaderBytes = 16;
+
+static void createDirectory(std::string const &path) {
+#ifdef _WIN32
+    _mkdir(path.c_str());
+#else
+    mkdir(path.c_str(), 0755);
+#endif
+}
+
+static size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+FrameEncoder::FrameEncoder(FrameEncoderSettings const &settings)
+    : settings(settings), frameBytes(size_t(settings.width) * settings.height * 4) {
+    if (settings.format == CaptureFormat::PNG) {
+        createDirectory(settings.path);
+        stbi_flip_vertically_on_write(1);
+    } else {
+        if (!rawFile.create(settings.path)) {
+            throw std::runtime_error("Could not create the capture file \"" + settings.path + "\"");
+        }
+        rawSlotBytes = alignUp(rawSlotHeaderBytes + frameBytes, MappedFileWriter::mappingAlignment);
+
+        unsigned char *header = rawFile.mapRange(0, MappedFileWriter::mappingAlignment);
+        if (!header) {
+            throw std::runtime_error("Could not map the capture file \"" + settings.path + "\"");
+        }
+        uint32_t fields[4] = { rawFileMagic, rawFileVersion, settings.width, settings.height };
+        uint64_t slotBytes = rawSlotBytes;
+        std::memcpy(header, fields, sizeof(fields));
+        std::memcpy(header + sizeof(fields), &slotBytes, sizeof(slotBytes));
+        rawFile.unmapRange(header, MappedFileWriter::mappingAlignment);
+    }
+
+    buffers.resize(std::max(1u, settings.queueCapacity));
+    for (std::vector<unsigned char> &buffer : buffers) {
+        buffer.resize(frameBytes);
+        freeBuffers.push_back(buffer.data());
+    }
+
+    unsigned int workerCount = settings.workerCount;
+    if (workerCount == 0) {
+        workerCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    }
+    for (unsigned int i = 0; i < workerCount; i++) {
+        workers.emplace_back(&FrameEncoder::runWorker, this);
+    }
+}
+
+FrameEncoder::~FrameEncoder() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isStopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    if (rawFile.isOpen()) {
+        uint64_t slotCount = encodedCount > 0 ? uint64_t(lastFrameNumber) + 1 : 0;
+        rawFile.close(MappedFileWriter::mappingAlignment + slotCount * rawSlotBytes);
+    }
+}
+
+unsigned char *FrameEncoder::acquireBuffer() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (freeBuffers.empty()) {
+        return nullptr;
+    }
+    unsigned char *buffer = freeBuffers.back();
+    freeBuffers.pop_back();
+    return buffer;
+}
+
+void FrameEncoder::submit(unsigned char *buffer, unsigned int frameNumber) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Job job = { buffer, frameNumber };
+        jobs.push_back(job);
+    }
+    workAvailable.notify_one();
+}
+
+void FrameEncoder::releaseBuffer(unsigned char *buffer) {
+    std::lock_guard<std::mutex> lock(mutex);
+    freeBuffers.push_back(buffer);
+}
+
+void FrameEncoder::finish() {
+    std::unique_lock<std::mutex> lock(mutex);
+    workDone.wait(lock, [&]() { return jobs.empty() && busyCount == 0; });
+}
+
+unsigned int FrameEncoder::getEncodedCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return encodedCount;
+}
+
+unsigned int FrameEncoder::getFailedCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return failedCount;
+}
+
+void FrameEncoder::runWorker() {
+    // Frames are encoded while later ones are drawn, so this is not part of any frame
+    BackgroundAllocationScope backgroundScope;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        // Frames still waiting are encoded before stopping
+        workAvailable.wait(lock, [&]() { return isStopping || !jobs.empty(); });
+        if (jobs.empty()) {
+            return;
+        }
+        Job job = jobs.front();
+        jobs.pop_front();
+        busyCount++;
+
+        lock.unlock();
+        bool isEncoded = encode(job);
+        lock.lock();
+
+        busyCount--;
+        freeBuffers.push_back(job.buffer);
+        if (isEncoded) {
+            encodedCount++;
+            lastFrameNumber = std::max(lastFrameNumber, job.frameNumber);
+        } else {
+            failedCount++;
+        }
+        workDone.notify_all();
+    }
+}
+
+bool FrameEncoder::encode(Job const &job) {
+    if (settings.format == CaptureFormat::PNG) {
+        char name[32];
+        snprintf(name, sizeof(name), "/frame-%06u.png", job.frameNumber);
+        std::string path = settings.path + name;
+        if (!stbi_write_png(path.c_str(), int(settings.width), int(settings.height), 4, job.buffer, int(settings.width * 4))) {
+            fprintf(stderr, "Could not write the captured frame \"%s\"\n", path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t offset = MappedFileWriter::mappingAlignment + uint64_t(job.frameNumber) * rawSlotBytes;
+    unsigned char *slot = rawFile.mapRange(offset, rawSlotBytes);
+    if (!slot) {
+        fprintf(stderr, "Could not map frame %u of the capture file \"%s\"\n", job.frameNumber, settings.path.c_str());
+        return false;
+    }
+    uint32_t isCaptured = 1;
+    std::memcpy(slot, &isCaptured, sizeof(isCaptured));
+    std::memcpy(slot + rawSlotHeaderBytes, job.buffer, frameBytes);
+    rawFile.unmapRange(slot, rawSlotBytes);
+    return true;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "mappedFile.hpp"
+
+enum class CaptureFormat {
+    // A numbered PNG file for each frame, in a directory
+    PNG,
+    // Every frame in one file, uncompressed (see FrameEncoder)
+    RAW
+};
+
+struct FrameEncoderSettings {
+    CaptureFormat format = CaptureFormat::PNG;
+    // The directory the PNG files are written to, or the raw file
+    std::string path;
+    unsigned int width = 0;
+    unsigned int height = 0;
+    // Zero uses all but one of the hardware threads, leaving one for rendering
+    unsigned int workerCount = 0;
+    // Frames which can wait for an encoder at once. Frames arriving while that many are waiting
+    // are dropped.
+    unsigned int queueCapacity = 8;
+};
+
+// Encodes captured frames on a pool of worker threads.
+//
+// Frames are RGBA8, bottom row first as glReadPixels() returns them. PNG files are flipped to
+// the usual top row first. A raw file starts with a header of mappingAlignment bytes:
+//     uint32 magic "GRAW", uint32 version, uint32 width, uint32 height, uint64 slot size
+// followed by a slot of the given size for each frame number, starting with a uint32 of 1 if
+// the frame was captured and 0 if it was dropped, then the rows of pixels from byte 16.
+class FrameEncoder {
+public:
+    // Throws a std::runtime_error if the output cannot be created
+    FrameEncoder(FrameEncoderSettings const &settings);
+    // Encodes the frames still waiting before returning
+    ~FrameEncoder();
+
+    // Returns a buffer of width * height * 4 bytes to copy a frame into, or nullptr if every
+    // buffer is waiting for an encoder, in which case the frame should be dropped.
+    // Only to be called by the thread submitting the frames.
+    unsigned char *acquireBuffer();
+    // Queues a buffer from acquireBuffer() for encoding as the given frame
+    void submit(unsigned char *buffer, unsigned int frameNumber);
+    // Gives back a buffer from acquireBuffer() without encoding it
+    void releaseBuffer(unsigned char *buffer);
+
+    // Waits until every submitted frame has been encoded
+    void finish();
+
+    unsigned int getEncodedCount();
+    unsigned int getFailedCount();
+    unsigned int getWorkerCount() const { return unsigned(workers.size()); }
+
+private:
+    FrameEncoder(FrameEncoder const &) = delete;
+    FrameEncoder & operator =(FrameEncoder const &) = delete;
+
+    struct Job {
+        unsigned char *buffer;
+        unsigned int frameNumber;
+    };
+
+    void runWorker();
+    bool encode(Job const &job);
+
+    FrameEncoderSettings settings;
+    size_t frameBytes;
+    size_t rawSlotBytes = 0;
+    MappedFileWriter rawFile;
+    std::vector<std::vector<unsigned char>> buffers;
+
+    // Shared with the worker threads, guarded by the mutex
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable workDone;
+    std::deque<Job> jobs;
+    std::vector<unsigned char*> freeBuffers;
+    unsigned int busyCount = 0;
+    unsigned int encodedCount = 0;
+    unsigned int failedCount = 0;
+    unsigned int lastFrameNumber = 0;
+    bool isStopping = false;
+
+    std::vector<std::thread> workers;
+};
@@ -0,0 +1,54 @@
+#include <algorithm>
+#include <thread>
+#include "framePacing.hpp"
+
+typedef std::chrono::steady_clock steadyClock;
+
+// Bounds for the busy-wait margin. The lower bound keeps us from relying on
+// sub-millisecond sleeps, the upper bound keeps a bad sleep from wasting a whole frame spinning.
+static const steadyClock::duration minimumSpinMargin = std::chrono::microseconds(500);
+static const steadyClock::duration maximumSpinMargin = std::chrono::microseconds(4000);
+
+FrameLimiter::FrameLimiter(double targetFramesPerSecond) {
+    framePeriod = std::chrono::duration_cast<steadyClock::duration>(
+        std::chrono::duration<double>(1.0 / targetFramesPerSecond));
+    nextFrameTime = steadyClock::now();
+    spinMargin = std::chrono::microseconds(1500);
+}
+
+void FrameLimiter::waitForNextFrame() {
+    nextFrameTime += framePeriod;
+
+    steadyClock::time_point now = steadyClock::now();
+
+    // If we have fallen more than a frame behind, start over from now rather than
+    // rendering a burst of frames back to back to catch up. Smaller delays fall through
+    // without waiting, and the schedule is kept so the next frame makes up for them.
+    if (now - nextFrameTime > framePeriod) {
+        nextFrameTime = now;
+        return;
+    }
+
+    // Sleep through most of the wait
+    steadyClock::time_point wakeTime = nextFrameTime - spinMargin;
+    if (now < wakeTime) {
+        std::this_thread::sleep_until(wakeTime);
+
+        // Adapt the margin to how much the sleep overshot: grow quickly, shrink slowly
+        steadyClock::duration overshoot = steadyClock::now() - wakeTime;
+        if (overshoot * 2 > spinMargin) {
+            spinMargin = std::min(maximumSpinMargin, overshoot * 2);
+        } else {
+            spinMargin = std::max(minimumSpinMargin, spinMargin - spinMargin / 16);
+        }
+    }
+
+    // Spin for the remainder
+    while (steadyClock::now() < nextFrameTime) {
+        std::this_thread::yield();
+    }
+}
+
+double FrameLimiter::getTargetFrameSeconds() const {
+    return std::chrono::duration<double>(framePeriod).count();
+}
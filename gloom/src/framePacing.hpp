@@ -0,0 +1,24 @@
+#pragma once
+
+#include <chrono>
+
+// Limits the frame rate to a fixed target without relying on vsync.
+// Waiting is done with a hybrid strategy: the thread sleeps for most of the remaining time,
+// and busy-waits for the last part, since sleeping alone routinely overshoots by a millisecond
+// or more. The busy-wait margin adapts to how much the operating system oversleeps.
+class FrameLimiter {
+public:
+    FrameLimiter(double targetFramesPerSecond);
+
+    // Blocks until it is time to start the next frame.
+    void waitForNextFrame();
+
+    double getTargetFrameSeconds() const;
+
+private:
+    std::chrono::steady_clock::duration framePeriod;
+    std::chrono::steady_clock::time_point nextFrameTime;
+
+    // How long before the deadline we stop sleeping and start spinning
+    std::chrono::steady_clock::duration spinMargin;
+};
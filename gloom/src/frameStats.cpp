@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "frameStats.hpp"
+
+const unsigned int FrameTimeHistogram::bucketCount;
+constexpr double FrameTimeHistogram::bucketWidthSeconds;
+constexpr double FrameStatistics::hitchFactor;
+
+static const char* sectionNames[FRAME_SECTION_COUNT] = {
+    "pacing", "update", "traversal", "occluders", "draw", "capture", "swap", "input-to-submit", "frame"
+};
+
+static const char* counterNames[FRAME_COUNTER_COUNT] = {
+    "triangles", "triangles-no-lod", "clusters", "clusters-culled", "triangles-culled",
+    "nodes-occluded", "chunks-resident", "chunk-megabytes", "chunks-uploaded",
+    "gl-calls", "gl-calls-elided", "capture-dropped", "allocations"
+};
+
+FrameTimeHistogram::FrameTimeHistogram() {
+    clear();
+}
+
+void FrameTimeHistogram::addSample(double seconds) {
+    unsigned int bucket = bucketCount - 1;
+    if (seconds < bucketCount * bucketWidthSeconds) {
+        bucket = std::max(0, int(seconds / bucketWidthSeconds));
+    }
+    buckets[bucket]++;
+    sampleCount++;
+    sumSeconds += seconds;
+    maxSeconds = std::max(maxSeconds, seconds);
+}
+
+void FrameTimeHistogram::clear() {
+    std::memset(buckets, 0, sizeof(buckets));
+    sampleCount = 0;
+    sumSeconds = 0.0;
+    maxSeconds = 0.0;
+}
+
+double FrameTimeHistogram::getMeanSeconds() const {
+    return (sampleCount > 0) ? sumSeconds / sampleCount : 0.0;
+}
+
+double FrameTimeHistogram::getPercentileSeconds(double fraction) const {
+    if (sampleCount == 0) {
+        return 0.0;
+    }
+
+    // The rank of the sample we are looking for, counting from 1
+    unsigned int rank = std::max(1u, unsigned(fraction * sampleCount + 0.5));
+    unsigned int accumulated = 0;
+
+    for (unsigned int bucket = 0; bucket < bucketCount - 1; bucket++) {
+        accumulated += buckets[bucket];
+        if (accumulated >= rank) {
+            // Report the middle of the bucket, but never more than the largest sample seen
+            return std::min((bucket + 0.5) * bucketWidthSeconds, maxSeconds);
+        }
+    }
+
+    // The sample is in the overflow bucket, so the maximum is the best estimate we have
+    return maxSeconds;
+}
+
+unsigned int FrameTimeHistogram::countSamplesAbove(double seconds) const {
+    if (sampleCount == 0 || seconds >= maxSeconds) {
+        return 0;
+    }
+
+    unsigned int thresholdBucket = bucketCount - 1;
+    if (seconds < bucketCount * bucketWidthSeconds) {
+        thresholdBucket = std::max(0, int(seconds / bucketWidthSeconds));
+    }
+
+    // The samples in the bucket holding the threshold are taken to be spread evenly over it,
+    // and the share of them above the threshold is counted. The overflow bucket ends at the maximum.
+    double bucketStart = thresholdBucket * bucketWidthSeconds;
+    double bucketEnd = (thresholdBucket == bucketCount - 1) ? maxSeconds : bucketStart + bucketWidthSeconds;
+    double fractionAbove = std::max(0.0, std::min(1.0, (bucketEnd - seconds) / (bucketEnd - bucketStart)));
+    double count = buckets[thresholdBucket] * fractionAbove;
+
+    for (unsigned int bucket = thresholdBucket + 1; bucket < bucketCount; bucket++) {
+        count += buckets[bucket];
+    }
+    return unsigned(count + 0.5);
+}
+
+
+FrameStatistics::FrameStatistics(double reportInterval, std::string const &outputFileName)
+        : reportClock("report"),
+          reportIntervalSeconds(reportInterval),
+          elapsedSeconds(0.0),
+          writeJson(false),
+          isFirstRecord(true) {
+    for (int section = 0; section < FRAME_SECTION_COUNT; section++) {
+        sectionClocks.emplace_back(sectionNames[section]);
+    }
+    histograms.resize(FRAME_SECTION_COUNT);
+
+    for (int counter = 0; counter < FRAME_COUNTER_COUNT; counter++) {
+        currentCounters[counter] = 0.0;
+        counterSums[counter] = 0.0;
+        counterMaxima[counter] = 0.0;
+    }
+
+    if (!outputFileName.empty()) {
+        outputFile.open(outputFileName);
+        if (!outputFile) {
+            fprintf(stderr, "Could not open frame statistics file \"%s\" for writing.\n", outputFileName.c_str());
+            return;
+        }
+
+        std::string extension = outputFileName.substr(outputFileName.rfind('.') + 1);
+        writeJson = (extension == "json");
+
+        if (writeJson) {
+            outputFile << "[\n";
+        } else {
+            // Times are in milliseconds; counters only have a mean and maximum per frame
+            outputFile << "time,name,frames,mean,p50,p95,p99,max,hitches\n";
+        }
+    }
+}
+
+FrameStatistics::~FrameStatistics() {
+    // Frames since the last periodic report would otherwise be lost
+    if (histograms[FRAME_SECTION_TOTAL].getSampleCount() > 0) {
+        report();
+    }
+
+    if (outputFile.is_open() && writeJson) {
+        outputFile << "\n]\n";
+    }
+}
+
+void FrameStatistics::beginSection(FrameSection section) {
+    sectionClocks[section].reset();
+}
+
+void FrameStatistics::endSection(FrameSection section) {
+    histograms[section].addSample(sectionClocks[section].getTimeDeltaSeconds());
+}
+
+void FrameStatistics::endFrame() {
+    histograms[FRAME_SECTION_TOTAL].addSample(sectionClocks[FRAME_SECTION_TOTAL].getTimeDeltaSeconds());
+
+    for (int counter = 0; counter < FRAME_COUNTER_COUNT; counter++) {
+        counterSums[counter] += currentCounters[counter];
+        counterMaxima[counter] = std::max(counterMaxima[counter], currentCounters[counter]);
+        currentCounters[counter] = 0.0;
+    }
+
+    if (reportClock.peekTimeDeltaSeconds() >= reportIntervalSeconds) {
+        report();
+    }
+}
+
+void FrameStatistics::report() {
+    elapsedSeconds += reportClock.getTimeDeltaSeconds();
+
+    // Hitches are judged against the median of the whole frame, not of the individual sections
+    double hitchThreshold = hitchFactor * histograms[FRAME_SECTION_TOTAL].getPercentileSeconds(0.5);
+
+    printf("Frame statistics after %.1f s (ms):        mean     p50     p95     p99     max  hitches\n", elapsedSeconds);
+    for (int section = 0; section < FRAME_SECTION_COUNT; section++) {
+        FrameTimeHistogram const &histogram = histograms[section];
+        unsigned int hitchCount = histogram.countSamplesAbove(hitchThreshold);
+        printf("    %-15s %6u frames  %7.3f %7.3f %7.3f %7.3f %7.3f %8u\n",
+               sectionNames[section],
+               histogram.getSampleCount(),
+               1000.0 * histogram.getMeanSeconds(),
+               1000.0 * histogram.getPercentileSeconds(0.50),
+               1000.0 * histogram.getPercentileSeconds(0.95),
+               1000.0 * histogram.getPercentileSeconds(0.99),
+               1000.0 * histogram.getMaxSeconds(),
+               hitchCount);
+
+        if (outputFile.is_open()) {
+            writeRecord(FrameSection(section), hitchCount);
+        }
+    }
+
+    unsigned int frameCount = histograms[FRAME_SECTION_TOTAL].getSampleCount();
+    for (int counter = 0; counter < FRAME_COUNTER_COUNT; counter++) {
+        printf("    %-18s per frame: mean %.1f, max %.0f\n",
+               counterNames[counter],
+               (frameCount > 0) ? counterSums[counter] / frameCount : 0.0,
+               counterMaxima[counter]);
+
+        if (outputFile.is_open()) {
+            writeCounterRecord(FrameCounter(counter));
+        }
+    }
+    fflush(stdout);
+
+    for (FrameTimeHistogram &histogram : histograms) {
+        histogram.clear();
+    }
+    for (int counter = 0; counter < FRAME_COUNTER_COUNT; counter++) {
+        counterSums[counter] = 0.0;
+        counterMaxima[counter] = 0.0;
+    }
+}
+
+void FrameStatistics::writeRecord(FrameSection section, unsigned int hitchCount) {
+    FrameTimeHistogram const &histogram = histograms[section];
+    char record[256];
+
+    if (writeJson) {
+        snprintf(record, sizeof(record),
+                 "%s  {\"time\": %.3f, \"section\": \"%s\", \"frames\": %u, \"mean_ms\": %.4f, "
+                 "\"p50_ms\": %.4f, \"p95_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f, \"hitches\": %u}",
+                 isFirstRecord ? "" : ",\n",
+                 elapsedSeconds, sectionNames[section], histogram.getSampleCount(),
+                 1000.0 * histogram.getMeanSeconds(),
+                 1000.0 * histogram.getPercentileSeconds(0.50),
+                 1000.0 * histogram.getPercentileSeconds(0.95),
+                 1000.0 * histogram.getPercentileSeconds(0.99),
+                 1000.0 * histogram.getMaxSeconds(),
+                 hitchCount);
+    } else {
+        snprintf(record, sizeof(record), "%.3f,%s,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%u\n",
+                 elapsedSeconds, sectionNames[section], histogram.getSampleCount(),
+                 1000.0 * histogram.getMeanSeconds(),
+                 1000.0 * histogram.getPercentileSeconds(0.50),
+                 1000.0 * histogram.getPercentileSeconds(0.95),
+                 1000.0 * histogram.getPercentileSeconds(0.99),
+                 1000.0 * histogram.getMaxSeconds(),
+                 hitchCount);
+    }
+
+    outputFile << record;
+    outputFile.flush();
+    isFirstRecord = false;
+}
+
+void FrameStatistics::writeCounterRecord(FrameCounter counter) {
+    unsigned int frameCount = histograms[FRAME_SECTION_TOTAL].getSampleCount();
+    double mean = (frameCount > 0) ? counterSums[counter] / frameCount : 0.0;
+    char record[256];
+
+    if (writeJson) {
+        snprintf(record, sizeof(record),
+                 "%s  {\"time\": %.3f, \"counter\": \"%s\", \"frames\": %u, \"mean\": %.2f, \"max\": %.0f}",
+                 isFirstRecord ? "" : ",\n",
+                 elapsedSeconds, counterNames[counter], frameCount, mean, counterMaxima[counter]);
+    } else {
+        snprintf(record, sizeof(record), "%.3f,%s,%u,%.2f,,,,%.0f,\n",
+                 elapsedSeconds, counterNames[counter], frameCount, mean, counterMaxima[counter]);
+    }
+
+    outputFile << record;
+    outputFile.flush();
+    isFirstRecord = false;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "toolbox.hpp"
+
+// The parts of a frame which are timed separately.
+// FRAME_SECTION_INPUT_LATENCY overlaps the others; it runs from when keyboard input is
+// sampled until all draw calls depending on it have been submitted.
+// FRAME_SECTION_TOTAL covers the whole frame, from one endFrame() call to the next.
+enum FrameSection {
+    FRAME_SECTION_PACING = 0,
+    FRAME_SECTION_UPDATE,
+    FRAME_SECTION_TRAVERSAL,
+    FRAME_SECTION_OCCLUDERS,
+    FRAME_SECTION_DRAW,
+    FRAME_SECTION_CAPTURE,
+    FRAME_SECTION_SWAP,
+    FRAME_SECTION_INPUT_LATENCY,
+    FRAME_SECTION_TOTAL,
+    FRAME_SECTION_COUNT
+};
+
+// Quantities which are counted every frame, such as the amount of geometry submitted.
+enum FrameCounter {
+    FRAME_COUNTER_TRIANGLES_SUBMITTED = 0,
+    FRAME_COUNTER_TRIANGLES_WITHOUT_LOD,
+    FRAME_COUNTER_CLUSTERS,
+    FRAME_COUNTER_CLUSTERS_CULLED,
+    FRAME_COUNTER_TRIANGLES_CULLED,
+    FRAME_COUNTER_NODES_OCCLUDED,
+    FRAME_COUNTER_CHUNKS_RESIDENT,
+    FRAME_COUNTER_CHUNK_MEGABYTES,
+    FRAME_COUNTER_CHUNKS_UPLOADED,
+    // State changes and uniform uploads made while drawing, and those skipped as redundant
+    FRAME_COUNTER_GL_CALLS,
+    FRAME_COUNTER_GL_CALLS_ELIDED,
+    // Frames which were not captured, to avoid stalling on the readback or the encoders
+    FRAME_COUNTER_CAPTURE_DROPPED,
+    // Allocations made by the main thread, which are only counted when memory tracking is built in
+    FRAME_COUNTER_ALLOCATIONS,
+    FRAME_COUNTER_COUNT
+};
+
+// A histogram of frame times with a fixed number of equally wide buckets.
+// Adding a sample never allocates, so it is safe to use inside the rendering loop.
+// Times beyond the last bucket are counted in the last bucket, but the exact maximum is kept.
+class FrameTimeHistogram {
+public:
+    static const unsigned int bucketCount = 5000;
+    static constexpr double bucketWidthSeconds = 20e-6;
+
+    FrameTimeHistogram();
+
+    void addSample(double seconds);
+    void clear();
+
+    unsigned int getSampleCount() const { return sampleCount; }
+    double getMeanSeconds() const;
+    double getMaxSeconds() const { return maxSeconds; }
+
+    // Returns the time below which the given fraction (0 to 1) of the samples lie.
+    double getPercentileSeconds(double fraction) const;
+
+    // Returns the number of samples which took longer than the given time. Samples in the same
+    // bucket as the time are interpolated, assuming they are spread evenly over the bucket.
+    unsigned int countSamplesAbove(double seconds) const;
+
+private:
+    unsigned int buckets[bucketCount];
+    unsigned int sampleCount;
+    double sumSeconds;
+    double maxSeconds;
+};
+
+// Records the CPU time spent in each section of every frame, and periodically prints
+// a summary (mean, p50/p95/p99/max and hitch count) of the frames since the previous one,
+// along with the mean and maximum per frame of each counter.
+// If an output file is given, the summaries are also written to it; a file name ending in
+// ".json" produces a JSON array, anything else produces CSV.
+class FrameStatistics {
+public:
+    // A frame counts as a hitch when it takes more than this many times the median frame time.
+    static constexpr double hitchFactor = 2.0;
+
+    FrameStatistics(double reportIntervalSeconds, std::string const &outputFile = "");
+    ~FrameStatistics();
+
+    // Starts timing a section of the current frame.
+    void beginSection(FrameSection section);
+
+    // Stops timing a section and records the time spent in it.
+    void endSection(FrameSection section);
+
+    // Adds to one of the counters for the current frame.
+    void addToCounter(FrameCounter counter, double amount) { currentCounters[counter] += amount; }
+
+    // Records the total frame time and the counters, and prints a report if the report interval has passed.
+    void endFrame();
+
+    // Prints and writes a summary of all frames since the previous report, and clears the histograms.
+    void report();
+
+private:
+    FrameStatistics(FrameStatistics const &) = delete;
+    FrameStatistics & operator =(FrameStatistics const &) = delete;
+
+    void writeRecord(FrameSection section, unsigned int hitchCount);
+    void writeCounterRecord(FrameCounter counter);
+
+    std::vector<Clock> sectionClocks;
+    std::vector<FrameTimeHistogram> histograms;
+    double currentCounters[FRAME_COUNTER_COUNT];
+    double counterSums[FRAME_COUNTER_COUNT];
+    double counterMaxima[FRAME_COUNTER_COUNT];
+
+    Clock reportClock;
+    double reportIntervalSeconds;
+    double elapsedSeconds;
+
+    std::ofstream outputFile;
+    bool writeJson;
+    bool isFirstRecord;
+};
@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <cstring>
+#include "glState.hpp"
+
+GLStateCache::GLStateCache(GLFunctions const &functions)
+        : functions(functions) {}
+
+void GLStateCache::useProgram(GLuint newProgram) {
+    bool isIssued = !isProgramKnown || program != newProgram;
+    if (isIssued) {
+        functions.useProgram(newProgram);
+        program = newProgram;
+        isProgramKnown = true;
+    }
+    countCall(isIssued);
+}
+
+void GLStateCache::bindVertexArray(GLuint newVertexArray) {
+    bool isIssued = !isVertexArrayKnown || vertexArray != newVertexArray;
+    if (isIssued) {
+        functions.bindVertexArray(newVertexArray);
+        vertexArray = newVertexArray;
+        isVertexArrayKnown = true;
+
+        // The element array buffer binding is part of the vertex array's state
+        buffers.erase(std::remove_if(buffers.begin(), buffers.end(), [](BufferBinding const &binding) {
+            return binding.target == GL_ELEMENT_ARRAY_BUFFER;
+        }), buffers.end());
+    }
+    countCall(isIssued);
+}
+
+void GLStateCache::bindBuffer(GLenum target, GLuint buffer) {
+    auto binding = std::find_if(buffers.begin(), buffers.end(), [&](BufferBinding const &binding) {
+        return binding.target == target;
+    });
+
+    bool isIssued = binding == buffers.end() || binding->buffer != buffer;
+    if (isIssued) {
+        functions.bindBuffer(target, buffer);
+        if (binding == buffers.end()) {
+            BufferBinding newBinding = { target, buffer };
+            buffers.push_back(newBinding);
+        } else {
+            binding->buffer = buffer;
+        }
+    }
+    countCall(isIssued);
+}
+
+void GLStateCache::forgetProgram(GLuint deletedProgram) {
+    // A deleted program stays in use until another one is, so this only matters if its
+    // name is reused
+    if (isProgramKnown && program == deletedProgram) {
+        isProgramKnown = false;
+    }
+}
+
+void GLStateCache::forgetVertexArray(GLuint deletedVertexArray) {
+    if (isVertexArrayKnown && vertexArray == deletedVertexArray) {
+        vertexArray = 0;
+        buffers.erase(std::remove_if(buffers.begin(), buffers.end(), [](BufferBinding const &binding) {
+            return binding.target == GL_ELEMENT_ARRAY_BUFFER;
+        }), buffers.end());
+    }
+}
+
+void GLStateCache::forgetBuffer(GLuint deletedBuffer) {
+    for (BufferBinding &binding : buffers) {
+        if (binding.buffer == deletedBuffer) {
+            binding.buffer = 0;
+        }
+    }
+}
+
+void GLStateCache::invalidate() {
+    isProgramKnown = false;
+    isVertexArrayKnown = false;
+    buffers.clear();
+}
+
+
+// Size in bytes of one element of a uniform of the given type
+static size_t getUniformTypeSize(GLenum type) {
+    switch (type) {
+        case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_BOOL_VEC2: return 8;
+        case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_BOOL_VEC3: return 12;
+        case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_BOOL_VEC4: case GL_FLOAT_MAT2: return 16;
+        case GL_FLOAT_MAT3: return 36;
+        case GL_FLOAT_MAT4: return 64;
+        // Scalars, including samplers and images, which are set as integers
+        default: return 4;
+    }
+}
+
+// Array uniforms are reported as "name[0]"
+static std::string removeArrayIndex(std::string const &name) {
+    size_t bracket = name.find('[');
+    return bracket == std::string::npos ? name : name.substr(0, bracket);
+}
+
+ProgramInterface::ProgramInterface(GLStateCache &state, GLuint program)
+        : state(state), program(program) {
+    GLFunctions const &gl = state.getFunctions();
+
+    GLint uniformCount = 0;
+    GLint maxNameLength = 0;
+    gl.getProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+    gl.getProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    std::vector<GLchar> name(std::max(maxNameLength, 1));
+
+    for (GLint i = 0; i < uniformCount; i++) {
+        GLsizei nameLength = 0;
+        GLint arraySize = 0;
+        GLenum type = 0;
+        gl.getActiveUniform(program, GLuint(i), GLsizei(name.size()), &nameLength, &arraySize, &type, name.data());
+
+        // Uniforms in uniform blocks have no location, and are not set through here
+        GLint location = gl.getUniformLocation(program, name.data());
+        if (location < 0) {
+            continue;
+        }
+
+        uniformLocations[removeArrayIndex(std::string(name.data(), nameLength))] = location;
+        Uniform uniform = { values.size(), getUniformTypeSize(type) * size_t(std::max(arraySize, 1)), false };
+        uniforms[location] = uniform;
+        values.resize(values.size() + uniform.valueSize);
+    }
+
+    GLint attributeCount = 0;
+    gl.getProgramiv(program, GL_ACTIVE_ATTRIBUTES, &attributeCount);
+    gl.getProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxNameLength);
+    name.resize(std::max(maxNameLength, 1));
+
+    for (GLint i = 0; i < attributeCount; i++) {
+        GLsizei nameLength = 0;
+        GLint arraySize = 0;
+        GLenum type = 0;
+        gl.getActiveAttrib(program, GLuint(i), GLsizei(name.size()), &nameLength, &arraySize, &type, name.data());
+        attributeLocations[std::string(name.data(), nameLength)] = gl.getAttribLocation(program, name.data());
+    }
+}
+
+GLint ProgramInterface::getUniformLocation(std::string const &name) const {
+    auto location = uniformLocations.find(name);
+    return location == uniformLocations.end() ? -1 : location->second;
+}
+
+GLint ProgramInterface::getAttributeLocation(std::string const &name) const {
+    auto location = attributeLocations.find(name);
+    return location == attributeLocations.end() ? -1 : location->second;
+}
+
+bool ProgramInterface::updateValue(GLint location, void const *data, size_t &size) {
+    auto found = uniforms.find(location);
+    if (found == uniforms.end()) {
+        return false;
+    }
+
+    Uniform &uniform = found->second;
+    size = std::min(size, uniform.valueSize);
+    unsigned char *value = &values[uniform.valueOffset];
+    if (uniform.hasValue && std::memcmp(value, data, size) == 0) {
+        state.countCall(false);
+        return false;
+    }
+
+    std::memcpy(value, data, size);
+    uniform.hasValue = true;
+    state.useProgram(program);
+    state.countCall(true);
+    return true;
+}
+
+void ProgramInterface::setUniform(GLint location, int value) {
+    size_t size = sizeof(value);
+    if (updateValue(location, &value, size)) {
+        state.getFunctions().uniform1i(location, value);
+    }
+}
+
+void ProgramInterface::setUniform(GLint location, float value) {
+    size_t size = sizeof(value);
+    if (updateValue(location, &value, size)) {
+        state.getFunctions().uniform1f(location, value);
+    }
+}
+
+void ProgramInterface::setUniform(GLint location, float4 value) {
+    float components[4] = { value.x, value.y, value.z, value.w };
+    size_t size = sizeof(components);
+    if (updateValue(location, components, size)) {
+        state.getFunctions().uniform4fv(location, 1, components);
+    }
+}
+
+void ProgramInterface::setUniform(GLint location, glm::mat4 const *matrices, unsigned int count) {
+    size_t size = count * sizeof(glm::mat4);
+    if (updateValue(location, &matrices[0][0][0], size)) {
+        state.getFunctions().uniformMatrix4fv(location, GLsizei(size / sizeof(glm::mat4)), GL_FALSE, &matrices[0][0][0]);
+    }
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include "floats.hpp"
+
+// The OpenGL functions used by GLStateCache and ProgramInterface. They only call OpenGL through
+// this table, so that a table of mock functions can stand in for OpenGL when checking them.
+struct GLFunctions {
+    PFNGLUSEPROGRAMPROC useProgram;
+    PFNGLBINDVERTEXARRAYPROC bindVertexArray;
+    PFNGLBINDBUFFERPROC bindBuffer;
+    PFNGLGETPROGRAMIVPROC getProgramiv;
+    PFNGLGETACTIVEUNIFORMPROC getActiveUniform;
+    PFNGLGETACTIVEATTRIBPROC getActiveAttrib;
+    PFNGLGETUNIFORMLOCATIONPROC getUniformLocation;
+    PFNGLGETATTRIBLOCATIONPROC getAttribLocation;
+    PFNGLUNIFORM1IPROC uniform1i;
+    PFNGLUNIFORM1FPROC uniform1f;
+    PFNGLUNIFORM4FVPROC uniform4fv;
+    PFNGLUNIFORMMATRIX4FVPROC uniformMatrix4fv;
+};
+
+// The functions of the current OpenGL context. Only valid once glad has loaded them.
+inline GLFunctions loadGLFunctions() {
+    GLFunctions functions;
+    functions.useProgram = glUseProgram;
+    functions.bindVertexArray = glBindVertexArray;
+    functions.bindBuffer = glBindBuffer;
+    functions.getProgramiv = glGetProgramiv;
+    functions.getActiveUniform = glGetActiveUniform;
+    functions.getActiveAttrib = glGetActiveAttrib;
+    functions.getUniformLocation = glGetUniformLocation;
+    functions.getAttribLocation = glGetAttribLocation;
+    functions.uniform1i = glUniform1i;
+    functions.uniform1f = glUniform1f;
+    functions.uniform4fv = glUniform4fv;
+    functions.uniformMatrix4fv = glUniformMatrix4fv;
+    return functions;
+}
+
+// Numbers of state changes and uniform uploads passed on to OpenGL, and of those skipped
+// because they would not have changed anything
+struct GLCallCounts {
+    unsigned long long issued = 0;
+    unsigned long long elided = 0;
+};
+
+// Keeps track of the bound program, vertex array and buffers, and skips binding whatever is
+// already bound. Everything bound while the cache is in use has to go through it, or the
+// cache has to be invalidated afterwards.
+class GLStateCache {
+public:
+    explicit GLStateCache(GLFunctions const &functions);
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vertexArray);
+    void bindBuffer(GLenum target, GLuint buffer);
+
+    // Deleting an object unbinds it, so the cache has to be told about it
+    void forgetProgram(GLuint program);
+    void forgetVertexArray(GLuint vertexArray);
+    void forgetBuffer(GLuint buffer);
+    // Forgets all bindings, after OpenGL has been called without going through the cache
+    void invalidate();
+
+    GLuint getProgram() const { return isProgramKnown ? program : 0; }
+
+    GLFunctions const &getFunctions() const { return functions; }
+    GLCallCounts const &getCallCounts() const { return counts; }
+    // Counts a call made on behalf of the cache, such as a uniform upload
+    void countCall(bool isIssued) { isIssued ? counts.issued++ : counts.elided++; }
+
+private:
+    struct BufferBinding {
+        GLenum target;
+        GLuint buffer;
+    };
+
+    GLFunctions functions;
+    GLCallCounts counts;
+
+    bool isProgramKnown = false;
+    GLuint program = 0;
+    bool isVertexArrayKnown = false;
+    GLuint vertexArray = 0;
+    // The known buffer bindings. Targets missing from it are unknown.
+    std::vector<BufferBinding> buffers;
+};
+
+// The active uniforms and attributes of a linked program, looked up once when it is created.
+// Uniforms are set through typed setters, which skip uploading values the uniform already has.
+class ProgramInterface {
+public:
+    ProgramInterface(GLStateCache &state, GLuint program);
+
+    // Locations are -1 for names which are not active in the program. Arrays are found by
+    // their name without an index.
+    GLint getUniformLocation(std::string const &name) const;
+    GLint getAttributeLocation(std::string const &name) const;
+
+    // Setting a uniform makes the program current. Locations of -1 are ignored, as OpenGL does.
+    void setUniform(GLint location, int value);
+    void setUniform(GLint location, float value);
+    void setUniform(GLint location, float4 value);
+    void setUniform(GLint location, glm::mat4 const *matrices, unsigned int count = 1);
+
+    GLuint getProgram() const { return program; }
+
+private:
+    struct Uniform {
+        // Where the uniform's last value is kept in values
+        size_t valueOffset;
+        size_t valueSize;
+        bool hasValue;
+    };
+
+    // Stores a new value for a uniform, and returns whether it differs from the last one.
+    // Values larger than the uniform are cut off.
+    bool updateValue(GLint location, void const *data, size_t &size);
+
+    GLStateCache &state;
+    GLuint program;
+    std::unordered_map<std::string, GLint> uniformLocations;
+    std::unordered_map<std::string, GLint> attributeLocations;
+    std::unordered_map<GLint, Uniform> uniforms;
+    std::vector<unsigned char> values;
+};
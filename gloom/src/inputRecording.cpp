@@ -0,0 +1,91 @@
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include "inputRecording.hpp"
+
+static const char fileMagic[8] = { 'G', 'L', 'O', 'O', 'M', 'R', 'E', 'C' };
+static const uint32_t fileVersion = 1;
+
+// The values are stored in the byte order of the machine, which is little endian on
+// every platform we run on. Recordings are not meant to be moved to other architectures.
+template <class T>
+static void writeValue(std::ofstream &file, T value) {
+    file.write(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+
+template <class T>
+static bool readValue(std::ifstream &file, T &value) {
+    return bool(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+
+InputRecorder::InputRecorder(std::string const &fileName, uint32_t randomSeed)
+        : file(fileName, std::ios::binary), frameCount(0) {
+    if (!file) {
+        throw std::runtime_error("Could not open the recording file '" + fileName + "' for writing.");
+    }
+
+    file.write(fileMagic, sizeof(fileMagic));
+    writeValue(file, fileVersion);
+    writeValue(file, randomSeed);
+}
+
+void InputRecorder::recordFrame(RecordedFrame const &frame) {
+    writeValue(file, frame.deltaTime);
+    writeValue(file, frame.keyState);
+    writeValue(file, frame.transformChecksum);
+    frameCount++;
+}
+
+
+InputReplayer::InputReplayer(std::string const &fileName)
+        : file(fileName, std::ios::binary), frameCount(0), divergentFrameCount(0) {
+    if (!file) {
+        throw std::runtime_error("Could not open the recording file '" + fileName + "'. Check if the path is correct.");
+    }
+
+    char magic[sizeof(fileMagic)];
+    uint32_t version = 0;
+    file.read(magic, sizeof(magic));
+    readValue(file, version);
+
+    if (!file || std::memcmp(magic, fileMagic, sizeof(fileMagic)) != 0 || version != fileVersion) {
+        throw std::runtime_error("The file '" + fileName + "' is not a recording made by this version of gloom.");
+    }
+
+    readValue(file, randomSeed);
+}
+
+InputReplayer::~InputReplayer() {
+    if (divergentFrameCount == 0) {
+        printf("Replay finished: all %u frames matched the recording.\n", frameCount);
+    } else {
+        printf("Replay finished: %u of %u frames diverged from the recording.\n", divergentFrameCount, frameCount);
+    }
+}
+
+bool InputReplayer::readFrame(RecordedFrame &frame) {
+    if (!readValue(file, currentFrame.deltaTime) ||
+        !readValue(file, currentFrame.keyState) ||
+        !readValue(file, currentFrame.transformChecksum)) {
+        return false;
+    }
+
+    frame = currentFrame;
+    frameCount++;
+    return true;
+}
+
+void InputReplayer::verifyChecksum(uint64_t transformChecksum) {
+    if (transformChecksum == currentFrame.transformChecksum) {
+        return;
+    }
+
+    if (divergentFrameCount == 0) {
+        fprintf(stderr, "Replay diverged from the recording at frame %u (checksum %016llx, expected %016llx).\n",
+                frameCount - 1,
+                (unsigned long long) transformChecksum,
+                (unsigned long long) currentFrame.transformChecksum);
+    }
+    divergentFrameCount++;
+}
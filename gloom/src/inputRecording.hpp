@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// Everything needed to reproduce a single frame of a run: the time step the animations were
+// advanced by, the keys held down, and a checksum of the resulting scene graph transformations.
+struct RecordedFrame {
+    double deltaTime;
+    uint32_t keyState;
+    uint64_t transformChecksum;
+};
+
+// Writes the frames of a run to a compact binary file, so it can be replayed later.
+//
+// File layout (little endian):
+//     char[8]  magic "GLOOMREC"
+//     uint32   format version
+//     uint32   random number generator seed
+//     then per frame: float64 delta time, uint32 key state, uint64 transformation checksum
+class InputRecorder {
+public:
+    InputRecorder(std::string const &fileName, uint32_t randomSeed);
+
+    void recordFrame(RecordedFrame const &frame);
+
+    unsigned int getFrameCount() const { return frameCount; }
+
+private:
+    std::ofstream file;
+    unsigned int frameCount;
+};
+
+// Reads back a file written by InputRecorder one frame at a time, and compares the
+// transformation checksums of the replayed run against the recorded ones.
+class InputReplayer {
+public:
+    InputReplayer(std::string const &fileName);
+    ~InputReplayer();
+
+    uint32_t getRandomSeed() const { return randomSeed; }
+
+    // Reads the next frame. Returns false when the recording has ended.
+    bool readFrame(RecordedFrame &frame);
+
+    // Compares the checksum of the current frame in this run against the recorded one.
+    // Prints a message the first time the runs diverge.
+    void verifyChecksum(uint64_t transformChecksum);
+
+    unsigned int getFrameCount() const { return frameCount; }
+    unsigned int getDivergentFrameCount() const { return divergentFrameCount; }
+
+private:
+    std::ifstream file;
+    uint32_t randomSeed;
+    RecordedFrame currentFrame;
+    unsigned int frameCount;
+    unsigned int divergentFrameCount;
+};
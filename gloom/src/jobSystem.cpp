@@ -0,0 +1,321 @@
+#include <algorithm>
+#include "jobSystem.hpp"
+
+struct Job {
+    Job(std::function<void()> function)
+        : function(std::move(function)), pieces(nullptr), firstPiece(0), lastPiece(0), pendingCount(1), isFinished(false) {}
+    // A spare job for splitting up parallelFor() calls, which is given its pieces when used
+    Job() : pieces(nullptr), firstPiece(0), lastPiece(0), pendingCount(1), isFinished(false) {}
+
+    std::function<void()> function;
+    // Jobs splitting up a parallelFor() run pieces of it instead of a function
+    JobSystem::ParallelForState *pieces;
+    size_t firstPiece;
+    size_t lastPiece;
+    // Unfinished dependencies, plus one until the job has been submitted
+    std::atomic<unsigned int> pendingCount;
+    std::atomic<bool> isFinished;
+    // Guards the dependents, so that none are added after the job has finished
+    std::mutex mutex;
+    std::vector<JobHandle> dependents;
+};
+
+// The job system the current thread works for, if any, and the index of its deque
+static thread_local JobSystem const *currentSystem = nullptr;
+static thread_local unsigned int currentQueue = 0;
+
+struct JobSystem::ParallelForState {
+    size_t begin;
+    size_t end;
+    size_t grainSize;
+    BodyFunction function;
+    void const *body;
+    std::atomic<size_t> remainingPieces;
+};
+
+// The jobs which split up the parallelFor() calls of the current thread, kept for the next
+// calls once they have run. They are used in turn, so the first to be checked is always the one
+// which was submitted longest ago.
+static thread_local std::vector<JobHandle> spareJobs;
+static thread_local size_t nextSpareJob = 0;
+
+// Spare jobs are made this many at a time: many more than a thread's parallelFor() calls have
+// running at once, so that a job is long done with by the time its turn comes round again
+static const size_t spareJobBatchSize = 64;
+
+// Adds a batch of spare jobs, to be used next
+static void addSpareJobs() {
+    std::vector<JobHandle> batch(spareJobBatchSize);
+    for (JobHandle &job : batch) {
+        job = std::make_shared<Job>();
+    }
+    spareJobs.insert(spareJobs.begin() + nextSpareJob, batch.begin(), batch.end());
+}
+
+JobSystem::JobSystem(unsigned int threadCount) : queuedCount(0), sleepingCount(0), isStopping(false), startedCount(0) {
+    threadCount = std::max(1u, threadCount);
+    for (unsigned int i = 0; i < threadCount; i++) {
+        queues.emplace_back(new Queue());
+    }
+    for (unsigned int i = 1; i < threadCount; i++) {
+        workers.emplace_back(&JobSystem::runWorker, this, i);
+    }
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    workerStarted.wait(lock, [&]() { return startedCount == workers.size(); });
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        isStopping = true;
+    }
+    jobQueued.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    // Without workers, the queued jobs are left to us
+    while (runQueuedJob(0)) {
+    }
+}
+
+JobHandle JobSystem::createJob(std::function<void()> function) {
+    return std::make_shared<Job>(std::move(function));
+}
+
+JobHandle JobSystem::createPiecesJob(ParallelForState &state, size_t firstPiece, size_t lastPiece) {
+    if (spareJobs.empty()) {
+        addSpareJobs();
+    }
+
+    // Piece jobs are only held by the deques and the threads running them until they have run,
+    // so a job nobody else holds any more is done with. The next one almost always is; more are
+    // only made if none of them are.
+    for (size_t checked = 0; spareJobs[nextSpareJob].use_count() != 1; ) {
+        nextSpareJob = (nextSpareJob + 1) % spareJobs.size();
+        if (++checked == spareJobs.size()) {
+            addSpareJobs();
+            break;
+        }
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    JobHandle &spare = spareJobs[nextSpareJob];
+    nextSpareJob = (nextSpareJob + 1) % spareJobs.size();
+    spare->pieces = &state;
+    spare->firstPiece = firstPiece;
+    spare->lastPiece = lastPiece;
+    spare->pendingCount = 1;
+    spare->isFinished = false;
+    return spare;
+}
+
+void JobSystem::addDependency(JobHandle const &job, JobHandle const &dependency) {
+    std::lock_guard<std::mutex> lock(dependency->mutex);
+    if (!dependency->isFinished) {
+        job->pendingCount++;
+        dependency->dependents.push_back(job);
+    }
+}
+
+void JobSystem::submit(JobHandle const &job) {
+    if (--job->pendingCount == 0) {
+        enqueue(job);
+    }
+}
+
+JobHandle JobSystem::run(std::function<void()> function) {
+    JobHandle job = createJob(std::move(function));
+    submit(job);
+    return job;
+}
+
+JobHandle JobSystem::runAfter(JobHandle const &job, std::function<void()> function) {
+    JobHandle continuation = createJob(std::move(function));
+    addDependency(continuation, job);
+    submit(continuation);
+    return continuation;
+}
+
+bool JobSystem::isFinished(JobHandle const &job) const {
+    return job->isFinished.load(std::memory_order_acquire);
+}
+
+void JobSystem::wait(JobHandle const &job) {
+    unsigned int queueIndex = getQueueIndex();
+    while (!isFinished(job)) {
+        if (!runQueuedJob(queueIndex)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::runParallelFor(size_t begin, size_t end, size_t grainSize, BodyFunction function, void const *body) {
+    if (end <= begin) {
+        return;
+    }
+
+    grainSize = std::max<size_t>(1, grainSize);
+    size_t pieceCount = (end - begin + grainSize - 1) / grainSize;
+    if (workers.empty() || pieceCount == 1) {
+        for (size_t piece = 0; piece < pieceCount; piece++) {
+            size_t pieceBegin = begin + piece * grainSize;
+            function(body, pieceBegin, std::min(end, pieceBegin + grainSize));
+        }
+        return;
+    }
+
+    ParallelForState state;
+    state.begin = begin;
+    state.end = end;
+    state.grainSize = grainSize;
+    state.function = function;
+    state.body = body;
+    state.remainingPieces = pieceCount;
+    runPieces(state, 0, pieceCount);
+
+    unsigned int queueIndex = getQueueIndex();
+    while (state.remainingPieces.load(std::memory_order_acquire) > 0) {
+        if (!runQueuedJob(queueIndex)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// Hands the upper half of the pieces to a new job until a single piece is left, and runs that.
+// The halves other threads steal are large, so a thief rarely has to come back for more, while
+// the pieces are still spread evenly however long each of them takes.
+void JobSystem::runPieces(ParallelForState &state, size_t firstPiece, size_t lastPiece) {
+    while (lastPiece - firstPiece > 1) {
+        size_t middle = firstPiece + (lastPiece - firstPiece) / 2;
+        submit(createPiecesJob(state, middle, lastPiece));
+        lastPiece = middle;
+    }
+
+    size_t pieceBegin = state.begin + firstPiece * state.grainSize;
+    state.function(state.body, pieceBegin, std::min(state.end, pieceBegin + state.grainSize));
+    // The state lives on the stack of the waiting thread, which may return as soon as this is 0
+    state.remainingPieces.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::Queue::pushBack(JobHandle job) {
+    if (count == ring.size()) {
+        std::vector<JobHandle> larger(std::max<size_t>(16, 2 * ring.size()));
+        for (size_t i = 0; i < count; i++) {
+            larger[i] = std::move(ring[(front + i) % ring.size()]);
+        }
+        ring.swap(larger);
+        front = 0;
+    }
+    ring[(front + count) % ring.size()] = std::move(job);
+    count++;
+}
+
+JobHandle JobSystem::Queue::popBack() {
+    count--;
+    return std::move(ring[(front + count) % ring.size()]);
+}
+
+JobHandle JobSystem::Queue::popFront() {
+    JobHandle job = std::move(ring[front]);
+    front = (front + 1) % ring.size();
+    count--;
+    return job;
+}
+
+void JobSystem::runWorker(unsigned int queueIndex) {
+    currentSystem = this;
+    currentQueue = queueIndex;
+    // Made now, rather than when the worker first splits up stolen work in the middle of a frame
+    addSpareJobs();
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        startedCount++;
+    }
+    workerStarted.notify_one();
+
+    while (true) {
+        if (runQueuedJob(queueIndex)) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        if (isStopping && queuedCount == 0) {
+            break;
+        }
+        // Submitting threads read sleepingCount after counting their job, and wake us if it was
+        // nonzero, so either we see the job here or they see us sleeping
+        sleepingCount++;
+        jobQueued.wait(lock, [&]() { return isStopping || queuedCount > 0; });
+        sleepingCount--;
+    }
+
+    currentSystem = nullptr;
+}
+
+unsigned int JobSystem::getQueueIndex() const {
+    return currentSystem == this ? currentQueue : 0;
+}
+
+void JobSystem::enqueue(JobHandle job) {
+    // Counted before it can be taken, so the count never drops below the number of queued jobs
+    queuedCount++;
+    Queue &queue = *queues[getQueueIndex()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.pushBack(std::move(job));
+    }
+
+    if (sleepingCount > 0) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        jobQueued.notify_one();
+    }
+}
+
+bool JobSystem::runQueuedJob(unsigned int queueIndex) {
+    if (queuedCount == 0) {
+        return false;
+    }
+
+    JobHandle job;
+    {
+        Queue &own = *queues[queueIndex];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.isEmpty()) {
+            job = own.popBack();
+        }
+    }
+    for (size_t i = 1; !job && i < queues.size(); i++) {
+        Queue &victim = *queues[(queueIndex + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.isEmpty()) {
+            job = victim.popFront();
+        }
+    }
+    if (!job) {
+        return false;
+    }
+
+    queuedCount--;
+    execute(job);
+    return true;
+}
+
+void JobSystem::execute(JobHandle const &job) noexcept {
+    if (job->pieces) {
+        runPieces(*job->pieces, job->firstPiece, job->lastPiece);
+    } else {
+        job->function();
+        // Let go of whatever the function captured as soon as possible
+        job->function = nullptr;
+    }
+
+    std::vector<JobHandle> dependents;
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->isFinished.store(true, std::memory_order_release);
+        dependents.swap(job->dependents);
+    }
+    for (JobHandle const &dependent : dependents) {
+        submit(dependent);
+    }
+}
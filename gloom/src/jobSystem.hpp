@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Job;
+
+// Refers to a job. A job stays alive while there are handles to it or while it waits to run.
+typedef std::shared_ptr<Job> JobHandle;
+
+// A pool of worker threads which share their work by stealing it from each other.
+//
+// Each worker has a deque of its own. The jobs it creates go onto the back, and it takes its
+// next job from the back too, so it keeps working on data it touched recently. Idle workers steal
+// from the front of the other deques instead, where the oldest and usually largest pieces of work
+// are. Threads outside the pool share one more deque.
+//
+// A job can depend on other jobs, and only runs once all of them have finished. A thread waiting
+// for a job runs queued jobs in the meantime rather than blocking, which is how the main thread
+// takes part in the work, and how jobs can wait for the jobs they created.
+//
+// Jobs must not throw: an exception escaping a job ends the program.
+//
+// The jobs parallelFor() splits its work into are used again once they have run, so once the
+// system has warmed up, parallelFor() allocates nothing.
+class JobSystem {
+public:
+    // Starts threadCount - 1 workers. The threads waiting for jobs make up the last one.
+    explicit JobSystem(unsigned int threadCount);
+    // Runs the jobs which are still queued before returning
+    ~JobSystem();
+
+    unsigned int getThreadCount() const { return unsigned(workers.size()) + 1; }
+
+    // Creates a job which runs the function once it has been submitted and every job it
+    // depends on has finished
+    JobHandle createJob(std::function<void()> function);
+    // Makes a job wait for another one, which may already have been submitted or even have
+    // finished. Only to be called before the job itself is submitted.
+    void addDependency(JobHandle const &job, JobHandle const &dependency);
+    void submit(JobHandle const &job);
+
+    // Creates and submits a job
+    JobHandle run(std::function<void()> function);
+    // Creates and submits a job which runs after the given one has finished
+    JobHandle runAfter(JobHandle const &job, std::function<void()> function);
+
+    bool isFinished(JobHandle const &job) const;
+    // Runs queued jobs on the calling thread until the given job has finished
+    void wait(JobHandle const &job);
+
+    // See parallelFor() in parallel.hpp
+    template <typename Body>
+    void parallelFor(size_t begin, size_t end, size_t grainSize, Body const &body) {
+        runParallelFor(begin, end, grainSize, &callBody<Body>, &body);
+    }
+
+private:
+    JobSystem(JobSystem const &) = delete;
+    JobSystem & operator =(JobSystem const &) = delete;
+
+    friend struct Job;
+
+    // The body of a parallelFor() is passed around as a pointer along with a function calling
+    // it, rather than as a std::function, which would have to allocate for larger lambdas
+    typedef void (*BodyFunction)(void const *body, size_t pieceBegin, size_t pieceEnd);
+    template <typename Body>
+    static void callBody(void const *body, size_t pieceBegin, size_t pieceEnd) {
+        (*static_cast<Body const *>(body))(pieceBegin, pieceEnd);
+    }
+
+    // A deque of jobs, kept in a ring which only ever grows, so that queueing jobs stops
+    // allocating once the ring has become large enough. It starts out large enough for the
+    // parallelFor() calls of a frame, so the workers' rings do not grow during one.
+    struct Queue {
+        Queue() : ring(64) {}
+
+        std::mutex mutex;
+        std::vector<JobHandle> ring;
+        size_t front = 0;
+        size_t count = 0;
+
+        bool isEmpty() const { return count == 0; }
+        void pushBack(JobHandle job);
+        JobHandle popBack();
+        JobHandle popFront();
+    };
+    struct ParallelForState;
+
+    void runWorker(unsigned int queueIndex);
+    unsigned int getQueueIndex() const;
+    void enqueue(JobHandle job);
+    // Runs a job from the calling thread's own deque, or one stolen from another. Returns false
+    // if there was nothing to run.
+    bool runQueuedJob(unsigned int queueIndex);
+    // Declared noexcept so that a throwing job ends the program wherever it runs
+    void execute(JobHandle const &job) noexcept;
+    void runParallelFor(size_t begin, size_t end, size_t grainSize, BodyFunction function, void const *body);
+    // Returns a job running the given pieces, reusing one of the calling thread's earlier ones if it can
+    JobHandle createPiecesJob(ParallelForState &state, size_t firstPiece, size_t lastPiece);
+    void runPieces(ParallelForState &state, size_t firstPiece, size_t lastPiece);
+
+    // The deque of the threads outside the pool comes first, followed by one per worker
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::atomic<size_t> queuedCount;
+
+    // Idle workers sleep until a job is queued
+    std::mutex sleepMutex;
+    std::condition_variable jobQueued;
+    std::atomic<unsigned int> sleepingCount;
+    std::atomic<bool> isStopping;
+
+    // The constructor waits for every worker to have started, so that none of them is still
+    // setting itself up once the frames have begun
+    std::condition_variable workerStarted;
+    unsigned int startedCount;
+
+    std::vector<std::thread> workers;
+};
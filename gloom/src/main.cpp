@@ -1,6 +1,8 @@
 // Local headers
 #include "gloom/gloom.hpp"
 #include "program.hpp"
+#include "options.hpp"
+#include "memoryTracking.hpp"
 
 // System headers
 #include <glad/glad.h>
@@ -69,14 +71,28 @@ GLFWwindow* initialise()
 
 int main(int argc, char* argb[])
 {
+    // Parse command line options before opening any windows
+    ProgramOptions options = parseCommandLine(argc, argb);
+
+    // Headless runs only simulate and cull the scene, so they need no window or OpenGL context
+    if (options.headless)
+    {
+        runHeadless(options);
+        printMemoryReport();
+        return EXIT_SUCCESS;
+    }
+
     // Initialise window using GLFW
     GLFWwindow* window = initialise();
 
     // Run an OpenGL application using this window
-    runProgram(window);
+    runProgram(window, options);
 
     // Terminate GLFW (no need to call glfwDestroyWindow)
     glfwTerminate();
 
+    // Only prints anything when memory tracking is built in
+    printMemoryReport();
+
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <utility>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "mappedFile.hpp"
+
+const size_t MappedFileWriter::mappingAlignment;
+
+// Files of zero bytes cannot be mapped, but are valid files all the same
+static unsigned char const emptyContents[1] = { 0 };
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) {
+    *this = std::move(other);
+}
+
+MappedFile & MappedFile::operator =(MappedFile &&other) {
+    if (this != &other) {
+        close();
+        std::swap(contents, other.contents);
+        std::swap(size, other.size);
+#ifdef _WIN32
+        std::swap(fileHandle, other.fileHandle);
+        std::swap(mappingHandle, other.mappingHandle);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(std::string const &path) {
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return false;
+    }
+    if (fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        contents = emptyContents;
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    contents = static_cast<unsigned char const*>(view);
+    size = size_t(fileSize.QuadPart);
+    return true;
+}
+
+void MappedFile::close() {
+    if (contents && contents != emptyContents) {
+        UnmapViewOfFile(contents);
+        CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+    }
+    contents = nullptr;
+    size = 0;
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+}
+
+MappedFileWriter::~MappedFileWriter() {
+    if (isOpen()) {
+        close(size);
+    }
+}
+
+bool MappedFileWriter::isOpen() const {
+    return fileHandle != nullptr;
+}
+
+bool MappedFileWriter::create(std::string const &path) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    fileHandle = file;
+    size = 0;
+    return true;
+}
+
+bool MappedFileWriter::close(uint64_t finalSize) {
+    LARGE_INTEGER end;
+    end.QuadPart = LONGLONG(finalSize);
+    bool isTruncated = SetFilePointerEx(fileHandle, end, nullptr, FILE_BEGIN) && SetEndOfFile(fileHandle);
+    CloseHandle(fileHandle);
+    fileHandle = nullptr;
+    size = 0;
+    return isTruncated;
+}
+
+unsigned char *MappedFileWriter::mapRange(uint64_t offset, size_t rangeSize) {
+    // A mapping as large as the end of the range grows the file to that size. The view keeps
+    // the mapping alive after its handle is closed.
+    uint64_t end = offset + rangeSize;
+    HANDLE mapping;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        size = std::max(size, end);
+        mapping = CreateFileMappingA(fileHandle, nullptr, PAGE_READWRITE, DWORD(size >> 32), DWORD(size), nullptr);
+    }
+    if (!mapping) {
+        return nullptr;
+    }
+    void *view = MapViewOfFile(mapping, FILE_MAP_WRITE, DWORD(offset >> 32), DWORD(offset), rangeSize);
+    CloseHandle(mapping);
+    return static_cast<unsigned char*>(view);
+}
+
+void MappedFileWriter::unmapRange(unsigned char *data, size_t) {
+    UnmapViewOfFile(data);
+}
+
+#else
+
+bool MappedFile::open(std::string const &path) {
+    close();
+
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+    struct stat status;
+    if (fstat(file, &status) != 0) {
+        ::close(file);
+        return false;
+    }
+    if (status.st_size == 0) {
+        ::close(file);
+        contents = emptyContents;
+        return true;
+    }
+
+    // The mapping stays valid after the file is closed
+    void *view = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+
+    contents = static_cast<unsigned char const*>(view);
+    size = size_t(status.st_size);
+    return true;
+}
+
+void MappedFile::close() {
+    if (contents && contents != emptyContents) {
+        munmap(const_cast<unsigned char*>(contents), size);
+    }
+    contents = nullptr;
+    size = 0;
+}
+
+MappedFileWriter::~MappedFileWriter() {
+    if (isOpen()) {
+        close(size);
+    }
+}
+
+bool MappedFileWriter::isOpen() const {
+    return fileDescriptor >= 0;
+}
+
+bool MappedFileWriter::create(std::string const &path) {
+    fileDescriptor = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    size = 0;
+    return fileDescriptor >= 0;
+}
+
+bool MappedFileWriter::close(uint64_t finalSize) {
+    bool isTruncated = ftruncate(fileDescriptor, off_t(finalSize)) == 0;
+    ::close(fileDescriptor);
+    fileDescriptor = -1;
+    size = 0;
+    return isTruncated;
+}
+
+unsigned char *MappedFileWriter::mapRange(uint64_t offset, size_t rangeSize) {
+    uint64_t end = offset + rangeSize;
+    {
+        // Growing the file leaves a hole, which takes no space until it is written
+        std::lock_guard<std::mutex> lock(mutex);
+        if (end > size) {
+            if (ftruncate(fileDescriptor, off_t(end)) != 0) {
+                return nullptr;
+            }
+            size = end;
+        }
+    }
+    void *view = mmap(nullptr, rangeSize, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, off_t(offset));
+    return view == MAP_FAILED ? nullptr : static_cast<unsigned char*>(view);
+}
+
+void MappedFileWriter::unmapRange(unsigned char *data, size_t rangeSize) {
+    munmap(data, rangeSize);
+}
+
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// A file mapped into memory for reading, so that large files can be used in place without
+// reading them in first. The operating system pages the contents in as they are touched.
+class MappedFile {
+public:
+    MappedFile() {}
+    ~MappedFile();
+
+    MappedFile(MappedFile &&other);
+    MappedFile & operator =(MappedFile &&other);
+
+    // Maps the whole file. Returns false if it cannot be opened or mapped.
+    bool open(std::string const &path);
+    void close();
+
+    bool isOpen() const { return contents != nullptr; }
+    unsigned char const *getData() const { return contents; }
+    size_t getSize() const { return size; }
+
+private:
+    MappedFile(MappedFile const &) = delete;
+    MappedFile & operator =(MappedFile const &) = delete;
+
+    unsigned char const *contents = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+};
+
+// A file written through memory mappings of parts of it, so that several threads can fill in
+// different parts at once without seeking. The file grows as parts beyond its end are mapped.
+class MappedFileWriter {
+public:
+    // Offsets of mapped ranges have to be multiples of this
+    static const size_t mappingAlignment = 1 << 16;
+
+    MappedFileWriter() {}
+    ~MappedFileWriter();
+
+    // Creates the file, replacing any existing one. Returns false if it cannot be created.
+    bool create(std::string const &path);
+    // Truncates the file to the given size and closes it. Every range has to be unmapped first.
+    // Returns false if the file could not be truncated, in which case it keeps zeroes at the end.
+    bool close(uint64_t finalSize);
+
+    bool isOpen() const;
+
+    // Maps size bytes from offset for writing, growing the file if needed, or returns nullptr
+    // if that fails. Parts of the file which are never written read as zeroes. May be called
+    // from any thread.
+    unsigned char *mapRange(uint64_t offset, size_t size);
+    void unmapRange(unsigned char *data, size_t size);
+
+private:
+    MappedFileWriter(MappedFileWriter const &) = delete;
+    MappedFileWriter & operator =(MappedFileWriter const &) = delete;
+
+    // Guards growing the file
+    std::mutex mutex;
+    uint64_t size = 0;
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+#else
+    int fileDescriptor = -1;
+#endif
+};
@@ -0,0 +1,239 @@
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+#include "memoryTracking.hpp"
+
+static char const* const memoryTagNames[MEMORY_TAG_COUNT] = {
+    "untagged", "mesh", "scene-node", "loader", "gpu-buffers"
+};
+
+char const* getMemoryTagName(MemoryTag tag) {
+    return memoryTagNames[tag];
+}
+
+uint64_t FrameAllocationMonitor::endFrame() {
+    uint64_t allocations = getFrameAllocationCount() - allocationsBefore;
+    frameCount++;
+    if (allocations > 0 && isExcused) {
+        excusedFrameCount++;
+    } else if (allocations > 0) {
+        if (allocatingFrameCount == 0) {
+            fprintf(stderr, "Frame %u allocated memory %llu times in the render loop\n",
+                    frameCount, (unsigned long long) allocations);
+        }
+        allocatingFrameCount++;
+    }
+    return allocations;
+}
+
+#ifdef GLOOM_TRACK_MEMORY
+
+// Kept as plain atomics rather than behind a lock, since every allocation of every thread
+// passes through here
+struct AtomicTagStats {
+    std::atomic<size_t> liveBytes;
+    std::atomic<size_t> peakBytes;
+    std::atomic<uint64_t> allocationCount;
+    std::atomic<uint64_t> freeCount;
+};
+
+// Zero-initialised before any constructor runs, so allocations made during static
+// initialisation are counted too
+static AtomicTagStats tagStats[MEMORY_TAG_COUNT];
+static std::atomic<uint64_t> frameAllocationCount;
+static thread_local MemoryTag currentTag = MEMORY_TAG_UNTAGGED;
+static thread_local unsigned int backgroundScopeDepth = 0;
+
+static void countAllocation(size_t size, MemoryTag tag) {
+    AtomicTagStats &stats = tagStats[tag];
+    size_t live = stats.liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t peak = stats.peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !stats.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+    stats.allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (backgroundScopeDepth == 0) {
+        frameAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+static void countFree(size_t size, MemoryTag tag) {
+    AtomicTagStats &stats = tagStats[tag];
+    stats.liveBytes.fetch_sub(size, std::memory_order_relaxed);
+    stats.freeCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void* allocateTracked(size_t size, MemoryTag tag) {
+    void* pointer = std::malloc(size > 0 ? size : 1);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    countAllocation(size, tag);
+    return pointer;
+}
+
+void freeTracked(void* pointer, size_t size, MemoryTag tag) {
+    if (!pointer) {
+        return;
+    }
+    countFree(size, tag);
+    std::free(pointer);
+}
+
+MemoryTagStats getMemoryTagStats(MemoryTag tag) {
+    MemoryTagStats stats;
+    stats.liveBytes = tagStats[tag].liveBytes.load();
+    stats.peakBytes = tagStats[tag].peakBytes.load();
+    stats.allocationCount = tagStats[tag].allocationCount.load();
+    stats.freeCount = tagStats[tag].freeCount.load();
+    return stats;
+}
+
+uint64_t getFrameAllocationCount() {
+    return frameAllocationCount.load(std::memory_order_relaxed);
+}
+
+MemoryTag getCurrentMemoryTag() {
+    return currentTag;
+}
+
+MemoryTagScope::MemoryTagScope(MemoryTag tag) : previousTag(currentTag) {
+    currentTag = tag;
+}
+
+MemoryTagScope::~MemoryTagScope() {
+    currentTag = previousTag;
+}
+
+BackgroundAllocationScope::BackgroundAllocationScope() {
+    backgroundScopeDepth++;
+}
+
+BackgroundAllocationScope::~BackgroundAllocationScope() {
+    backgroundScopeDepth--;
+}
+
+// The sizes of the GPU buffers, by name. Functions rather than globals, so they exist before the
+// first buffer is recorded whatever the order of static initialisation.
+static std::mutex &getGpuBufferMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+static std::unordered_map<unsigned int, size_t> &getGpuBufferSizes() {
+    static std::unordered_map<unsigned int, size_t> sizes;
+    return sizes;
+}
+
+void recordGpuBuffer(unsigned int buffer, size_t bytes) {
+    std::lock_guard<std::mutex> lock(getGpuBufferMutex());
+    size_t &size = getGpuBufferSizes()[buffer];
+    if (size > 0) {
+        countFree(size, MEMORY_TAG_GPU_BUFFERS);
+    }
+    size = bytes;
+    countAllocation(bytes, MEMORY_TAG_GPU_BUFFERS);
+}
+
+void forgetGpuBuffer(unsigned int buffer) {
+    std::lock_guard<std::mutex> lock(getGpuBufferMutex());
+    auto found = getGpuBufferSizes().find(buffer);
+    if (found != getGpuBufferSizes().end()) {
+        countFree(found->second, MEMORY_TAG_GPU_BUFFERS);
+        getGpuBufferSizes().erase(found);
+    }
+}
+
+void printMemoryReport(FILE* file) {
+    fprintf(file, "Memory by tag:\n");
+    fprintf(file, "%-14s %12s %12s %14s %14s\n", "tag", "live MB", "peak MB", "allocations", "frees");
+    for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+        MemoryTagStats stats = getMemoryTagStats(MemoryTag(tag));
+        fprintf(file, "%-14s %12.3f %12.3f %14llu %14llu\n", getMemoryTagName(MemoryTag(tag)),
+                stats.liveBytes / 1e6, stats.peakBytes / 1e6,
+                (unsigned long long) stats.allocationCount, (unsigned long long) stats.freeCount);
+    }
+}
+
+// Every other allocation made with new goes through these. A small header in front of each
+// block remembers its size and tag, since plain delete is not told either.
+struct AllocationHeader {
+    size_t size;
+    MemoryTag tag;
+};
+// Keeps the blocks as aligned as malloc() makes them
+static const size_t allocationHeaderBytes = 16;
+static_assert(sizeof(AllocationHeader) <= allocationHeaderBytes, "The allocation header does not fit");
+
+static void* allocateWithHeader(size_t size) {
+    MemoryTag tag = currentTag;
+    unsigned char* block = static_cast<unsigned char*>(std::malloc(allocationHeaderBytes + size));
+    if (!block) {
+        return nullptr;
+    }
+    AllocationHeader* header = reinterpret_cast<AllocationHeader*>(block);
+    header->size = size;
+    header->tag = tag;
+    countAllocation(size, tag);
+    return block + allocationHeaderBytes;
+}
+
+static void freeWithHeader(void* pointer) {
+    if (!pointer) {
+        return;
+    }
+    // Worked out as an integer: the compiler may have seen the pointer come from a new
+    // expression in this file, and would warn about reading in front of it and freeing it
+    void* block = reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(pointer) - allocationHeaderBytes);
+    AllocationHeader* header = static_cast<AllocationHeader*>(block);
+    countFree(header->size, header->tag);
+    std::free(block);
+}
+
+void* operator new(size_t size) {
+    void* pointer = allocateWithHeader(size);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, std::nothrow_t const &) noexcept {
+    return allocateWithHeader(size);
+}
+
+void* operator new[](size_t size, std::nothrow_t const &) noexcept {
+    return allocateWithHeader(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    freeWithHeader(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    freeWithHeader(pointer);
+}
+
+void operator delete(void* pointer, std::nothrow_t const &) noexcept {
+    freeWithHeader(pointer);
+}
+
+void operator delete[](void* pointer, std::nothrow_t const &) noexcept {
+    freeWithHeader(pointer);
+}
+
+#if defined(__cpp_sized_deallocation)
+void operator delete(void* pointer, size_t) noexcept {
+    freeWithHeader(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    freeWithHeader(pointer);
+}
+#endif
+
+#endif
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <new>
+#include <vector>
+
+// Accounting of the memory used by each part of the program, built in when GLOOM_TRACK_MEMORY is
+// defined (the CMake option of the same name). Otherwise everything below compiles down to plain
+// std::vectors and empty inline functions, and costs nothing.
+//
+// Memory is counted under a tag. Mesh attributes and scene nodes always carry their own tag,
+// through TaggedAllocator and GLOOM_TAGGED_NEW. Everything else allocated with new, including the
+// insides of the standard containers, goes to the tag of the innermost MemoryTagScope on the
+// allocating thread. GPU buffers are not allocated by us, so their sizes are recorded by hand.
+
+enum MemoryTag {
+    MEMORY_TAG_UNTAGGED = 0,
+    MEMORY_TAG_MESH,
+    MEMORY_TAG_SCENE_NODE,
+    MEMORY_TAG_LOADER,
+    MEMORY_TAG_GPU_BUFFERS,
+    MEMORY_TAG_COUNT
+};
+
+struct MemoryTagStats {
+    size_t liveBytes = 0;
+    size_t peakBytes = 0;
+    uint64_t allocationCount = 0;
+    uint64_t freeCount = 0;
+};
+
+char const* getMemoryTagName(MemoryTag tag);
+
+#ifdef GLOOM_TRACK_MEMORY
+
+void* allocateTracked(size_t size, MemoryTag tag);
+void freeTracked(void* pointer, size_t size, MemoryTag tag);
+
+MemoryTagStats getMemoryTagStats(MemoryTag tag);
+// Allocations made so far, of any tag, by every thread outside a BackgroundAllocationScope
+uint64_t getFrameAllocationCount();
+MemoryTag getCurrentMemoryTag();
+
+// Records the size of a GPU buffer when it is filled, replacing any size recorded before,
+// and forgets it when the buffer is deleted
+void recordGpuBuffer(unsigned int buffer, size_t bytes);
+void forgetGpuBuffer(unsigned int buffer);
+
+// Prints the live, peak and total allocations of every tag
+void printMemoryReport(FILE* file = stdout);
+
+// Counts what the calling thread allocates with new under the given tag, until it goes out of scope
+class MemoryTagScope {
+public:
+    explicit MemoryTagScope(MemoryTag tag);
+    ~MemoryTagScope();
+
+private:
+    MemoryTagScope(MemoryTagScope const &) = delete;
+    MemoryTagScope & operator =(MemoryTagScope const &) = delete;
+
+    MemoryTag previousTag;
+};
+
+// Leaves what the calling thread allocates out of getFrameAllocationCount() until it goes out of
+// scope. For threads whose work is not part of any frame, such as streaming or encoding.
+class BackgroundAllocationScope {
+public:
+    BackgroundAllocationScope();
+    ~BackgroundAllocationScope();
+
+private:
+    BackgroundAllocationScope(BackgroundAllocationScope const &) = delete;
+    BackgroundAllocationScope & operator =(BackgroundAllocationScope const &) = delete;
+};
+
+// Allocator for standard containers counting their memory under a fixed tag
+template <typename T, MemoryTag tag>
+struct TaggedAllocator {
+    typedef T value_type;
+
+    template <typename U>
+    struct rebind {
+        typedef TaggedAllocator<U, tag> other;
+    };
+
+    TaggedAllocator() {}
+    template <typename U>
+    TaggedAllocator(TaggedAllocator<U, tag> const &) {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(allocateTracked(count * sizeof(T), tag));
+    }
+    void deallocate(T* pointer, size_t count) {
+        freeTracked(pointer, count * sizeof(T), tag);
+    }
+};
+
+template <typename T, typename U, MemoryTag tag>
+bool operator ==(TaggedAllocator<T, tag> const &, TaggedAllocator<U, tag> const &) { return true; }
+template <typename T, typename U, MemoryTag tag>
+bool operator !=(TaggedAllocator<T, tag> const &, TaggedAllocator<U, tag> const &) { return false; }
+
+template <typename T, MemoryTag tag>
+using TaggedVector = std::vector<T, TaggedAllocator<T, tag>>;
+
+// Placed in a class, counts its instances created with new under the given tag
+#define GLOOM_TAGGED_NEW(tag) \
+    static void* operator new(size_t size) { return allocateTracked(size, tag); } \
+    static void operator delete(void* pointer, size_t size) { freeTracked(pointer, size, tag); }
+
+// The same for arrays of instances created with new[]
+#define GLOOM_TAGGED_NEW_ARRAY(tag) \
+    static void* operator new[](size_t size) { return allocateTracked(size, tag); } \
+    static void operator delete[](void* pointer, size_t size) { freeTracked(pointer, size, tag); }
+
+#else
+
+inline MemoryTagStats getMemoryTagStats(MemoryTag) { return MemoryTagStats(); }
+inline uint64_t getFrameAllocationCount() { return 0; }
+inline MemoryTag getCurrentMemoryTag() { return MEMORY_TAG_UNTAGGED; }
+inline void recordGpuBuffer(unsigned int, size_t) {}
+inline void forgetGpuBuffer(unsigned int) {}
+inline void printMemoryReport(FILE* = stdout) {}
+
+class MemoryTagScope {
+public:
+    explicit MemoryTagScope(MemoryTag) {}
+};
+
+class BackgroundAllocationScope {
+public:
+    BackgroundAllocationScope() {}
+};
+
+template <typename T, MemoryTag tag>
+using TaggedVector = std::vector<T>;
+
+#define GLOOM_TAGGED_NEW(tag)
+#define GLOOM_TAGGED_NEW_ARRAY(tag)
+
+#endif
+
+// Watches for allocations during frames, on the calling thread and on the job system's workers
+// alike: every thread which is not in a BackgroundAllocationScope. The first frame sizes the
+// working space kept from one frame to the next, after which frames should not need to allocate,
+// except for those doing work which allocates by its nature, such as loading. Those are excused,
+// as is the first frame. Warns about the first other frame which allocates, and counts how many do.
+class FrameAllocationMonitor {
+public:
+    void beginFrame() {
+        allocationsBefore = getFrameAllocationCount();
+        isExcused = frameCount == 0;
+    }
+    // Lets the current frame allocate without counting as an allocating frame
+    void excuseFrame() { isExcused = true; }
+    // Returns the number of allocations made since beginFrame(), excused or not
+    uint64_t endFrame();
+
+    unsigned int getAllocatingFrameCount() const { return allocatingFrameCount; }
+    // Frames which allocated, but were excused
+    unsigned int getExcusedFrameCount() const { return excusedFrameCount; }
+    unsigned int getFrameCount() const { return frameCount; }
+
+private:
+    uint64_t allocationsBefore = 0;
+    bool isExcused = false;
+    unsigned int allocatingFrameCount = 0;
+    unsigned int excusedFrameCount = 0;
+    unsigned int frameCount = 0;
+};
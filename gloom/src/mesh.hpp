@@ -3,20 +3,24 @@
 #include <string>
 #include <vector>
 #include "floats.hpp"
+#include "memoryTracking.hpp"
 
 class Mesh;
 
 class Mesh {
 public:
 	std::string name;
-	std::vector<float4> vertices;
-	std::vector<float4> colours;
-	std::vector<float3> normals;
-	std::vector<unsigned int> indices;
+	TaggedVector<float4, MEMORY_TAG_MESH> vertices;
+	TaggedVector<float4, MEMORY_TAG_MESH> colours;
+	TaggedVector<float3, MEMORY_TAG_MESH> normals;
+	// One per vertex when hasTextureCoordinates is set, and empty otherwise
+	TaggedVector<float2, MEMORY_TAG_MESH> textureCoordinates;
+	TaggedVector<unsigned int, MEMORY_TAG_MESH> indices;
 
 	Mesh(std::string vname) : name(vname) {}
 
-	bool hasNormals;
+	bool hasNormals = false;
+	bool hasTextureCoordinates = false;
 
 	unsigned long faceCount() {
 		return (this->vertices.size() / 3);
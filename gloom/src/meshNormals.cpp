@@ -0,0 +1,178 @@
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+#include "meshNormals.hpp"
+#include "parallel.hpp"
+
+// Number of triangles or corners each thread handles at a time
+static const size_t grainSize = 16384;
+
+static size_t hashPosition(float4 const &position) {
+    uint32_t bits[3];
+    std::memcpy(bits, &position, sizeof(bits));
+    return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+}
+
+static bool isSamePosition(float4 const &a, float4 const &b) {
+    return std::memcmp(&a, &b, 3 * sizeof(float)) == 0;
+}
+
+// Normals are compared with a tolerance, since the same smoothing group summed in a different
+// order can give slightly different results
+static bool isSameNormal(float3 const &a, float3 const &b) {
+    return a == b || a.dot(b) > 0.9999f;
+}
+
+static float angleBetween(float3 a, float3 b) {
+    float lengths = std::sqrt(a.dot(a) * b.dot(b));
+    if (lengths <= 0.0f) {
+        return 0.0f;
+    }
+    return std::acos(std::max(-1.0f, std::min(1.0f, a.dot(b) / lengths)));
+}
+
+void generateSmoothNormals(Mesh &mesh, float creaseAngleDegrees, NormalWeighting weighting) {
+    size_t vertexCount = mesh.vertices.size();
+    size_t cornerCount = mesh.indices.size() - mesh.indices.size() % 3;
+    size_t triangleCount = cornerCount / 3;
+    auto const &indices = mesh.indices;
+
+    // Per triangle: the unit normal. Per corner: what it contributes to the normals around it.
+    std::vector<float3> faceNormals(triangleCount);
+    std::vector<float3> cornerContributions(cornerCount);
+
+    parallelFor(0, triangleCount, grainSize, [&](size_t first, size_t last) {
+        for (size_t triangle = first; triangle < last; triangle++) {
+            float3 p0 = mesh.vertices[indices[3 * triangle + 0]].toFloat3();
+            float3 p1 = mesh.vertices[indices[3 * triangle + 1]].toFloat3();
+            float3 p2 = mesh.vertices[indices[3 * triangle + 2]].toFloat3();
+
+            // The length of the cross product is twice the area of the triangle
+            float3 areaNormal = (p1 - p0).cross(p2 - p0);
+            float3 unitNormal = areaNormal;
+            unitNormal.normalize();
+            faceNormals[triangle] = unitNormal;
+
+            if (weighting == NORMAL_WEIGHTING_AREA) {
+                cornerContributions[3 * triangle + 0] = areaNormal;
+                cornerContributions[3 * triangle + 1] = areaNormal;
+                cornerContributions[3 * triangle + 2] = areaNormal;
+            } else {
+                cornerContributions[3 * triangle + 0] = unitNormal * angleBetween(p1 - p0, p2 - p0);
+                cornerContributions[3 * triangle + 1] = unitNormal * angleBetween(p2 - p1, p0 - p1);
+                cornerContributions[3 * triangle + 2] = unitNormal * angleBetween(p0 - p2, p1 - p2);
+            }
+        }
+    });
+
+    // Give every distinct position an ID, so corners at the same place are smoothed
+    // together even if they use different vertices. The lookup uses a flat open addressing
+    // table, since a node based hash map dominates the run time on large meshes.
+    std::vector<unsigned int> vertexPosition(vertexCount);
+    unsigned int positionCount = 0;
+    {
+        size_t tableSize = 1;
+        while (tableSize < 2 * vertexCount) {
+            tableSize *= 2;
+        }
+        std::vector<unsigned int> table(tableSize, ~0u);
+
+        for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+            float4 const &position = mesh.vertices[vertex];
+            size_t slot = hashPosition(position) & (tableSize - 1);
+
+            while (table[slot] != ~0u && !isSamePosition(mesh.vertices[table[slot]], position)) {
+                slot = (slot + 1) & (tableSize - 1);
+            }
+
+            if (table[slot] == ~0u) {
+                table[slot] = unsigned(vertex);
+                vertexPosition[vertex] = positionCount++;
+            } else {
+                vertexPosition[vertex] = vertexPosition[table[slot]];
+            }
+        }
+    }
+
+    // List the corners at each position (a counting sort), so each corner can gather the
+    // contributions of its neighbours instead of every corner scattering into shared sums
+    std::vector<unsigned int> positionCornerStart(positionCount + 1, 0);
+    std::vector<unsigned int> positionCorners(cornerCount);
+    for (size_t corner = 0; corner < cornerCount; corner++) {
+        positionCornerStart[vertexPosition[indices[corner]] + 1]++;
+    }
+    for (unsigned int position = 0; position < positionCount; position++) {
+        positionCornerStart[position + 1] += positionCornerStart[position];
+    }
+    {
+        std::vector<unsigned int> fillPosition(positionCornerStart.begin(), positionCornerStart.end() - 1);
+        for (size_t corner = 0; corner < cornerCount; corner++) {
+            positionCorners[fillPosition[vertexPosition[indices[corner]]]++] = unsigned(corner);
+        }
+    }
+
+    float creaseCosine = std::cos(creaseAngleDegrees * float(M_PI) / 180.0f);
+    std::vector<float3> cornerNormals(cornerCount);
+
+    parallelFor(0, cornerCount, grainSize, [&](size_t first, size_t last) {
+        for (size_t corner = first; corner < last; corner++) {
+            float3 const &faceNormal = faceNormals[corner / 3];
+            unsigned int position = vertexPosition[indices[corner]];
+
+            float3 sum(0, 0, 0);
+            for (unsigned int i = positionCornerStart[position]; i < positionCornerStart[position + 1]; i++) {
+                unsigned int neighbour = positionCorners[i];
+                if (neighbour == corner || faceNormal.dot(faceNormals[neighbour / 3]) >= creaseCosine) {
+                    sum += cornerContributions[neighbour];
+                }
+            }
+
+            // Corners of degenerate triangles get the normal of their neighbours, or nothing at all
+            cornerNormals[corner] = sum.normalize();
+        }
+    });
+
+    // Store the normals per vertex. Vertices used by corners with different normals are duplicated.
+    mesh.normals.assign(vertexCount, float3(0, 0, 0));
+    std::vector<bool> isAssigned(vertexCount, false);
+    std::unordered_map<unsigned int, std::vector<unsigned int>> duplicates;
+    bool hasColours = mesh.colours.size() == vertexCount;
+    bool hasTextureCoordinates = mesh.hasTextureCoordinates && mesh.textureCoordinates.size() == vertexCount;
+
+    for (size_t corner = 0; corner < cornerCount; corner++) {
+        unsigned int vertex = indices[corner];
+        float3 const &normal = cornerNormals[corner];
+
+        if (!isAssigned[vertex]) {
+            mesh.normals[vertex] = normal;
+            isAssigned[vertex] = true;
+            continue;
+        }
+        if (isSameNormal(mesh.normals[vertex], normal)) {
+            continue;
+        }
+
+        std::vector<unsigned int> &copies = duplicates[vertex];
+        unsigned int replacement = ~0u;
+        for (unsigned int copy : copies) {
+            if (isSameNormal(mesh.normals[copy], normal)) {
+                replacement = copy;
+                break;
+            }
+        }
+        if (replacement == ~0u) {
+            replacement = unsigned(mesh.vertices.size());
+            mesh.vertices.push_back(mesh.vertices[vertex]);
+            if (hasColours) mesh.colours.push_back(mesh.colours[vertex]);
+            if (hasTextureCoordinates) mesh.textureCoordinates.push_back(mesh.textureCoordinates[vertex]);
+            mesh.normals.push_back(normal);
+            copies.push_back(replacement);
+        }
+        mesh.indices[corner] = replacement;
+    }
+
+    mesh.hasNormals = true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "mesh.hpp"
+
+// How the triangles around a vertex contribute to its normal.
+enum NormalWeighting {
+    // By the area of the triangle. Cheap, but long thin triangles pull the normal towards them.
+    NORMAL_WEIGHTING_AREA,
+    // By the angle of the triangle at the vertex. Independent of how the surface is triangulated.
+    NORMAL_WEIGHTING_ANGLE
+};
+
+// Replaces the normals of a mesh with smooth normals computed from its triangles.
+//
+// All corners sharing a position are smoothed together, so this works both on indexed meshes
+// and on meshes where every triangle has its own vertices (as produced by loadWavefront).
+// Triangles meeting at a sharper angle than creaseAngleDegrees are not smoothed together,
+// which keeps hard edges hard. In an indexed mesh, vertices which end up with more than one
+// normal because of this are duplicated.
+//
+// The work is spread over several threads. Each thread only writes to the triangles and
+// corners it is responsible for, so no atomics or locks are needed.
+void generateSmoothNormals(Mesh &mesh, float creaseAngleDegrees = 60.0f, NormalWeighting weighting = NORMAL_WEIGHTING_ANGLE);
@@ -0,0 +1,506 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+#include "meshSimplification.hpp"
+#include "toolbox.hpp"
+
+// A symmetric 4x4 matrix representing the sum of squared distances to a set of planes.
+// Only the upper triangle is stored, along with the sum of the planes' weights.
+struct Quadric {
+    double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+    double weight;
+
+    Quadric() : a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0), weight(0) {}
+
+    // The quadric of the plane ax + by + cz + d = 0, scaled by a weight
+    Quadric(double a, double b, double c, double d, double weight)
+        : a2(weight * a * a), ab(weight * a * b), ac(weight * a * c), ad(weight * a * d),
+          b2(weight * b * b), bc(weight * b * c), bd(weight * b * d),
+          c2(weight * c * c), cd(weight * c * d), d2(weight * d * d), weight(weight) {}
+
+    Quadric& operator+= (Quadric const &other) {
+        a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+        b2 += other.b2; bc += other.bc; bd += other.bd;
+        c2 += other.c2; cd += other.cd; d2 += other.d2;
+        weight += other.weight;
+        return *this;
+    }
+
+    // The weighted sum of squared distances from a point to the planes
+    double evaluate(float4 const &p) const {
+        double x = p.x, y = p.y, z = p.z;
+        return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+             + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+             + c2 * z * z + 2 * cd * z
+             + d2;
+    }
+
+    // The weighted root mean square distance from a point to the planes
+    double distance(float4 const &p) const {
+        return weight > 0.0 ? std::sqrt(std::max(0.0, evaluate(p) / weight)) : 0.0;
+    }
+};
+
+// A candidate edge collapse, moving vertex `from` onto vertex `to`
+struct Collapse {
+    unsigned int from;
+    unsigned int to;
+    double cost;
+    // The geometric part of the cost, as a distance
+    double error;
+    unsigned int fromVersion;
+    unsigned int toVersion;
+
+    // The priority queue puts the largest element first, so the comparison is reversed
+    bool operator< (Collapse const &other) const {
+        return cost > other.cost;
+    }
+};
+
+// Hash of the raw bytes of a vertex' attributes, used to weld identical vertices
+struct VertexKey {
+    float values[13];
+
+    bool operator== (VertexKey const &other) const {
+        return std::memcmp(values, other.values, sizeof(values)) == 0;
+    }
+};
+
+struct VertexKeyHash {
+    size_t operator() (VertexKey const &key) const {
+        unsigned char const* bytes = reinterpret_cast<unsigned char const*>(key.values);
+        size_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < sizeof(key.values); i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+};
+
+static VertexKey makeVertexKey(Mesh const &mesh, unsigned int vertex, bool includeAttributes) {
+    VertexKey key;
+    std::memset(key.values, 0, sizeof(key.values));
+
+    float4 const &position = mesh.vertices[vertex];
+    key.values[0] = position.x;
+    key.values[1] = position.y;
+    key.values[2] = position.z;
+
+    if (includeAttributes) {
+        if (vertex < mesh.colours.size()) {
+            float4 const &colour = mesh.colours[vertex];
+            key.values[3] = colour.x;
+            key.values[4] = colour.y;
+            key.values[5] = colour.z;
+            key.values[6] = colour.w;
+        }
+        if (vertex < mesh.normals.size()) {
+            float3 const &normal = mesh.normals[vertex];
+            key.values[7] = normal.x;
+            key.values[8] = normal.y;
+            key.values[9] = normal.z;
+        }
+        if (vertex < mesh.textureCoordinates.size()) {
+            float2 const &textureCoordinate = mesh.textureCoordinates[vertex];
+            key.values[10] = textureCoordinate.x;
+            key.values[11] = textureCoordinate.y;
+        }
+        key.values[12] = 1.0f;
+    }
+    return key;
+}
+
+static float3 triangleNormal(float4 const &a, float4 const &b, float4 const &c) {
+    float3 ab(b.x - a.x, b.y - a.y, b.z - a.z);
+    float3 ac(c.x - a.x, c.y - a.y, c.z - a.z);
+    return ab.cross(ac);
+}
+
+// Builds an indexed copy of the mesh where identical vertices are shared
+static Mesh weldVertices(Mesh const &mesh) {
+    Mesh welded(mesh.name);
+    welded.hasNormals = mesh.hasNormals;
+    welded.hasTextureCoordinates = mesh.hasTextureCoordinates;
+
+    bool hasColours = mesh.colours.size() == mesh.vertices.size();
+    bool hasNormals = mesh.normals.size() == mesh.vertices.size();
+    bool hasTextureCoordinates = mesh.textureCoordinates.size() == mesh.vertices.size();
+
+    std::unordered_map<VertexKey, unsigned int, VertexKeyHash> uniqueVertices;
+    uniqueVertices.reserve(mesh.vertices.size());
+    std::vector<unsigned int> remap(mesh.vertices.size());
+
+    for (unsigned int vertex = 0; vertex < mesh.vertices.size(); vertex++) {
+        VertexKey key = makeVertexKey(mesh, vertex, true);
+        auto inserted = uniqueVertices.insert(std::make_pair(key, unsigned(welded.vertices.size())));
+        if (inserted.second) {
+            welded.vertices.push_back(mesh.vertices[vertex]);
+            if (hasColours) welded.colours.push_back(mesh.colours[vertex]);
+            if (hasNormals) welded.normals.push_back(mesh.normals[vertex]);
+            if (hasTextureCoordinates) welded.textureCoordinates.push_back(mesh.textureCoordinates[vertex]);
+        }
+        remap[vertex] = inserted.first->second;
+    }
+
+    welded.indices.reserve(mesh.indices.size());
+    for (unsigned int index : mesh.indices) {
+        welded.indices.push_back(remap[index]);
+    }
+    return welded;
+}
+
+Mesh simplifyMesh(Mesh const &original, unsigned int targetTriangleCount, float maxError, float* error) {
+    Mesh mesh = weldVertices(original);
+
+    unsigned int vertexCount = unsigned(mesh.vertices.size());
+    unsigned int triangleCount = unsigned(mesh.indices.size() / 3);
+    auto &indices = mesh.indices;
+
+    // Group vertices sharing a position. Collapses move whole groups, so the vertices on either
+    // side of a seam (where the colours, normals or texture coordinates change) stay together.
+    // The vertices of each group are kept in a list running through nextVertexInGroup.
+    std::vector<unsigned int> positionGroup(vertexCount);
+    std::vector<unsigned int> nextVertexInGroup(vertexCount);
+    std::vector<unsigned int> groupFirstVertex;
+    std::vector<unsigned int> groupVertexCount;
+    {
+        std::unordered_map<VertexKey, unsigned int, VertexKeyHash> groups;
+        for (unsigned int vertex = 0; vertex < vertexCount; vertex++) {
+            auto inserted = groups.insert(std::make_pair(makeVertexKey(mesh, vertex, false), unsigned(groupFirstVertex.size())));
+            if (inserted.second) {
+                groupFirstVertex.push_back(~0u);
+                groupVertexCount.push_back(0);
+            }
+            unsigned int group = inserted.first->second;
+            positionGroup[vertex] = group;
+            nextVertexInGroup[vertex] = groupFirstVertex[group];
+            groupFirstVertex[group] = vertex;
+            groupVertexCount[group]++;
+        }
+    }
+    unsigned int groupCount = unsigned(groupFirstVertex.size());
+
+    // Edges used by only one triangle lie on the border of the surface, so their ends must not move
+    std::vector<bool> isLocked(groupCount, false);
+    {
+        std::unordered_map<unsigned long long, unsigned int> edgeUseCount;
+        for (unsigned int triangle = 0; triangle < triangleCount; triangle++) {
+            for (int corner = 0; corner < 3; corner++) {
+                unsigned long long a = positionGroup[indices[3 * triangle + corner]];
+                unsigned long long b = positionGroup[indices[3 * triangle + (corner + 1) % 3]];
+                edgeUseCount[(std::min(a, b) << 32) | std::max(a, b)]++;
+            }
+        }
+        for (unsigned int triangle = 0; triangle < triangleCount; triangle++) {
+            for (int corner = 0; corner < 3; corner++) {
+                unsigned long long a = positionGroup[indices[3 * triangle + corner]];
+                unsigned long long b = positionGroup[indices[3 * triangle + (corner + 1) % 3]];
+                if (edgeUseCount[(std::min(a, b) << 32) | std::max(a, b)] == 1) {
+                    isLocked[a] = true;
+                    isLocked[b] = true;
+                }
+            }
+        }
+    }
+
+    // Accumulate the quadric of every triangle's plane, weighted by area, in its corners' groups
+    std::vector<Quadric> quadrics(groupCount);
+    std::vector<std::vector<unsigned int>> vertexTriangles(vertexCount);
+    for (unsigned int triangle = 0; triangle < triangleCount; triangle++) {
+        unsigned int v0 = indices[3 * triangle + 0];
+        unsigned int v1 = indices[3 * triangle + 1];
+        unsigned int v2 = indices[3 * triangle + 2];
+
+        float3 normal = triangleNormal(mesh.vertices[v0], mesh.vertices[v1], mesh.vertices[v2]);
+        double doubleArea = std::sqrt(normal.dot(normal));
+        if (doubleArea > 0.0) {
+            normal *= float(1.0 / doubleArea);
+            float4 const &p = mesh.vertices[v0];
+            double d = -(normal.x * p.x + normal.y * p.y + normal.z * p.z);
+            Quadric quadric(normal.x, normal.y, normal.z, d, 0.5 * doubleArea);
+            quadrics[positionGroup[v0]] += quadric;
+            quadrics[positionGroup[v1]] += quadric;
+            quadrics[positionGroup[v2]] += quadric;
+        }
+
+        vertexTriangles[v0].push_back(triangle);
+        vertexTriangles[v1].push_back(triangle);
+        vertexTriangles[v2].push_back(triangle);
+    }
+
+    // Colour and normal differences are measured relative to the size of the mesh,
+    // so the weighting does not depend on the units the mesh is modelled in
+    float3 boundsMin(std::numeric_limits<float>::max());
+    float3 boundsMax(-std::numeric_limits<float>::max());
+    for (float4 const &vertex : mesh.vertices) {
+        boundsMin = float3(std::min(boundsMin.x, vertex.x), std::min(boundsMin.y, vertex.y), std::min(boundsMin.z, vertex.z));
+        boundsMax = float3(std::max(boundsMax.x, vertex.x), std::max(boundsMax.y, vertex.y), std::max(boundsMax.z, vertex.z));
+    }
+    float3 extent = boundsMax - boundsMin;
+    double attributeWeight = 0.01 * extent.dot(extent);
+
+    std::vector<bool> isTriangleAlive(triangleCount, true);
+    std::vector<unsigned int> groupVersion(groupCount, 0);
+
+    auto attributeDistance = [&](unsigned int a, unsigned int b) {
+        double distance = 0.0;
+        if (!mesh.colours.empty()) {
+            float4 difference = mesh.colours[a] - mesh.colours[b];
+            distance += difference.x * difference.x + difference.y * difference.y + difference.z * difference.z + difference.w * difference.w;
+        }
+        if (!mesh.normals.empty()) {
+            float3 difference = mesh.normals[a] - mesh.normals[b];
+            distance += difference.dot(difference);
+        }
+        if (!mesh.textureCoordinates.empty()) {
+            float2 difference = mesh.textureCoordinates[a] - mesh.textureCoordinates[b];
+            distance += difference.x * difference.x + difference.y * difference.y;
+        }
+        return distance;
+    };
+
+    auto triangleTouchesGroup = [&](unsigned int triangle, unsigned int group) {
+        unsigned int const* corners = &indices[3 * triangle];
+        if (groupVertexCount[group] == 1) {
+            unsigned int vertex = groupFirstVertex[group];
+            return corners[0] == vertex || corners[1] == vertex || corners[2] == vertex;
+        }
+        return positionGroup[corners[0]] == group || positionGroup[corners[1]] == group || positionGroup[corners[2]] == group;
+    };
+
+    // Finds, for each vertex of group `from`, the vertex of group `to` it merges with: the one with
+    // the closest attributes among those it shares an edge with. A vertex with none of them, such as
+    // the corner of a side which does not reach `to`, keeps its attributes and only moves, which
+    // leaves the seam where it is. That is only allowed if `to` lies on a seam as well, so seams are
+    // never dragged into the inside of an area of constant attributes.
+    // Returns false if the collapse is not allowed, and the summed attribute distance otherwise.
+    std::vector<unsigned int> mergeTargets;
+    auto findMergeTargets = [&](unsigned int from, unsigned int to, double &attributeCost) {
+        mergeTargets.clear();
+        attributeCost = 0.0;
+        bool toIsOnSeam = groupVertexCount[to] > 1;
+
+        // Away from seams, the groups are the two ends of an edge and there is nothing to look for
+        if (groupVertexCount[from] == 1 && !toIsOnSeam) {
+            mergeTargets.push_back(groupFirstVertex[to]);
+            attributeCost = attributeDistance(groupFirstVertex[from], groupFirstVertex[to]);
+            return true;
+        }
+
+        for (unsigned int vertex = groupFirstVertex[from]; vertex != ~0u; vertex = nextVertexInGroup[vertex]) {
+            unsigned int target = ~0u;
+            double targetDistance = std::numeric_limits<double>::max();
+            for (unsigned int triangle : vertexTriangles[vertex]) {
+                if (!isTriangleAlive[triangle]) continue;
+                for (int corner = 0; corner < 3; corner++) {
+                    unsigned int neighbour = indices[3 * triangle + corner];
+                    if (positionGroup[neighbour] != to) continue;
+                    double distance = attributeDistance(vertex, neighbour);
+                    if (distance < targetDistance) {
+                        target = neighbour;
+                        targetDistance = distance;
+                    }
+                }
+            }
+            if (target == ~0u) {
+                if (!toIsOnSeam) {
+                    return false;
+                }
+            } else {
+                attributeCost += targetDistance;
+            }
+            mergeTargets.push_back(target);
+        }
+        return true;
+    };
+
+    std::priority_queue<Collapse> candidates;
+    auto addCandidate = [&](unsigned int from, unsigned int to) {
+        double attributeCost;
+        if (isLocked[from] || !findMergeTargets(from, to, attributeCost)) {
+            return;
+        }
+        Quadric combined = quadrics[from];
+        combined += quadrics[to];
+        float4 const &target = mesh.vertices[groupFirstVertex[to]];
+        Collapse collapse;
+        collapse.from = from;
+        collapse.to = to;
+        collapse.error = combined.distance(target);
+        // Collapses moving the surface too far are never made, so they need not be queued
+        if (collapse.error > maxError) {
+            return;
+        }
+        collapse.cost = combined.evaluate(target) + attributeWeight * attributeCost;
+        collapse.fromVersion = groupVersion[from];
+        collapse.toVersion = groupVersion[to];
+        candidates.push(collapse);
+    };
+
+    for (unsigned int triangle = 0; triangle < triangleCount; triangle++) {
+        for (int corner = 0; corner < 3; corner++) {
+            unsigned int a = positionGroup[indices[3 * triangle + corner]];
+            unsigned int b = positionGroup[indices[3 * triangle + (corner + 1) % 3]];
+            addCandidate(a, b);
+            addCandidate(b, a);
+        }
+    }
+
+    // Moving a group must not flip any of the triangles around it
+    auto wouldFlipTriangles = [&](unsigned int from, unsigned int to) {
+        float4 const &target = mesh.vertices[groupFirstVertex[to]];
+        for (unsigned int vertex = groupFirstVertex[from]; vertex != ~0u; vertex = nextVertexInGroup[vertex]) {
+            for (unsigned int triangle : vertexTriangles[vertex]) {
+                if (!isTriangleAlive[triangle] || triangleTouchesGroup(triangle, to)) continue;
+
+                unsigned int* corners = &indices[3 * triangle];
+                float4 moved[3];
+                for (int corner = 0; corner < 3; corner++) {
+                    moved[corner] = (positionGroup[corners[corner]] == from) ? target : mesh.vertices[corners[corner]];
+                }
+                float3 before = triangleNormal(mesh.vertices[corners[0]], mesh.vertices[corners[1]], mesh.vertices[corners[2]]);
+                float3 after = triangleNormal(moved[0], moved[1], moved[2]);
+                if (before.dot(after) <= 0.2f * std::sqrt(before.dot(before) * after.dot(after))) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+
+    unsigned int aliveTriangles = triangleCount;
+    double largestError = 0.0;
+    while (aliveTriangles > targetTriangleCount && !candidates.empty()) {
+        Collapse collapse = candidates.top();
+        candidates.pop();
+
+        // Skip candidates which were computed before one of the groups changed
+        if (collapse.fromVersion != groupVersion[collapse.from] || collapse.toVersion != groupVersion[collapse.to]) {
+            continue;
+        }
+        if (wouldFlipTriangles(collapse.from, collapse.to)) {
+            continue;
+        }
+
+        unsigned int from = collapse.from;
+        unsigned int to = collapse.to;
+        largestError = std::max(largestError, collapse.error);
+        double attributeCost;
+        findMergeTargets(from, to, attributeCost);
+        float4 target = mesh.vertices[groupFirstVertex[to]];
+
+        unsigned int next;
+        for (unsigned int vertex = groupFirstVertex[from], i = 0; vertex != ~0u; vertex = next, i++) {
+            next = nextVertexInGroup[vertex];
+            unsigned int merged = mergeTargets[i];
+
+            for (unsigned int triangle : vertexTriangles[vertex]) {
+                if (!isTriangleAlive[triangle]) continue;
+
+                if (triangleTouchesGroup(triangle, to)) {
+                    // The triangle contains the collapsed edge, so it degenerates
+                    isTriangleAlive[triangle] = false;
+                    aliveTriangles--;
+                } else if (merged != ~0u) {
+                    unsigned int* corners = &indices[3 * triangle];
+                    for (int corner = 0; corner < 3; corner++) {
+                        if (corners[corner] == vertex) corners[corner] = merged;
+                    }
+                    vertexTriangles[merged].push_back(triangle);
+                }
+            }
+
+            if (merged != ~0u) {
+                vertexTriangles[vertex].clear();
+            } else {
+                mesh.vertices[vertex] = target;
+                positionGroup[vertex] = to;
+                nextVertexInGroup[vertex] = groupFirstVertex[to];
+                groupFirstVertex[to] = vertex;
+                groupVertexCount[to]++;
+            }
+        }
+        groupFirstVertex[from] = ~0u;
+        groupVertexCount[from] = 0;
+
+        quadrics[to] += quadrics[from];
+        groupVersion[from]++;
+        groupVersion[to]++;
+
+        // The costs of all edges around the surviving group have changed. The triangles which
+        // degenerated are dropped from its lists on the way, so later collapses skip over fewer.
+        for (unsigned int vertex = groupFirstVertex[to]; vertex != ~0u; vertex = nextVertexInGroup[vertex]) {
+            std::vector<unsigned int> &triangles = vertexTriangles[vertex];
+            triangles.erase(std::remove_if(triangles.begin(), triangles.end(),
+                                           [&](unsigned int triangle) { return !isTriangleAlive[triangle]; }),
+                            triangles.end());
+            for (unsigned int triangle : triangles) {
+                for (int corner = 0; corner < 3; corner++) {
+                    unsigned int neighbour = positionGroup[indices[3 * triangle + corner]];
+                    if (neighbour != to) {
+                        addCandidate(neighbour, to);
+                        addCandidate(to, neighbour);
+                    }
+                }
+            }
+        }
+    }
+
+    if (error) {
+        *error = float(largestError);
+    }
+
+    // Copy the remaining triangles and the vertices they use into a compact mesh
+    Mesh simplified(original.name);
+    simplified.hasNormals = mesh.hasNormals;
+    simplified.hasTextureCoordinates = mesh.hasTextureCoordinates;
+    std::vector<unsigned int> remap(vertexCount, ~0u);
+    simplified.indices.reserve(3 * aliveTriangles);
+
+    for (unsigned int triangle = 0; triangle < triangleCount; triangle++) {
+        if (!isTriangleAlive[triangle]) continue;
+        for (int corner = 0; corner < 3; corner++) {
+            unsigned int vertex = indices[3 * triangle + corner];
+            if (remap[vertex] == ~0u) {
+                remap[vertex] = unsigned(simplified.vertices.size());
+                simplified.vertices.push_back(mesh.vertices[vertex]);
+                if (!mesh.colours.empty()) simplified.colours.push_back(mesh.colours[vertex]);
+                if (!mesh.normals.empty()) simplified.normals.push_back(mesh.normals[vertex]);
+                if (!mesh.textureCoordinates.empty()) simplified.textureCoordinates.push_back(mesh.textureCoordinates[vertex]);
+            }
+            simplified.indices.push_back(remap[vertex]);
+        }
+    }
+
+    return simplified;
+}
+
+std::vector<SimplifiedLevel> generateLODChain(Mesh const &mesh, unsigned int maxLevels, float reductionPerLevel,
+                                              float maxRelativeError) {
+    std::vector<SimplifiedLevel> levels;
+    unsigned int previousTriangleCount = unsigned(mesh.indices.size() / 3);
+    float maxError = maxRelativeError * computeBoundingSphere(mesh).radius;
+    float previousError = 0.0f;
+
+    for (unsigned int level = 1; level <= maxLevels; level++) {
+        unsigned int target = unsigned(previousTriangleCount * reductionPerLevel);
+        float stepError;
+        Mesh simplified = simplifyMesh(levels.empty() ? mesh : levels.back().mesh, target,
+                                       maxError - previousError, &stepError);
+        unsigned int triangleCount = unsigned(simplified.indices.size() / 3);
+
+        // Stop when the simplification got stuck, there is no point in storing an identical level
+        if (triangleCount == 0 || triangleCount > 0.9f * previousTriangleCount) {
+            break;
+        }
+
+        previousTriangleCount = triangleCount;
+        previousError += stepError;
+        SimplifiedLevel simplifiedLevel = { std::move(simplified), previousError };
+        levels.push_back(std::move(simplifiedLevel));
+    }
+
+    return levels;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <limits>
+#include <vector>
+#include "mesh.hpp"
+
+// Mesh simplification using quadric error metrics (Garland & Heckbert).
+//
+// Triangles are removed by repeatedly collapsing the edge whose removal changes the surface
+// the least. Collapses move one position onto the other rather than to a new position, so the
+// remaining vertices keep their original colours and normals. Where the colours or normals are
+// discontinuous (a seam, for instance at the boundary between two differently coloured faces),
+// several vertices share a position and are moved together: each one merges with the vertex at
+// the other end of the edge that it shares a face with, and the others keep their attributes, so
+// both sides of the seam stay intact. Vertices on the border of an open surface are never moved.
+//
+// The result is always an indexed mesh where vertices with identical attributes are shared.
+//
+// The error of a collapse is the root mean square distance of the moved position to the planes
+// of the original triangles around it, weighted by their area, so it is in the mesh's units.
+
+// Returns a simplified copy of the mesh with at most targetTriangleCount triangles, or as
+// few as possible if the target can not be reached without removing border vertices or
+// making collapses with an error above maxError. If error is not null, it is set to the
+// largest error of the collapses made.
+Mesh simplifyMesh(Mesh const &mesh, unsigned int targetTriangleCount,
+                  float maxError = std::numeric_limits<float>::infinity(), float* error = nullptr);
+
+// A simplified version of a mesh, along with how far its surface may lie from the original
+struct SimplifiedLevel {
+    Mesh mesh;
+    float error;
+};
+
+// Generates a chain of progressively simpler versions of a mesh, each with about
+// reductionPerLevel times the triangles of the previous one. The original mesh is not
+// included. Each level is simplified from the one before, so its error is the sum of the
+// errors of the steps leading to it. The chain ends early once a level no longer removes a
+// meaningful number of triangles without its error exceeding maxRelativeError times the radius
+// of the mesh's bounding sphere.
+std::vector<SimplifiedLevel> generateLODChain(Mesh const &mesh, unsigned int maxLevels = 4,
+                                              float reductionPerLevel = 0.5f, float maxRelativeError = 0.02f);
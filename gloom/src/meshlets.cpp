@@ -0,0 +1,257 @@
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include "meshlets.hpp"
+
+// Computes the bounding sphere and normal cone of a meshlet whose index range is already set
+static void computeMeshletBounds(Mesh const &mesh, Meshlet &meshlet) {
+    unsigned int const *indices = &mesh.indices[meshlet.indexOffset];
+
+    float3 minimum = mesh.vertices[indices[0]].toFloat3();
+    float3 maximum = minimum;
+    for (unsigned int i = 1; i < meshlet.indexCount; i++) {
+        float3 position = mesh.vertices[indices[i]].toFloat3();
+        minimum = float3(std::min(minimum.x, position.x), std::min(minimum.y, position.y), std::min(minimum.z, position.z));
+        maximum = float3(std::max(maximum.x, position.x), std::max(maximum.y, position.y), std::max(maximum.z, position.z));
+    }
+
+    float3 centre = (minimum + maximum) * 0.5f;
+    float radiusSquared = 0;
+    for (unsigned int i = 0; i < meshlet.indexCount; i++) {
+        float3 offset = mesh.vertices[indices[i]].toFloat3() - centre;
+        radiusSquared = std::max(radiusSquared, offset.dot(offset));
+    }
+    meshlet.boundingSphereCentre = centre;
+    meshlet.boundingSphereRadius = std::sqrt(radiusSquared);
+
+    // The cone axis is the average direction of the triangles; the cone is as wide as the
+    // triangle furthest from it. Degenerate triangles have no direction and are ignored.
+    std::vector<float3> normals;
+    normals.reserve(meshlet.indexCount / 3);
+    float3 axis(0, 0, 0);
+    for (unsigned int i = 0; i + 2 < meshlet.indexCount; i += 3) {
+        float3 p0 = mesh.vertices[indices[i + 0]].toFloat3();
+        float3 p1 = mesh.vertices[indices[i + 1]].toFloat3();
+        float3 p2 = mesh.vertices[indices[i + 2]].toFloat3();
+        float3 normal = (p1 - p0).cross(p2 - p0);
+        if (normal.dot(normal) > 0.0f) {
+            normal.normalize();
+            normals.push_back(normal);
+            axis += normal;
+        }
+    }
+
+    meshlet.coneAxis = float3(0, 0, 0);
+    meshlet.coneCutoff = 1.0f;
+    if (normals.empty() || axis.dot(axis) <= 0.0f) {
+        return;
+    }
+    axis.normalize();
+
+    float minimumDot = 1.0f;
+    for (float3 const &normal : normals) {
+        minimumDot = std::min(minimumDot, normal.dot(axis));
+    }
+    meshlet.coneAxis = axis;
+    // A cone of 90 degrees or more always has some triangle facing the camera
+    if (minimumDot > 0.0f) {
+        meshlet.coneCutoff = std::sqrt(1.0f - minimumDot * minimumDot);
+    }
+}
+
+std::vector<Meshlet> buildMeshlets(Mesh &mesh, unsigned int maxVertices, unsigned int maxTriangles) {
+    std::vector<Meshlet> meshlets;
+    size_t vertexCount = mesh.vertices.size();
+    size_t triangleCount = mesh.indices.size() / 3;
+    if (triangleCount == 0 || maxVertices < 3 || maxTriangles == 0) {
+        return meshlets;
+    }
+    auto const &indices = mesh.indices;
+
+    // The triangles using each vertex, as a counting sort
+    std::vector<unsigned int> vertexTriangleStart(vertexCount + 1, 0);
+    std::vector<unsigned int> vertexTriangles(3 * triangleCount);
+    for (size_t corner = 0; corner < 3 * triangleCount; corner++) {
+        vertexTriangleStart[indices[corner] + 1]++;
+    }
+    for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+        vertexTriangleStart[vertex + 1] += vertexTriangleStart[vertex];
+    }
+    {
+        std::vector<unsigned int> fillPosition(vertexTriangleStart.begin(), vertexTriangleStart.end() - 1);
+        for (size_t corner = 0; corner < 3 * triangleCount; corner++) {
+            vertexTriangles[fillPosition[indices[corner]]++] = unsigned(corner / 3);
+        }
+    }
+
+    std::vector<bool> isTriangleUsed(triangleCount, false);
+    // The meshlet each vertex was last added to, so membership of the current one is a single comparison
+    std::vector<unsigned int> vertexMeshlet(vertexCount, ~0u);
+    decltype(mesh.indices) reorderedIndices;
+    reorderedIndices.reserve(3 * triangleCount);
+    // Unused triangles sharing a vertex with the current meshlet
+    std::vector<unsigned int> candidates;
+    size_t nextUnusedTriangle = 0;
+
+    while (true) {
+        while (nextUnusedTriangle < triangleCount && isTriangleUsed[nextUnusedTriangle]) {
+            nextUnusedTriangle++;
+        }
+        if (nextUnusedTriangle == triangleCount) {
+            break;
+        }
+
+        unsigned int meshletID = unsigned(meshlets.size());
+        Meshlet meshlet;
+        meshlet.indexOffset = unsigned(reorderedIndices.size());
+        unsigned int meshletVertexCount = 0;
+        unsigned int meshletTriangleCount = 0;
+        candidates.clear();
+
+        auto countNewVertices = [&](unsigned int triangle) {
+            unsigned int count = 0;
+            for (int corner = 0; corner < 3; corner++) {
+                if (vertexMeshlet[indices[3 * triangle + corner]] != meshletID) {
+                    count++;
+                }
+            }
+            return count;
+        };
+
+        unsigned int triangle = unsigned(nextUnusedTriangle);
+        while (true) {
+            isTriangleUsed[triangle] = true;
+            meshletTriangleCount++;
+            for (int corner = 0; corner < 3; corner++) {
+                unsigned int vertex = indices[3 * triangle + corner];
+                reorderedIndices.push_back(vertex);
+                if (vertexMeshlet[vertex] != meshletID) {
+                    vertexMeshlet[vertex] = meshletID;
+                    meshletVertexCount++;
+                    for (unsigned int i = vertexTriangleStart[vertex]; i < vertexTriangleStart[vertex + 1]; i++) {
+                        if (!isTriangleUsed[vertexTriangles[i]]) {
+                            candidates.push_back(vertexTriangles[i]);
+                        }
+                    }
+                }
+            }
+
+            if (meshletTriangleCount == maxTriangles) {
+                break;
+            }
+
+            // Continue with the neighbour adding the fewest new vertices, which keeps the meshlet compact
+            unsigned int best = ~0u;
+            unsigned int bestNewVertices = 4;
+            for (size_t i = 0; i < candidates.size(); ) {
+                unsigned int candidate = candidates[i];
+                if (isTriangleUsed[candidate]) {
+                    candidates[i] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+                unsigned int newVertices = countNewVertices(candidate);
+                if (meshletVertexCount + newVertices <= maxVertices &&
+                    (newVertices < bestNewVertices || (newVertices == bestNewVertices && candidate < best))) {
+                    best = candidate;
+                    bestNewVertices = newVertices;
+                }
+                i++;
+            }
+
+            // Without a fitting neighbour, continue with the next triangle in storage order
+            if (best == ~0u) {
+                while (nextUnusedTriangle < triangleCount && isTriangleUsed[nextUnusedTriangle]) {
+                    nextUnusedTriangle++;
+                }
+                if (nextUnusedTriangle == triangleCount ||
+                    meshletVertexCount + countNewVertices(unsigned(nextUnusedTriangle)) > maxVertices) {
+                    break;
+                }
+                best = unsigned(nextUnusedTriangle);
+            }
+            triangle = best;
+        }
+
+        meshlet.indexCount = 3 * meshletTriangleCount;
+        meshlets.push_back(meshlet);
+    }
+
+    // Any incomplete triangle at the end of the index buffer is kept, but belongs to no meshlet
+    reorderedIndices.insert(reorderedIndices.end(), indices.begin() + 3 * triangleCount, indices.end());
+    mesh.indices.swap(reorderedIndices);
+
+    for (Meshlet &meshlet : meshlets) {
+        computeMeshletBounds(mesh, meshlet);
+    }
+    return meshlets;
+}
+
+MeshletCullingResult cullMeshlets(std::vector<Meshlet> const &meshlets, glm::mat4 const &modelViewProjection,
+                                  std::vector<IndexRange> &visibleRanges) {
+    MeshletCullingResult result = { 0, 0 };
+    visibleRanges.clear();
+
+    // The frustum planes in the mesh's own coordinate space, taken from the rows of the matrix.
+    // Points inside the frustum are on the positive side of all of them.
+    glm::mat4 const &m = modelViewProjection;
+    glm::vec4 rows[4];
+    for (int row = 0; row < 4; row++) {
+        rows[row] = glm::vec4(m[0][row], m[1][row], m[2][row], m[3][row]);
+    }
+    glm::vec4 planes[6] = {
+        rows[3] + rows[0], rows[3] - rows[0],
+        rows[3] + rows[1], rows[3] - rows[1],
+        rows[3] + rows[2], rows[3] - rows[2]
+    };
+    for (glm::vec4 &plane : planes) {
+        float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        if (length > 0.0f) {
+            plane = plane * (1.0f / length);
+        }
+    }
+
+    // The camera is the point a perspective projection sends to infinity
+    glm::vec4 camera = glm::inverse(modelViewProjection) * glm::vec4(0, 0, 1, 0);
+    bool canCullBackfaces = std::abs(camera.w) > 1e-12f;
+    float3 cameraPosition(0, 0, 0);
+    if (canCullBackfaces) {
+        cameraPosition = float3(camera.x / camera.w, camera.y / camera.w, camera.z / camera.w);
+    }
+
+    for (Meshlet const &meshlet : meshlets) {
+        float3 const &centre = meshlet.boundingSphereCentre;
+        float radius = meshlet.boundingSphereRadius;
+
+        bool isVisible = true;
+        for (glm::vec4 const &plane : planes) {
+            if (plane.x * centre.x + plane.y * centre.y + plane.z * centre.z + plane.w < -radius) {
+                isVisible = false;
+                break;
+            }
+        }
+
+        // The meshlet faces away if every direction from the camera to it lies within
+        // the normal cone, widened by the angle the bounding sphere covers
+        if (isVisible && canCullBackfaces && meshlet.coneCutoff < 1.0f) {
+            float3 view = centre - cameraPosition;
+            float distance = std::sqrt(view.dot(view));
+            if (view.dot(meshlet.coneAxis) >= meshlet.coneCutoff * distance + radius) {
+                isVisible = false;
+            }
+        }
+
+        if (!isVisible) {
+            result.clustersCulled++;
+            result.trianglesCulled += meshlet.indexCount / 3;
+        } else if (!visibleRanges.empty() &&
+                   visibleRanges.back().first + visibleRanges.back().count == meshlet.indexOffset) {
+            visibleRanges.back().count += meshlet.indexCount;
+        } else {
+            IndexRange range = { meshlet.indexOffset, meshlet.indexCount };
+            visibleRanges.push_back(range);
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <vector>
+#include "mesh.hpp"
+
+// Meshlets (clusters) are small groups of neighbouring triangles which are culled as a unit.
+// Splitting a large mesh into meshlets lets the parts of it outside the view, or facing away
+// from the camera, be skipped even when the mesh as a whole is visible.
+
+// A cluster of triangles stored contiguously in its mesh's index buffer.
+struct Meshlet {
+    // The part of the index buffer holding the meshlet's triangles
+    unsigned int indexOffset;
+    unsigned int indexCount;
+
+    // A sphere enclosing the meshlet, in the mesh's own coordinate space
+    float3 boundingSphereCentre;
+    float boundingSphereRadius;
+
+    // The normals of all triangles lie within a cone around coneAxis. coneCutoff is the sine of
+    // the cone's half angle, or 1 if the cone is too wide for the meshlet to ever face away entirely.
+    float3 coneAxis;
+    float coneCutoff;
+};
+
+// A range of an index buffer to draw, counted in indices.
+struct IndexRange {
+    unsigned int first;
+    unsigned int count;
+};
+
+struct MeshletCullingResult {
+    unsigned int clustersCulled;
+    unsigned int trianglesCulled;
+};
+
+// Splits a mesh into meshlets of at most maxVertices distinct vertices and maxTriangles triangles.
+// The triangles of the mesh are reordered so each meshlet occupies one range of the index buffer;
+// the vertices are left as they are. Meshlets are grown from triangles sharing vertices, so indexed
+// meshes give the tightest clusters; meshes where every triangle has its own vertices are
+// clustered in the order their triangles are stored.
+std::vector<Meshlet> buildMeshlets(Mesh &mesh, unsigned int maxVertices = 64, unsigned int maxTriangles = 124);
+
+// Tests each meshlet against the view frustum and its normal cone against the camera position,
+// and replaces the contents of visibleRanges with the index ranges of the meshlets which may be
+// visible. Ranges of meshlets which are next to each other in the index buffer are merged.
+// modelViewProjection transforms the mesh's coordinates to clip space, and must use a perspective projection.
+MeshletCullingResult cullMeshlets(std::vector<Meshlet> const &meshlets, glm::mat4 const &modelViewProjection,
+                                  std::vector<IndexRange> &visibleRanges);
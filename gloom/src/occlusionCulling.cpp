@@ -0,0 +1,335 @@
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include "occlusionCulling.hpp"
+#include "parallel.hpp"
+
+const unsigned int OcclusionBuffer::tileSize;
+
+struct PositionHash {
+    size_t operator() (float3 const &position) const {
+        // Adding 0 turns -0 into 0, which compares equal to it
+        float values[3] = { position.x + 0.0f, position.y + 0.0f, position.z + 0.0f };
+        uint32_t bits[3];
+        std::memcpy(bits, values, sizeof(bits));
+        return (size_t(bits[0]) * 73856093u) ^ (size_t(bits[1]) * 19349663u) ^ (size_t(bits[2]) * 83492791u);
+    }
+};
+
+OccluderMesh buildOccluderMesh(Mesh const &mesh) {
+    OccluderMesh occluder;
+
+    std::unordered_map<float3, unsigned int, PositionHash> positionIndices;
+    std::vector<unsigned int> remap(mesh.vertices.size());
+    for (size_t vertex = 0; vertex < mesh.vertices.size(); vertex++) {
+        float3 position = mesh.vertices[vertex].toFloat3();
+        auto inserted = positionIndices.insert(std::make_pair(position, unsigned(occluder.positions.size())));
+        if (inserted.second) {
+            occluder.positions.push_back(position);
+        }
+        remap[vertex] = inserted.first->second;
+    }
+
+    for (size_t first = 0; first + 2 < mesh.indices.size(); first += 3) {
+        unsigned int a = remap[mesh.indices[first]];
+        unsigned int b = remap[mesh.indices[first + 1]];
+        unsigned int c = remap[mesh.indices[first + 2]];
+        if (a != b && b != c && c != a) {
+            occluder.indices.push_back(a);
+            occluder.indices.push_back(b);
+            occluder.indices.push_back(c);
+        }
+    }
+
+    // Pair up the edges used by exactly two triangles
+    struct EdgeUse {
+        size_t firstEdge;
+        unsigned int count;
+    };
+    std::unordered_map<unsigned long long, EdgeUse> edgeUses;
+    auto edgeKey = [&](size_t edge) {
+        size_t triangle = edge - edge % 3;
+        unsigned long long a = occluder.indices[edge];
+        unsigned long long b = occluder.indices[triangle + (edge + 1) % 3];
+        return (std::min(a, b) << 32) | std::max(a, b);
+    };
+    for (size_t edge = 0; edge < occluder.indices.size(); edge++) {
+        auto inserted = edgeUses.insert(std::make_pair(edgeKey(edge), EdgeUse { edge, 0 }));
+        inserted.first->second.count++;
+    }
+
+    occluder.oppositeCorners.assign(occluder.indices.size(), ~0u);
+    for (size_t edge = 0; edge < occluder.indices.size(); edge++) {
+        EdgeUse const &use = edgeUses[edgeKey(edge)];
+        if (use.count == 2 && use.firstEdge != edge) {
+            size_t other = use.firstEdge;
+            occluder.oppositeCorners[edge] = occluder.indices[other - other % 3 + (other + 2) % 3];
+            occluder.oppositeCorners[other] = occluder.indices[edge - edge % 3 + (edge + 2) % 3];
+        }
+    }
+    return occluder;
+}
+
+OcclusionBuffer::OcclusionBuffer(unsigned int width, unsigned int height) {
+    tileColumns = std::max(1u, (width + tileSize - 1) / tileSize);
+    tileRows = std::max(1u, (height + tileSize - 1) / tileSize);
+    this->width = tileColumns * tileSize;
+    this->height = tileRows * tileSize;
+
+    depth.assign(this->width * this->height, 0.0f);
+    tileFarthestDepth.assign(tileColumns * tileRows, 0.0f);
+}
+
+void OcclusionBuffer::clear() {
+    triangles.clear();
+    std::fill(depth.begin(), depth.end(), 0.0f);
+    std::fill(tileFarthestDepth.begin(), tileFarthestDepth.end(), 0.0f);
+}
+
+void OcclusionBuffer::addOccluder(OccluderMesh const &occluder, glm::mat4 const &modelViewProjection) {
+    corners.resize(occluder.positions.size());
+    for (size_t i = 0; i < occluder.positions.size(); i++) {
+        glm::vec4 clip = modelViewProjection * glm::vec4(glm::vec3(occluder.positions[i]), 1.0f);
+        ScreenCorner &corner = corners[i];
+        corner.isInFront = clip.w > 0.0f && clip.z >= -clip.w;
+        if (corner.isInFront) {
+            corner.depth = 1.0f / clip.w;
+            corner.x = (clip.x * corner.depth * 0.5f + 0.5f) * width;
+            corner.y = (clip.y * corner.depth * 0.5f + 0.5f) * height;
+        }
+    }
+
+    // Made to pass whatever pixel it is tested on
+    ScreenEdge alwaysPassing = { 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, -1.0f };
+
+    for (size_t first = 0; first + 2 < occluder.indices.size(); first += 3) {
+        ScreenCorner const* triangleCorners[3];
+        bool isInFront = true;
+        for (int corner = 0; corner < 3; corner++) {
+            triangleCorners[corner] = &corners[occluder.indices[first + corner]];
+            isInFront &= triangleCorners[corner]->isInFront;
+        }
+        if (!isInFront) {
+            continue;
+        }
+        ScreenCorner const &c0 = *triangleCorners[0];
+        ScreenCorner const &c1 = *triangleCorners[1];
+        ScreenCorner const &c2 = *triangleCorners[2];
+
+        // Occluders are double sided, so the area may have either sign
+        float area = (c1.x - c0.x) * (c2.y - c0.y) - (c2.x - c0.x) * (c1.y - c0.y);
+        if (std::abs(area) < 1e-6f) {
+            continue;
+        }
+
+        ScreenTriangle triangle;
+        triangle.minimumX = std::min(c0.x, std::min(c1.x, c2.x));
+        triangle.maximumX = std::max(c0.x, std::max(c1.x, c2.x));
+        triangle.minimumY = std::min(c0.y, std::min(c1.y, c2.y));
+        triangle.maximumY = std::max(c0.y, std::max(c1.y, c2.y));
+        if (triangle.maximumX < 0.0f || triangle.minimumX > width || triangle.maximumY < 0.0f || triangle.minimumY > height) {
+            continue;
+        }
+
+        // The plane through the three corners' 1/w
+        float dx1 = c1.x - c0.x, dy1 = c1.y - c0.y, dz1 = c1.depth - c0.depth;
+        float dx2 = c2.x - c0.x, dy2 = c2.y - c0.y, dz2 = c2.depth - c0.depth;
+        triangle.depthPerX = (dz1 * dy2 - dz2 * dy1) / area;
+        triangle.depthPerY = (dz2 * dx1 - dz1 * dx2) / area;
+        triangle.depthAtOrigin = c0.depth - triangle.depthPerX * c0.x - triangle.depthPerY * c0.y;
+        triangle.neighbourhoodDepth = std::min(c0.depth, std::min(c1.depth, c2.depth));
+
+        for (int edge = 0; edge < 3; edge++) {
+            ScreenCorner const &from = *triangleCorners[edge];
+            ScreenCorner const &to = *triangleCorners[(edge + 1) % 3];
+            ScreenCorner const &third = *triangleCorners[(edge + 2) % 3];
+            triangle.edges[edge] = makeEdge(from, to, third);
+            triangle.coverageOffsets[edge] = triangle.edges[edge].offset;
+            triangle.neighbourEdges[edge][0] = alwaysPassing;
+            triangle.neighbourEdges[edge][1] = alwaysPassing;
+
+            // The edge is only inside the occluder if the neighbour lies on the other side of it
+            // on screen. Otherwise the occluder folds over along it, and it is part of the outline.
+            unsigned int opposite = occluder.oppositeCorners[first + edge];
+            if (opposite == ~0u || !corners[opposite].isInFront) {
+                continue;
+            }
+            ScreenCorner const &neighbourCorner = corners[opposite];
+            ScreenEdge const &shared = triangle.edges[edge];
+            float side = shared.sign * ((neighbourCorner.y - shared.fromY) * shared.deltaX - (neighbourCorner.x - shared.fromX) * shared.deltaY);
+            if (side >= 0.0f) {
+                continue;
+            }
+            triangle.coverageOffsets[edge] = 0.0f;
+            triangle.neighbourEdges[edge][0] = makeEdge(from, neighbourCorner, to);
+            triangle.neighbourEdges[edge][1] = makeEdge(to, neighbourCorner, from);
+            triangle.neighbourhoodDepth = std::min(triangle.neighbourhoodDepth, neighbourCorner.depth);
+        }
+
+        triangles.push_back(triangle);
+    }
+}
+
+OcclusionBuffer::ScreenEdge OcclusionBuffer::makeEdge(ScreenCorner const &a, ScreenCorner const &b, ScreenCorner const &inside) {
+    bool isReversed = a.x > b.x || (a.x == b.x && a.y > b.y);
+    ScreenCorner const &from = isReversed ? b : a;
+    ScreenCorner const &to = isReversed ? a : b;
+
+    ScreenEdge edge;
+    edge.fromX = from.x;
+    edge.fromY = from.y;
+    edge.deltaX = to.x - from.x;
+    edge.deltaY = to.y - from.y;
+    float insideValue = (inside.y - edge.fromY) * edge.deltaX - (inside.x - edge.fromX) * edge.deltaY;
+    edge.sign = (insideValue < 0.0f) ? -1.0f : 1.0f;
+    // The most the function changes between the centre of a pixel and its corners
+    edge.offset = 0.5f * (std::abs(edge.deltaX) + std::abs(edge.deltaY));
+    return edge;
+}
+
+void OcclusionBuffer::rasterize() {
+    parallelFor(0, tileRows, 1, [&](size_t first, size_t last) {
+        for (size_t tileRow = first; tileRow < last; tileRow++) {
+            rasterizeBand(unsigned(tileRow));
+        }
+    });
+}
+
+void OcclusionBuffer::startEdgeRow(ScreenEdge const &edge, float pixelY, float &start, float &step) {
+    start = edge.sign * (edge.deltaX * (pixelY - edge.fromY) + edge.deltaY * edge.fromX);
+    step = -edge.sign * edge.deltaY;
+}
+
+void OcclusionBuffer::rasterizeBand(unsigned int tileRow) {
+    int bandBegin = int(tileRow * tileSize);
+    int bandEnd = bandBegin + int(tileSize);
+
+    for (ScreenTriangle const &triangle : triangles) {
+        if (triangle.maximumY < bandBegin || triangle.minimumY > bandEnd) {
+            continue;
+        }
+
+        int firstX = std::max(0, int(std::floor(triangle.minimumX)));
+        int lastX = std::min(int(width) - 1, int(std::floor(triangle.maximumX)));
+        int firstY = std::max(bandBegin, int(std::floor(triangle.minimumY)));
+        int lastY = std::min(bandEnd - 1, int(std::floor(triangle.maximumY)));
+
+        for (int y = firstY; y <= lastY; y++) {
+            float pixelY = y + 0.5f;
+            float *row = &depth[y * width];
+
+            // Each edge function is linear along the row: edge(x) = edgeStart + edgeStep * x
+            float edgeStart[3], edgeStep[3], edgeOffset[3];
+            float neighbourStart[3][2], neighbourStep[3][2], neighbourOffset[3][2];
+            for (int edge = 0; edge < 3; edge++) {
+                startEdgeRow(triangle.edges[edge], pixelY, edgeStart[edge], edgeStep[edge]);
+                edgeOffset[edge] = triangle.edges[edge].offset;
+                for (int side = 0; side < 2; side++) {
+                    ScreenEdge const &neighbourEdge = triangle.neighbourEdges[edge][side];
+                    startEdgeRow(neighbourEdge, pixelY, neighbourStart[edge][side], neighbourStep[edge][side]);
+                    neighbourOffset[edge][side] = neighbourEdge.offset;
+                }
+            }
+            // The depth of the farthest point of the triangle's plane within each pixel
+            float rowDepth = triangle.depthAtOrigin + triangle.depthPerY * pixelY -
+                             0.5f * (std::abs(triangle.depthPerX) + std::abs(triangle.depthPerY));
+
+            for (int x = firstX; x <= lastX; x++) {
+                float pixelX = x + 0.5f;
+                // A pixel is covered if it lies wholly inside the outline edges, and its centre is
+                // inside the shared edges with the part across them inside the neighbour
+                bool isCovered = true;
+                bool isWhollyInside = true;
+                for (int edge = 0; edge < 3; edge++) {
+                    float value = edgeStart[edge] + edgeStep[edge] * pixelX;
+                    bool isInsideEdge = value >= edgeOffset[edge];
+                    bool isInsideNeighbour = (neighbourStart[edge][0] + neighbourStep[edge][0] * pixelX >= neighbourOffset[edge][0]) &
+                                             (neighbourStart[edge][1] + neighbourStep[edge][1] * pixelX >= neighbourOffset[edge][1]);
+                    isCovered &= (value >= triangle.coverageOffsets[edge]) & (isInsideEdge | isInsideNeighbour);
+                    isWhollyInside &= isInsideEdge;
+                }
+                float pixelDepth = rowDepth + triangle.depthPerX * pixelX;
+                pixelDepth = isWhollyInside ? pixelDepth : std::min(pixelDepth, triangle.neighbourhoodDepth);
+                row[x] = isCovered ? std::max(row[x], pixelDepth) : row[x];
+            }
+        }
+    }
+
+    for (unsigned int tileColumn = 0; tileColumn < tileColumns; tileColumn++) {
+        float farthest = std::numeric_limits<float>::max();
+        for (int y = bandBegin; y < bandEnd; y++) {
+            float const *row = &depth[y * width + tileColumn * tileSize];
+            for (unsigned int x = 0; x < tileSize; x++) {
+                farthest = std::min(farthest, row[x]);
+            }
+        }
+        tileFarthestDepth[tileRow * tileColumns + tileColumn] = farthest;
+    }
+}
+
+bool OcclusionBuffer::isSphereOccluded(float3 centre, float radius, glm::mat4 const &modelViewProjection) const {
+    // The screen bounds of the cube around the sphere, which also enclose the sphere itself
+    float minimumX = std::numeric_limits<float>::max();
+    float minimumY = std::numeric_limits<float>::max();
+    float maximumX = -std::numeric_limits<float>::max();
+    float maximumY = -std::numeric_limits<float>::max();
+    float nearestW = std::numeric_limits<float>::max();
+
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec4 position(centre.x + ((corner & 1) ? radius : -radius),
+                           centre.y + ((corner & 2) ? radius : -radius),
+                           centre.z + ((corner & 4) ? radius : -radius), 1.0f);
+        glm::vec4 clip = modelViewProjection * position;
+        if (clip.w <= 0.0f || clip.z < -clip.w) {
+            return false;
+        }
+
+        float x = (clip.x / clip.w * 0.5f + 0.5f) * width;
+        float y = (clip.y / clip.w * 0.5f + 0.5f) * height;
+        minimumX = std::min(minimumX, x);
+        maximumX = std::max(maximumX, x);
+        minimumY = std::min(minimumY, y);
+        maximumY = std::max(maximumY, y);
+        nearestW = std::min(nearestW, clip.w);
+    }
+
+    // Whatever is off screen can not be seen anyway, so only the part on screen is tested
+    if (maximumX < 0.0f || minimumX >= width || maximumY < 0.0f || minimumY >= height) {
+        return false;
+    }
+    int firstX = std::max(0, int(std::floor(minimumX)));
+    int lastX = std::min(int(width) - 1, int(std::floor(maximumX)));
+    int firstY = std::max(0, int(std::floor(minimumY)));
+    int lastY = std::min(int(height) - 1, int(std::floor(maximumY)));
+    float nearestDepth = 1.0f / nearestW;
+
+    for (int tileRow = firstY / int(tileSize); tileRow <= lastY / int(tileSize); tileRow++) {
+        for (int tileColumn = firstX / int(tileSize); tileColumn <= lastX / int(tileSize); tileColumn++) {
+            // Every occluder in the tile is in front of the sphere
+            if (tileFarthestDepth[tileRow * tileColumns + tileColumn] > nearestDepth) {
+                continue;
+            }
+
+            int tileFirstX = std::max(firstX, tileColumn * int(tileSize));
+            int tileLastX = std::min(lastX, tileColumn * int(tileSize) + int(tileSize) - 1);
+            int tileFirstY = std::max(firstY, tileRow * int(tileSize));
+            int tileLastY = std::min(lastY, tileRow * int(tileSize) + int(tileSize) - 1);
+
+            for (int y = tileFirstY; y <= tileLastY; y++) {
+                float const *row = &depth[y * width];
+                bool isVisible = false;
+                for (int x = tileFirstX; x <= tileLastX; x++) {
+                    isVisible |= row[x] <= nearestDepth;
+                }
+                if (isVisible) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
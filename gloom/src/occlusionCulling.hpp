@@ -0,0 +1,124 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <vector>
+#include "floats.hpp"
+#include "mesh.hpp"
+
+// The triangles of an occluder with their corners shared, so that the rasterizer can tell where
+// two of them meet
+struct OccluderMesh {
+    std::vector<float3> positions;
+    // Three per triangle
+    std::vector<unsigned int> indices;
+    // For the edge from corner i to corner i + 1 of each triangle, the corner opposite it in the
+    // other triangle using the edge, or ~0u if no other triangle (or more than one) does
+    std::vector<unsigned int> oppositeCorners;
+};
+
+// Makes an occluder of the triangles of a mesh. Vertices at the same position are merged, so the
+// occluder is not split along the seams of the mesh.
+OccluderMesh buildOccluderMesh(Mesh const &mesh);
+
+// A low resolution depth buffer which occluders are rasterized into on the CPU, so that
+// objects hidden behind them can be skipped before anything is sent to the GPU.
+//
+// Each pixel holds 1/w (the reciprocal of the distance in front of the camera) of the closest
+// occluder covering all of it, or 0 where there is none. 1/w varies linearly across a triangle
+// on screen, so it is interpolated exactly. The buffer is divided into tiles which also store
+// the farthest occluder depth within them, so most tests only have to look at the tiles and not
+// the individual pixels.
+//
+// Occluders are rasterized conservatively, so nothing is ever reported hidden which could be
+// seen: a pixel is only covered if all of it lies inside the occluder, and it gets the depth of
+// the farthest point of the occluder within it. Along an edge where two triangles of an occluder
+// meet on screen, a pixel reaching across is covered if the rest of it lies inside the triangle
+// on the other side, so the occluder has no gaps along its inner edges.
+//
+// The rows are stored contiguously and the inner rasterization and test loops do the same
+// arithmetic for every pixel, which lets the compiler vectorise them.
+class OcclusionBuffer {
+public:
+    static const unsigned int tileSize = 8;
+
+    // The resolution is rounded up to a whole number of tiles
+    OcclusionBuffer(unsigned int width, unsigned int height);
+
+    // Removes all occluders.
+    void clear();
+
+    // Adds the triangles of an occluder. Triangles crossing the near plane are left out, as are
+    // triangles which are entirely off screen.
+    void addOccluder(OccluderMesh const &occluder, glm::mat4 const &modelViewProjection);
+
+    // Rasterizes all occluders added since the last clear(). Every thread used rasterizes its own
+    // band of rows, so they never write to the same pixels.
+    void rasterize();
+
+    // Returns true if a sphere is certainly hidden behind the rasterized occluders.
+    // Spheres crossing the near plane are never considered hidden.
+    bool isSphereOccluded(float3 centre, float radius, glm::mat4 const &modelViewProjection) const;
+
+    unsigned int getWidth() const { return width; }
+    unsigned int getHeight() const { return height; }
+
+private:
+    // A corner of an occluder in pixel coordinates
+    struct ScreenCorner {
+        float x;
+        float y;
+        float depth;
+        bool isInFront;
+    };
+
+    // A line through two corners, as the function (y - fromY) * deltaX - (x - fromX) * deltaY,
+    // which is 0 on the line. It is multiplied by sign to make it positive on the inside, and
+    // offset is subtracted from it before comparing with 0. Edges are always made from their
+    // corners in the same order, so two triangles sharing one get exactly opposite values.
+    struct ScreenEdge {
+        float fromX;
+        float fromY;
+        float deltaX;
+        float deltaY;
+        float sign;
+        float offset;
+    };
+
+    // A triangle in pixel coordinates, along with the plane its 1/w lies in. For each edge shared
+    // with a neighbour on screen, the neighbour's two other edges are kept as well; for the other
+    // edges, they are made to always pass.
+    struct ScreenTriangle {
+        ScreenEdge edges[3];
+        ScreenEdge neighbourEdges[3][2];
+        // The edges' offsets which have to be passed to cover a pixel. They are the same as the
+        // offsets in edges on the outline, and 0 on shared edges.
+        float coverageOffsets[3];
+        float depthAtOrigin;
+        float depthPerX;
+        float depthPerY;
+        // The farthest corner of the triangle and its neighbours, for pixels reaching across an edge
+        float neighbourhoodDepth;
+        float minimumX;
+        float maximumX;
+        float minimumY;
+        float maximumY;
+    };
+
+    // Makes the edge through corners a and b, positive on the side of the corner inside
+    static ScreenEdge makeEdge(ScreenCorner const &a, ScreenCorner const &b, ScreenCorner const &inside);
+    // Finds the value and the step per pixel of an edge function along a row of pixels
+    static void startEdgeRow(ScreenEdge const &edge, float pixelY, float &start, float &step);
+
+    void rasterizeBand(unsigned int tileRow);
+
+    unsigned int width;
+    unsigned int height;
+    unsigned int tileColumns;
+    unsigned int tileRows;
+
+    std::vector<ScreenTriangle> triangles;
+    std::vector<ScreenCorner> corners;
+    std::vector<float> depth;
+    // The smallest (farthest) depth of any pixel in each tile
+    std::vector<float> tileFarthestDepth;
+};
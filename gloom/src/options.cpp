@@ -0,0 +1,143 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "options.hpp"
+
+static void printUsage(char const *programName) {
+    printf(
+        "Usage: %s [options]\n"
+        "\n"
+        "Options:\n"
+        "  --frame-stats                 Print frame time statistics periodically\n"
+        "  --frame-stats-file <path>     Also write the statistics to a .csv or .json file\n"
+        "  --frame-stats-interval <s>    Seconds between statistics reports (default 5)\n"
+        "  --target-fps <rate>           Pace frames to a fixed rate with vsync disabled\n"
+        "  --no-lod                      Always draw meshes at full detail\n"
+        "  --record <file>               Record frame times and input to a file\n"
+        "  --replay <file>               Replay a recording and check that the scene matches it\n"
+        "  --cluster-culling             Split meshes into meshlets which are culled individually\n"
+        "  --crowd <count>               Add characters walking the path as a group\n"
+        "  --crowd-follow                Have the crowd find its way to Steve instead of walking the path\n"
+        "  --terrain <tiles>             Stream a board of tiles by tiles around the camera\n"
+        "  --terrain-budget <MB>         Memory for streamed terrain chunks (default 64)\n"
+        "  --no-skinning                 Draw characters as a node for each body part\n"
+        "  --no-static-batching          Draw nodes which never move one by one instead of merged\n"
+        "  --shader-cache <dir>          Cache compiled shaders in a directory (default shader-cache)\n"
+        "  --no-shader-cache             Compile the shaders every time\n"
+        "  --capture <path>              Capture every frame as PNGs in a directory, or to a .raw file\n"
+        "  --capture-encoders <count>    Threads encoding captured frames (default all but one)\n"
+        "  --scene <file>                Add the nodes of a scene file made by gloom_convert_scene\n"
+        "  --occlusion-culling           Skip nodes hidden behind large occluders, tested on the CPU\n"
+        "  --headless                    Run without a window and print frame statistics\n"
+        "  --frames <count>              Frames to run in headless mode (default 600)\n"
+        "  --help                        Show this message\n",
+        programName);
+}
+
+// Returns the value following an option, or exits if there is none
+static char const* requireValue(int argc, char* argv[], int &index) {
+    if (index + 1 >= argc) {
+        fprintf(stderr, "Missing value for option %s\n", argv[index]);
+        printUsage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    index++;
+    return argv[index];
+}
+
+static double requirePositiveNumber(int argc, char* argv[], int &index) {
+    char const *option = argv[index];
+    char const *value = requireValue(argc, argv, index);
+    char *end;
+    double number = strtod(value, &end);
+    if (*end != '\0' || !(number > 0.0)) {
+        fprintf(stderr, "Option %s expects a positive number, got \"%s\"\n", option, value);
+        exit(EXIT_FAILURE);
+    }
+    return number;
+}
+
+ProgramOptions parseCommandLine(int argc, char* argv[]) {
+    ProgramOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+
+        if (argument == "--help" || argument == "-h") {
+            printUsage(argv[0]);
+            exit(EXIT_SUCCESS);
+        } else if (argument == "--frame-stats") {
+            options.frameStats = true;
+        } else if (argument == "--frame-stats-file") {
+            options.frameStats = true;
+            options.frameStatsFile = requireValue(argc, argv, i);
+        } else if (argument == "--frame-stats-interval") {
+            options.frameStatsIntervalSeconds = requirePositiveNumber(argc, argv, i);
+        } else if (argument == "--target-fps") {
+            options.targetFramesPerSecond = requirePositiveNumber(argc, argv, i);
+        } else if (argument == "--no-lod") {
+            options.levelsOfDetail = false;
+        } else if (argument == "--record") {
+            options.recordFile = requireValue(argc, argv, i);
+        } else if (argument == "--replay") {
+            options.replayFile = requireValue(argc, argv, i);
+        } else if (argument == "--cluster-culling") {
+            options.clusterCulling = true;
+        } else if (argument == "--crowd") {
+            options.crowdSize = (unsigned int) requirePositiveNumber(argc, argv, i);
+        } else if (argument == "--crowd-follow") {
+            options.crowdFollowsSteve = true;
+        } else if (argument == "--terrain") {
+            options.terrainTiles = (unsigned int) requirePositiveNumber(argc, argv, i);
+        } else if (argument == "--terrain-budget") {
+            options.terrainBudgetMegabytes = requirePositiveNumber(argc, argv, i);
+        } else if (argument == "--no-skinning") {
+            options.skinning = false;
+        } else if (argument == "--no-static-batching") {
+            options.staticBatching = false;
+        } else if (argument == "--shader-cache") {
+            options.shaderCacheDirectory = requireValue(argc, argv, i);
+        } else if (argument == "--no-shader-cache") {
+            options.shaderCacheDirectory.clear();
+        } else if (argument == "--capture") {
+            options.captureFile = requireValue(argc, argv, i);
+        } else if (argument == "--capture-encoders") {
+            options.captureEncoderCount = (unsigned int) requirePositiveNumber(argc, argv, i);
+        } else if (argument == "--scene") {
+            options.sceneFile = requireValue(argc, argv, i);
+        } else if (argument == "--occlusion-culling") {
+            options.occlusionCulling = true;
+        } else if (argument == "--headless") {
+            options.headless = true;
+            options.frameStats = true;
+        } else if (argument == "--frames") {
+            options.headlessFrameCount = (unsigned int) requirePositiveNumber(argc, argv, i);
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            printUsage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (!options.recordFile.empty() && !options.replayFile.empty()) {
+        fprintf(stderr, "--record and --replay can not be used at the same time\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (options.crowdFollowsSteve && options.crowdSize == 0) {
+        fprintf(stderr, "--crowd-follow needs a crowd, given with --crowd\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (options.headless && !options.recordFile.empty()) {
+        fprintf(stderr, "--record needs keyboard input, so it can not be used with --headless\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (options.headless && !options.captureFile.empty()) {
+        fprintf(stderr, "--capture reads back rendered frames, so it can not be used with --headless\n");
+        exit(EXIT_FAILURE);
+    }
+
+    return options;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+
+// Settings which can be changed from the command line when starting gloom.
+struct ProgramOptions {
+    // Print frame time statistics periodically
+    bool frameStats = false;
+    double frameStatsIntervalSeconds = 5.0;
+    // File the frame statistics are also written to (.csv or .json). Empty if unused.
+    std::string frameStatsFile;
+
+    // Frame rate to pace rendering to, instead of relying on vsync. Zero if unused.
+    double targetFramesPerSecond = 0.0;
+
+    // Generate simplified versions of meshes and draw them when they are far away
+    bool levelsOfDetail = true;
+
+    // Files to record the run to, or to replay a previous recording from. Empty if unused.
+    std::string recordFile;
+    std::string replayFile;
+
+    // Split meshes into meshlets and cull those outside the view or facing away individually
+    bool clusterCulling = false;
+
+    // Number of extra characters walking the path as a group, avoiding each other
+    unsigned int crowdSize = 0;
+    // Have the crowd follow Steve across the board along flow fields, instead of walking the path
+    bool crowdFollowsSteve = false;
+
+    // Size in tiles of a board streamed in chunks around the camera, replacing the small ground.
+    // Zero if unused.
+    unsigned int terrainTiles = 0;
+    // Memory the streamed chunks may use before chunks far from the camera are evicted
+    double terrainBudgetMegabytes = 64.0;
+
+    // Draw each character as one mesh moved by its bones, rather than as a node for each part
+    bool skinning = true;
+
+    // Merge the meshes of nodes which never move into a few pre-transformed meshes
+    bool staticBatching = true;
+
+    // Directory the compiled shader programs are cached in between runs. Empty if unused.
+    std::string shaderCacheDirectory = "shader-cache";
+
+    // Where every frame is captured to: a directory of PNG files, or a single raw file if the
+    // name ends in ".raw". Empty if unused.
+    std::string captureFile;
+    // Threads encoding captured frames. Zero leaves one hardware thread for rendering and uses the rest.
+    unsigned int captureEncoderCount = 0;
+
+    // A binary scene file (see sceneFile.hpp) whose nodes are added to the scene. Empty if unused.
+    std::string sceneFile;
+
+    // Rasterize large occluders into a CPU depth buffer and skip nodes hidden behind them
+    bool occlusionCulling = false;
+
+    // Run the scene without opening a window, for a fixed number of frames (or until the end
+    // of the replayed recording) at a fixed time step, and print the frame statistics
+    bool headless = false;
+    unsigned int headlessFrameCount = 600;
+};
+
+// Parses the command line arguments. Prints usage information and exits on invalid arguments.
+ProgramOptions parseCommandLine(int argc, char* argv[]);
@@ -0,0 +1,29 @@
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "parallel.hpp"
+
+static unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+// Started on first use, and again after the thread count changes
+static std::unique_ptr<JobSystem> jobSystem;
+static std::mutex jobSystemMutex;
+
+unsigned int getThreadCount() {
+    return threadCount;
+}
+
+void setThreadCount(unsigned int count) {
+    std::lock_guard<std::mutex> lock(jobSystemMutex);
+    threadCount = std::max(1u, count);
+    jobSystem.reset();
+}
+
+JobSystem &getJobSystem() {
+    std::lock_guard<std::mutex> lock(jobSystemMutex);
+    if (!jobSystem) {
+        jobSystem.reset(new JobSystem(threadCount));
+    }
+    return *jobSystem;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include "jobSystem.hpp"
+
+// Returns the number of threads parallelFor() spreads its work over.
+// Defaults to the number of hardware threads.
+unsigned int getThreadCount();
+
+// Changes the number of threads used by parallelFor(). A count of 1 runs everything on the calling thread.
+// Restarts the shared job system, so it must not be called while any work is running on it.
+void setThreadCount(unsigned int threadCount);
+
+// The job system shared by the whole program, with getThreadCount() threads
+JobSystem &getJobSystem();
+
+// Splits the range [begin, end) into pieces of grainSize elements (the last may be smaller)
+// and calls body(pieceBegin, pieceEnd) for each of them, spread over the threads of the shared
+// job system. The calling thread takes part in the work. Returns when every piece has been processed.
+// May be called from within a job, including the body of another parallelFor().
+// The body is called through a plain pointer to it, so calling parallelFor() does not allocate.
+template <typename Body>
+void parallelFor(size_t begin, size_t end, size_t grainSize, Body const &body) {
+    getJobSystem().parallelFor(begin, end, grainSize, body);
+}
@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <cstdlib>
+#include "pathfinding.hpp"
+
+NavigationGrid::NavigationGrid(unsigned int width, unsigned int height)
+    : width(width), height(height), blocked(size_t(width) * height, 0) {}
+
+void NavigationGrid::setBlocked(int2 tile, bool isBlocked) {
+    if (contains(tile)) {
+        blocked[getIndex(tile)] = isBlocked ? 1 : 0;
+    }
+}
+
+// The length of the shortest path between two tiles on open ground
+static unsigned int octileDistance(int2 a, int2 b) {
+    unsigned int dx = unsigned(std::abs(a.x - b.x));
+    unsigned int dy = unsigned(std::abs(a.y - b.y));
+    unsigned int diagonalSteps = std::min(dx, dy);
+    return diagonalSteps * diagonalStepCost + (std::max(dx, dy) - diagonalSteps) * straightStepCost;
+}
+
+static int sign(int value) {
+    return (value > 0) - (value < 0);
+}
+
+static bool isSameTile(int2 a, int2 b) {
+    return a.x == b.x && a.y == b.y;
+}
+
+// Orders the open list so the node with the lowest estimate ends up on top of the heap.
+// Equal estimates are ordered by tile, so that results do not depend on the heap's history.
+struct IsWorseNode {
+    template <typename Node>
+    bool operator()(Node const &a, Node const &b) const {
+        return a.estimate > b.estimate || (a.estimate == b.estimate && a.index > b.index);
+    }
+};
+
+Pathfinder::Pathfinder(NavigationGrid const &grid) : grid(grid) {
+    size_t tileCount = size_t(grid.getWidth()) * grid.getHeight();
+    searchStamps.assign(tileCount, 0);
+    distances.resize(tileCount);
+    parents.resize(tileCount);
+    closed.resize(tileCount);
+}
+
+// Walks from a tile in a horizontal or vertical direction until reaching the goal, a blocked
+// tile, or a tile next to an obstacle, where a shortest path might have to turn a corner.
+// Only that last kind of tile needs to be added to the open list.
+bool Pathfinder::jumpStraight(int2 tile, int dx, int dy, int2 goal, int2 &jumpPoint) const {
+    int2 current = tile;
+    while (grid.canStep(current, dx, dy)) {
+        current.x += dx;
+        current.y += dy;
+        if (isSameTile(current, goal)) {
+            jumpPoint = current;
+            return true;
+        }
+
+        // A tile beside the path which could not be reached as quickly any other way
+        bool isForced;
+        if (dx != 0) {
+            int2 above = { current.x, current.y + 1 }, behindAbove = { current.x - dx, current.y + 1 };
+            int2 below = { current.x, current.y - 1 }, behindBelow = { current.x - dx, current.y - 1 };
+            isForced = (grid.isWalkable(above) && !grid.isWalkable(behindAbove)) ||
+                       (grid.isWalkable(below) && !grid.isWalkable(behindBelow));
+        } else {
+            int2 right = { current.x + 1, current.y }, behindRight = { current.x + 1, current.y - dy };
+            int2 left = { current.x - 1, current.y }, behindLeft = { current.x - 1, current.y - dy };
+            isForced = (grid.isWalkable(right) && !grid.isWalkable(behindRight)) ||
+                       (grid.isWalkable(left) && !grid.isWalkable(behindLeft));
+        }
+        if (isForced) {
+            jumpPoint = current;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Same as jumpStraight(), for any of the eight directions. Walking diagonally stops wherever
+// walking straight along either axis from there would find a jump point.
+bool Pathfinder::jump(int2 tile, int dx, int dy, int2 goal, int2 &jumpPoint) const {
+    if (dx == 0 || dy == 0) {
+        return jumpStraight(tile, dx, dy, goal, jumpPoint);
+    }
+
+    int2 current = tile;
+    while (grid.canStep(current, dx, dy)) {
+        current.x += dx;
+        current.y += dy;
+        int2 unused;
+        if (isSameTile(current, goal) || jumpStraight(current, dx, 0, goal, unused) ||
+            jumpStraight(current, 0, dy, goal, unused)) {
+            jumpPoint = current;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Pathfinder::addSuccessor(int2 from, int2 to, int2 goal) {
+    unsigned int index = unsigned(grid.getIndex(to));
+    if (searchStamps[index] != currentSearch) {
+        searchStamps[index] = currentSearch;
+        distances[index] = unreachableDistance;
+        closed[index] = 0;
+    }
+    if (closed[index]) {
+        return;
+    }
+
+    unsigned int fromIndex = unsigned(grid.getIndex(from));
+    unsigned int distance = distances[fromIndex] + octileDistance(from, to);
+    if (distance < distances[index]) {
+        distances[index] = distance;
+        parents[index] = fromIndex;
+        OpenNode node = { distance + octileDistance(to, goal), index };
+        openNodes.push_back(node);
+        std::push_heap(openNodes.begin(), openNodes.end(), IsWorseNode());
+    }
+}
+
+bool Pathfinder::findPath(int2 start, int2 goal, std::vector<int2> &path) {
+    path.clear();
+    pathLength = 0;
+    if (!grid.isWalkable(start) || !grid.isWalkable(goal)) {
+        return false;
+    }
+
+    currentSearch++;
+    if (currentSearch == 0) {
+        // The stamps have wrapped around, so old ones could look current
+        std::fill(searchStamps.begin(), searchStamps.end(), 0);
+        currentSearch = 1;
+    }
+
+    unsigned int startIndex = unsigned(grid.getIndex(start));
+    unsigned int goalIndex = unsigned(grid.getIndex(goal));
+    searchStamps[startIndex] = currentSearch;
+    distances[startIndex] = 0;
+    parents[startIndex] = startIndex;
+    closed[startIndex] = 0;
+
+    openNodes.clear();
+    OpenNode startNode = { octileDistance(start, goal), startIndex };
+    openNodes.push_back(startNode);
+
+    bool isGoalReached = false;
+    while (!openNodes.empty()) {
+        std::pop_heap(openNodes.begin(), openNodes.end(), IsWorseNode());
+        unsigned int index = openNodes.back().index;
+        openNodes.pop_back();
+
+        // Nodes can be in the open list several times, only the first time counts
+        if (closed[index]) {
+            continue;
+        }
+        closed[index] = 1;
+        if (index == goalIndex) {
+            isGoalReached = true;
+            break;
+        }
+
+        int2 tile = grid.getTile(index);
+        int2 jumpPoint;
+
+        // The start tile looks in every direction. Other tiles only look in the directions
+        // a shortest path arriving from their parent could continue in.
+        if (index == startIndex) {
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    if ((dx != 0 || dy != 0) && jump(tile, dx, dy, goal, jumpPoint)) {
+                        addSuccessor(tile, jumpPoint, goal);
+                    }
+                }
+            }
+            continue;
+        }
+
+        int2 parent = grid.getTile(parents[index]);
+        int dx = sign(tile.x - parent.x);
+        int dy = sign(tile.y - parent.y);
+        int2 directions[5];
+        int directionCount = 0;
+
+        if (dx != 0 && dy != 0) {
+            directions[directionCount++] = { dx, 0 };
+            directions[directionCount++] = { 0, dy };
+            directions[directionCount++] = { dx, dy };
+        } else if (dx != 0) {
+            directions[directionCount++] = { dx, 0 };
+            directions[directionCount++] = { dx, 1 };
+            directions[directionCount++] = { dx, -1 };
+            directions[directionCount++] = { 0, 1 };
+            directions[directionCount++] = { 0, -1 };
+        } else {
+            directions[directionCount++] = { 0, dy };
+            directions[directionCount++] = { 1, dy };
+            directions[directionCount++] = { -1, dy };
+            directions[directionCount++] = { 1, 0 };
+            directions[directionCount++] = { -1, 0 };
+        }
+
+        for (int i = 0; i < directionCount; i++) {
+            if (jump(tile, directions[i].x, directions[i].y, goal, jumpPoint)) {
+                addSuccessor(tile, jumpPoint, goal);
+            }
+        }
+    }
+
+    if (!isGoalReached) {
+        return false;
+    }
+
+    pathLength = distances[goalIndex];
+    for (unsigned int index = goalIndex; index != startIndex; index = parents[index]) {
+        path.push_back(grid.getTile(index));
+    }
+    path.push_back(start);
+    std::reverse(path.begin(), path.end());
+    return true;
+}
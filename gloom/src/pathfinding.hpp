@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+#include "floats.hpp"
+
+// Path lengths are measured in thousandths of a tile, so that they can be added up exactly.
+// A diagonal step costs sqrt(2) tiles.
+static const unsigned int straightStepCost = 1000;
+static const unsigned int diagonalStepCost = 1414;
+static const unsigned int unreachableDistance = ~0u;
+
+// The tiles of a chessboard, each of which is either walkable or blocked. Tile (x, y) is
+// the same tile as in generateChessboard() and Path.
+//
+// Characters move between the eight tiles around them. A diagonal step is only possible when
+// both tiles beside it are walkable, so that characters never cut across the corner of a
+// blocked tile.
+class NavigationGrid {
+public:
+    // Creates a grid on which every tile is walkable
+    NavigationGrid(unsigned int width, unsigned int height);
+
+    unsigned int getWidth() const { return width; }
+    unsigned int getHeight() const { return height; }
+
+    bool contains(int2 tile) const {
+        return tile.x >= 0 && tile.y >= 0 && unsigned(tile.x) < width && unsigned(tile.y) < height;
+    }
+
+    // Tiles outside the grid count as blocked
+    bool isWalkable(int2 tile) const {
+        return contains(tile) && !blocked[getIndex(tile)];
+    }
+
+    // Whether a character can step from a tile to the neighbouring tile in direction (dx, dy)
+    bool canStep(int2 tile, int dx, int dy) const {
+        int2 next = { tile.x + dx, tile.y + dy };
+        if (!isWalkable(next)) {
+            return false;
+        }
+        int2 besideX = { tile.x + dx, tile.y };
+        int2 besideY = { tile.x, tile.y + dy };
+        return dx == 0 || dy == 0 || (isWalkable(besideX) && isWalkable(besideY));
+    }
+
+    void setBlocked(int2 tile, bool isBlocked);
+
+    size_t getIndex(int2 tile) const { return size_t(tile.y) * width + tile.x; }
+    int2 getTile(size_t index) const {
+        int2 tile = { int(index % width), int(index / width) };
+        return tile;
+    }
+
+private:
+    unsigned int width;
+    unsigned int height;
+    std::vector<unsigned char> blocked;
+};
+
+// Finds shortest paths between two tiles with A*, using jump point search to skip over the
+// many equally short ways of crossing open ground. The search state is kept between queries,
+// so one Pathfinder should be reused for many queries on the same grid. Tiles may be blocked
+// or unblocked between queries.
+class Pathfinder {
+public:
+    Pathfinder(NavigationGrid const &grid);
+
+    // Replaces the contents of path with the tiles where a shortest path from start to goal
+    // changes direction, starting with start and ending with goal. Each tile can be reached
+    // from the previous one by walking in a straight line, so the result can be turned into
+    // a Path directly. Returns false, leaving path empty, if the goal can not be reached.
+    bool findPath(int2 start, int2 goal, std::vector<int2> &path);
+
+    // The length of the last path found, in thousandths of a tile
+    unsigned int getPathLength() const { return pathLength; }
+
+private:
+    struct OpenNode {
+        unsigned int estimate;
+        unsigned int index;
+    };
+
+    bool jumpStraight(int2 tile, int dx, int dy, int2 goal, int2 &jumpPoint) const;
+    bool jump(int2 tile, int dx, int dy, int2 goal, int2 &jumpPoint) const;
+    void addSuccessor(int2 from, int2 to, int2 goal);
+
+    NavigationGrid const &grid;
+
+    // Indexed by tile. A tile's entries are only valid if its stamp equals the current search,
+    // which saves clearing them before every query.
+    std::vector<unsigned int> searchStamps;
+    std::vector<unsigned int> distances;
+    std::vector<unsigned int> parents;
+    std::vector<unsigned char> closed;
+    unsigned int currentSearch = 0;
+
+    std::vector<OpenNode> openNodes;
+    unsigned int pathLength = 0;
+};
@@ -1,7 +1,6 @@
 // Local headers
 #include "program.hpp"
 #include "gloom/gloom.hpp"
-#include "gloom/shader.hpp"
 #include "glm/mat4x4.hpp"
 #include "glm/gtc/type_ptr.hpp"
 #include "glm/gtx/transform.hpp"
@@ -9,19 +8,80 @@
 #include "glm/gtc/matrix_transform.hpp"
 
 #include "OBJLoader.hpp"
+#include "agents.hpp"
+#include "chessboard.hpp"
+#include "compiledPath.hpp"
+#include "flowField.hpp"
+#include "frameCapture.hpp"
+#include "framePacing.hpp"
+#include "frameStats.hpp"
+#include "glState.hpp"
+#include "inputRecording.hpp"
+#include "memoryTracking.hpp"
+#include "meshSimplification.hpp"
+#include "meshlets.hpp"
+#include "occlusionCulling.hpp"
+#include "sceneFile.hpp"
 #include "sceneGraph.hpp"
+#include "shaderCache.hpp"
+#include "skinning.hpp"
+#include "staticBatching.hpp"
+#include "terrainStreaming.hpp"
 #include "toolbox.hpp"
 
+#include <algorithm>
+#include <ctime>
+#include <stdexcept>
+#include <memory>
+#include <unordered_map>
+
+
+// Bindings and uniform values are tracked, so that redundant OpenGL calls can be skipped.
+// Both are only created when there is a window.
+GLStateCache* glState = nullptr;
+ProgramInterface* shaderInterface = nullptr;
 
 // Shader attribute and uniform locations
 GLint positionAttribute;
 GLint colorAttribute;
-GLuint transformMatrixLocation;
-
-
-// Camera parameters
-const float cameraSpeed = 0.3;
-const float cameraRotationSpeed = 0.03;
+GLint boneIndicesAttribute;
+GLint boneWeightsAttribute;
+GLint transformMatrixLocation;
+GLint isSkinnedLocation;
+GLint bonePaletteLocation;
+
+
+// Level of detail selection. A node is drawn with the simplest level whose geometric error
+// covers at most lodPixelError pixels on screen.
+const float lodPixelError = 1.0f;
+// Converts a distance-scaled length into pixels; updated from the projection matrix every frame
+float lodProjectionScale = 1.0f;
+bool useLevelsOfDetail = true;
+
+// Split meshes into meshlets which are culled individually
+bool useClusterCulling = false;
+// Headless runs keep all geometry on the CPU, without creating any VAOs
+bool uploadMeshes = true;
+// Scratch mesh skinned on the CPU in headless runs, reused between nodes and frames
+Mesh cpuSkinnedMesh("CPU skinned mesh");
+
+// Occluders are rasterized at a low resolution with the same aspect ratio as the window.
+// Only set when occlusion culling is enabled.
+const unsigned int occlusionBufferWidth = 256;
+OcclusionBuffer* occlusionBuffer = nullptr;
+
+// Scratch buffers for building the draw calls of a node, reused between nodes and frames
+std::vector<IndexRange> visibleRanges;
+std::vector<GLsizei> drawCounts;
+std::vector<const void*> drawOffsets;
+
+// Only set while frame statistics are collected
+FrameStatistics* currentFrameStats = nullptr;
+
+
+// Camera parameters (speeds are per second)
+const float cameraSpeed = 18.0;
+const float cameraRotationSpeed = 1.8;
 float cameraX = 120;
 float cameraY = 110;
 float cameraZ = 160;
@@ -29,67 +89,777 @@ float cameraPitch = -0.66;
 float cameraYaw = 0.52;
 
 
+// The GLFW key bound to each of the control keys
+const int controlKeyBindings[CONTROL_KEY_COUNT] = {
+	GLFW_KEY_ESCAPE,
+	GLFW_KEY_W,
+	GLFW_KEY_S,
+	GLFW_KEY_D,
+	GLFW_KEY_A,
+	GLFW_KEY_SPACE,
+	GLFW_KEY_LEFT_SHIFT,
+	GLFW_KEY_UP,
+	GLFW_KEY_DOWN,
+	GLFW_KEY_LEFT,
+	GLFW_KEY_RIGHT
+};
+
+
 GLuint createVaoFromMesh(Mesh mesh)
 {
 	GLuint vao;
 	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
+	glState->bindVertexArray(vao);
 
 	GLuint vbo;
 	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glState->bindBuffer(GL_ARRAY_BUFFER, vbo);
 	glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(float4), &mesh.vertices[0], GL_STATIC_DRAW);
+	recordGpuBuffer(vbo, mesh.vertices.size() * sizeof(float4));
 
 	glEnableVertexAttribArray(positionAttribute);
 	glVertexAttribPointer(positionAttribute, 4, GL_FLOAT, GL_FALSE, 0, 0);
 
 	GLuint colorBufferObject;
 	glGenBuffers(1, &colorBufferObject);
-	glBindBuffer(GL_ARRAY_BUFFER, colorBufferObject);
+	glState->bindBuffer(GL_ARRAY_BUFFER, colorBufferObject);
 	glBufferData(GL_ARRAY_BUFFER, mesh.colours.size() * sizeof(float4), &mesh.colours[0], GL_STATIC_DRAW);
+	recordGpuBuffer(colorBufferObject, mesh.colours.size() * sizeof(float4));
 
 	glEnableVertexAttribArray(colorAttribute);
 	glVertexAttribPointer(colorAttribute, 4, GL_FLOAT, GL_FALSE, 0, 0);
 
 	GLuint ebo;
 	glGenBuffers(1, &ebo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	glState->bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), &mesh.indices[0], GL_STATIC_DRAW);
+	recordGpuBuffer(ebo, mesh.indices.size() * sizeof(unsigned int));
 
 	return vao;
 }
 
-glm::vec3 glmVec3FromFloat3(float3 f3) { return glm::vec3(f3.x, f3.y, f3.z); }
+// Uploads a mesh along with the bones moving each of its vertices
+GLuint createVaoFromSkinnedMesh(SkinnedMesh const &skinnedMesh)
+{
+	GLuint vao = createVaoFromMesh(skinnedMesh.mesh);
+
+	GLuint boneIndexBuffer;
+	glGenBuffers(1, &boneIndexBuffer);
+	glState->bindBuffer(GL_ARRAY_BUFFER, boneIndexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, skinnedMesh.boneIndices.size() * sizeof(float4), &skinnedMesh.boneIndices[0], GL_STATIC_DRAW);
+	recordGpuBuffer(boneIndexBuffer, skinnedMesh.boneIndices.size() * sizeof(float4));
+
+	glEnableVertexAttribArray(boneIndicesAttribute);
+	glVertexAttribPointer(boneIndicesAttribute, 4, GL_FLOAT, GL_FALSE, 0, 0);
 
-void visitSceneNode(SceneNode* node, glm::mat4 currentTransformation)
+	GLuint boneWeightBuffer;
+	glGenBuffers(1, &boneWeightBuffer);
+	glState->bindBuffer(GL_ARRAY_BUFFER, boneWeightBuffer);
+	glBufferData(GL_ARRAY_BUFFER, skinnedMesh.boneWeights.size() * sizeof(float4), &skinnedMesh.boneWeights[0], GL_STATIC_DRAW);
+	recordGpuBuffer(boneWeightBuffer, skinnedMesh.boneWeights.size() * sizeof(float4));
+
+	glEnableVertexAttribArray(boneWeightsAttribute);
+	glVertexAttribPointer(boneWeightsAttribute, 4, GL_FLOAT, GL_FALSE, 0, 0);
+
+	return vao;
+}
+
+// Frees a VAO created by createVaoFromMesh(), along with its buffers
+void deleteVao(GLuint vao)
 {
-	// Update the transformation
-	node->currentTransformationMatrix = currentTransformation * 
-		glm::translate(glmVec3FromFloat3(node->position)) *
-		glm::translate(glmVec3FromFloat3(node->referencePoint)) *
-		glm::rotate(node->rotation.x, glm::vec3(1, 0, 0)) *
-		glm::rotate(node->rotation.y, glm::vec3(0, 1, 0)) *
-		glm::rotate(node->rotation.z, glm::vec3(0, 0, 1)) *
-		glm::translate(-glmVec3FromFloat3(node->referencePoint));
+	glState->bindVertexArray(vao);
+	GLint buffers[3];
+	glGetVertexAttribiv(positionAttribute, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &buffers[0]);
+	glGetVertexAttribiv(colorAttribute, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &buffers[1]);
+	glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &buffers[2]);
+	glState->bindVertexArray(0);
+
+	for (GLint buffer : buffers)
+	{
+		GLuint bufferID = GLuint(buffer);
+		glDeleteBuffers(1, &bufferID);
+		glState->forgetBuffer(bufferID);
+		forgetGpuBuffer(bufferID);
+	}
+	glDeleteVertexArrays(1, &vao);
+	glState->forgetVertexArray(vao);
+}
 
+// Uploads a mesh and makes it the appearance of a node, along with simplified versions of it
+// unless withLevelsOfDetail is false
+void attachMeshToNode(SceneNode* node, Mesh const &mesh, bool withLevelsOfDetail = true)
+{
+	// Clustering reorders the triangles, so it is done on the copy which gets uploaded
+	Mesh drawnMesh = mesh;
+	if (useClusterCulling)
+	{
+		node->meshlets = buildMeshlets(drawnMesh);
+	}
+
+	node->vertexArrayObjectID = uploadMeshes ? createVaoFromMesh(drawnMesh) : -1;
+	node->VAOIndexCount = drawnMesh.indices.size();
 
+	BoundingSphere bounds = computeBoundingSphere(mesh);
+	node->boundingSphereCentre = bounds.centre;
+	node->boundingSphereRadius = bounds.radius;
+
+	if (useLevelsOfDetail && withLevelsOfDetail)
+	{
+		for (SimplifiedLevel const &level : generateLODChain(mesh))
+		{
+			LevelOfDetail lod;
+			lod.vertexArrayObjectID = uploadMeshes ? createVaoFromMesh(level.mesh) : -1;
+			lod.VAOIndexCount = level.mesh.indices.size();
+			lod.geometricError = level.error;
+			node->levelsOfDetail.push_back(lod);
+		}
+	}
+}
+
+// Makes a skinned mesh the appearance of a node. The node is drawn with its bonePalette, which
+// has to be set before it is first drawn. Skinned meshes have no simplified levels or meshlets,
+// since those would not follow the bones.
+void attachSkinnedMeshToNode(SceneNode* node, std::shared_ptr<SkinnedMesh> const &skinnedMesh, Skeleton const &skeleton)
+{
+	if (skeleton.bones.size() > maxBoneCount)
+	{
+		throw std::runtime_error("The skeleton has more bones than the shader's bone palette can hold");
+	}
+
+	node->vertexArrayObjectID = uploadMeshes ? createVaoFromSkinnedMesh(*skinnedMesh) : -1;
+	node->VAOIndexCount = skinnedMesh->mesh.indices.size();
+	node->boneCount = skeleton.bones.size();
+	node->skinnedMesh = skinnedMesh;
+
+	// The sphere is enlarged to cover the limbs as they swing away from the rest pose
+	BoundingSphere bounds = computeBoundingSphere(skinnedMesh->mesh);
+	node->boundingSphereCentre = bounds.centre;
+	node->boundingSphereRadius = bounds.radius * 1.25f;
+}
+
+// Picks a level of detail from how large the levels' geometric errors appear on screen.
+// Level 0 is the full mesh, level i is node->levelsOfDetail[i - 1].
+unsigned int selectLevelOfDetail(SceneNode* node)
+{
+	if (node->levelsOfDetail.empty())
+	{
+		return 0;
+	}
+
+	// The transformation includes the projection, so w is the distance in front of the camera
+	glm::vec4 centre = node->currentTransformationMatrix * glm::vec4(glm::vec3(node->boundingSphereCentre), 1);
+	if (centre.w <= node->boundingSphereRadius)
+	{
+		return 0;
+	}
+
+	// The errors grow along the chain, so the levels are tried from the full mesh onwards.
+	// The error is projected from the nearest point of the bounding sphere.
+	float pixelsPerUnit = lodProjectionScale / (centre.w - node->boundingSphereRadius);
+
+	unsigned int level = 0;
+	while (level < node->levelsOfDetail.size() &&
+		node->levelsOfDetail[level].geometricError * pixelsPerUnit <= lodPixelError)
+	{
+		level++;
+	}
+	return level;
+}
+
+// Decides which geometry of a node to draw this frame. Returns the VAO to draw from, and
+// fills visibleRanges with the parts of its index buffer which need to be drawn.
+int selectNodeGeometry(SceneNode* node)
+{
+	int vertexArrayObjectID = node->vertexArrayObjectID;
+	visibleRanges.clear();
+
+	// Occluders themselves are not tested, since they are always drawn into the occlusion buffer
+	if (occlusionBuffer && !node->occluder &&
+		occlusionBuffer->isSphereOccluded(node->boundingSphereCentre, node->boundingSphereRadius, node->currentTransformationMatrix))
+	{
+		if (currentFrameStats)
+		{
+			currentFrameStats->addToCounter(FRAME_COUNTER_NODES_OCCLUDED, 1);
+			currentFrameStats->addToCounter(FRAME_COUNTER_TRIANGLES_WITHOUT_LOD, node->VAOIndexCount / 3);
+		}
+		return vertexArrayObjectID;
+	}
+
+	unsigned int level = selectLevelOfDetail(node);
+	if (level > 0)
+	{
+		// Simplified levels are small enough that culling them in parts is not worth it
+		vertexArrayObjectID = node->levelsOfDetail[level - 1].vertexArrayObjectID;
+		IndexRange range = { 0, node->levelsOfDetail[level - 1].VAOIndexCount };
+		visibleRanges.push_back(range);
+	}
+	else if (!node->meshlets.empty())
+	{
+		MeshletCullingResult culled = cullMeshlets(node->meshlets, node->currentTransformationMatrix, visibleRanges);
+
+		if (currentFrameStats)
+		{
+			currentFrameStats->addToCounter(FRAME_COUNTER_CLUSTERS, node->meshlets.size());
+			currentFrameStats->addToCounter(FRAME_COUNTER_CLUSTERS_CULLED, culled.clustersCulled);
+			currentFrameStats->addToCounter(FRAME_COUNTER_TRIANGLES_CULLED, culled.trianglesCulled);
+		}
+	}
+	else
+	{
+		IndexRange range = { 0, node->VAOIndexCount };
+		visibleRanges.push_back(range);
+	}
+
+	if (currentFrameStats)
+	{
+		unsigned int indexCount = 0;
+		for (IndexRange const &range : visibleRanges)
+		{
+			indexCount += range.count;
+		}
+		currentFrameStats->addToCounter(FRAME_COUNTER_TRIANGLES_SUBMITTED, indexCount / 3);
+		currentFrameStats->addToCounter(FRAME_COUNTER_TRIANGLES_WITHOUT_LOD, node->VAOIndexCount / 3);
+	}
+
+	return vertexArrayObjectID;
+}
+
+void renderNode(SceneNode* node)
+{
 	// Render the node
 	if (node->VAOIndexCount > 0)
 	{
-		glUniformMatrix4fv(transformMatrixLocation, 1, GL_FALSE, &node->currentTransformationMatrix[0][0]);
-		glBindVertexArray(node->vertexArrayObjectID);
-		glDrawElements(GL_TRIANGLES, node->VAOIndexCount, GL_UNSIGNED_INT, 0);
+		int vertexArrayObjectID = selectNodeGeometry(node);
+
+		if (!visibleRanges.empty())
+		{
+			shaderInterface->setUniform(transformMatrixLocation, &node->currentTransformationMatrix);
+			glState->bindVertexArray(vertexArrayObjectID);
+
+			shaderInterface->setUniform(isSkinnedLocation, int(node->boneCount > 0));
+			if (node->boneCount > 0)
+			{
+				shaderInterface->setUniform(bonePaletteLocation, node->bonePalette, node->boneCount);
+			}
+		}
+
+		if (visibleRanges.size() == 1)
+		{
+			glDrawElements(GL_TRIANGLES, visibleRanges[0].count, GL_UNSIGNED_INT,
+				reinterpret_cast<const void*>(visibleRanges[0].first * sizeof(unsigned int)));
+		}
+		else if (visibleRanges.size() > 1)
+		{
+			// Draw all the visible meshlets with a single call
+			drawCounts.clear();
+			drawOffsets.clear();
+			for (IndexRange const &range : visibleRanges)
+			{
+				drawCounts.push_back(range.count);
+				drawOffsets.push_back(reinterpret_cast<const void*>(range.first * sizeof(unsigned int)));
+			}
+			glMultiDrawElements(GL_TRIANGLES, drawCounts.data(), GL_UNSIGNED_INT, drawOffsets.data(), drawCounts.size());
+		}
 	}
 
 	// Render the node's children
-	for (int i = 0; i < node->children.size(); i++)
+	for (SceneNode* child : node->children)
+	{
+		renderNode(child);
+	}
+}
+
+// Makes a node hide whatever is behind it, using the triangles of a mesh
+void makeOccluder(SceneNode* node, Mesh const &mesh)
+{
+	if (occlusionBuffer)
+	{
+		node->occluder = std::make_shared<OccluderMesh>(buildOccluderMesh(mesh));
+	}
+}
+
+void addOccluders(SceneNode* node)
+{
+	if (node->occluder)
+	{
+		occlusionBuffer->addOccluder(*node->occluder, node->currentTransformationMatrix);
+	}
+
+	for (SceneNode* child : node->children)
+	{
+		addOccluders(child);
+	}
+}
+
+// Fills the occlusion buffer with the occluders of the scene graph as they are this frame
+void rasterizeOccluders(SceneNode* node)
+{
+	occlusionBuffer->clear();
+	addOccluders(node);
+	occlusionBuffer->rasterize();
+}
+
+// Does the same work as renderNode, except for the OpenGL calls. Skinned nodes are skinned
+// on the CPU instead, since there is no shader to do it.
+void cullNode(SceneNode* node)
+{
+	if (node->VAOIndexCount > 0)
+	{
+		selectNodeGeometry(node);
+		if (node->boneCount > 0 && !visibleRanges.empty())
+		{
+			skinMesh(*node->skinnedMesh, node->bonePalette, cpuSkinnedMesh);
+		}
+	}
+
+	for (SceneNode* child : node->children)
+	{
+		cullNode(child);
+	}
+}
+
+
+// The scene, shared by the windowed and headless loops
+const int chessboardScale = 20;
+SceneNode* nodeRoot;
+SceneNode* nodeSteveTorso;
+Path* walkingPath;
+CompiledPath* walkingCurve;
+PathCursor steveCursor;
+double animationTime = 0.0;
+
+// The streamed terrain has its own root node, since which chunks are resident depends on
+// how fast they are generated. Keeping them out of nodeRoot keeps replays deterministic.
+SceneNode* nodeTerrain;
+TerrainStreamer* terrainStreamer = nullptr;
+std::unordered_map<uint64_t, SceneNode*> terrainChunkNodes;
+
+// The nodes loaded from a scene file, which live as long as the scene
+SceneInstance fileScene;
+
+// Characters are drawn as one skinned mesh each, or with skinning disabled, as a node for
+// each part. The poses and palettes of all characters are stored together, CHARACTER_BONE_COUNT
+// entries for each: Steve's first, then those of the crowd.
+bool useSkinning = true;
+Skeleton characterSkeleton;
+std::vector<BonePose> characterPoses;
+std::vector<glm::mat4> characterPalettes;
+
+// The crowd walking the path along with Steve. Each agent is drawn by a copy of Steve, and
+// chases a point of its own along Steve's curve.
+std::vector<Agent> crowd;
+std::vector<PathCursor> crowdCursors;
+std::vector<SceneNode*> crowdTorsoNodes;
+SpatialGrid* crowdGrid;
+SteeringParameters crowdSteering;
+
+// With --crowd-follow, the crowd heads for the tile Steve is on instead of walking the path.
+// Steve's tile changes every few seconds, so the fields of the tiles he has just crossed are
+// kept, and built again only once he has moved on far enough.
+NavigationGrid* crowdNavigationGrid;
+FlowFieldCache* crowdFlowFields;
+
+// Whether the last update did work which allocates by its nature, filling the flow field cache
+// or streaming in terrain
+bool updateAllocated = false;
+
+// Swings the arms and legs of a character back and forth, given the rotations of its limbs
+void animateLimbs(float3 &armL, float3 &armR, float3 &legL, float3 &legR, double time)
+{
+	const double limbSwingSpeed = 3.3;
+	const double legSwingAmplitude = 0.9;
+	const double armSwingAmplitude = 0.7;
+
+	armR.x = armSwingAmplitude * sin(limbSwingSpeed * time);
+	armL.x = armSwingAmplitude * -sin(limbSwingSpeed * time);
+	legR.x = legSwingAmplitude * -sin(limbSwingSpeed * time);
+	legL.x = legSwingAmplitude * sin(limbSwingSpeed * time);
+}
+
+// Animates the limbs of a character, whose torso node is the one drawing it when skinned
+void animateCharacter(SceneNode* torso, size_t character, double time)
+{
+	if (useSkinning)
+	{
+		BonePose* poses = &characterPoses[character * CHARACTER_BONE_COUNT];
+		animateLimbs(poses[CHARACTER_BONE_LEFT_ARM].rotation, poses[CHARACTER_BONE_RIGHT_ARM].rotation,
+			poses[CHARACTER_BONE_LEFT_LEG].rotation, poses[CHARACTER_BONE_RIGHT_LEG].rotation, time);
+	}
+	else
+	{
+		// The torso's children are in the order they were added in createScene(): the head,
+		// then the left and right arms and the left and right legs
+		animateLimbs(torso->children[1]->rotation, torso->children[2]->rotation,
+			torso->children[3]->rotation, torso->children[4]->rotation, time);
+	}
+}
+
+// Creates a node for each part of a character, with the limbs as children of the torso
+SceneNode* createCharacterNodes(MinecraftCharacter const &character)
+{
+	Mesh const* parts[CHARACTER_BONE_COUNT] = {
+		&character.torso, &character.head, &character.leftArm, &character.rightArm, &character.leftLeg, &character.rightLeg
+	};
+
+	SceneNode* torso = nullptr;
+	for (unsigned int bone = 0; bone < CHARACTER_BONE_COUNT; bone++)
+	{
+		SceneNode* node = createSceneNode();
+		attachMeshToNode(node, *parts[bone]);
+		node->referencePoint = characterSkeleton.bones[bone].referencePoint;
+
+		if (bone == CHARACTER_BONE_TORSO)
+		{
+			torso = node;
+		}
+		else
+		{
+			addChild(torso, node);
+		}
+	}
+	return torso;
+}
+
+// Gives the static nodes below root their appearance. With batching, their meshes are merged
+// into a few nodes directly below root, which are drawn in place of them. The static geometry
+// is also what hides the rest of the scene behind it when occlusion culling is enabled.
+//
+// The static geometry gets no simplified levels. A batch spans much of the scene, so a single
+// level picked for all of it would coarsen the parts close to the camera along with the far
+// ones. The ground also shares its vertices between tiles of different colours, which only
+// works with its triangles exactly as generated (see generateChessboardGrid), and would lose
+// its pattern to simplification.
+void attachStaticMeshes(SceneNode* root, bool useBatching)
+{
+	std::vector<StaticInstance> instances = collectStaticInstances(root);
+	if (useBatching)
+	{
+		for (StaticBatch const &batch : buildStaticBatches(instances))
+		{
+			SceneNode* node = createSceneNode();
+			attachMeshToNode(node, batch.mesh, false);
+			makeOccluder(node, batch.mesh);
+			addChild(root, node);
+		}
+	}
+
+	for (StaticInstance const &instance : instances)
+	{
+		if (!useBatching)
+		{
+			attachMeshToNode(instance.node, *instance.mesh, false);
+			makeOccluder(instance.node, *instance.mesh);
+		}
+		instance.node->staticMesh.reset();
+	}
+}
+
+// Gives static nodes somewhere below a moving node their own appearance, since only static
+// nodes whose ancestors are all static end up in the static batches
+void attachStrandedStaticMeshes(SceneNode* node, bool isBelowMovingNode)
+{
+	if (node->staticMesh && isBelowMovingNode)
+	{
+		attachMeshToNode(node, *node->staticMesh);
+		node->staticMesh.reset();
+	}
+	for (SceneNode* child : node->children)
+	{
+		attachStrandedStaticMeshes(child, isBelowMovingNode || !node->isStatic);
+	}
+}
+
+// Adds the nodes of a scene file below root. Meshes are given as "<OBJ file>:<object name>",
+// and each OBJ file is loaded once. Static nodes are merged along with the rest of the scene.
+void addSceneFile(SceneNode* root, std::string const &path)
+{
+	SceneFile file;
+	file.open(path);
+
+	std::unordered_map<std::string, std::vector<Mesh>> objFiles;
+	std::vector<std::shared_ptr<Mesh>> meshes;
+	for (uint32_t i = 0; i < file.getMeshCount(); i++)
+	{
+		std::string source = file.getMeshSource(i);
+		size_t separator = source.rfind(':');
+		if (separator == std::string::npos)
+		{
+			throw std::runtime_error("The mesh \"" + source + "\" in " + path + " is not of the form <OBJ file>:<object name>");
+		}
+		std::string objPath = source.substr(0, separator);
+		std::string objectName = source.substr(separator + 1);
+
+		auto loaded = objFiles.find(objPath);
+		if (loaded == objFiles.end())
+		{
+			loaded = objFiles.insert(std::make_pair(objPath, loadWavefront(objPath))).first;
+			for (Mesh &mesh : loaded->second)
+			{
+				colourFaces(mesh);
+			}
+		}
+
+		auto found = std::find_if(loaded->second.begin(), loaded->second.end(),
+			[&](Mesh const &mesh) { return mesh.name == objectName; });
+		if (found == loaded->second.end())
+		{
+			throw std::runtime_error("There is no object called \"" + objectName + "\" in " + objPath);
+		}
+		meshes.push_back(std::make_shared<Mesh>(*found));
+	}
+
+	fileScene = instantiateScene(file, [&](SceneNode* node, uint32_t mesh)
+	{
+		if (node->isStatic)
+		{
+			node->staticMesh = meshes[mesh];
+		}
+		else
+		{
+			attachMeshToNode(node, *meshes[mesh]);
+		}
+	});
+	for (SceneNode* node : fileScene.roots)
+	{
+		attachStrandedStaticMeshes(node, false);
+		addChild(root, node);
+	}
+}
+
+// Loads the meshes and builds the scene graph
+void createScene(ProgramOptions const &options)
+{
+	useLevelsOfDetail = options.levelsOfDetail;
+	useClusterCulling = options.clusterCulling;
+	useSkinning = options.skinning;
+	if (options.occlusionCulling)
+	{
+		occlusionBuffer = new OcclusionBuffer(occlusionBufferWidth, occlusionBufferWidth * windowHeight / windowWidth);
+	}
+
+	// Load meshes
+	MinecraftCharacter steve = loadMinecraftCharacterModel("steve.obj");
+	Mesh chessboardMesh = generateChessboardGrid(7, 5, chessboardScale, float4(1, 1, 1, 1), float4(0.2, 0.2, 0.2, 1));
+
+	// Create scene graph
+	nodeRoot = createSceneNode();
+
+	SceneNode* nodeGround = createSceneNode();
+	nodeGround->isStatic = true;
+	if (options.terrainTiles == 0)
 	{
-		visitSceneNode(node->children[i], node->currentTransformationMatrix);
+		nodeGround->staticMesh = std::make_shared<Mesh>(chessboardMesh);
 	}
+
+	characterSkeleton = createCharacterSkeleton();
+	if (useSkinning)
+	{
+		nodeSteveTorso = createSceneNode();
+		attachSkinnedMeshToNode(nodeSteveTorso, std::make_shared<SkinnedMesh>(createSkinnedCharacter(steve)), characterSkeleton);
+	}
+	else
+	{
+		nodeSteveTorso = createCharacterNodes(steve);
+	}
+
+	addChild(nodeRoot, nodeGround);
+	addChild(nodeRoot, nodeSteveTorso);
+
+	if (!options.sceneFile.empty())
+	{
+		addSceneFile(nodeRoot, options.sceneFile);
+	}
+
+	// Chunks are uploaded without levels of detail or meshlets, which keeps the work done
+	// on the rendering thread for each chunk small
+	nodeTerrain = createSceneNode();
+	if (options.terrainTiles > 0)
+	{
+		TerrainStreamingSettings settings;
+		settings.boardWidth = options.terrainTiles;
+		settings.boardHeight = options.terrainTiles;
+		settings.tileWidth = chessboardScale;
+		settings.memoryBudgetBytes = size_t(options.terrainBudgetMegabytes * 1024 * 1024);
+
+		auto uploadChunk = [](uint64_t chunkID, ChessboardChunk &chunk)
+		{
+			SceneNode* node = createSceneNode();
+			node->vertexArrayObjectID = uploadMeshes ? createVaoFromMesh(chunk.mesh) : -1;
+			node->VAOIndexCount = chunk.mesh.indices.size();
+			node->boundingSphereCentre = chunk.bounds.centre;
+			node->boundingSphereRadius = chunk.bounds.radius;
+			addChild(nodeTerrain, node);
+			terrainChunkNodes[chunkID] = node;
+		};
+		auto evictChunk = [](uint64_t chunkID)
+		{
+			SceneNode* node = terrainChunkNodes[chunkID];
+			terrainChunkNodes.erase(chunkID);
+			auto &chunkNodes = nodeTerrain->children;
+			chunkNodes.erase(std::find(chunkNodes.begin(), chunkNodes.end(), node));
+			if (uploadMeshes)
+			{
+				deleteVao(node->vertexArrayObjectID);
+			}
+			delete node;
+		};
+		terrainStreamer = new TerrainStreamer(settings, uploadChunk, evictChunk);
+	}
+
+	walkingPath = new Path("coordinates_0.txt");
+	walkingCurve = new CompiledPath(*walkingPath, chessboardScale);
+	steveCursor = walkingCurve->getCursor(0);
+
+	// The crowd starts out spread around the first waypoint
+	crowdGrid = new SpatialGrid(chessboardScale);
+	if (options.crowdFollowsSteve)
+	{
+		unsigned int boardWidth = options.terrainTiles > 0 ? options.terrainTiles : 7;
+		unsigned int boardHeight = options.terrainTiles > 0 ? options.terrainTiles : 5;
+		crowdNavigationGrid = new NavigationGrid(boardWidth, boardHeight);
+		crowdFlowFields = new FlowFieldCache(*crowdNavigationGrid, 16);
+	}
+	std::vector<float> crowdOffsets(2 * size_t(options.crowdSize));
+	getThreadRandomStream().fillUniform(crowdOffsets.data(), crowdOffsets.size());
+	for (unsigned int i = 0; i < options.crowdSize; i++)
+	{
+		Agent agent;
+		agent.position = walkingPath->getWaypoint(0, chessboardScale) +
+			float2(crowdOffsets[2 * i] - 0.5f, crowdOffsets[2 * i + 1] - 0.5f) * (4.0f * chessboardScale);
+		agent.velocity = float2(0, 0);
+		agent.waypoint = 0;
+		crowd.push_back(agent);
+		crowdCursors.push_back(walkingCurve->getCursor(0));
+
+		SceneNode* torso = copySceneNode(nodeSteveTorso);
+		addChild(nodeRoot, torso);
+		crowdTorsoNodes.push_back(torso);
+	}
+
+	// The palettes are sized once here, so that the nodes can point into them
+	if (useSkinning)
+	{
+		size_t characterCount = 1 + crowd.size();
+		characterPoses.assign(characterCount * CHARACTER_BONE_COUNT, BonePose());
+		computeBonePalettes(characterSkeleton, characterPoses, characterPalettes);
+
+		nodeSteveTorso->bonePalette = &characterPalettes[0];
+		for (size_t i = 0; i < crowd.size(); i++)
+		{
+			crowdTorsoNodes[i]->bonePalette = &characterPalettes[(i + 1) * CHARACTER_BONE_COUNT];
+		}
+	}
+
+	attachStaticMeshes(nodeRoot, options.staticBatching);
 }
 
+// Advances the animations by a time step
+void updateScene(double deltaTime)
+{
+	const double walkingSpeed = 20.0;
+
+	animationTime += deltaTime;
+	updateAllocated = false;
+
+	animateCharacter(nodeSteveTorso, 0, animationTime);
+
+	// Steve walks along a smooth curve through the waypoints, so he turns gradually
+	// instead of snapping to face each new waypoint
+	float2 stevePosition;
+	float2 walkingDir;
+	steveCursor = walkingCurve->getCursor(steveCursor.distance + float(walkingSpeed * deltaTime));
+	walkingCurve->sample(steveCursor, stevePosition, walkingDir);
+
+	nodeSteveTorso->position = float3(stevePosition.x, 0, stevePosition.y);
+	nodeSteveTorso->rotation.y = atan2(walkingDir.x, walkingDir.y);
 
-void runProgram(GLFWwindow* window)
+	if (!crowd.empty() && crowdFlowFields != nullptr)
+	{
+		int2 goal = crowdGrid->getTile(stevePosition);
+		goal.x = std::min(std::max(goal.x, 0), int(crowdNavigationGrid->getWidth()) - 1);
+		goal.y = std::min(std::max(goal.y, 0), int(crowdNavigationGrid->getHeight()) - 1);
+		size_t fieldCount = crowdFlowFields->getFieldCount();
+		updateAgents(crowd, crowdFlowFields->getFlowField(goal), *crowdGrid, crowdSteering, deltaTime);
+		updateAllocated = updateAllocated || crowdFlowFields->getFieldCount() > fieldCount;
+	}
+	else if (!crowd.empty())
+	{
+		updateAgents(crowd, *walkingCurve, crowdCursors, *crowdGrid, crowdSteering, deltaTime);
+	}
+
+	for (size_t i = 0; i < crowd.size(); i++)
+	{
+		SceneNode* torso = crowdTorsoNodes[i];
+		torso->position = float3(crowd[i].position.x, 0, crowd[i].position.y);
+		if (crowd[i].velocity != float2(0, 0))
+		{
+			torso->rotation.y = atan2(crowd[i].velocity.x, crowd[i].velocity.y);
+		}
+
+		// Each member of the crowd swings its limbs slightly out of step with the others
+		animateCharacter(torso, i + 1, animationTime + 0.37 * i);
+	}
+
+	if (useSkinning)
+	{
+		computeBonePalettes(characterSkeleton, characterPoses, characterPalettes);
+	}
+}
+
+// Streams in the terrain around the camera, and counts the resident chunks
+void streamTerrain()
+{
+	if (!terrainStreamer)
+	{
+		return;
+	}
+
+	terrainStreamer->update(float2(cameraX, cameraZ));
+	if (terrainStreamer->getRequestedChunkCount() > 0 || terrainStreamer->getUploadedChunkCount() > 0)
+	{
+		updateAllocated = true;
+	}
+	if (currentFrameStats)
+	{
+		currentFrameStats->addToCounter(FRAME_COUNTER_CHUNKS_RESIDENT, terrainStreamer->getResidentChunkCount());
+		currentFrameStats->addToCounter(FRAME_COUNTER_CHUNK_MEGABYTES, terrainStreamer->getResidentBytes() / (1024.0 * 1024.0));
+		currentFrameStats->addToCounter(FRAME_COUNTER_CHUNKS_UPLOADED, terrainStreamer->getUploadedChunkCount());
+	}
+}
+
+// Stops streaming and prints how long chunks took to arrive
+void finishTerrainStreaming()
+{
+	if (!terrainStreamer)
+	{
+		return;
+	}
+
+	printf("Terrain streaming: %u chunks streamed, %u resident (%.1f MB), latency mean %.1f ms, p95 %.1f ms, max %.1f ms\n",
+		terrainStreamer->getStreamedChunkCount(), terrainStreamer->getResidentChunkCount(),
+		terrainStreamer->getResidentBytes() / (1024.0 * 1024.0),
+		1000.0 * terrainStreamer->getMeanLatencySeconds(),
+		1000.0 * terrainStreamer->getLatencyPercentileSeconds(0.95),
+		1000.0 * terrainStreamer->getMaxLatencySeconds());
+	delete terrainStreamer;
+	terrainStreamer = nullptr;
+}
+
+// Creates the combined projection and view matrix from the camera parameters
+glm::mat4 createViewProjectionMatrix()
+{
+	glm::mat4x4 projectionMatrix = glm::perspective(glm::radians(60.0f), (float)windowWidth / windowHeight, 0.1f, 1000.0f);
+
+	lodProjectionScale = projectionMatrix[1][1] * windowHeight / 2.0f;
+
+	return projectionMatrix *
+		glm::rotate(-cameraPitch, glm::vec3(1, 0, 0)) *
+		glm::rotate(-cameraYaw, glm::vec3(0, 1, 0)) *
+		glm::translate(glm::vec3(-cameraX, -cameraY, -cameraZ));
+}
+
+
+void runProgram(GLFWwindow* window, ProgramOptions const &options)
 {
 	// Enable depth (Z) buffer (accept "closest" fragment)
 	glEnable(GL_DEPTH_TEST);
@@ -106,210 +876,396 @@ void runProgram(GLFWwindow* window)
 	glClearColor(0.39f, 0.58f, 0.92f, 1.0f);
 
 
-	// Create the shader program
-	Gloom::Shader shader;
-	shader.attach("../gloom/shaders/simple.frag");
-	shader.attach("../gloom/shaders/simple.vert");
-	shader.link();
+	// Create the shader programs, all at once so that they can be compiled in parallel
+	ShaderProgramCache shaderCache(std::string(PROJECT_SOURCE_DIR) + "/gloom/shaders/", options.shaderCacheDirectory);
+	size_t simpleProgram = shaderCache.addProgram({ "simple.vert", "simple.frag" });
+	shaderCache.build();
+	printf("Shaders: %u programs loaded from the cache and %u compiled in %.1f ms\n",
+		shaderCache.getLoadedCount(), shaderCache.getCompiledCount(), 1000.0 * shaderCache.getBuildSeconds());
 
-	shader.activate();
+	glState = new GLStateCache(loadGLFunctions());
+	shaderInterface = new ProgramInterface(*glState, shaderCache.getProgram(simpleProgram));
+	glState->useProgram(shaderCache.getProgram(simpleProgram));
 
 	// Get attribute locations in shader
-	positionAttribute = glGetAttribLocation(shader.get(), "position");
-	colorAttribute = glGetAttribLocation(shader.get(), "vertexColor");
-
-	// Get the transform matrix location
-	transformMatrixLocation = glGetUniformLocation(shader.get(), "transformMatrix");
-
+	positionAttribute = shaderInterface->getAttributeLocation("position");
+	colorAttribute = shaderInterface->getAttributeLocation("vertexColor");
+	boneIndicesAttribute = shaderInterface->getAttributeLocation("boneIndices");
+	boneWeightsAttribute = shaderInterface->getAttributeLocation("boneWeights");
+
+	// Get the uniform locations
+	transformMatrixLocation = shaderInterface->getUniformLocation("transformMatrix");
+	isSkinnedLocation = shaderInterface->getUniformLocation("isSkinned");
+	bonePaletteLocation = shaderInterface->getUniformLocation("bonePalette");
+
+
+	// Recording and replaying runs requires the random colours to be the same every time,
+	// so the generator is seeded before anything is loaded
+	std::unique_ptr<InputRecorder> recorder;
+	std::unique_ptr<InputReplayer> replayer;
+	if (!options.replayFile.empty())
+	{
+		replayer.reset(new InputReplayer(options.replayFile));
+		seedRandom(replayer->getRandomSeed());
+	}
+	else if (!options.recordFile.empty())
+	{
+		unsigned int randomSeed = unsigned(time(0));
+		recorder.reset(new InputRecorder(options.recordFile, randomSeed));
+		seedRandom(randomSeed);
+	}
 
 	// Setup scene geometry
-	int chessboardScale = 20;
-
-	// Load meshes
-	MinecraftCharacter steve = loadMinecraftCharacterModel("steve.obj");
-	Mesh chessboardMesh = generateChessboard(7, 5, chessboardScale, float4(1, 1, 1, 1), float4(0.2, 0.2, 0.2, 1));
-
-	// Create scene graph
-	SceneNode* nodeRoot = createSceneNode();
-
-	SceneNode* nodeGround = createSceneNode();
-	nodeGround->vertexArrayObjectID = createVaoFromMesh(chessboardMesh);
-	nodeGround->VAOIndexCount = chessboardMesh.indices.size();
-
-	SceneNode* nodeSteveTorso = createSceneNode();
-	nodeSteveTorso->vertexArrayObjectID = createVaoFromMesh(steve.torso);
-	nodeSteveTorso->VAOIndexCount = steve.torso.indices.size();
-	nodeSteveTorso->referencePoint = float3(0, 0, 0);
-
-	SceneNode* nodeSteveHead = createSceneNode();
-	nodeSteveHead->vertexArrayObjectID = createVaoFromMesh(steve.head);
-	nodeSteveHead->VAOIndexCount = steve.head.indices.size();
-	nodeSteveHead->referencePoint = float3(0, 24, 0);
-
-	SceneNode* nodeSteveArmL = createSceneNode();
-	nodeSteveArmL->vertexArrayObjectID = createVaoFromMesh(steve.leftArm);
-	nodeSteveArmL->VAOIndexCount = steve.leftArm.indices.size();
-	nodeSteveArmL->referencePoint = float3(-4, 22, 0);
-
-	SceneNode* nodeSteveArmR = createSceneNode();
-	nodeSteveArmR->vertexArrayObjectID = createVaoFromMesh(steve.rightArm);
-	nodeSteveArmR->VAOIndexCount = steve.rightArm.indices.size();
-	nodeSteveArmR->referencePoint = float3(4, 22, 0);
-
-	SceneNode* nodeSteveLegL = createSceneNode();
-	nodeSteveLegL->vertexArrayObjectID = createVaoFromMesh(steve.leftLeg);
-	nodeSteveLegL->VAOIndexCount = steve.leftLeg.indices.size();
-	nodeSteveLegL->referencePoint = float3(-2, 12, 0);
-
-	SceneNode* nodeSteveLegR = createSceneNode();
-	nodeSteveLegR->vertexArrayObjectID = createVaoFromMesh(steve.rightLeg);
-	nodeSteveLegR->VAOIndexCount = steve.rightLeg.indices.size();
-	nodeSteveLegR->referencePoint = float3(2, 12, 0);
+	createScene(options);
 
-	addChild(nodeRoot, nodeGround);
-	addChild(nodeRoot, nodeSteveTorso);
-	addChild(nodeSteveTorso, nodeSteveHead);
-	addChild(nodeSteveTorso, nodeSteveArmL);
-	addChild(nodeSteveTorso, nodeSteveArmR);
-	addChild(nodeSteveTorso, nodeSteveLegL);
-	addChild(nodeSteveTorso, nodeSteveLegR);
+	// Frame time statistics are only collected when asked for on the command line
+	std::unique_ptr<FrameStatistics> frameStats;
+	if (options.frameStats)
+	{
+		frameStats.reset(new FrameStatistics(options.frameStatsIntervalSeconds, options.frameStatsFile));
+		currentFrameStats = frameStats.get();
+	}
 
+	// When pacing to a target frame rate, vsync would only get in the way
+	std::unique_ptr<FrameLimiter> frameLimiter;
+	if (options.targetFramesPerSecond > 0)
+	{
+		frameLimiter.reset(new FrameLimiter(options.targetFramesPerSecond));
+		glfwSwapInterval(0);
+	}
 
-	// Animation parameters
-	const double limbSwingSpeed = 3.3;
-	const double legSwingAmplitude = 0.9;
-	const double armSwingAmplitude = 0.7;
-	double currentTime = 0.0;
-	double walkingSpeed = 20.0;
+	// When capturing, every frame is read back and encoded in the background
+	std::unique_ptr<FrameEncoder> frameEncoder;
+	std::unique_ptr<FrameCapture> frameCapture;
+	if (!options.captureFile.empty())
+	{
+		int framebufferWidth, framebufferHeight;
+		glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+
+		std::string const &path = options.captureFile;
+		bool isRaw = path.size() >= 4 && path.compare(path.size() - 4, 4, ".raw") == 0;
+
+		FrameEncoderSettings settings;
+		settings.format = isRaw ? CaptureFormat::RAW : CaptureFormat::PNG;
+		settings.path = path;
+		settings.width = framebufferWidth;
+		settings.height = framebufferHeight;
+		settings.workerCount = options.captureEncoderCount;
+		frameEncoder.reset(new FrameEncoder(settings));
+		frameCapture.reset(new FrameCapture(*glState, *frameEncoder, settings.width, settings.height));
+	}
 
-	Path walkingPath = Path("coordinates_0.txt");
+	// Once the first frame has sized the buffers kept between frames, the rendering loop should
+	// only allocate while filling the flow field cache or streaming terrain. With memory tracking
+	// built in, the other frames which allocate are counted.
+	FrameAllocationMonitor allocationMonitor;
 
 	// Rendering Loop
 	while (!glfwWindowShouldClose(window))
 	{
-		// Update animations
-		double deltaTime = getTimeDeltaSeconds();
-		currentTime += deltaTime;
+		allocationMonitor.beginFrame();
 
-		nodeSteveArmR->rotation.x = armSwingAmplitude * sin(limbSwingSpeed * currentTime);
-		nodeSteveArmL->rotation.x = armSwingAmplitude * -sin(limbSwingSpeed * currentTime);
-		nodeSteveLegR->rotation.x = legSwingAmplitude * -sin(limbSwingSpeed * currentTime);
-		nodeSteveLegL->rotation.x = legSwingAmplitude * sin(limbSwingSpeed * currentTime);
+		if (frameLimiter)
+		{
+			if (frameStats) frameStats->beginSection(FRAME_SECTION_PACING);
+			frameLimiter->waitForNextFrame();
+			if (frameStats) frameStats->endSection(FRAME_SECTION_PACING);
+		}
 
-		float2 walkingDir = walkingPath.getCurrentWaypoint(chessboardScale) -
-			float2(nodeSteveTorso->position.x, nodeSteveTorso->position.z);
-		walkingDir /= sqrt(walkingDir.x * walkingDir.x + walkingDir.y * walkingDir.y);
+		if (frameStats) frameStats->beginSection(FRAME_SECTION_UPDATE);
 
-		nodeSteveTorso->position += float3(walkingDir.x, 0, walkingDir.y) * walkingSpeed * deltaTime;
-		// (This rotation is not smooth, and it looks a bit wonky when Steve suddenly snaps in a
-		// different direction. Making him turn smoothly isn't that hard, but making him always
-		// turn in the correct direction would be much simpler if using quaternions for rotation, so
-		// this is left as a future optimization.)
-		nodeSteveTorso->rotation.y = atan2(walkingDir.x, walkingDir.y);
+		// When replaying, the time step and input come from the recording instead
+		RecordedFrame recordedFrame;
+		if (replayer && !replayer->readFrame(recordedFrame))
+		{
+			break;
+		}
 
-		if (walkingPath.hasWaypointBeenReached(float2(nodeSteveTorso->position.x, nodeSteveTorso->position.z), chessboardScale))
+		// Update animations
+		double deltaTime = replayer ? recordedFrame.deltaTime : getTimeDeltaSeconds();
+		updateScene(deltaTime);
+		streamTerrain();
+		if (updateAllocated)
 		{
-			walkingPath.advanceToNextWaypoint();
+			allocationMonitor.excuseFrame();
 		}
 
+		if (frameStats) frameStats->endSection(FRAME_SECTION_UPDATE);
+
+		// Sample input as late as possible, right before the view matrix is built,
+		// so camera movement shows up in the frame currently being rendered
+		glfwPollEvents();
+		if (frameStats) frameStats->beginSection(FRAME_SECTION_INPUT_LATENCY);
+		unsigned int keyState = replayer ? recordedFrame.keyState : sampleKeyboardState(window);
+		handleKeyboardInput(window, keyState, deltaTime);
+
 		// Clear colour and depth buffers
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// Create view and projection matrices
-		glm::mat4x4 projectionMatrix = glm::perspective(glm::radians(60.0f), (float)windowWidth / windowHeight, 0.1f, 1000.0f);
+		glm::mat4x4 viewMatrix = createViewProjectionMatrix();
 
-		glm::mat4x4 viewMatrix = projectionMatrix *
-			glm::rotate(-cameraPitch, glm::vec3(1, 0, 0)) *
-			glm::rotate(-cameraYaw, glm::vec3(0, 1, 0)) *
-			glm::translate(glm::vec3(-cameraX, -cameraY, -cameraZ));
+		// Update the transformations of the scene graph
+		if (frameStats) frameStats->beginSection(FRAME_SECTION_TRAVERSAL);
+		updateNodeTransformations(nodeRoot, viewMatrix);
+		updateNodeTransformations(nodeTerrain, viewMatrix);
+		if (frameStats) frameStats->endSection(FRAME_SECTION_TRAVERSAL);
+
+		if (occlusionBuffer)
+		{
+			if (frameStats) frameStats->beginSection(FRAME_SECTION_OCCLUDERS);
+			rasterizeOccluders(nodeRoot);
+			if (frameStats) frameStats->endSection(FRAME_SECTION_OCCLUDERS);
+		}
+
+		if (recorder)
+		{
+			RecordedFrame frame = { deltaTime, keyState, computeTransformationChecksum(nodeRoot) };
+			recorder->recordFrame(frame);
+		}
+		else if (replayer)
+		{
+			replayer->verifyChecksum(computeTransformationChecksum(nodeRoot));
+		}
 
 		// Render the scene graph
-		visitSceneNode(nodeRoot, viewMatrix);
+		if (frameStats) frameStats->beginSection(FRAME_SECTION_DRAW);
+		GLCallCounts callsBefore = glState->getCallCounts();
+		renderNode(nodeRoot);
+		renderNode(nodeTerrain);
+		if (frameStats)
+		{
+			frameStats->addToCounter(FRAME_COUNTER_GL_CALLS, glState->getCallCounts().issued - callsBefore.issued);
+			frameStats->addToCounter(FRAME_COUNTER_GL_CALLS_ELIDED, glState->getCallCounts().elided - callsBefore.elided);
+			frameStats->endSection(FRAME_SECTION_DRAW);
+		}
+		if (frameStats) frameStats->endSection(FRAME_SECTION_INPUT_LATENCY);
+
+		// Read the frame back before it is swapped away
+		if (frameCapture)
+		{
+			if (frameStats) frameStats->beginSection(FRAME_SECTION_CAPTURE);
+			frameCapture->captureFrame();
+			if (frameStats)
+			{
+				frameStats->addToCounter(FRAME_COUNTER_CAPTURE_DROPPED, frameCapture->getDroppedThisFrame());
+				frameStats->endSection(FRAME_SECTION_CAPTURE);
+			}
+		}
 
 		// Flip buffers
+		if (frameStats) frameStats->beginSection(FRAME_SECTION_SWAP);
 		glfwSwapBuffers(window);
+		if (frameStats) frameStats->endSection(FRAME_SECTION_SWAP);
 		
 		printGLError();
 
-		// Handle other events
-		glfwPollEvents();
-		handleKeyboardInput(window);
+		uint64_t frameAllocations = allocationMonitor.endFrame();
+		if (frameStats) frameStats->addToCounter(FRAME_COUNTER_ALLOCATIONS, double(frameAllocations));
+		if (frameStats) frameStats->endFrame();
+	}
+
+	currentFrameStats = nullptr;
+	finishTerrainStreaming();
+
+	if (allocationMonitor.getAllocatingFrameCount() > 0)
+	{
+		printf("Allocations: %u of %u frames allocated memory in the render loop, besides %u which were expected to\n",
+			allocationMonitor.getAllocatingFrameCount(), allocationMonitor.getFrameCount(),
+			allocationMonitor.getExcusedFrameCount());
+	}
+
+	if (frameCapture)
+	{
+		frameCapture->finish();
+		frameEncoder->finish();
+		printf("Capture: %u of %u frames captured, %u dropped (%u with the readbacks full, %u with the encoders behind), "
+			"%u encoded by %u threads, readback latency mean %.1f ms, p95 %.1f ms, max %.1f ms\n",
+			frameCapture->getCapturedCount(), frameCapture->getFrameCount(), frameCapture->getDroppedCount(),
+			frameCapture->getDroppedInFlightCount(), frameCapture->getDroppedEncoderCount(),
+			frameEncoder->getEncodedCount(), frameEncoder->getWorkerCount(),
+			1000.0 * frameCapture->getMeanLatencySeconds(),
+			1000.0 * frameCapture->getLatencyPercentileSeconds(0.95),
+			1000.0 * frameCapture->getMaxLatencySeconds());
+	}
+}
+
+void runHeadless(ProgramOptions const &options)
+{
+	// A replayed recording gives the same random colours as the run it was recorded from
+	std::unique_ptr<InputReplayer> replayer;
+	if (!options.replayFile.empty())
+	{
+		replayer.reset(new InputReplayer(options.replayFile));
+		seedRandom(replayer->getRandomSeed());
+	}
+
+	// Setup scene geometry, without uploading anything
+	uploadMeshes = false;
+	createScene(options);
+
+	FrameStatistics frameStats(options.frameStatsIntervalSeconds, options.frameStatsFile);
+	currentFrameStats = &frameStats;
+
+	// Without a recording, time advances at a fixed rate and the camera stands still
+	const double fixedTimeStep = 1.0 / 60.0;
+
+	FrameAllocationMonitor allocationMonitor;
+
+	for (unsigned int frame = 0; replayer || frame < options.headlessFrameCount; frame++)
+	{
+		allocationMonitor.beginFrame();
+		frameStats.beginSection(FRAME_SECTION_UPDATE);
+
+		RecordedFrame recordedFrame;
+		if (replayer && !replayer->readFrame(recordedFrame))
+		{
+			break;
+		}
+
+		double deltaTime = replayer ? recordedFrame.deltaTime : fixedTimeStep;
+		updateScene(deltaTime);
+		streamTerrain();
+		if (updateAllocated)
+		{
+			allocationMonitor.excuseFrame();
+		}
+
+		frameStats.endSection(FRAME_SECTION_UPDATE);
+
+		frameStats.beginSection(FRAME_SECTION_INPUT_LATENCY);
+		handleKeyboardInput(nullptr, replayer ? recordedFrame.keyState : 0, deltaTime);
+
+		glm::mat4x4 viewMatrix = createViewProjectionMatrix();
+
+		frameStats.beginSection(FRAME_SECTION_TRAVERSAL);
+		updateNodeTransformations(nodeRoot, viewMatrix);
+		updateNodeTransformations(nodeTerrain, viewMatrix);
+		frameStats.endSection(FRAME_SECTION_TRAVERSAL);
+
+		if (occlusionBuffer)
+		{
+			frameStats.beginSection(FRAME_SECTION_OCCLUDERS);
+			rasterizeOccluders(nodeRoot);
+			frameStats.endSection(FRAME_SECTION_OCCLUDERS);
+		}
+
+		if (replayer)
+		{
+			replayer->verifyChecksum(computeTransformationChecksum(nodeRoot));
+		}
+
+		// Only the culling part of drawing is done
+		frameStats.beginSection(FRAME_SECTION_DRAW);
+		cullNode(nodeRoot);
+		cullNode(nodeTerrain);
+		frameStats.endSection(FRAME_SECTION_DRAW);
+		frameStats.endSection(FRAME_SECTION_INPUT_LATENCY);
+
+		frameStats.addToCounter(FRAME_COUNTER_ALLOCATIONS, double(allocationMonitor.endFrame()));
+		frameStats.endFrame();
+	}
+
+	currentFrameStats = nullptr;
+	finishTerrainStreaming();
+
+	if (allocationMonitor.getAllocatingFrameCount() > 0)
+	{
+		printf("Allocations: %u of %u frames allocated memory in the render loop, besides %u which were expected to\n",
+			allocationMonitor.getAllocatingFrameCount(), allocationMonitor.getFrameCount(),
+			allocationMonitor.getExcusedFrameCount());
 	}
 }
 
-void handleKeyboardInput(GLFWwindow* window)
+unsigned int sampleKeyboardState(GLFWwindow* window)
 {
-	// Use escape key for terminating the GLFW window
-	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+	unsigned int keyState = 0;
+	for (int key = 0; key < CONTROL_KEY_COUNT; key++)
+	{
+		if (glfwGetKey(window, controlKeyBindings[key]) == GLFW_PRESS)
+		{
+			keyState |= 1 << key;
+		}
+	}
+	return keyState;
+}
+
+void handleKeyboardInput(GLFWwindow* window, unsigned int keyState, double deltaTime)
+{
+	float distance = cameraSpeed * deltaTime;
+	float angle = cameraRotationSpeed * deltaTime;
+
+	// Use escape key for terminating the GLFW window (headless runs have none)
+	if (window && (keyState & (1 << CONTROL_KEY_EXIT)))
 	{
 		glfwSetWindowShouldClose(window, GL_TRUE);
 	}
 
 	// Camera position
-	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+	if (keyState & (1 << CONTROL_KEY_FORWARD))
 	{
 		// Move forward
-		cameraX -= cameraSpeed * sin(cameraYaw) * cos(cameraPitch);
-		cameraZ -= cameraSpeed * cos(cameraYaw) * cos(cameraPitch);
-		cameraY += cameraSpeed * sin(cameraPitch);
+		cameraX -= distance * sin(cameraYaw) * cos(cameraPitch);
+		cameraZ -= distance * cos(cameraYaw) * cos(cameraPitch);
+		cameraY += distance * sin(cameraPitch);
 	}
 
-	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+	if (keyState & (1 << CONTROL_KEY_BACKWARD))
 	{
 		// Move backward
-		cameraX += cameraSpeed * sin(cameraYaw) * cos(cameraPitch);
-		cameraZ += cameraSpeed * cos(cameraYaw) * cos(cameraPitch);
-		cameraY -= cameraSpeed * sin(cameraPitch);
+		cameraX += distance * sin(cameraYaw) * cos(cameraPitch);
+		cameraZ += distance * cos(cameraYaw) * cos(cameraPitch);
+		cameraY -= distance * sin(cameraPitch);
 	}
 
-	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+	if (keyState & (1 << CONTROL_KEY_RIGHT))
 	{
 		// Strafe right
-		cameraX -= cameraSpeed * sin(cameraYaw - glm::radians(90.0f));
-		cameraZ -= cameraSpeed * cos(cameraYaw - glm::radians(90.0f));
+		cameraX -= distance * sin(cameraYaw - glm::radians(90.0f));
+		cameraZ -= distance * cos(cameraYaw - glm::radians(90.0f));
 	}
 
-	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+	if (keyState & (1 << CONTROL_KEY_LEFT))
 	{
 		// Strafe left
-		cameraX -= cameraSpeed * sin(cameraYaw + glm::radians(90.0f));
-		cameraZ -= cameraSpeed * cos(cameraYaw + glm::radians(90.0f));
+		cameraX -= distance * sin(cameraYaw + glm::radians(90.0f));
+		cameraZ -= distance * cos(cameraYaw + glm::radians(90.0f));
 	}
 
-	if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+	if (keyState & (1 << CONTROL_KEY_UP))
 	{
 		// Crane up
-		cameraY += cameraSpeed;
+		cameraY += distance;
 	}
 
-	if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+	if (keyState & (1 << CONTROL_KEY_DOWN))
 	{
 		// Crane down
-		cameraY -= cameraSpeed;
+		cameraY -= distance;
 	}
 
 	// Camera rotation
-	if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
+	if (keyState & (1 << CONTROL_KEY_TILT_UP))
 	{
 		// Tilt view up
-		cameraPitch += cameraRotationSpeed;
+		cameraPitch += angle;
 	}
 
-	if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
+	if (keyState & (1 << CONTROL_KEY_TILT_DOWN))
 	{
 		// Tilt view down
-		cameraPitch -= cameraRotationSpeed;
+		cameraPitch -= angle;
 	}
 
-	if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS)
+	if (keyState & (1 << CONTROL_KEY_PAN_LEFT))
 	{
 		// Pan view left
-		cameraYaw += cameraRotationSpeed;
+		cameraYaw += angle;
 	}
 
-	if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS)
+	if (keyState & (1 << CONTROL_KEY_PAN_RIGHT))
 	{
 		// Pan view right
-		cameraYaw -= cameraRotationSpeed;
+		cameraYaw -= angle;
 	}
 }
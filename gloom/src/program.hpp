@@ -7,14 +7,42 @@
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
 #include <string>
+#include "options.hpp"
 
 
 // Main OpenGL program
-void runProgram(GLFWwindow* window);
+void runProgram(GLFWwindow* window, ProgramOptions const &options);
 
+// Runs the same scene without a window or any OpenGL calls. Everything up to submitting
+// draw calls is done, including level of detail selection and cluster culling.
+void runHeadless(ProgramOptions const &options);
 
-// Function for handling keypresses
-void handleKeyboardInput(GLFWwindow* window);
+
+// The keys which control the program. A key state is a bit mask with
+// bit (1 << CONTROL_KEY_...) set for each key held down.
+enum ControlKey {
+    CONTROL_KEY_EXIT = 0,
+    CONTROL_KEY_FORWARD,
+    CONTROL_KEY_BACKWARD,
+    CONTROL_KEY_RIGHT,
+    CONTROL_KEY_LEFT,
+    CONTROL_KEY_UP,
+    CONTROL_KEY_DOWN,
+    CONTROL_KEY_TILT_UP,
+    CONTROL_KEY_TILT_DOWN,
+    CONTROL_KEY_PAN_LEFT,
+    CONTROL_KEY_PAN_RIGHT,
+    CONTROL_KEY_COUNT
+};
+
+
+// Reads which of the control keys are currently held down
+unsigned int sampleKeyboardState(GLFWwindow* window);
+
+
+// Function for handling keypresses. Movement is scaled by the time the frame took,
+// so the camera moves equally fast regardless of frame rate.
+void handleKeyboardInput(GLFWwindow* window, unsigned int keyState, double deltaTime);
 
 
 // Checks for whether an OpenGL error occurred. If one did,
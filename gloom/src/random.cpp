@@ -0,0 +1,160 @@
+#include "random.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RANDOM_USE_SSE2 1
+#endif
+
+// 2^-24, which turns the top 24 bits of a number into a float in [0, 1)
+static const float floatFromBits = 1.0f / 16777216.0f;
+
+// Used to spread seeds over the state, as recommended for the xoshiro generators
+static uint64_t splitMix64(uint64_t &x) {
+    uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static inline uint32_t rotateLeft(uint32_t x, int bits) {
+    return (x << bits) | (x >> (32 - bits));
+}
+
+static void seedState(uint32_t state[4], uint64_t seed, uint64_t stream) {
+    uint64_t mix = stream;
+    uint64_t x = seed ^ splitMix64(mix);
+    uint64_t low = splitMix64(x);
+    uint64_t high = splitMix64(x);
+    state[0] = uint32_t(low);
+    state[1] = uint32_t(low >> 32);
+    state[2] = uint32_t(high);
+    state[3] = uint32_t(high >> 32);
+    // The one state the generator cannot leave
+    if ((low | high) == 0) {
+        state[0] = 1;
+    }
+}
+
+static inline uint32_t advance(uint32_t state[4]) {
+    uint32_t result = state[0] + state[3];
+    uint32_t t = state[1] << 9;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = rotateLeft(state[3], 11);
+    return result;
+}
+
+static void jumpState(uint32_t state[4]) {
+    static const uint32_t jumpPolynomial[4] = { 0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b };
+    uint32_t jumped[4] = { 0, 0, 0, 0 };
+    for (uint32_t word : jumpPolynomial) {
+        for (int bit = 0; bit < 32; bit++) {
+            if (word & (1u << bit)) {
+                for (int i = 0; i < 4; i++) {
+                    jumped[i] ^= state[i];
+                }
+            }
+            advance(state);
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        state[i] = jumped[i];
+    }
+}
+
+RandomStream::RandomStream(uint64_t seed, uint64_t stream) {
+    seedState(state, seed, stream);
+}
+
+uint32_t RandomStream::nextUint32() {
+    return advance(state);
+}
+
+uint64_t RandomStream::nextUint64() {
+    uint64_t high = advance(state);
+    return (high << 32) | advance(state);
+}
+
+float RandomStream::nextFloat() {
+    // The low bits of xoshiro128+ are its weakest, so only the top ones are used
+    return float(advance(state) >> 8) * floatFromBits;
+}
+
+void RandomStream::jump() {
+    jumpState(state);
+}
+
+void RandomStream::fillUniform(float* values, size_t count) {
+    WideRandomStream wide(nextUint64(), 0);
+    wide.fillUniform(values, count);
+}
+
+WideRandomStream::WideRandomStream(uint64_t seed, uint64_t stream) {
+    for (int lane = 0; lane < 4; lane++) {
+        uint32_t laneState[4];
+        seedState(laneState, seed, stream * 4 + lane);
+        for (int word = 0; word < 4; word++) {
+            state[word][lane] = laneState[word];
+        }
+    }
+}
+
+void WideRandomStream::jump() {
+    for (int lane = 0; lane < 4; lane++) {
+        uint32_t laneState[4];
+        for (int word = 0; word < 4; word++) {
+            laneState[word] = state[word][lane];
+        }
+        jumpState(laneState);
+        for (int word = 0; word < 4; word++) {
+            state[word][lane] = laneState[word];
+        }
+    }
+}
+
+void WideRandomStream::fillUniform(float* values, size_t count) {
+    size_t i = 0;
+
+#ifdef RANDOM_USE_SSE2
+    __m128i s0 = _mm_load_si128(reinterpret_cast<__m128i const*>(state[0]));
+    __m128i s1 = _mm_load_si128(reinterpret_cast<__m128i const*>(state[1]));
+    __m128i s2 = _mm_load_si128(reinterpret_cast<__m128i const*>(state[2]));
+    __m128i s3 = _mm_load_si128(reinterpret_cast<__m128i const*>(state[3]));
+    __m128 scale = _mm_set1_ps(floatFromBits);
+    for (; i + 4 <= count; i += 4) {
+        __m128i result = _mm_add_epi32(s0, s3);
+        __m128i t = _mm_slli_epi32(s1, 9);
+        s2 = _mm_xor_si128(s2, s0);
+        s3 = _mm_xor_si128(s3, s1);
+        s1 = _mm_xor_si128(s1, s2);
+        s0 = _mm_xor_si128(s0, s3);
+        s2 = _mm_xor_si128(s2, t);
+        s3 = _mm_or_si128(_mm_slli_epi32(s3, 11), _mm_srli_epi32(s3, 21));
+        // The top 24 bits fit into a signed integer, which SSE2 can convert
+        __m128 floats = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(result, 8)), scale);
+        _mm_storeu_ps(values + i, floats);
+    }
+    _mm_store_si128(reinterpret_cast<__m128i*>(state[0]), s0);
+    _mm_store_si128(reinterpret_cast<__m128i*>(state[1]), s1);
+    _mm_store_si128(reinterpret_cast<__m128i*>(state[2]), s2);
+    _mm_store_si128(reinterpret_cast<__m128i*>(state[3]), s3);
+#endif
+
+    // The rest, or everything without SSE2, one step of all four generators at a time
+    while (i < count) {
+        float lanes[4];
+        for (int lane = 0; lane < 4; lane++) {
+            uint32_t laneState[4] = { state[0][lane], state[1][lane], state[2][lane], state[3][lane] };
+            lanes[lane] = float(advance(laneState) >> 8) * floatFromBits;
+            for (int word = 0; word < 4; word++) {
+                state[word][lane] = laneState[word];
+            }
+        }
+        for (int lane = 0; lane < 4 && i < count; lane++, i++) {
+            values[i] = lanes[lane];
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Random numbers from xoshiro128+ (Blackman and Vigna), a small and fast generator with a period
+// of 2^128 - 1, which is plenty for floats.
+//
+// Every stream is seeded explicitly, so a seed gives the same numbers on every machine. Work
+// spread over threads stays reproducible by giving each piece of work its own stream, chosen by
+// the index of the piece rather than the thread running it: RandomStream(seed, pieceIndex).
+
+class RandomStream {
+public:
+    // The stream index picks one of many streams for the same seed. Both are mixed through
+    // SplitMix64, so nearby seeds and indices give unrelated streams.
+    explicit RandomStream(uint64_t seed = 0, uint64_t stream = 0);
+
+    uint32_t nextUint32();
+    uint64_t nextUint64();
+    // A float in [0, 1), with all 24 bits of its mantissa random
+    float nextFloat();
+    // A float in [min, max)
+    float nextFloat(float min, float max) { return min + (max - min) * nextFloat(); }
+
+    // Skips ahead by 2^64 numbers. Jumping one copy of a stream once, another twice and so on
+    // gives streams which are guaranteed not to overlap, for instance one for each thread.
+    void jump();
+
+    // Fills an array with floats in [0, 1). Faster than calling nextFloat() for each of them,
+    // but gives different numbers from the same stream.
+    void fillUniform(float* values, size_t count);
+
+private:
+    friend class WideRandomStream;
+
+    uint32_t state[4];
+};
+
+// Four xoshiro128+ generators side by side, advanced together with SSE2 where it is available.
+// The numbers are the same with and without SSE2.
+class WideRandomStream {
+public:
+    explicit WideRandomStream(uint64_t seed = 0, uint64_t stream = 0);
+
+    // Fills an array with floats in [0, 1), taking them from the four generators in turn
+    void fillUniform(float* values, size_t count);
+
+    // Skips every generator ahead by 2^64 numbers
+    void jump();
+
+private:
+    // state[word][lane], so each word of the four generators sits in one SSE register
+    alignas(16) uint32_t state[4][4];
+};
@@ -0,0 +1,283 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include "sceneFile.hpp"
+
+// Identifies scene files, and the version of their layout
+static const uint32_t sceneFileMagic = 0x4e435347; // "GSCN"
+static const uint32_t sceneFileVersion = 1;
+
+static_assert(sizeof(SceneFileHeader) == 32, "The scene file header has to match the file layout");
+static_assert(sizeof(SceneFileString) == 8, "Scene file strings have to match the file layout");
+static_assert(sizeof(SceneFileNode) == 72, "Scene file nodes have to match the file layout");
+
+static float3 float3FromArray(float const values[3]) {
+    return float3(values[0], values[1], values[2]);
+}
+
+static void copyToArray(float3 const &value, float values[3]) {
+    values[0] = value.x;
+    values[1] = value.y;
+    values[2] = value.z;
+}
+
+void SceneFile::open(std::string const &path) {
+    close();
+    if (!file.open(path)) {
+        throw std::runtime_error("Could not open the scene file \"" + path + "\"");
+    }
+    auto invalid = [&](std::string const &reason) {
+        file.close();
+        return std::runtime_error("\"" + path + "\" is not a valid scene file: " + reason);
+    };
+
+    // Counts are checked one at a time, so that none of the sums below can overflow
+    size_t size = file.getSize();
+    unsigned char const *data = file.getData();
+    if (size < sizeof(SceneFileHeader)) {
+        throw invalid("it is too short");
+    }
+    SceneFileHeader const *fileHeader = reinterpret_cast<SceneFileHeader const *>(data);
+    if (fileHeader->magic != sceneFileMagic) {
+        throw invalid("it does not start with GSCN");
+    }
+    if (fileHeader->version != sceneFileVersion) {
+        throw invalid("it is version " + std::to_string(fileHeader->version) + ", not " + std::to_string(sceneFileVersion));
+    }
+    uint64_t expectedSize = sizeof(SceneFileHeader) + uint64_t(fileHeader->meshCount) * sizeof(SceneFileString) +
+                            uint64_t(fileHeader->nodeCount) * sizeof(SceneFileNode) + fileHeader->stringBytes;
+    if (expectedSize != size) {
+        throw invalid("its size does not match the counts in its header");
+    }
+
+    SceneFileString const *fileMeshes = reinterpret_cast<SceneFileString const *>(data + sizeof(SceneFileHeader));
+    SceneFileNode const *fileNodes = reinterpret_cast<SceneFileNode const *>(fileMeshes + fileHeader->meshCount);
+    uint32_t stringBytes = fileHeader->stringBytes;
+    auto isValidString = [&](SceneFileString const &string) {
+        return string.offset <= stringBytes && string.length <= stringBytes - string.offset;
+    };
+
+    for (uint32_t i = 0; i < fileHeader->meshCount; i++) {
+        if (!isValidString(fileMeshes[i])) {
+            throw invalid("the source of mesh " + std::to_string(i) + " is out of range");
+        }
+    }
+
+    // Every child has to fit into the count its parent gave, which together with the parents
+    // coming first lets the nodes be created in one pass
+    std::vector<uint32_t> remainingChildren(fileHeader->nodeCount);
+    for (uint32_t i = 0; i < fileHeader->nodeCount; i++) {
+        SceneFileNode const &node = fileNodes[i];
+        remainingChildren[i] = node.childCount;
+        if (!isValidString(node.name)) {
+            throw invalid("the name of node " + std::to_string(i) + " is out of range");
+        }
+        if (node.mesh != sceneFileNone && node.mesh >= fileHeader->meshCount) {
+            throw invalid("node " + std::to_string(i) + " refers to a mesh which does not exist");
+        }
+        if (node.parent != sceneFileNone) {
+            if (node.parent >= i) {
+                throw invalid("node " + std::to_string(i) + " comes before its parent");
+            }
+            if (remainingChildren[node.parent] == 0) {
+                throw invalid("node " + std::to_string(node.parent) + " has more children than it says");
+            }
+            remainingChildren[node.parent]--;
+        }
+    }
+    for (uint32_t i = 0; i < fileHeader->nodeCount; i++) {
+        if (remainingChildren[i] != 0) {
+            throw invalid("node " + std::to_string(i) + " has fewer children than it says");
+        }
+    }
+
+    header = fileHeader;
+    meshes = fileMeshes;
+    nodes = fileNodes;
+    strings = reinterpret_cast<char const *>(fileNodes + fileHeader->nodeCount);
+}
+
+void SceneFile::close() {
+    file.close();
+    header = nullptr;
+    meshes = nullptr;
+    nodes = nullptr;
+    strings = nullptr;
+}
+
+SceneInstance instantiateScene(SceneFile const &file, SceneMeshCallback const &attachMesh) {
+    SceneInstance instance;
+    instance.nodeCount = file.getNodeCount();
+    instance.nodes.reset(new SceneNode[instance.nodeCount]);
+
+    for (uint32_t i = 0; i < file.getNodeCount(); i++) {
+        SceneFileNode const &record = file.getNode(i);
+        SceneNode* node = &instance.nodes[i];
+        node->position = float3FromArray(record.position);
+        node->rotation = float3FromArray(record.rotation);
+        node->scale = float3FromArray(record.scale);
+        node->referencePoint = float3FromArray(record.referencePoint);
+        node->isStatic = (record.flags & SCENE_FILE_NODE_STATIC) != 0;
+        node->children.reserve(record.childCount);
+
+        if (record.parent == sceneFileNone) {
+            instance.roots.push_back(node);
+        } else {
+            // The parent came first, so its list of children has already been sized
+            instance.nodes[record.parent].children.push_back(node);
+        }
+        if (record.mesh != sceneFileNone && attachMesh) {
+            attachMesh(node, record.mesh);
+        }
+    }
+    return instance;
+}
+
+SceneDescription parseSceneText(std::string const &path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Could not open the scene description \"" + path + "\"");
+    }
+
+    SceneDescription scene;
+    std::unordered_map<std::string, uint32_t> meshIndices;
+    std::unordered_map<std::string, uint32_t> nodeIndices;
+
+    std::string line;
+    unsigned int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        auto fail = [&](std::string const &reason) {
+            return std::runtime_error(path + ":" + std::to_string(lineNumber) + ": " + reason);
+        };
+
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+        std::istringstream words(line);
+        std::string statement;
+        if (!(words >> statement)) {
+            continue;
+        }
+
+        std::string name;
+        if (!(words >> name)) {
+            throw fail("expected a name after \"" + statement + "\"");
+        }
+
+        if (statement == "mesh") {
+            std::string source;
+            if (!(words >> source)) {
+                throw fail("expected the source of mesh \"" + name + "\"");
+            }
+            if (!meshIndices.insert(std::make_pair(name, uint32_t(scene.meshSources.size()))).second) {
+                throw fail("there is already a mesh called \"" + name + "\"");
+            }
+            scene.meshSources.push_back(source);
+        } else if (statement == "node") {
+            SceneDescriptionNode node;
+            node.name = name;
+
+            auto readVector = [&](std::string const &property, float3 &value) {
+                if (!(words >> value.x >> value.y >> value.z)) {
+                    throw fail("expected three numbers after \"" + property + "\"");
+                }
+            };
+            std::string property;
+            while (words >> property) {
+                if (property == "parent" || property == "mesh") {
+                    std::string reference;
+                    if (!(words >> reference)) {
+                        throw fail("expected a name after \"" + property + "\"");
+                    }
+                    std::unordered_map<std::string, uint32_t> const &indices = (property == "parent") ? nodeIndices : meshIndices;
+                    auto found = indices.find(reference);
+                    if (found == indices.end()) {
+                        throw fail("there is no " + std::string(property == "parent" ? "node" : "mesh") + " called \"" + reference + "\" above this line");
+                    }
+                    (property == "parent" ? node.parent : node.mesh) = found->second;
+                } else if (property == "position") {
+                    readVector(property, node.position);
+                } else if (property == "rotation") {
+                    readVector(property, node.rotation);
+                } else if (property == "scale") {
+                    readVector(property, node.scale);
+                } else if (property == "reference") {
+                    readVector(property, node.referencePoint);
+                } else if (property == "static") {
+                    node.isStatic = true;
+                } else {
+                    throw fail("unknown node property \"" + property + "\"");
+                }
+            }
+
+            if (!nodeIndices.insert(std::make_pair(name, uint32_t(scene.nodes.size()))).second) {
+                throw fail("there is already a node called \"" + name + "\"");
+            }
+            scene.nodes.push_back(node);
+        } else {
+            throw fail("unknown statement \"" + statement + "\"");
+        }
+    }
+    return scene;
+}
+
+void writeSceneFile(std::string const &path, SceneDescription const &scene) {
+    std::vector<char> strings;
+    auto addString = [&](std::string const &text) {
+        SceneFileString string;
+        string.offset = uint32_t(strings.size());
+        string.length = uint32_t(text.size());
+        strings.insert(strings.end(), text.begin(), text.end());
+        return string;
+    };
+
+    std::vector<SceneFileString> meshes;
+    for (std::string const &source : scene.meshSources) {
+        meshes.push_back(addString(source));
+    }
+
+    std::vector<SceneFileNode> nodes(scene.nodes.size());
+    for (size_t i = 0; i < scene.nodes.size(); i++) {
+        SceneDescriptionNode const &description = scene.nodes[i];
+        SceneFileNode &node = nodes[i];
+        std::memset(&node, 0, sizeof(node));
+        node.parent = description.parent;
+        node.mesh = description.mesh;
+        node.flags = description.isStatic ? SCENE_FILE_NODE_STATIC : 0;
+        node.name = addString(description.name);
+        copyToArray(description.position, node.position);
+        copyToArray(description.rotation, node.rotation);
+        copyToArray(description.scale, node.scale);
+        copyToArray(description.referencePoint, node.referencePoint);
+
+        if (node.parent != sceneFileNone) {
+            if (node.parent >= i) {
+                throw std::runtime_error("Node \"" + description.name + "\" comes before its parent");
+            }
+            nodes[node.parent].childCount++;
+        }
+    }
+    strings.resize((strings.size() + 3) / 4 * 4, '\0');
+
+    SceneFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = sceneFileMagic;
+    header.version = sceneFileVersion;
+    header.nodeCount = uint32_t(nodes.size());
+    header.meshCount = uint32_t(meshes.size());
+    header.stringBytes = uint32_t(strings.size());
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+    file.write(reinterpret_cast<char const *>(meshes.data()), meshes.size() * sizeof(SceneFileString));
+    file.write(reinterpret_cast<char const *>(nodes.data()), nodes.size() * sizeof(SceneFileNode));
+    file.write(strings.data(), strings.size());
+    if (!file) {
+        throw std::runtime_error("Could not write the scene file \"" + path + "\"");
+    }
+}
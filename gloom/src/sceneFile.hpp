@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "floats.hpp"
+#include "mappedFile.hpp"
+#include "sceneGraph.hpp"
+
+// Scenes described in data rather than code. A scene is written as text, converted into a
+// binary file by gloom_convert_scene, and the binary file is mapped into memory and turned into
+// scene nodes in a single pass.
+//
+// The text format has one statement per line, and # starts a comment:
+//     mesh <name> <source>
+//     node <name> [parent <node>] [mesh <mesh>] [position x y z] [rotation x y z]
+//                 [scale x y z] [reference x y z] [static]
+// Parents have to be declared before their children. Sources are up to whoever attaches the
+// meshes; gloom itself reads them as "<OBJ file>:<object name>".
+//
+// Binary layout (little endian), every part a multiple of 4 bytes long:
+//     SceneFileHeader
+//     SceneFileString[meshCount], the sources of the meshes
+//     SceneFileNode[nodeCount], parents before their children
+//     char[stringBytes], the names and sources the strings refer to
+
+static const uint32_t sceneFileNone = 0xffffffffu;
+
+enum SceneFileNodeFlags {
+    SCENE_FILE_NODE_STATIC = 1
+};
+
+struct SceneFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t nodeCount;
+    uint32_t meshCount;
+    uint32_t stringBytes;
+    uint32_t reserved[3];
+};
+
+// A range of the string table
+struct SceneFileString {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct SceneFileNode {
+    // Index of the parent node, or sceneFileNone for the nodes at the top
+    uint32_t parent;
+    uint32_t childCount;
+    // Index of the mesh, or sceneFileNone
+    uint32_t mesh;
+    uint32_t flags;
+    SceneFileString name;
+    float position[3];
+    float rotation[3];
+    float scale[3];
+    float referencePoint[3];
+};
+
+// A scene file mapped into memory, checked when opened so that it can be used without checks
+class SceneFile {
+public:
+    // Throws a std::runtime_error if the file cannot be read or is not a valid scene file
+    void open(std::string const &path);
+    void close();
+
+    uint32_t getNodeCount() const { return header ? header->nodeCount : 0; }
+    uint32_t getMeshCount() const { return header ? header->meshCount : 0; }
+    SceneFileNode const &getNode(uint32_t index) const { return nodes[index]; }
+    std::string getNodeName(uint32_t index) const { return getString(nodes[index].name); }
+    std::string getMeshSource(uint32_t index) const { return getString(meshes[index]); }
+    size_t getSizeBytes() const { return file.getSize(); }
+
+private:
+    std::string getString(SceneFileString const &string) const { return std::string(strings + string.offset, string.length); }
+
+    MappedFile file;
+    SceneFileHeader const *header = nullptr;
+    SceneFileString const *meshes = nullptr;
+    SceneFileNode const *nodes = nullptr;
+    char const *strings = nullptr;
+};
+
+// The nodes made from a scene file. They are kept in a single array, in the order of the file,
+// so they must not be deleted one by one.
+struct SceneInstance {
+    std::unique_ptr<SceneNode[]> nodes;
+    size_t nodeCount = 0;
+    // The nodes without a parent in the file
+    std::vector<SceneNode*> roots;
+};
+
+// Called for every node which refers to a mesh, once the node's own fields have been set
+typedef std::function<void(SceneNode* node, uint32_t mesh)> SceneMeshCallback;
+
+// Creates the nodes of a scene in one pass over the file. Apart from the array of nodes, only
+// nodes with children allocate, once each, for their list of children.
+SceneInstance instantiateScene(SceneFile const &file, SceneMeshCallback const &attachMesh = nullptr);
+
+// A scene in the form it is written in, before conversion
+struct SceneDescriptionNode {
+    std::string name;
+    uint32_t parent = sceneFileNone;
+    uint32_t mesh = sceneFileNone;
+    bool isStatic = false;
+    float3 position = float3(0, 0, 0);
+    float3 rotation = float3(0, 0, 0);
+    float3 scale = float3(1, 1, 1);
+    float3 referencePoint = float3(0, 0, 0);
+};
+
+struct SceneDescription {
+    std::vector<std::string> meshSources;
+    std::vector<SceneDescriptionNode> nodes;
+};
+
+// Reads the text format. Throws a std::runtime_error naming the line of the first mistake.
+SceneDescription parseSceneText(std::string const &path);
+
+// Writes the binary format. Parents have to come before their children.
+// Throws a std::runtime_error if the file cannot be written.
+void writeSceneFile(std::string const &path, SceneDescription const &scene);
@@ -1,5 +1,6 @@
 #include "sceneGraph.hpp"
 #include <iostream>
+#include "parallel.hpp"
 
 // --- Matrix Stack related functions ---
 
@@ -49,6 +50,21 @@ void addChild(SceneNode* parent, SceneNode* child) {
 	parent->children.push_back(child);
 }
 
+SceneNode* copySceneNode(SceneNode* node) {
+	SceneNode* copy = new SceneNode(*node);
+	for (SceneNode* &child : copy->children) {
+		child = copySceneNode(child);
+	}
+	return copy;
+}
+
+void deleteSceneNode(SceneNode* node) {
+	for (SceneNode* child : node->children) {
+		deleteSceneNode(child);
+	}
+	delete node;
+}
+
 // Pretty prints the current values of a SceneNode instance to stdout
 void printNode(SceneNode* node) {
 	printf(
@@ -66,3 +82,66 @@ void printNode(SceneNode* node) {
 		node->vertexArrayObjectID);
 }
 
+
+glm::mat4 computeLocalTransformation(SceneNode* node) {
+	glm::mat4 rotation = glm::rotate(node->rotation.x, glm::vec3(1, 0, 0)) *
+		glm::rotate(node->rotation.y, glm::vec3(0, 1, 0)) *
+		glm::rotate(node->rotation.z, glm::vec3(0, 0, 1));
+	// Unscaled nodes skip the multiplication, which keeps their matrices exactly as they were
+	// before nodes had a scale, and so the checksums of existing recordings valid
+	if (node->scale != float3(1, 1, 1)) {
+		rotation = rotation * glm::scale(glm::vec3(node->scale));
+	}
+	return glm::translate(glm::vec3(node->position)) *
+		glm::translate(glm::vec3(node->referencePoint)) *
+		rotation *
+		glm::translate(-glm::vec3(node->referencePoint));
+}
+
+// Nodes with at least this many children have their subtrees updated in parallel, a batch of
+// childrenPerPiece at a time. Smaller families are not worth handing to other threads.
+static const size_t parallelChildCount = 64;
+static const size_t childrenPerPiece = 16;
+
+void updateNodeTransformations(SceneNode* node, glm::mat4 transformationThusFar) {
+	node->currentTransformationMatrix = transformationThusFar * computeLocalTransformation(node);
+
+	// Each subtree only writes to its own nodes
+	if (node->children.size() >= parallelChildCount) {
+		parallelFor(0, node->children.size(), childrenPerPiece, [&](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++) {
+				updateNodeTransformations(node->children[i], node->currentTransformationMatrix);
+			}
+		});
+		return;
+	}
+
+	for (SceneNode* child : node->children) {
+		updateNodeTransformations(child, node->currentTransformationMatrix);
+	}
+}
+
+// FNV-1a, applied to the raw bytes of the matrices
+static uint64_t hashBytes(void const* data, size_t size, uint64_t hash) {
+	unsigned char const* bytes = static_cast<unsigned char const*>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+static uint64_t hashTransformations(SceneNode* node, uint64_t hash) {
+	hash = hashBytes(glm::value_ptr(node->currentTransformationMatrix), sizeof(glm::mat4), hash);
+	if (node->boneCount > 0) {
+		hash = hashBytes(glm::value_ptr(node->bonePalette[0]), node->boneCount * sizeof(glm::mat4), hash);
+	}
+
+	for (SceneNode* child : node->children) {
+		hash = hashTransformations(child, hash);
+	}
+	return hash;
+}
+
+uint64_t computeTransformationChecksum(SceneNode* node) {
+	return hashTransformations(node, 14695981039346656037ull);
+}
@@ -8,12 +8,19 @@
 #include <stack>
 #include <vector>
 #include <cstdio>
+#include <cstdint>
 #include <stdbool.h>
 #include <cstdlib> 
 #include <ctime> 
 #include <chrono>
 #include <fstream>
+#include <memory>
 #include "floats.hpp"
+#include "memoryTracking.hpp"
+#include "meshlets.hpp"
+
+struct SkinnedMesh;
+struct OccluderMesh;
 
 // Matrix stack related functions
 std::stack<glm::mat4>* createEmptyMatrixStack();
@@ -23,6 +30,14 @@ glm::mat4 peekMatrix(std::stack<glm::mat4>* stack);
 
 void printMatrix(glm::mat4 matrix);
 
+// A VAO containing a simplified version of a node's geometry
+struct LevelOfDetail {
+	int vertexArrayObjectID;
+	unsigned int VAOIndexCount;
+	// How far the simplified surface may lie from the full one, in the mesh's units
+	float geometricError;
+};
+
 // In case you haven't got much experience with C or C++, let me explain this "typedef" you see below.
 // The point of a typedef is that you it, as its name implies, allows you to define arbitrary data types based upon existing ones. For instance, "typedef float typeWhichMightBeAFloat;" allows you to define a variable such as this one: "typeWhichMightBeAFloat variableName = 5.0;". The C/C++ compiler translates this type into a float. 
 // What is the point of using it here? A smrt person, while designing the C language, thought it would be a good idea for various reasons to force you to explicitly state that you are using a data structure datatype (struct). So, when defining a variable, you'd have to type "struct SceneNode node = ..." in the case of a SceneNode. Which can get in the way of readability.
@@ -31,19 +46,34 @@ typedef struct SceneNode {
 	SceneNode() {
 		position = float3(0, 0, 0);
 		rotation = float3(0, 0, 0);
+		scale = float3(1, 1, 1);
 
         referencePoint = float3(0, 0, 0);
         vertexArrayObjectID = -1;
         VAOIndexCount = 0;
+
+        boundingSphereCentre = float3(0, 0, 0);
+        boundingSphereRadius = 0;
+
+        isStatic = false;
+
+        bonePalette = nullptr;
+        boneCount = 0;
 	}
 
+	// Nodes and their lists of children are counted as scene graph memory
+	GLOOM_TAGGED_NEW(MEMORY_TAG_SCENE_NODE)
+	GLOOM_TAGGED_NEW_ARRAY(MEMORY_TAG_SCENE_NODE)
+
 	// A list of all children that belong to this node.
 	// For instance, in case of the scene graph of a human body shown in the assignment text, the "Upper Torso" node would contain the "Left Arm", "Right Arm", "Head" and "Lower Torso" nodes in its list of children.
-	std::vector<SceneNode*> children;
+	TaggedVector<SceneNode*, MEMORY_TAG_SCENE_NODE> children;
 	
-	// The node's position and rotation relative to its parent
+	// The node's position, rotation and scale relative to its parent. The rotation and scale
+	// are applied around the reference point.
 	float3 position;
 	float3 rotation;
+	float3 scale;
 
 	// A transformation matrix representing the transformation of the node's location relative to its parent. This matrix is updated every frame.
 	glm::mat4 currentTransformationMatrix;
@@ -54,6 +84,34 @@ typedef struct SceneNode {
 	// The ID of the VAO containing the "appearance" of this SceneNode.
 	int vertexArrayObjectID;
 	unsigned int VAOIndexCount;
+
+	// Simplified versions of the appearance, used when the node covers a small part of the screen.
+	// The first entry is the most detailed one after the VAO above.
+	std::vector<LevelOfDetail> levelsOfDetail;
+
+	// A sphere enclosing the node's geometry, relative to the node itself
+	float3 boundingSphereCentre;
+	float boundingSphereRadius;
+
+	// Clusters of the full detail geometry which are culled individually. Empty if the
+	// node is only culled as a whole.
+	std::vector<Meshlet> meshlets;
+
+	// Triangles rasterized into the occlusion buffer to hide other nodes behind this one.
+	// Not set if the node is not an occluder.
+	std::shared_ptr<OccluderMesh> occluder;
+
+	// Static nodes never move relative to their parent. Their meshes are kept here, on the CPU,
+	// until they have been merged into static batches (see staticBatching.hpp).
+	bool isStatic;
+	std::shared_ptr<Mesh> staticMesh;
+
+	// Skinned nodes have their vertices moved by a palette of bone transformations relative to
+	// the node, which is owned by whoever animates them (see skinning.hpp). The mesh is kept for
+	// skinning on the CPU when nothing is uploaded. boneCount is 0 for other nodes.
+	glm::mat4 const* bonePalette;
+	unsigned int boneCount;
+	std::shared_ptr<SkinnedMesh> skinnedMesh;
 } SceneNode;
 
 // Struct for keeping track of 2D coordinates
@@ -61,7 +119,28 @@ typedef struct SceneNode {
 
 SceneNode* createSceneNode();
 void addChild(SceneNode* parent, SceneNode* child);
+
+// Creates a copy of a node and all its descendants. The copies share the VAOs of the originals,
+// so this is a cheap way of placing the same object in the scene several times.
+SceneNode* copySceneNode(SceneNode* node);
+// Deletes a node made with createSceneNode() or copySceneNode(), and all its descendants. The
+// nodes of a SceneInstance are freed along with it instead.
+void deleteSceneNode(SceneNode* node);
 void printNode(SceneNode* node);
 
 
+// Returns the transformation of a node relative to its parent
+glm::mat4 computeLocalTransformation(SceneNode* node);
+
+// Recursively updates the currentTransformationMatrix of a node and all its descendants,
+// given the transformation of the node's parent. The subtrees of nodes with many children are
+// updated in parallel on the shared job system.
+void updateNodeTransformations(SceneNode* node, glm::mat4 transformationThusFar);
+
+// Computes a hash of the transformation matrices of a node and all its descendants,
+// including the bone palettes of skinned nodes.
+// Two runs which produce the same scene give the same checksum, bit for bit.
+uint64_t computeTransformationChecksum(SceneNode* node);
+
+
 // For more details, see SceneGraph.cpp.
\ No newline at end of file
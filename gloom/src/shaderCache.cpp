@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+#include "shaderCache.hpp"
+
+// Identifies the files written by saveBinary()
+static const uint32_t binaryFileMagic = 0x42534c47; // "GLSB"
+
+// FNV-1a
+static uint64_t hashString(std::string const &text, uint64_t hash) {
+    for (unsigned char character : text) {
+        hash = (hash ^ character) * 1099511628211ull;
+    }
+    // Separates consecutive strings, so that moving text from one to the next changes the hash
+    return (hash ^ 0xff) * 1099511628211ull;
+}
+
+static std::string getGLString(GLenum name) {
+    char const *value = reinterpret_cast<char const*>(glGetString(name));
+    return value ? value : "";
+}
+
+static void createDirectory(std::string const &path) {
+#ifdef _WIN32
+    _mkdir(path.c_str());
+#else
+    mkdir(path.c_str(), 0755);
+#endif
+}
+
+// The shader type for a file, going by its extension
+static GLenum getShaderType(std::string const &filename) {
+    std::string extension = filename.substr(filename.rfind('.') + 1);
+    if (extension == "comp") return GL_COMPUTE_SHADER;
+    if (extension == "frag") return GL_FRAGMENT_SHADER;
+    if (extension == "geom") return GL_GEOMETRY_SHADER;
+    if (extension == "tcs") return GL_TESS_CONTROL_SHADER;
+    if (extension == "tes") return GL_TESS_EVALUATION_SHADER;
+    if (extension == "vert") return GL_VERTEX_SHADER;
+    throw std::runtime_error("Unknown shader type of \"" + filename + "\"");
+}
+
+std::string loadShaderSource(std::string const &sourceDirectory, std::string const &name) {
+#ifdef GLOOM_EMBED_SHADERS
+    for (size_t i = 0; i < embeddedShaderCount; i++) {
+        if (name == embeddedShaders[i].name) {
+            return embeddedShaders[i].source;
+        }
+    }
+#endif
+
+    std::ifstream file(sourceDirectory + name);
+    if (!file) {
+        throw std::runtime_error("Could not read the shader \"" + sourceDirectory + name + "\"");
+    }
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+ShaderProgramCache::ShaderProgramCache(std::string const &sourceDirectory, std::string const &cacheDirectory)
+        : sourceDirectory(sourceDirectory), cacheDirectory(cacheDirectory) {
+    if (!cacheDirectory.empty()) {
+        createDirectory(cacheDirectory);
+    }
+}
+
+ShaderProgramCache::~ShaderProgramCache() {
+    for (CachedProgram const &program : programs) {
+        glDeleteProgram(program.program);
+    }
+}
+
+size_t ShaderProgramCache::addProgram(std::vector<std::string> const &shaderFiles) {
+    CachedProgram program;
+    program.files = shaderFiles;
+    program.key = 0;
+    program.program = 0;
+    program.isBuilt = false;
+    programs.push_back(program);
+    return programs.size() - 1;
+}
+
+std::string ShaderProgramCache::getBinaryPath(uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long) key);
+    return cacheDirectory + "/" + name;
+}
+
+bool ShaderProgramCache::loadBinary(CachedProgram &program) const {
+    std::ifstream file(getBinaryPath(program.key), std::ios::binary);
+    uint32_t header[2];
+    if (!file.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] != binaryFileMagic) {
+        return false;
+    }
+    std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // The driver may still refuse the binary, for instance after it has been updated
+    program.program = glCreateProgram();
+    glProgramBinary(program.program, GLenum(header[1]), binary.data(), GLsizei(binary.size()));
+    GLint status = GL_FALSE;
+    glGetProgramiv(program.program, GL_LINK_STATUS, &status);
+    if (!status) {
+        glDeleteProgram(program.program);
+        program.program = 0;
+        return false;
+    }
+    return true;
+}
+
+void ShaderProgramCache::saveBinary(CachedProgram const &program) const {
+    GLint length = 0;
+    glGetProgramiv(program.program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program.program, length, &length, &format, binary.data());
+
+    // Written under another name first, so that other runs never see half a file
+    std::string path = getBinaryPath(program.key);
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary);
+        uint32_t header[2] = { binaryFileMagic, uint32_t(format) };
+        file.write(reinterpret_cast<char const*>(header), sizeof(header));
+        file.write(binary.data(), length);
+        if (!file) {
+            fprintf(stderr, "Could not write the shader cache file \"%s\"\n", temporaryPath.c_str());
+            return;
+        }
+    }
+    std::remove(path.c_str());
+    std::rename(temporaryPath.c_str(), path.c_str());
+}
+
+// Prints the log of a shader or program which failed to build
+static void printInfoLog(GLuint object, bool isProgram, std::string const &name) {
+    GLint length = 0;
+    isProgram ? glGetProgramiv(object, GL_INFO_LOG_LENGTH, &length) : glGetShaderiv(object, GL_INFO_LOG_LENGTH, &length);
+    std::unique_ptr<char[]> log(new char[std::max(length, 1)]);
+    log[0] = '\0';
+    isProgram ? glGetProgramInfoLog(object, length, nullptr, log.get()) : glGetShaderInfoLog(object, length, nullptr, log.get());
+    fprintf(stderr, "%s\n%s\n", name.c_str(), log.get());
+}
+
+void ShaderProgramCache::build() {
+    auto start = std::chrono::steady_clock::now();
+    loadedCount = 0;
+    compiledCount = 0;
+
+    GLint binaryFormatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormatCount);
+    bool useBinaries = !cacheDirectory.empty() && binaryFormatCount > 0;
+
+    // Binaries only work with the driver which produced them
+    uint64_t driverHash = 14695981039346656037ull;
+    driverHash = hashString(getGLString(GL_VENDOR), driverHash);
+    driverHash = hashString(getGLString(GL_RENDERER), driverHash);
+    driverHash = hashString(getGLString(GL_VERSION), driverHash);
+
+    std::vector<CachedProgram*> toCompile;
+    for (CachedProgram &program : programs) {
+        if (program.isBuilt) {
+            continue;
+        }
+
+        program.key = driverHash;
+        program.sources.clear();
+        for (std::string const &file : program.files) {
+            program.sources.push_back(loadShaderSource(sourceDirectory, file));
+            program.key = hashString(file, program.key);
+            program.key = hashString(program.sources.back(), program.key);
+        }
+
+        if (useBinaries && loadBinary(program)) {
+            program.isBuilt = true;
+            loadedCount++;
+        } else {
+            toCompile.push_back(&program);
+        }
+    }
+
+    // Only there if glad was generated with the extension, which CMake reports when configuring.
+    // Without it, the driver compiles the way it does by default, which is often still in the
+    // background, since nothing asks for results until everything has been started.
+#ifdef GL_KHR_parallel_shader_compile
+    if (GLAD_GL_KHR_parallel_shader_compile) {
+        // Lets the driver pick how many threads to compile with
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    }
+#endif
+
+    // Start compiling and linking everything before asking for any results, since asking
+    // waits for that compile or link to finish
+    for (CachedProgram *program : toCompile) {
+        program->program = glCreateProgram();
+        for (size_t i = 0; i < program->files.size(); i++) {
+            GLuint shader = glCreateShader(getShaderType(program->files[i]));
+            char const *source = program->sources[i].c_str();
+            glShaderSource(shader, 1, &source, nullptr);
+            glCompileShader(shader);
+            glAttachShader(program->program, shader);
+            program->shaders.push_back(shader);
+        }
+    }
+    for (CachedProgram *program : toCompile) {
+        if (useBinaries) {
+            glProgramParameteri(program->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        glLinkProgram(program->program);
+    }
+
+    for (CachedProgram *program : toCompile) {
+        GLint status = GL_FALSE;
+        glGetProgramiv(program->program, GL_LINK_STATUS, &status);
+        if (!status) {
+            // The compile logs are only looked at when something went wrong
+            for (size_t i = 0; i < program->shaders.size(); i++) {
+                GLint compileStatus = GL_FALSE;
+                glGetShaderiv(program->shaders[i], GL_COMPILE_STATUS, &compileStatus);
+                if (!compileStatus) {
+                    printInfoLog(program->shaders[i], false, program->files[i]);
+                }
+            }
+            std::string files;
+            for (std::string const &file : program->files) {
+                files += (files.empty() ? "" : ", ") + file;
+            }
+            printInfoLog(program->program, true, "Linking " + files);
+            throw std::runtime_error("A shader program failed to build");
+        }
+
+        for (GLuint shader : program->shaders) {
+            glDetachShader(program->program, shader);
+            glDeleteShader(shader);
+        }
+        program->shaders.clear();
+        program->isBuilt = true;
+        compiledCount++;
+
+        if (useBinaries) {
+            saveBinary(*program);
+        }
+    }
+
+    buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
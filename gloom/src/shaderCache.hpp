@@ -0,0 +1,78 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A shader source compiled into the executable by embedShaders.cmake, when gloom is built
+// with GLOOM_EMBED_SHADERS
+struct EmbeddedShader {
+    char const *name;
+    char const *source;
+};
+extern EmbeddedShader const embeddedShaders[];
+extern size_t const embeddedShaderCount;
+
+// Returns the source of a shader file, such as "simple.vert". The sources compiled into the
+// executable are used if there are any; otherwise the file is read from sourceDirectory.
+// Throws a std::runtime_error if the shader cannot be found.
+std::string loadShaderSource(std::string const &sourceDirectory, std::string const &name);
+
+// Builds shader programs, reusing the programs built by earlier runs where possible.
+//
+// Linked programs are stored on disk as the binaries returned by glGetProgramBinary(), named
+// after a hash of their sources and the driver they were built with, and loaded again with
+// glProgramBinary() the next time. Programs which are not in the cache are all compiled and
+// linked before the result of any of them is checked, so that drivers compiling in the
+// background (GL_KHR_parallel_shader_compile) can work on all of them at once.
+class ShaderProgramCache {
+public:
+    // Shader files are looked for in sourceDirectory. The binaries are kept in cacheDirectory,
+    // which is created if it does not exist; if it is empty, nothing is cached.
+    ShaderProgramCache(std::string const &sourceDirectory, std::string const &cacheDirectory);
+    ~ShaderProgramCache();
+
+    // Adds a program made of the given shader files, whose types are taken from their
+    // extensions (.vert, .frag and so on). Returns the index to get the program by once built.
+    size_t addProgram(std::vector<std::string> const &shaderFiles);
+
+    // Builds all programs added since the last call. Throws a std::runtime_error, after
+    // printing the driver's log, if a program fails to compile or link.
+    void build();
+
+    // The programs belong to the cache, and are deleted along with it
+    GLuint getProgram(size_t index) const { return programs[index].program; }
+
+    // Numbers of programs loaded from the cache and compiled by the last call to build(),
+    // and how long it took
+    unsigned int getLoadedCount() const { return loadedCount; }
+    unsigned int getCompiledCount() const { return compiledCount; }
+    double getBuildSeconds() const { return buildSeconds; }
+
+private:
+    ShaderProgramCache(ShaderProgramCache const &) = delete;
+    ShaderProgramCache & operator =(ShaderProgramCache const &) = delete;
+
+    struct CachedProgram {
+        std::vector<std::string> files;
+        std::vector<std::string> sources;
+        uint64_t key;
+        GLuint program;
+        std::vector<GLuint> shaders;
+        bool isBuilt;
+    };
+
+    std::string getBinaryPath(uint64_t key) const;
+    bool loadBinary(CachedProgram &program) const;
+    void saveBinary(CachedProgram const &program) const;
+
+    std::string sourceDirectory;
+    std::string cacheDirectory;
+    std::vector<CachedProgram> programs;
+
+    unsigned int loadedCount = 0;
+    unsigned int compiledCount = 0;
+    double buildSeconds = 0.0;
+};
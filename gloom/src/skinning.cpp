@@ -0,0 +1,192 @@
+#include <cmath>
+#include "parallel.hpp"
+#include "skinning.hpp"
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define SKINNING_USE_SSE 1
+#endif
+
+// Number of characters each thread computes the palettes of at a time
+static const size_t charactersPerPiece = 256;
+
+SkinnedMesh mergeRigidParts(std::vector<Mesh const*> const &parts, std::string const &name) {
+    SkinnedMesh skinned = { Mesh(name), {}, {} };
+    Mesh &merged = skinned.mesh;
+
+    merged.hasNormals = true;
+    merged.hasTextureCoordinates = true;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    for (Mesh const *part : parts) {
+        merged.hasNormals = merged.hasNormals && part->hasNormals;
+        merged.hasTextureCoordinates = merged.hasTextureCoordinates && part->hasTextureCoordinates;
+        vertexCount += part->vertices.size();
+        indexCount += part->indices.size();
+    }
+    merged.vertices.reserve(vertexCount);
+    merged.colours.reserve(vertexCount);
+    merged.indices.reserve(indexCount);
+    skinned.boneIndices.reserve(vertexCount);
+    skinned.boneWeights.reserve(vertexCount);
+
+    for (size_t bone = 0; bone < parts.size(); bone++) {
+        Mesh const &part = *parts[bone];
+        unsigned int firstVertex = unsigned(merged.vertices.size());
+
+        merged.vertices.insert(merged.vertices.end(), part.vertices.begin(), part.vertices.end());
+        merged.colours.insert(merged.colours.end(), part.colours.begin(), part.colours.end());
+        if (merged.hasNormals) {
+            merged.normals.insert(merged.normals.end(), part.normals.begin(), part.normals.end());
+        }
+        if (merged.hasTextureCoordinates) {
+            merged.textureCoordinates.insert(merged.textureCoordinates.end(), part.textureCoordinates.begin(), part.textureCoordinates.end());
+        }
+        for (unsigned int index : part.indices) {
+            merged.indices.push_back(firstVertex + index);
+        }
+
+        skinned.boneIndices.insert(skinned.boneIndices.end(), part.vertices.size(), float4(float(bone), 0, 0, 0));
+        skinned.boneWeights.insert(skinned.boneWeights.end(), part.vertices.size(), float4(1, 0, 0, 0));
+    }
+
+    return skinned;
+}
+
+Skeleton createCharacterSkeleton() {
+    Skeleton skeleton;
+    skeleton.bones.resize(CHARACTER_BONE_COUNT);
+
+    // These are the points the parts of steve.obj turn around
+    Bone torso = { -1, float3(0, 0, 0) };
+    Bone head = { CHARACTER_BONE_TORSO, float3(0, 24, 0) };
+    Bone leftArm = { CHARACTER_BONE_TORSO, float3(-4, 22, 0) };
+    Bone rightArm = { CHARACTER_BONE_TORSO, float3(4, 22, 0) };
+    Bone leftLeg = { CHARACTER_BONE_TORSO, float3(-2, 12, 0) };
+    Bone rightLeg = { CHARACTER_BONE_TORSO, float3(2, 12, 0) };
+
+    skeleton.bones[CHARACTER_BONE_TORSO] = torso;
+    skeleton.bones[CHARACTER_BONE_HEAD] = head;
+    skeleton.bones[CHARACTER_BONE_LEFT_ARM] = leftArm;
+    skeleton.bones[CHARACTER_BONE_RIGHT_ARM] = rightArm;
+    skeleton.bones[CHARACTER_BONE_LEFT_LEG] = leftLeg;
+    skeleton.bones[CHARACTER_BONE_RIGHT_LEG] = rightLeg;
+    return skeleton;
+}
+
+SkinnedMesh createSkinnedCharacter(MinecraftCharacter const &character) {
+    std::vector<Mesh const*> parts(CHARACTER_BONE_COUNT);
+    parts[CHARACTER_BONE_TORSO] = &character.torso;
+    parts[CHARACTER_BONE_HEAD] = &character.head;
+    parts[CHARACTER_BONE_LEFT_ARM] = &character.leftArm;
+    parts[CHARACTER_BONE_RIGHT_ARM] = &character.rightArm;
+    parts[CHARACTER_BONE_LEFT_LEG] = &character.leftLeg;
+    parts[CHARACTER_BONE_RIGHT_LEG] = &character.rightLeg;
+    return mergeRigidParts(parts, "Skinned character");
+}
+
+// The same transformation as computeLocalTransformation() in sceneGraph.cpp, written out
+// rather than multiplying five matrices: a rotation around x, then y, then z about the
+// reference point, followed by a translation
+static void computeBoneTransformation(Bone const &bone, BonePose const &pose, glm::mat4 &transformation) {
+    float sx = std::sin(pose.rotation.x), cx = std::cos(pose.rotation.x);
+    float sy = std::sin(pose.rotation.y), cy = std::cos(pose.rotation.y);
+    float sz = std::sin(pose.rotation.z), cz = std::cos(pose.rotation.z);
+
+    // Columns of the rotation
+    glm::vec3 column0(cy * cz, cx * sz + sx * sy * cz, sx * sz - cx * sy * cz);
+    glm::vec3 column1(-cy * sz, cx * cz - sx * sy * sz, sx * cz + cx * sy * sz);
+    glm::vec3 column2(sy, -sx * cy, cx * cy);
+
+    glm::vec3 reference = bone.referencePoint;
+    glm::vec3 translation = glm::vec3(pose.position) + reference -
+        (column0 * reference.x + column1 * reference.y + column2 * reference.z);
+
+    transformation[0] = glm::vec4(column0, 0);
+    transformation[1] = glm::vec4(column1, 0);
+    transformation[2] = glm::vec4(column2, 0);
+    transformation[3] = glm::vec4(translation, 1);
+}
+
+// result = a * b. result may not be a or b.
+static void multiplyMatrices(glm::mat4 const &a, glm::mat4 const &b, glm::mat4 &result) {
+#ifdef SKINNING_USE_SSE
+    __m128 a0 = _mm_loadu_ps(&a[0][0]);
+    __m128 a1 = _mm_loadu_ps(&a[1][0]);
+    __m128 a2 = _mm_loadu_ps(&a[2][0]);
+    __m128 a3 = _mm_loadu_ps(&a[3][0]);
+    for (int column = 0; column < 4; column++) {
+        __m128 sum = _mm_mul_ps(a0, _mm_set1_ps(b[column][0]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(a1, _mm_set1_ps(b[column][1])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_set1_ps(b[column][2])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_set1_ps(b[column][3])));
+        _mm_storeu_ps(&result[column][0], sum);
+    }
+#else
+    result = a * b;
+#endif
+}
+
+void computeBonePalette(Skeleton const &skeleton, BonePose const *poses, glm::mat4 *palette) {
+    glm::mat4 local;
+    for (size_t i = 0; i < skeleton.bones.size(); i++) {
+        Bone const &bone = skeleton.bones[i];
+        if (bone.parent < 0) {
+            computeBoneTransformation(bone, poses[i], palette[i]);
+        } else {
+            computeBoneTransformation(bone, poses[i], local);
+            multiplyMatrices(palette[bone.parent], local, palette[i]);
+        }
+    }
+}
+
+void computeBonePalettes(Skeleton const &skeleton, std::vector<BonePose> const &poses, std::vector<glm::mat4> &palettes) {
+    size_t boneCount = skeleton.bones.size();
+    size_t characterCount = boneCount > 0 ? poses.size() / boneCount : 0;
+    palettes.resize(characterCount * boneCount);
+
+    parallelFor(0, characterCount, charactersPerPiece, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            computeBonePalette(skeleton, &poses[i * boneCount], &palettes[i * boneCount]);
+        }
+    });
+}
+
+void skinMesh(SkinnedMesh const &skinnedMesh, glm::mat4 const *palette, Mesh &result) {
+    Mesh const &mesh = skinnedMesh.mesh;
+    if (result.indices.size() != mesh.indices.size() || result.colours.size() != mesh.colours.size()) {
+        result.colours = mesh.colours;
+        result.textureCoordinates = mesh.textureCoordinates;
+        result.indices = mesh.indices;
+    }
+    result.hasNormals = mesh.hasNormals;
+    result.hasTextureCoordinates = mesh.hasTextureCoordinates;
+    result.vertices.resize(mesh.vertices.size());
+    result.normals.resize(mesh.normals.size());
+
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        float4 const &bones = skinnedMesh.boneIndices[i];
+        float4 const &weights = skinnedMesh.boneWeights[i];
+
+        // Most vertices follow a single bone, which needs no blending
+        glm::mat4 transformation = palette[int(bones.x)];
+        if (weights.x != 1.0f) {
+            transformation = transformation * weights.x + palette[int(bones.y)] * weights.y +
+                             palette[int(bones.z)] * weights.z + palette[int(bones.w)] * weights.w;
+        }
+
+        float4 const &vertex = mesh.vertices[i];
+        result.vertices[i] = transformation * glm::vec4(vertex);
+
+        if (mesh.hasNormals) {
+            // Bones only rotate and move, so the normals need no inverse transpose
+            float3 const &normal = mesh.normals[i];
+            glm::vec3 rotated = glm::mat3(transformation) * glm::vec3(normal);
+            float length = std::sqrt(rotated.x * rotated.x + rotated.y * rotated.y + rotated.z * rotated.z);
+            if (length > 0.0f) {
+                rotated = rotated * (1.0f / length);
+            }
+            result.normals[i] = rotated;
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <vector>
+#include "OBJLoader.hpp"
+#include "floats.hpp"
+#include "mesh.hpp"
+
+// Skinning draws a character made of several moving parts as a single mesh. Each vertex is
+// tied to one or more bones of a skeleton, and is moved by the transformations of those bones
+// when it is drawn. The transformations are passed along as a palette of matrices, one per
+// bone, so that animating a character only changes the palette.
+
+// Largest number of bones in a skeleton, which is the size of the palette in simple.vert
+const unsigned int maxBoneCount = 16;
+
+// A bone rotates around its reference point, and moves along with its parent
+struct Bone {
+    // Index of the parent bone, which comes earlier in the skeleton, or -1 for the root
+    int parent;
+    float3 referencePoint;
+};
+
+struct Skeleton {
+    std::vector<Bone> bones;
+};
+
+// Where a bone is relative to its parent, with the same meaning as the position and rotation of a SceneNode
+struct BonePose {
+    float3 position;
+    float3 rotation;
+};
+
+struct SkinnedMesh {
+    Mesh mesh;
+    // Up to four bones influence each vertex, with weights summing to 1. Bones are stored as
+    // floats so that they can be uploaded the same way as the other vertex attributes.
+    std::vector<float4> boneIndices;
+    std::vector<float4> boneWeights;
+};
+
+// Merges meshes which each move rigidly along with one bone; parts[i] follows bone i.
+// The parts must already be placed where they are in the skeleton's rest pose.
+SkinnedMesh mergeRigidParts(std::vector<Mesh const*> const &parts, std::string const &name);
+
+// The bones of a MinecraftCharacter
+enum CharacterBone {
+    CHARACTER_BONE_TORSO,
+    CHARACTER_BONE_HEAD,
+    CHARACTER_BONE_LEFT_ARM,
+    CHARACTER_BONE_RIGHT_ARM,
+    CHARACTER_BONE_LEFT_LEG,
+    CHARACTER_BONE_RIGHT_LEG,
+    CHARACTER_BONE_COUNT
+};
+
+// The skeleton of a MinecraftCharacter, with the torso as the root and the limbs attached to it
+Skeleton createCharacterSkeleton();
+// The parts of a character merged into one mesh for createCharacterSkeleton()
+SkinnedMesh createSkinnedCharacter(MinecraftCharacter const &character);
+
+// Computes the transformation of each bone relative to the skeleton's root, given the pose
+// of every bone. poses and palette both hold one entry per bone.
+void computeBonePalette(Skeleton const &skeleton, BonePose const *poses, glm::mat4 *palette);
+
+// Computes the palettes of many characters sharing a skeleton. The poses of each character
+// follow each other, as do their palettes. The characters are spread over several threads,
+// and the matrices multiplied with SSE where available.
+void computeBonePalettes(Skeleton const &skeleton, std::vector<BonePose> const &poses, std::vector<glm::mat4> &palettes);
+
+// Moves the vertices and normals of a mesh by a palette on the CPU, for when they are not
+// skinned by the shader. The colours and triangles are only copied into result if it does
+// not have them yet, so reusing result between frames only rewrites vertices and normals.
+void skinMesh(SkinnedMesh const &skinnedMesh, glm::mat4 const *palette, Mesh &result);
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "spatialGrid.hpp"
+
+// Orders neighbours by distance, then by ID, so results do not depend on the order points are visited in
+static bool isCloser(Neighbour const &a, Neighbour const &b) {
+    return a.distanceSquared < b.distanceSquared || (a.distanceSquared == b.distanceSquared && a.id < b.id);
+}
+
+static float distanceSquared(float2 a, float2 b) {
+    float dx = a.x - b.x;
+    float dy = a.y - b.y;
+    return dx * dx + dy * dy;
+}
+
+SpatialGrid::SpatialGrid(float tileWidth) : tileWidth(tileWidth) {
+    minimumTile = { 0, 0 };
+    maximumTile = { -1, -1 };
+    bucketStart.assign(2, 0);
+}
+
+int2 SpatialGrid::getTile(float2 position) const {
+    int2 tile = { int(std::floor(position.x / tileWidth + 0.5f)), int(std::floor(position.y / tileWidth + 0.5f)) };
+    return tile;
+}
+
+size_t SpatialGrid::getBucket(int2 tile) const {
+    uint32_t hash = (uint32_t(tile.x) * 73856093u) ^ (uint32_t(tile.y) * 19349663u);
+    return hash & (bucketStart.size() - 2);
+}
+
+void SpatialGrid::rebuild(std::vector<float2> const &positions) {
+    size_t pointCount = positions.size();
+
+    // About two buckets per point keeps collisions between tiles rare
+    size_t bucketCount = 16;
+    while (bucketCount < 2 * pointCount) {
+        bucketCount *= 2;
+    }
+    bucketStart.assign(bucketCount + 1, 0);
+    pointBuckets.resize(pointCount);
+    entries.resize(pointCount);
+
+    minimumTile = { 0, 0 };
+    maximumTile = { -1, -1 };
+    if (pointCount > 0) {
+        minimumTile = maximumTile = getTile(positions[0]);
+    }
+
+    for (size_t point = 0; point < pointCount; point++) {
+        int2 tile = getTile(positions[point]);
+        minimumTile.x = std::min(minimumTile.x, tile.x);
+        minimumTile.y = std::min(minimumTile.y, tile.y);
+        maximumTile.x = std::max(maximumTile.x, tile.x);
+        maximumTile.y = std::max(maximumTile.y, tile.y);
+
+        size_t bucket = getBucket(tile);
+        pointBuckets[point] = unsigned(bucket);
+        bucketStart[bucket + 1]++;
+    }
+    for (size_t bucket = 0; bucket < bucketCount; bucket++) {
+        bucketStart[bucket + 1] += bucketStart[bucket];
+    }
+
+    // Points keep their original order within a bucket, since they are placed in order of ID
+    nextEntry.assign(bucketStart.begin(), bucketStart.end() - 1);
+    for (size_t point = 0; point < pointCount; point++) {
+        Entry &entry = entries[nextEntry[pointBuckets[point]]++];
+        entry.position = positions[point];
+        entry.tile = getTile(positions[point]);
+        entry.id = unsigned(point);
+    }
+}
+
+template <typename Visitor>
+void SpatialGrid::visitTile(int2 tile, Visitor const &visit) const {
+    if (tile.x < minimumTile.x || tile.x > maximumTile.x || tile.y < minimumTile.y || tile.y > maximumTile.y) {
+        return;
+    }
+
+    size_t bucket = getBucket(tile);
+    for (unsigned int index = bucketStart[bucket]; index < bucketStart[bucket + 1]; index++) {
+        Entry const &entry = entries[index];
+        if (entry.tile.x == tile.x && entry.tile.y == tile.y) {
+            visit(entry);
+        }
+    }
+}
+
+void SpatialGrid::queryRadius(float2 position, float radius, std::vector<Neighbour> &result, unsigned int ignoredID) const {
+    result.clear();
+    float radiusSquared = radius * radius;
+    int2 first = getTile(position - float2(radius, radius));
+    int2 last = getTile(position + float2(radius, radius));
+
+    first.x = std::max(first.x, minimumTile.x);
+    first.y = std::max(first.y, minimumTile.y);
+    last.x = std::min(last.x, maximumTile.x);
+    last.y = std::min(last.y, maximumTile.y);
+
+    for (int y = first.y; y <= last.y; y++) {
+        for (int x = first.x; x <= last.x; x++) {
+            int2 tile = { x, y };
+            visitTile(tile, [&](Entry const &entry) {
+                float distance = distanceSquared(entry.position, position);
+                if (distance <= radiusSquared && entry.id != ignoredID) {
+                    Neighbour neighbour = { entry.id, distance };
+                    result.push_back(neighbour);
+                }
+            });
+        }
+    }
+}
+
+void SpatialGrid::queryNearest(float2 position, unsigned int k, std::vector<Neighbour> &result, unsigned int ignoredID,
+                               float maxDistance) const {
+    result.clear();
+    if (k == 0 || entries.empty()) {
+        return;
+    }
+
+    // result is kept as a heap with the farthest of the nearest points found so far on top
+    float maxDistanceSquared = maxDistance * maxDistance;
+    auto consider = [&](Entry const &entry) {
+        if (entry.id == ignoredID) {
+            return;
+        }
+        Neighbour neighbour = { entry.id, distanceSquared(entry.position, position) };
+        if (neighbour.distanceSquared > maxDistanceSquared) {
+            return;
+        }
+        if (result.size() < k) {
+            result.push_back(neighbour);
+            std::push_heap(result.begin(), result.end(), isCloser);
+        } else if (isCloser(neighbour, result.front())) {
+            std::pop_heap(result.begin(), result.end(), isCloser);
+            result.back() = neighbour;
+            std::push_heap(result.begin(), result.end(), isCloser);
+        }
+    };
+
+    // Search rings of tiles around the position's own tile, moving outwards. Everything beyond
+    // ring n is at least n tile widths plus the distance to the edge of the own tile away.
+    int2 centre = getTile(position);
+    float edgeDistance = 0.5f * tileWidth - std::max(std::abs(position.x - centre.x * tileWidth),
+                                                     std::abs(position.y - centre.y * tileWidth));
+    edgeDistance = std::max(0.0f, edgeDistance);
+    int lastRing = std::max(std::max(centre.x - minimumTile.x, maximumTile.x - centre.x),
+                            std::max(centre.y - minimumTile.y, maximumTile.y - centre.y));
+
+    for (int ring = 0; ring <= lastRing; ring++) {
+        for (int dy = -ring; dy <= ring; dy++) {
+            // Rows at the top and bottom of the ring are visited completely, the others only at both ends
+            int step = (dy == -ring || dy == ring) ? 1 : std::max(1, 2 * ring);
+            for (int dx = -ring; dx <= ring; dx += step) {
+                int2 tile = { centre.x + dx, centre.y + dy };
+                visitTile(tile, consider);
+            }
+        }
+
+        float searchedDistance = ring * tileWidth + edgeDistance;
+        if (searchedDistance >= maxDistance ||
+            (result.size() == k && result.front().distanceSquared <= searchedDistance * searchedDistance)) {
+            break;
+        }
+    }
+
+    std::sort_heap(result.begin(), result.end(), isCloser);
+}
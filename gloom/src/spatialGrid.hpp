@@ -0,0 +1,73 @@
+#pragma once
+
+#include <limits>
+#include <vector>
+#include "floats.hpp"
+
+// A point found by a SpatialGrid query.
+struct Neighbour {
+    unsigned int id;
+    float distanceSquared;
+};
+
+// A uniform grid over the ground plane for finding points near each other, such as walking
+// characters. There is one cell per chessboard tile: tile (x, y) is the square centred on
+// (x, y) * tileWidth, the same as in generateChessboard() and Path.
+//
+// Cells are found through a hash table, so the grid covers the whole plane. It is meant to be
+// rebuilt every tick, which is a counting sort of the points by cell: no memory is allocated
+// once the grid has seen its largest number of points.
+class SpatialGrid {
+public:
+    SpatialGrid(float tileWidth);
+
+    // Replaces the points in the grid. Each point's index in the vector is its ID in query results.
+    void rebuild(std::vector<float2> const &positions);
+
+    // Replaces the contents of result with all points within radius of a position, in no particular order.
+    // The point with ID ignoredID is skipped, as in queryNearest().
+    void queryRadius(float2 position, float radius, std::vector<Neighbour> &result, unsigned int ignoredID = ~0u) const;
+
+    // Replaces the contents of result with the k points nearest to a position, nearest first.
+    // Points at the same distance are ordered by ID. The point with ID ignoredID is skipped,
+    // so a point can look for its neighbours without finding itself. Points farther away than
+    // maxDistance are left out. Once result has room for k points, this allocates nothing.
+    void queryNearest(float2 position, unsigned int k, std::vector<Neighbour> &result, unsigned int ignoredID = ~0u,
+                      float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+    // Returns the tile a position lies on.
+    int2 getTile(float2 position) const;
+
+    float getTileWidth() const { return tileWidth; }
+    size_t getPointCount() const { return entries.size(); }
+
+private:
+    // Everything a query needs to know about a point, kept together so looking at a point
+    // costs a single cache miss
+    struct Entry {
+        float2 position;
+        int2 tile;
+        unsigned int id;
+    };
+
+    size_t getBucket(int2 tile) const;
+
+    // Calls visit(entry) for each point in the tile
+    template <typename Visitor>
+    void visitTile(int2 tile, Visitor const &visit) const;
+
+    float tileWidth;
+
+    // The range of tiles containing any points
+    int2 minimumTile;
+    int2 maximumTile;
+
+    // The points sorted by bucket. Bucket b holds entries [bucketStart[b], bucketStart[b + 1]).
+    // Different tiles can share a bucket, so each entry also stores its tile.
+    std::vector<unsigned int> bucketStart;
+    std::vector<Entry> entries;
+
+    // Scratch space for rebuild()
+    std::vector<unsigned int> pointBuckets;
+    std::vector<unsigned int> nextEntry;
+};
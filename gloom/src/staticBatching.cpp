@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include "staticBatching.hpp"
+
+static void collectStaticNodes(SceneNode* node, glm::mat4 const &modelMatrix, std::vector<StaticInstance> &instances) {
+    if (node->staticMesh) {
+        StaticInstance instance = { node, node->staticMesh.get(), modelMatrix };
+        instances.push_back(instance);
+    }
+
+    for (SceneNode* child : node->children) {
+        if (child->isStatic) {
+            collectStaticNodes(child, modelMatrix * computeLocalTransformation(child), instances);
+        }
+    }
+}
+
+std::vector<StaticInstance> collectStaticInstances(SceneNode* root) {
+    std::vector<StaticInstance> instances;
+    for (SceneNode* child : root->children) {
+        if (child->isStatic) {
+            collectStaticNodes(child, computeLocalTransformation(child), instances);
+        }
+    }
+    return instances;
+}
+
+// Normals are transformed by the inverse transpose, which keeps them perpendicular to
+// surfaces under non-uniform scaling
+static glm::mat3 computeNormalMatrix(glm::mat4 const &modelMatrix) {
+    return glm::mat3(glm::transpose(glm::inverse(modelMatrix)));
+}
+
+static float4 transformPosition(glm::mat4 const &modelMatrix, float4 const &vertex) {
+    return modelMatrix * glm::vec4(vertex);
+}
+
+static void appendInstance(StaticBatch &batch, StaticInstance const &instance, unsigned int instanceIndex) {
+    Mesh &merged = batch.mesh;
+    Mesh const &mesh = *instance.mesh;
+
+    StaticBatchRange range;
+    range.instance = instanceIndex;
+    range.firstVertex = unsigned(merged.vertices.size());
+    range.vertexCount = unsigned(mesh.vertices.size());
+    range.firstIndex = unsigned(merged.indices.size());
+    range.indexCount = unsigned(mesh.indices.size());
+    batch.ranges.push_back(range);
+
+    for (float4 const &vertex : mesh.vertices) {
+        merged.vertices.push_back(transformPosition(instance.modelMatrix, vertex));
+    }
+    merged.colours.insert(merged.colours.end(), mesh.colours.begin(), mesh.colours.end());
+    if (merged.hasTextureCoordinates) {
+        merged.textureCoordinates.insert(merged.textureCoordinates.end(), mesh.textureCoordinates.begin(), mesh.textureCoordinates.end());
+    }
+
+    if (merged.hasNormals) {
+        glm::mat3 normalMatrix = computeNormalMatrix(instance.modelMatrix);
+        for (float3 const &normal : mesh.normals) {
+            glm::vec3 transformed = normalMatrix * glm::vec3(normal);
+            float length = std::sqrt(transformed.x * transformed.x + transformed.y * transformed.y + transformed.z * transformed.z);
+            if (length > 0.0f) {
+                transformed = transformed * (1.0f / length);
+            }
+            merged.normals.push_back(transformed);
+        }
+    }
+
+    for (unsigned int index : mesh.indices) {
+        merged.indices.push_back(range.firstVertex + index);
+    }
+}
+
+std::vector<StaticBatch> buildStaticBatches(std::vector<StaticInstance> const &instances, size_t maxVerticesPerBatch) {
+    std::vector<StaticBatch> batches;
+
+    size_t first = 0;
+    while (first < instances.size()) {
+        // Take as many instances as fit, but always at least one
+        size_t last = first;
+        size_t vertexCount = 0;
+        size_t indexCount = 0;
+        bool hasNormals = true;
+        bool hasTextureCoordinates = true;
+        do {
+            vertexCount += instances[last].mesh->vertices.size();
+            indexCount += instances[last].mesh->indices.size();
+            hasNormals = hasNormals && instances[last].mesh->hasNormals;
+            hasTextureCoordinates = hasTextureCoordinates && instances[last].mesh->hasTextureCoordinates;
+            last++;
+        } while (last < instances.size() && vertexCount + instances[last].mesh->vertices.size() <= maxVerticesPerBatch);
+
+        StaticBatch batch = { Mesh("Static batch " + std::to_string(batches.size())), BoundingSphere(), {} };
+        batch.mesh.hasNormals = hasNormals;
+        batch.mesh.hasTextureCoordinates = hasTextureCoordinates;
+        batch.mesh.vertices.reserve(vertexCount);
+        batch.mesh.colours.reserve(vertexCount);
+        batch.mesh.indices.reserve(indexCount);
+        if (hasNormals) {
+            batch.mesh.normals.reserve(vertexCount);
+        }
+        if (hasTextureCoordinates) {
+            batch.mesh.textureCoordinates.reserve(vertexCount);
+        }
+
+        for (size_t i = first; i < last; i++) {
+            appendInstance(batch, instances[i], unsigned(i));
+        }
+        batch.bounds = computeBoundingSphere(batch.mesh);
+        batches.push_back(std::move(batch));
+        first = last;
+    }
+
+    return batches;
+}
+
+float measureStaticBatchError(std::vector<StaticBatch> const &batches, std::vector<StaticInstance> const &instances) {
+    float largestError = 0.0f;
+    for (StaticBatch const &batch : batches) {
+        for (StaticBatchRange const &range : batch.ranges) {
+            StaticInstance const &instance = instances[range.instance];
+            Mesh const &mesh = *instance.mesh;
+
+            // The triangles have to match as well as the vertices
+            bool isSameTopology = range.indexCount == mesh.indices.size();
+            for (unsigned int i = 0; isSameTopology && i < range.indexCount; i++) {
+                isSameTopology = batch.mesh.indices[range.firstIndex + i] == range.firstVertex + mesh.indices[i];
+            }
+            if (!isSameTopology || range.vertexCount != mesh.vertices.size()) {
+                return INFINITY;
+            }
+
+            for (unsigned int i = 0; i < range.vertexCount; i++) {
+                float4 expected = transformPosition(instance.modelMatrix, mesh.vertices[i]);
+                float4 const &actual = batch.mesh.vertices[range.firstVertex + i];
+                float dx = expected.x - actual.x;
+                float dy = expected.y - actual.y;
+                float dz = expected.z - actual.z;
+                largestError = std::max(largestError, std::sqrt(dx * dx + dy * dy + dz * dz));
+            }
+        }
+    }
+    return largestError;
+}
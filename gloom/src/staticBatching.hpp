@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <vector>
+#include "mesh.hpp"
+#include "sceneGraph.hpp"
+#include "toolbox.hpp"
+
+// Static batching merges the meshes of nodes which never move into a few large meshes, with
+// the nodes' transformations applied to the vertices beforehand. However many static nodes
+// there are, drawing them then takes only a handful of draw calls, and their transformations
+// do not have to be updated every frame. Everything here runs on the CPU only.
+
+// A static mesh and where it is placed
+struct StaticInstance {
+    SceneNode* node;
+    Mesh const *mesh;
+    glm::mat4 modelMatrix;
+};
+
+// The part of a batch's vertices and indices which came from one instance
+struct StaticBatchRange {
+    unsigned int instance;
+    unsigned int firstVertex;
+    unsigned int vertexCount;
+    unsigned int firstIndex;
+    unsigned int indexCount;
+};
+
+struct StaticBatch {
+    Mesh mesh;
+    // Encloses the batch, in the coordinate space of the node the instances were collected from
+    BoundingSphere bounds;
+    std::vector<StaticBatchRange> ranges;
+};
+
+// Finds the static nodes with a static mesh below root. Nodes are only included if every node
+// between them and root is static as well, since they would move along with their parent
+// otherwise. The model matrices are relative to root.
+std::vector<StaticInstance> collectStaticInstances(SceneNode* root);
+
+// Merges the instances into batches, in order. A new batch is started whenever the next
+// instance would make the current one exceed maxVerticesPerBatch vertices; an instance
+// larger than that gets a batch of its own. Normals are only kept if all instances in a
+// batch have them.
+std::vector<StaticBatch> buildStaticBatches(std::vector<StaticInstance> const &instances,
+                                            size_t maxVerticesPerBatch = 1 << 16);
+
+// Transforms the vertices of each instance directly and returns the largest distance from
+// the same vertex in the batches, to check that merging did not move anything
+float measureStaticBatchError(std::vector<StaticBatch> const &batches, std::vector<StaticInstance> const &instances);
@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include "memoryTracking.hpp"
+#include "terrainStreaming.hpp"
+
+const unsigned int TerrainStreamer::latencyWindowSize;
+
+TerrainStreamer::TerrainStreamer(TerrainStreamingSettings const &settings, UploadCallback upload, EvictCallback evict)
+    : settings(settings), upload(upload), evict(evict), latencies(latencyWindowSize) {
+    this->settings.chunkSize = std::max(1u, settings.chunkSize);
+    this->settings.maxUploadsPerUpdate = std::max(1u, settings.maxUploadsPerUpdate);
+    for (unsigned int i = 0; i < std::max(1u, settings.workerCount); i++) {
+        workers.push_back(std::thread(&TerrainStreamer::runWorker, this));
+    }
+}
+
+TerrainStreamer::~TerrainStreamer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isStopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+int2 TerrainStreamer::getFirstTile(uint64_t chunkID) const {
+    int2 firstTile = { int(chunkID & 0xffffffffu) * int(settings.chunkSize), int(chunkID >> 32) * int(settings.chunkSize) };
+    return firstTile;
+}
+
+int2 TerrainStreamer::getChunkTileCount(uint64_t chunkID) const {
+    int2 firstTile = getFirstTile(chunkID);
+    int2 tileCount = { int(std::min(settings.chunkSize, settings.boardWidth - unsigned(firstTile.x))),
+                       int(std::min(settings.chunkSize, settings.boardHeight - unsigned(firstTile.y))) };
+    return tileCount;
+}
+
+float TerrainStreamer::getChunkDistance(uint64_t chunkID, float2 position) const {
+    int2 firstTile = getFirstTile(chunkID);
+    int2 tileCount = getChunkTileCount(chunkID);
+    float2 minimum((firstTile.x - 0.5f) * settings.tileWidth, (firstTile.y - 0.5f) * settings.tileWidth);
+    float2 maximum = minimum + float2(tileCount.x * settings.tileWidth, tileCount.y * settings.tileWidth);
+
+    float dx = std::max(std::max(minimum.x - position.x, position.x - maximum.x), 0.0f);
+    float dy = std::max(std::max(minimum.y - position.y, position.y - maximum.y), 0.0f);
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+void TerrainStreamer::runWorker() {
+    // Chunks are loaded whenever the camera asks for them, not as part of a frame
+    BackgroundAllocationScope backgroundScope;
+    while (true) {
+        ChunkRequest request;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workAvailable.wait(lock, [this]() { return isStopping || !requests.empty(); });
+            if (isStopping) {
+                return;
+            }
+            request = requests.back();
+            requests.pop_back();
+        }
+
+        int2 tileCount = getChunkTileCount(request.chunkID);
+        GeneratedChunk generated = {
+            request.chunkID,
+            generateChessboardChunk(getFirstTile(request.chunkID), unsigned(tileCount.x), unsigned(tileCount.y),
+                                    settings.tileWidth, settings.tileColour1, settings.tileColour2)
+        };
+
+        std::lock_guard<std::mutex> lock(mutex);
+        generatedChunks.push_back(std::move(generated));
+    }
+}
+
+void TerrainStreamer::update(float2 cameraPosition) {
+    updateCount++;
+    uploadedChunkCount = 0;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    // Find the chunks near the camera, starting from the range of chunks the load radius covers
+    float chunkWidth = settings.chunkSize * settings.tileWidth;
+    float2 boardMinimum(-0.5f * settings.tileWidth, -0.5f * settings.tileWidth);
+    int chunkCountX = int((settings.boardWidth + settings.chunkSize - 1) / settings.chunkSize);
+    int chunkCountY = int((settings.boardHeight + settings.chunkSize - 1) / settings.chunkSize);
+    int firstX = std::max(0, int(std::floor((cameraPosition.x - settings.loadRadius - boardMinimum.x) / chunkWidth)));
+    int firstY = std::max(0, int(std::floor((cameraPosition.y - settings.loadRadius - boardMinimum.y) / chunkWidth)));
+    int lastX = std::min(chunkCountX - 1, int(std::floor((cameraPosition.x + settings.loadRadius - boardMinimum.x) / chunkWidth)));
+    int lastY = std::min(chunkCountY - 1, int(std::floor((cameraPosition.y + settings.loadRadius - boardMinimum.y) / chunkWidth)));
+
+    newRequests.clear();
+    pendingChunkCount = 0;
+    for (int y = firstY; y <= lastY; y++) {
+        for (int x = firstX; x <= lastX; x++) {
+            uint64_t chunkID = getChunkID(unsigned(x), unsigned(y));
+            float distance = getChunkDistance(chunkID, cameraPosition);
+            if (distance > settings.loadRadius) {
+                continue;
+            }
+
+            auto found = chunks.find(chunkID);
+            if (found == chunks.end()) {
+                ChunkState state = { false, 0, updateCount, now };
+                chunks[chunkID] = state;
+                ChunkRequest request = { chunkID, distance };
+                newRequests.push_back(request);
+            } else {
+                found->second.lastNeeded = updateCount;
+            }
+            if (found == chunks.end() || !found->second.isResident) {
+                pendingChunkCount++;
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // Chunks the camera has moved away from before they were generated are not needed
+        // any more, and the others are reordered by their distance to the camera
+        auto isCancelled = [&](ChunkRequest const &request) {
+            auto state = chunks.find(request.chunkID);
+            if (state->second.lastNeeded != updateCount) {
+                chunks.erase(state);
+                return true;
+            }
+            return false;
+        };
+        requests.erase(std::remove_if(requests.begin(), requests.end(), isCancelled), requests.end());
+        for (ChunkRequest &request : requests) {
+            request.distance = getChunkDistance(request.chunkID, cameraPosition);
+        }
+        requests.insert(requests.end(), newRequests.begin(), newRequests.end());
+        std::sort(requests.begin(), requests.end(), [](ChunkRequest const &a, ChunkRequest const &b) {
+            return a.distance > b.distance || (a.distance == b.distance && a.chunkID > b.chunkID);
+        });
+
+        size_t finishedCount = std::min<size_t>(generatedChunks.size(), settings.maxUploadsPerUpdate);
+        std::move(generatedChunks.begin(), generatedChunks.begin() + finishedCount, std::back_inserter(finishedChunks));
+        generatedChunks.erase(generatedChunks.begin(), generatedChunks.begin() + finishedCount);
+    }
+    if (!newRequests.empty()) {
+        workAvailable.notify_all();
+    }
+
+    for (GeneratedChunk &generated : finishedChunks) {
+        auto state = chunks.find(generated.chunkID);
+        if (state->second.lastNeeded != updateCount) {
+            // The camera moved away while the chunk was being generated
+            chunks.erase(state);
+            continue;
+        }
+
+        Mesh const &mesh = generated.chunk.mesh;
+        size_t bytes = mesh.vertices.size() * sizeof(float4) + mesh.colours.size() * sizeof(float4) +
+                       mesh.indices.size() * sizeof(unsigned int);
+        upload(generated.chunkID, generated.chunk);
+
+        state->second.isResident = true;
+        state->second.bytes = bytes;
+        residentBytes += bytes;
+        residentChunkCount++;
+        uploadedChunkCount++;
+        pendingChunkCount--;
+        double latency = std::chrono::duration<double>(std::chrono::steady_clock::now() - state->second.requestTime).count();
+        latencies[streamedChunkCount % latencyWindowSize] = latency;
+        streamedChunkCount++;
+        latencySum += latency;
+        maxLatency = std::max(maxLatency, latency);
+    }
+    // The chunks have been uploaded, so their meshes can go
+    finishedChunks.clear();
+
+    // Evict the chunks which were needed longest ago, but never ones near the camera
+    if (residentBytes > settings.memoryBudgetBytes) {
+        std::vector<std::pair<unsigned long long, uint64_t>> &candidates = evictionCandidates;
+        candidates.clear();
+        for (auto const &chunk : chunks) {
+            if (chunk.second.isResident && chunk.second.lastNeeded != updateCount) {
+                candidates.push_back(std::make_pair(chunk.second.lastNeeded, chunk.first));
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        for (size_t i = 0; i < candidates.size() && residentBytes > settings.memoryBudgetBytes; i++) {
+            auto state = chunks.find(candidates[i].second);
+            evict(state->first);
+            residentBytes -= state->second.bytes;
+            residentChunkCount--;
+            chunks.erase(state);
+        }
+    }
+}
+
+double TerrainStreamer::getMeanLatencySeconds() const {
+    return streamedChunkCount > 0 ? latencySum / streamedChunkCount : 0.0;
+}
+
+double TerrainStreamer::getLatencyPercentileSeconds(double fraction) const {
+    size_t count = std::min<size_t>(streamedChunkCount, latencyWindowSize);
+    if (count == 0) {
+        return 0.0;
+    }
+    double sorted[latencyWindowSize];
+    std::copy(latencies.begin(), latencies.begin() + count, sorted);
+    size_t index = std::min(count - 1, size_t(fraction * count));
+    std::nth_element(sorted, sorted + index, sorted + count);
+    return sorted[index];
+}
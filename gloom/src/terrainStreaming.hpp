@@ -0,0 +1,139 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "chessboard.hpp"
+#include "floats.hpp"
+
+struct TerrainStreamingSettings {
+    // Size of the whole board, and of the chunks it is streamed in, measured in tiles
+    unsigned int boardWidth = 1024;
+    unsigned int boardHeight = 1024;
+    unsigned int chunkSize = 32;
+    float tileWidth = 20.0f;
+    float4 tileColour1 = float4(1, 1, 1, 1);
+    float4 tileColour2 = float4(0.2, 0.2, 0.2, 1);
+
+    // Chunks coming closer to the camera than this are made resident
+    float loadRadius = 1000.0f;
+    // Chunks which are no longer near the camera are kept until the resident chunks take up
+    // more memory than this. Chunks near the camera are never evicted, even above the budget.
+    size_t memoryBudgetBytes = 64 << 20;
+
+    // Number of threads generating chunks
+    unsigned int workerCount = 2;
+    // Number of chunks handed over for uploading in each call to update(), which limits how
+    // much work streaming adds to a single frame
+    unsigned int maxUploadsPerUpdate = 4;
+};
+
+// Keeps the part of a chessboard around the camera resident, for boards far too large to
+// keep in memory as a whole.
+//
+// The board is divided into chunks, which are generated on background threads, nearest to the
+// camera first. Finished chunks are handed to the upload callback a few at a time, on the thread
+// calling update(). Chunks which have moved out of range are evicted through the evict callback,
+// least recently needed first, once the resident chunks use more memory than the budget.
+class TerrainStreamer {
+public:
+    // Called with each newly generated chunk, which should be uploaded and added to the scene.
+    // The chunk is discarded afterwards, so the mesh may be moved out of it.
+    typedef std::function<void(uint64_t chunkID, ChessboardChunk &chunk)> UploadCallback;
+    // Called when a chunk given to the upload callback should be removed from the scene again
+    typedef std::function<void(uint64_t chunkID)> EvictCallback;
+
+    TerrainStreamer(TerrainStreamingSettings const &settings, UploadCallback upload, EvictCallback evict);
+    ~TerrainStreamer();
+
+    // Requests the chunks near the camera, uploads chunks which have finished generating, and
+    // evicts chunks if over the memory budget. The camera position is on the ground plane, so its
+    // y coordinate is the z coordinate of the terrain. Should be called once per frame.
+    void update(float2 cameraPosition);
+
+    unsigned int getResidentChunkCount() const { return residentChunkCount; }
+    // Memory used by the meshes of the resident chunks
+    size_t getResidentBytes() const { return residentBytes; }
+    // Chunks near the camera which have not been uploaded yet
+    unsigned int getPendingChunkCount() const { return pendingChunkCount; }
+    // Chunks requested and uploaded in the last call to update()
+    unsigned int getRequestedChunkCount() const { return unsigned(newRequests.size()); }
+    unsigned int getUploadedChunkCount() const { return uploadedChunkCount; }
+
+    // Times from when chunks were first requested until they were uploaded, in seconds. The mean
+    // and maximum cover every chunk streamed, the percentiles the last latencyWindowSize chunks.
+    static const unsigned int latencyWindowSize = 1024;
+    unsigned int getStreamedChunkCount() const { return streamedChunkCount; }
+    double getMeanLatencySeconds() const;
+    double getMaxLatencySeconds() const { return maxLatency; }
+    double getLatencyPercentileSeconds(double fraction) const;
+
+private:
+    TerrainStreamer(TerrainStreamer const &) = delete;
+    TerrainStreamer & operator =(TerrainStreamer const &) = delete;
+
+    struct ChunkState {
+        bool isResident;
+        size_t bytes;
+        // The last call to update() the chunk was near the camera in
+        unsigned long long lastNeeded;
+        std::chrono::steady_clock::time_point requestTime;
+    };
+
+    struct ChunkRequest {
+        uint64_t chunkID;
+        float distance;
+    };
+
+    struct GeneratedChunk {
+        uint64_t chunkID;
+        ChessboardChunk chunk;
+    };
+
+    uint64_t getChunkID(unsigned int chunkX, unsigned int chunkY) const {
+        return (uint64_t(chunkY) << 32) | chunkX;
+    }
+    int2 getFirstTile(uint64_t chunkID) const;
+    int2 getChunkTileCount(uint64_t chunkID) const;
+    // The distance from a position to the nearest point of a chunk
+    float getChunkDistance(uint64_t chunkID, float2 position) const;
+
+    void runWorker();
+
+    TerrainStreamingSettings settings;
+    UploadCallback upload;
+    EvictCallback evict;
+
+    // Only used by the thread calling update()
+    std::unordered_map<uint64_t, ChunkState> chunks;
+    unsigned long long updateCount = 0;
+    unsigned int residentChunkCount = 0;
+    size_t residentBytes = 0;
+    unsigned int pendingChunkCount = 0;
+    unsigned int uploadedChunkCount = 0;
+    unsigned int streamedChunkCount = 0;
+    double latencySum = 0.0;
+    double maxLatency = 0.0;
+    // The latencies of the last chunks streamed, overwritten in turn
+    std::vector<double> latencies;
+
+    // Working space for update(), kept so that frames without streaming allocate nothing
+    std::vector<ChunkRequest> newRequests;
+    std::vector<GeneratedChunk> finishedChunks;
+    std::vector<std::pair<unsigned long long, uint64_t>> evictionCandidates;
+
+    // Shared with the worker threads, guarded by the mutex. Requests are sorted so that the
+    // nearest chunk comes last.
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::vector<ChunkRequest> requests;
+    std::vector<GeneratedChunk> generatedChunks;
+    bool isStopping = false;
+
+    std::vector<std::thread> workers;
+};
@@ -0,0 +1,807 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include "parallel.hpp"
+#include "texture.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TEXTURE_USE_SSE2 1
+#endif
+
+// Number of block rows each thread compresses at a time
+static const size_t blockRowsPerPiece = 16;
+
+// Identifies texture cache files, and the version of their layout
+static const uint32_t cacheFileMagic = 0x43585447; // "GTXC"
+static const uint32_t cacheFileVersion = 1;
+static const size_t cacheDataAlignment = 16;
+
+size_t getTextureLevelSize(TextureFormat format, unsigned int width, unsigned int height) {
+    if (format == TextureFormat::BC1) {
+        return size_t((width + 3) / 4) * ((height + 3) / 4) * 8;
+    }
+    return size_t(width) * height * 4;
+}
+
+// Lays out a mip chain starting at the given dimensions, and allocates its data
+static void allocateLevels(Texture &texture, TextureFormat format, unsigned int width, unsigned int height, unsigned int maxLevels) {
+    texture.format = format;
+    texture.levels.clear();
+    size_t offset = 0;
+    while (true) {
+        TextureLevel level = { width, height, offset, getTextureLevelSize(format, width, height) };
+        texture.levels.push_back(level);
+        offset += level.size;
+        if ((width == 1 && height == 1) || (maxLevels != 0 && texture.levels.size() == maxLevels)) {
+            break;
+        }
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+    }
+    texture.data.resize(offset);
+}
+
+Texture decodeTexture(std::string const &path) {
+    int width, height, channels;
+    stbi_uc *pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+    if (!pixels) {
+        throw std::runtime_error("Could not decode the texture \"" + path + "\": " + stbi_failure_reason());
+    }
+
+    Texture texture;
+    texture.name = path;
+    allocateLevels(texture, TextureFormat::RGBA8, unsigned(width), unsigned(height), 1);
+
+    // Images are stored top row first
+    size_t rowBytes = size_t(width) * 4;
+    for (int row = 0; row < height; row++) {
+        std::memcpy(&texture.data[size_t(height - 1 - row) * rowBytes], pixels + size_t(row) * rowBytes, rowBytes);
+    }
+    stbi_image_free(pixels);
+    return texture;
+}
+
+std::vector<Texture> decodeTextures(std::vector<std::string> const &paths) {
+    std::vector<Texture> textures(paths.size());
+    // Exceptions cannot leave the worker threads, so they are passed on afterwards
+    std::vector<std::string> errors(paths.size());
+
+    parallelFor(0, paths.size(), 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            try {
+                textures[i] = decodeTexture(paths[i]);
+            } catch (std::exception const &error) {
+                errors[i] = error.what();
+            }
+        }
+    });
+
+    for (std::string const &error : errors) {
+        if (!error.empty()) {
+            throw std::runtime_error(error);
+        }
+    }
+    return textures;
+}
+
+// Halves an RGBA8 image by averaging 2x2 blocks. The last row or column of an image with an
+// odd size is counted twice, in place of the missing one.
+static void downsampleBox(unsigned char const *source, unsigned int sourceWidth, unsigned int sourceHeight,
+                          unsigned char *destination, unsigned int width, unsigned int height) {
+    for (unsigned int y = 0; y < height; y++) {
+        unsigned char const *row0 = source + size_t(std::min(2 * y, sourceHeight - 1)) * sourceWidth * 4;
+        unsigned char const *row1 = source + size_t(std::min(2 * y + 1, sourceHeight - 1)) * sourceWidth * 4;
+        unsigned char *output = destination + size_t(y) * width * 4;
+        unsigned int x = 0;
+
+#ifdef TEXTURE_USE_SSE2
+        // Two output pixels at a time, from four pixels of each row
+        __m128i zero = _mm_setzero_si128();
+        __m128i rounding = _mm_set1_epi16(2);
+        for (; 2 * x + 3 < sourceWidth && x + 1 < width; x += 2) {
+            __m128i top = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row0 + 8 * x));
+            __m128i bottom = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row1 + 8 * x));
+            __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+            __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+            __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+            sum = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(output + 4 * x), _mm_packus_epi16(sum, sum));
+        }
+#endif
+
+        for (; x < width; x++) {
+            unsigned int left = std::min(2 * x, sourceWidth - 1) * 4;
+            unsigned int right = std::min(2 * x + 1, sourceWidth - 1) * 4;
+            for (int channel = 0; channel < 4; channel++) {
+                unsigned int sum = row0[left + channel] + row0[right + channel] + row1[left + channel] + row1[right + channel];
+                output[4 * x + channel] = (unsigned char) ((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+// Modified Bessel function of the first kind, of order 0
+static double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 25; k++) {
+        double factor = x / (2.0 * k);
+        term *= factor * factor;
+        sum += term;
+    }
+    return sum;
+}
+
+static const int kaiserTaps = 6;
+
+// Weights of a sinc filter for halving an image, windowed by a Kaiser window reaching three
+// source pixels to either side of the output pixel
+static std::vector<float> computeKaiserWeights() {
+    const double beta = 4.0;
+    const double radius = 0.5 * kaiserTaps;
+    const double pi = 3.14159265358979323846;
+
+    std::vector<float> weights(kaiserTaps);
+    double total = 0.0;
+    for (int tap = 0; tap < kaiserTaps; tap++) {
+        // Distance from the centre of the output pixel, in source pixels
+        double distance = tap - 0.5 * (kaiserTaps - 1);
+        double t = distance / radius;
+        double window = besselI0(beta * std::sqrt(std::max(0.0, 1.0 - t * t))) / besselI0(beta);
+        double x = pi * distance * 0.5;
+        double sinc = x == 0.0 ? 1.0 : std::sin(x) / x;
+        weights[tap] = float(sinc * window);
+        total += weights[tap];
+    }
+    for (float &weight : weights) {
+        weight = float(weight / total);
+    }
+    return weights;
+}
+
+// Halves an RGBA8 image with the Kaiser filter: first along the rows, into floats, and then
+// along the columns. Pixels beyond the edges repeat the edge pixels.
+static void downsampleKaiser(unsigned char const *source, unsigned int sourceWidth, unsigned int sourceHeight,
+                             unsigned char *destination, unsigned int width, unsigned int height) {
+    static const std::vector<float> weights = computeKaiserWeights();
+    const int firstTap = -(kaiserTaps / 2 - 1);
+
+    std::vector<float> sourceRow(size_t(sourceWidth) * 4);
+    std::vector<float> filteredRows(size_t(sourceHeight) * width * 4);
+
+    for (unsigned int y = 0; y < sourceHeight; y++) {
+        unsigned char const *input = source + size_t(y) * sourceWidth * 4;
+        for (size_t i = 0; i < sourceRow.size(); i++) {
+            sourceRow[i] = input[i];
+        }
+
+        float *output = &filteredRows[size_t(y) * width * 4];
+        for (unsigned int x = 0; x < width; x++) {
+#ifdef TEXTURE_USE_SSE2
+            __m128 sum = _mm_setzero_ps();
+            for (int tap = 0; tap < kaiserTaps; tap++) {
+                int column = std::min(std::max(int(2 * x) + firstTap + tap, 0), int(sourceWidth) - 1);
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&sourceRow[4 * column]), _mm_set1_ps(weights[tap])));
+            }
+            _mm_storeu_ps(&output[4 * x], sum);
+#else
+            for (int channel = 0; channel < 4; channel++) {
+                float sum = 0.0f;
+                for (int tap = 0; tap < kaiserTaps; tap++) {
+                    int column = std::min(std::max(int(2 * x) + firstTap + tap, 0), int(sourceWidth) - 1);
+                    sum += sourceRow[4 * column + channel] * weights[tap];
+                }
+                output[4 * x + channel] = sum;
+            }
+#endif
+        }
+    }
+
+    for (unsigned int y = 0; y < height; y++) {
+        float const *rows[kaiserTaps];
+        for (int tap = 0; tap < kaiserTaps; tap++) {
+            int row = std::min(std::max(int(2 * y) + firstTap + tap, 0), int(sourceHeight) - 1);
+            rows[tap] = &filteredRows[size_t(row) * width * 4];
+        }
+
+        unsigned char *output = destination + size_t(y) * width * 4;
+        for (unsigned int x = 0; x < width; x++) {
+#ifdef TEXTURE_USE_SSE2
+            __m128 sum = _mm_setzero_ps();
+            for (int tap = 0; tap < kaiserTaps; tap++) {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&rows[tap][4 * x]), _mm_set1_ps(weights[tap])));
+            }
+            // The negative lobes can overshoot, which the saturating packs clamp away
+            __m128i rounded = _mm_cvtps_epi32(sum);
+            __m128i packed = _mm_packus_epi16(_mm_packs_epi32(rounded, rounded), rounded);
+            int pixel = _mm_cvtsi128_si32(packed);
+            std::memcpy(&output[4 * x], &pixel, 4);
+#else
+            for (int channel = 0; channel < 4; channel++) {
+                float sum = 0.0f;
+                for (int tap = 0; tap < kaiserTaps; tap++) {
+                    sum += rows[tap][4 * x + channel] * weights[tap];
+                }
+                output[4 * x + channel] = (unsigned char) std::min(std::max(std::lround(sum), 0l), 255l);
+            }
+#endif
+        }
+    }
+}
+
+void generateMipChain(Texture &texture, MipFilter filter, unsigned int maxLevels) {
+    if (texture.format != TextureFormat::RGBA8) {
+        throw std::runtime_error("Mip chains can only be generated for uncompressed textures, which \"" + texture.name + "\" is not");
+    }
+
+    Texture result;
+    result.name = texture.name;
+    allocateLevels(result, TextureFormat::RGBA8, texture.levels[0].width, texture.levels[0].height, maxLevels);
+    std::memcpy(result.getLevelData(0), texture.getLevelData(0), texture.levels[0].size);
+
+    for (size_t level = 1; level < result.levels.size(); level++) {
+        TextureLevel const &source = result.levels[level - 1];
+        TextureLevel const &destination = result.levels[level];
+        if (filter == MipFilter::BOX) {
+            downsampleBox(result.getLevelData(level - 1), source.width, source.height,
+                          result.getLevelData(level), destination.width, destination.height);
+        } else {
+            downsampleKaiser(result.getLevelData(level - 1), source.width, source.height,
+                             result.getLevelData(level), destination.width, destination.height);
+        }
+    }
+
+    texture = std::move(result);
+}
+
+void generateMipChains(std::vector<Texture> &textures, MipFilter filter, unsigned int maxLevels) {
+    parallelFor(0, textures.size(), 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            generateMipChain(textures[i], filter, maxLevels);
+        }
+    });
+}
+
+static uint16_t packColour565(int red, int green, int blue) {
+    return uint16_t(((red * 31 + 127) / 255) << 11 | ((green * 63 + 127) / 255) << 5 | ((blue * 31 + 127) / 255));
+}
+
+static void unpackColour565(uint16_t colour, int rgb[3]) {
+    int red = colour >> 11;
+    int green = (colour >> 5) & 63;
+    int blue = colour & 31;
+    rgb[0] = (red << 3) | (red >> 2);
+    rgb[1] = (green << 2) | (green >> 4);
+    rgb[2] = (blue << 3) | (blue >> 2);
+}
+
+// Compresses 16 RGBA8 pixels, row by row, into an eight byte BC1 block
+static void compressBlockBC1(unsigned char const pixels[64], unsigned char *block) {
+    int minimum[3] = { 255, 255, 255 };
+    int maximum[3] = { 0, 0, 0 };
+    for (int pixel = 0; pixel < 16; pixel++) {
+        for (int channel = 0; channel < 3; channel++) {
+            minimum[channel] = std::min(minimum[channel], int(pixels[4 * pixel + channel]));
+            maximum[channel] = std::max(maximum[channel], int(pixels[4 * pixel + channel]));
+        }
+    }
+    // Moving the endpoints slightly inwards puts the interpolated colours closer to the middle
+    for (int channel = 0; channel < 3; channel++) {
+        int inset = (maximum[channel] - minimum[channel]) / 16;
+        minimum[channel] += inset;
+        maximum[channel] -= inset;
+    }
+
+    uint16_t colour0 = packColour565(maximum[0], maximum[1], maximum[2]);
+    uint16_t colour1 = packColour565(minimum[0], minimum[1], minimum[2]);
+    uint32_t indices = 0;
+
+    // The four colour mode needs colour0 > colour1. Equal colours leave every index at 0.
+    if (colour0 < colour1) {
+        std::swap(colour0, colour1);
+    }
+    if (colour0 != colour1) {
+        int palette[4][3];
+        unpackColour565(colour0, palette[0]);
+        unpackColour565(colour1, palette[1]);
+        for (int channel = 0; channel < 3; channel++) {
+            palette[2][channel] = (2 * palette[0][channel] + palette[1][channel]) / 3;
+            palette[3][channel] = (palette[0][channel] + 2 * palette[1][channel]) / 3;
+        }
+
+        for (int pixel = 0; pixel < 16; pixel++) {
+            int best = 0;
+            int bestDistance = 1 << 30;
+            for (int entry = 0; entry < 4; entry++) {
+                int distance = 0;
+                for (int channel = 0; channel < 3; channel++) {
+                    int difference = int(pixels[4 * pixel + channel]) - palette[entry][channel];
+                    distance += difference * difference;
+                }
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    best = entry;
+                }
+            }
+            indices |= uint32_t(best) << (2 * pixel);
+        }
+    }
+
+    block[0] = uint8_t(colour0 & 0xff);
+    block[1] = uint8_t(colour0 >> 8);
+    block[2] = uint8_t(colour1 & 0xff);
+    block[3] = uint8_t(colour1 >> 8);
+    for (int i = 0; i < 4; i++) {
+        block[4 + i] = uint8_t(indices >> (8 * i));
+    }
+}
+
+Texture compressTextureBC1(Texture const &texture) {
+    if (texture.format != TextureFormat::RGBA8) {
+        throw std::runtime_error("The texture \"" + texture.name + "\" is already compressed");
+    }
+
+    Texture compressed;
+    compressed.name = texture.name;
+    compressed.format = TextureFormat::BC1;
+    size_t offset = 0;
+    for (TextureLevel const &level : texture.levels) {
+        TextureLevel compressedLevel = { level.width, level.height, offset, getTextureLevelSize(TextureFormat::BC1, level.width, level.height) };
+        compressed.levels.push_back(compressedLevel);
+        offset += compressedLevel.size;
+    }
+    compressed.data.resize(offset);
+
+    for (size_t levelIndex = 0; levelIndex < texture.levels.size(); levelIndex++) {
+        TextureLevel const &level = texture.levels[levelIndex];
+        unsigned char const *source = texture.getLevelData(levelIndex);
+        unsigned char *destination = compressed.getLevelData(levelIndex);
+        unsigned int blocksWide = (level.width + 3) / 4;
+        unsigned int blocksHigh = (level.height + 3) / 4;
+
+        parallelFor(0, blocksHigh, blockRowsPerPiece, [&](size_t firstRow, size_t lastRow) {
+            unsigned char pixels[64];
+            for (size_t blockY = firstRow; blockY < lastRow; blockY++) {
+                for (unsigned int blockX = 0; blockX < blocksWide; blockX++) {
+                    // Blocks hanging over the edges repeat the edge pixels
+                    for (unsigned int y = 0; y < 4; y++) {
+                        unsigned int row = std::min(unsigned(blockY) * 4 + y, level.height - 1);
+                        for (unsigned int x = 0; x < 4; x++) {
+                            unsigned int column = std::min(blockX * 4 + x, level.width - 1);
+                            std::memcpy(&pixels[4 * (4 * y + x)], source + (size_t(row) * level.width + column) * 4, 4);
+                        }
+                    }
+                    compressBlockBC1(pixels, destination + (blockY * blocksWide + blockX) * 8);
+                }
+            }
+        });
+    }
+
+    return compressed;
+}
+
+unsigned int getAtlasLevelCount(unsigned int padding) {
+    unsigned int levelCount = 1;
+    while (padding >= 2) {
+        padding /= 2;
+        levelCount++;
+    }
+    return levelCount;
+}
+
+static unsigned int alignUp(unsigned int value, unsigned int alignment) {
+    return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+}
+
+TextureAtlasSet packTextureAtlases(std::vector<Texture> textures, TextureAtlasSettings const &settings) {
+    TextureAtlasSet atlasSet;
+    atlasSet.placements.resize(textures.size());
+
+    unsigned int padding = settings.padding;
+    auto getPaddedWidth = [&](Texture const &texture) { return alignUp(texture.levels[0].width + 2 * padding, padding); };
+    auto getPaddedHeight = [&](Texture const &texture) { return alignUp(texture.levels[0].height + 2 * padding, padding); };
+
+    // Textures too large for an atlas keep to themselves
+    std::vector<size_t> packed;
+    for (size_t i = 0; i < textures.size(); i++) {
+        Texture &texture = textures[i];
+        if (texture.format != TextureFormat::RGBA8) {
+            throw std::runtime_error("Only uncompressed textures can be packed into atlases, which \"" + texture.name + "\" is not");
+        }
+        bool isSmall = texture.levels[0].width <= settings.maxPackedSize && texture.levels[0].height <= settings.maxPackedSize &&
+                       getPaddedWidth(texture) <= settings.atlasSize && getPaddedHeight(texture) <= settings.atlasSize;
+        if (isSmall) {
+            packed.push_back(i);
+        } else {
+            TexturePlacement placement = { unsigned(atlasSet.textures.size()), float2(0, 0), float2(1, 1) };
+            atlasSet.placements[i] = placement;
+            atlasSet.textures.push_back(std::move(texture));
+        }
+    }
+    atlasSet.firstAtlas = atlasSet.textures.size();
+
+    // Tallest first, so that the textures on each shelf are of similar heights
+    std::stable_sort(packed.begin(), packed.end(), [&](size_t a, size_t b) {
+        return textures[a].levels[0].height > textures[b].levels[0].height;
+    });
+
+    struct Rectangle {
+        unsigned int atlas;
+        unsigned int x;
+        unsigned int y;
+    };
+    std::vector<Rectangle> rectangles(textures.size());
+    std::vector<unsigned int> atlasHeights;
+    unsigned int shelfX = 0;
+    unsigned int shelfY = 0;
+    unsigned int shelfHeight = 0;
+
+    for (size_t i : packed) {
+        unsigned int width = getPaddedWidth(textures[i]);
+        unsigned int height = getPaddedHeight(textures[i]);
+        if (atlasHeights.empty() || shelfX + width > settings.atlasSize) {
+            shelfX = 0;
+            shelfY += shelfHeight;
+            shelfHeight = 0;
+        }
+        if (atlasHeights.empty() || shelfY + height > settings.atlasSize) {
+            atlasHeights.push_back(0);
+            shelfX = 0;
+            shelfY = 0;
+            shelfHeight = 0;
+        }
+        Rectangle rectangle = { unsigned(atlasHeights.size() - 1), shelfX, shelfY };
+        rectangles[i] = rectangle;
+        shelfX += width;
+        shelfHeight = std::max(shelfHeight, height);
+        atlasHeights.back() = std::max(atlasHeights.back(), shelfY + height);
+    }
+
+    // The last atlas is often mostly empty, so atlases are only as tall as they need to be,
+    // rounded up to a power of two
+    for (size_t atlasIndex = 0; atlasIndex < atlasHeights.size(); atlasIndex++) {
+        unsigned int height = 1;
+        while (height < atlasHeights[atlasIndex]) {
+            height *= 2;
+        }
+        atlasHeights[atlasIndex] = std::min(height, settings.atlasSize);
+
+        Texture atlas;
+        atlas.name = "Atlas " + std::to_string(atlasIndex);
+        allocateLevels(atlas, TextureFormat::RGBA8, settings.atlasSize, atlasHeights[atlasIndex], 1);
+        atlasSet.textures.push_back(std::move(atlas));
+    }
+
+    for (size_t i : packed) {
+        Rectangle const &rectangle = rectangles[i];
+        Texture &atlas = atlasSet.textures[atlasSet.firstAtlas + rectangle.atlas];
+        TextureLevel const &source = textures[i].levels[0];
+        unsigned char const *sourceData = textures[i].getLevelData(0);
+        unsigned int atlasWidth = atlas.levels[0].width;
+        unsigned int atlasHeight = atlas.levels[0].height;
+
+        // Fill the whole padded rectangle, repeating the edges of the texture into the padding
+        unsigned int width = getPaddedWidth(textures[i]);
+        unsigned int height = getPaddedHeight(textures[i]);
+        for (unsigned int y = 0; y < height; y++) {
+            int sourceY = std::min(std::max(int(y) - int(padding), 0), int(source.height) - 1);
+            unsigned char *output = atlas.getLevelData(0) + (size_t(rectangle.y + y) * atlasWidth + rectangle.x) * 4;
+            for (unsigned int x = 0; x < width; x++) {
+                int sourceX = std::min(std::max(int(x) - int(padding), 0), int(source.width) - 1);
+                std::memcpy(output + 4 * x, sourceData + (size_t(sourceY) * source.width + sourceX) * 4, 4);
+            }
+        }
+
+        TexturePlacement placement = {
+            unsigned(atlasSet.firstAtlas + rectangle.atlas),
+            float2(float(rectangle.x + padding) / atlasWidth, float(rectangle.y + padding) / atlasHeight),
+            float2(float(source.width) / atlasWidth, float(source.height) / atlasHeight)
+        };
+        atlasSet.placements[i] = placement;
+    }
+
+    return atlasSet;
+}
+
+TextureAtlasSet processTextures(std::vector<std::string> const &sourcePaths, TexturePipelineSettings const &settings) {
+    TextureAtlasSet atlasSet = packTextureAtlases(decodeTextures(sourcePaths), settings.atlases);
+
+    unsigned int atlasLevelCount = getAtlasLevelCount(settings.atlases.padding);
+    parallelFor(0, atlasSet.textures.size(), 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            if (i >= atlasSet.firstAtlas) {
+                generateMipChain(atlasSet.textures[i], MipFilter::BOX, atlasLevelCount);
+            } else {
+                generateMipChain(atlasSet.textures[i], settings.mipFilter);
+            }
+        }
+    });
+
+    if (settings.compress) {
+        for (Texture &texture : atlasSet.textures) {
+            texture = compressTextureBC1(texture);
+        }
+    }
+    return atlasSet;
+}
+
+// The layout of cache files. Every table entry is a multiple of eight bytes, so that the tables
+// stay aligned one after another. Values are stored in the byte order of the machine.
+struct CacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t settingsHash;
+    uint32_t sourceCount;
+    uint32_t textureCount;
+    uint32_t levelCount;
+    uint32_t nameBytes;
+    uint64_t dataOffset;
+    uint64_t dataSize;
+};
+
+struct CacheSource {
+    uint64_t fileSize;
+    int64_t modifiedTime;
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t texture;
+    float uvOffset[2];
+    float uvScale[2];
+    uint32_t unused;
+};
+
+struct CacheTexture {
+    uint32_t format;
+    uint32_t firstLevel;
+    uint32_t levelCount;
+    uint32_t unused;
+};
+
+struct CacheLevel {
+    uint32_t width;
+    uint32_t height;
+    // Relative to the start of the data
+    uint64_t offset;
+    uint64_t size;
+};
+
+static_assert(sizeof(CacheHeader) % 8 == 0 && sizeof(CacheSource) % 8 == 0 &&
+              sizeof(CacheTexture) % 8 == 0 && sizeof(CacheLevel) % 8 == 0,
+              "Texture cache entries should keep the tables aligned");
+
+// FNV-1a over the settings which change the contents of the cache
+static uint64_t hashSettings(TexturePipelineSettings const &settings) {
+    uint32_t values[] = {
+        cacheFileVersion, uint32_t(settings.mipFilter), uint32_t(settings.compress),
+        settings.atlases.maxPackedSize, settings.atlases.atlasSize, settings.atlases.padding
+    };
+    uint64_t hash = 14695981039346656037ull;
+    unsigned char const *bytes = reinterpret_cast<unsigned char const*>(values);
+    for (size_t i = 0; i < sizeof(values); i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+static bool getFileStamp(std::string const &path, uint64_t &size, int64_t &modifiedTime) {
+    struct stat status;
+    if (stat(path.c_str(), &status) != 0) {
+        return false;
+    }
+    size = uint64_t(status.st_size);
+    modifiedTime = int64_t(status.st_mtime);
+    return true;
+}
+
+static size_t alignOffset(size_t offset) {
+    return (offset + cacheDataAlignment - 1) / cacheDataAlignment * cacheDataAlignment;
+}
+
+void writeTextureCache(std::string const &path, std::vector<std::string> const &sourcePaths,
+                       TexturePipelineSettings const &settings, TextureAtlasSet const &atlasSet) {
+    std::vector<CacheSource> sources(sourcePaths.size());
+    std::string names;
+    for (size_t i = 0; i < sourcePaths.size(); i++) {
+        CacheSource &source = sources[i];
+        std::memset(&source, 0, sizeof(source));
+        if (!getFileStamp(sourcePaths[i], source.fileSize, source.modifiedTime)) {
+            throw std::runtime_error("Could not find the texture \"" + sourcePaths[i] + "\"");
+        }
+        source.nameOffset = uint32_t(names.size());
+        source.nameLength = uint32_t(sourcePaths[i].size());
+        names += sourcePaths[i];
+
+        TexturePlacement const &placement = atlasSet.placements[i];
+        source.texture = placement.texture;
+        source.uvOffset[0] = placement.uvOffset.x;
+        source.uvOffset[1] = placement.uvOffset.y;
+        source.uvScale[0] = placement.uvScale.x;
+        source.uvScale[1] = placement.uvScale.y;
+    }
+
+    std::vector<CacheTexture> textures;
+    std::vector<CacheLevel> levels;
+    size_t dataSize = 0;
+    for (Texture const &texture : atlasSet.textures) {
+        CacheTexture entry = { uint32_t(texture.format), uint32_t(levels.size()), uint32_t(texture.levels.size()), 0 };
+        textures.push_back(entry);
+        for (TextureLevel const &level : texture.levels) {
+            dataSize = alignOffset(dataSize);
+            CacheLevel levelEntry = { level.width, level.height, dataSize, level.size };
+            levels.push_back(levelEntry);
+            dataSize += level.size;
+        }
+    }
+
+    CacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = cacheFileMagic;
+    header.version = cacheFileVersion;
+    header.settingsHash = hashSettings(settings);
+    header.sourceCount = uint32_t(sources.size());
+    header.textureCount = uint32_t(textures.size());
+    header.levelCount = uint32_t(levels.size());
+    header.nameBytes = uint32_t(names.size());
+    size_t tablesBytes = sizeof(CacheHeader) + sources.size() * sizeof(CacheSource) +
+                         textures.size() * sizeof(CacheTexture) + levels.size() * sizeof(CacheLevel) + names.size();
+    header.dataOffset = alignOffset(tablesBytes);
+    header.dataSize = dataSize;
+
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary);
+        auto writePadding = [&](size_t position) {
+            static const char zeros[cacheDataAlignment] = {};
+            file.write(zeros, std::streamsize(alignOffset(position) - position));
+        };
+
+        file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        file.write(reinterpret_cast<char const*>(sources.data()), std::streamsize(sources.size() * sizeof(CacheSource)));
+        file.write(reinterpret_cast<char const*>(textures.data()), std::streamsize(textures.size() * sizeof(CacheTexture)));
+        file.write(reinterpret_cast<char const*>(levels.data()), std::streamsize(levels.size() * sizeof(CacheLevel)));
+        file.write(names.data(), std::streamsize(names.size()));
+        writePadding(tablesBytes);
+
+        // The data starts aligned, so aligning positions within it aligns them in the file
+        size_t position = 0;
+        for (Texture const &texture : atlasSet.textures) {
+            for (size_t level = 0; level < texture.levels.size(); level++) {
+                writePadding(position);
+                position = alignOffset(position);
+                file.write(reinterpret_cast<char const*>(texture.getLevelData(level)), std::streamsize(texture.levels[level].size));
+                position += texture.levels[level].size;
+            }
+        }
+
+        if (!file) {
+            throw std::runtime_error("Could not write the texture cache file \"" + temporaryPath + "\"");
+        }
+    }
+    std::remove(path.c_str());
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Could not replace the texture cache file \"" + path + "\"");
+    }
+}
+
+bool TextureCache::open(std::string const &path) {
+    close();
+    if (!file.open(path)) {
+        return false;
+    }
+
+    // Everything is checked against the size of the file, since it may have been cut short
+    unsigned char const *contents = file.getData();
+    size_t fileSize = file.getSize();
+    CacheHeader header;
+    if (fileSize < sizeof(header)) {
+        close();
+        return false;
+    }
+    std::memcpy(&header, contents, sizeof(header));
+
+    size_t tablesEnd = sizeof(CacheHeader) + size_t(header.sourceCount) * sizeof(CacheSource) +
+                       size_t(header.textureCount) * sizeof(CacheTexture) + size_t(header.levelCount) * sizeof(CacheLevel);
+    if (header.magic != cacheFileMagic || header.version != cacheFileVersion ||
+        tablesEnd + header.nameBytes > header.dataOffset || header.dataOffset > fileSize ||
+        header.dataSize > fileSize - header.dataOffset) {
+        close();
+        return false;
+    }
+
+    CacheSource const *sourceTable = reinterpret_cast<CacheSource const*>(contents + sizeof(CacheHeader));
+    CacheTexture const *textureTable = reinterpret_cast<CacheTexture const*>(sourceTable + header.sourceCount);
+    CacheLevel const *levelTable = reinterpret_cast<CacheLevel const*>(textureTable + header.textureCount);
+    char const *names = reinterpret_cast<char const*>(levelTable + header.levelCount);
+
+    settingsHash = header.settingsHash;
+    for (uint32_t i = 0; i < header.sourceCount; i++) {
+        CacheSource const &source = sourceTable[i];
+        if (size_t(source.nameOffset) + source.nameLength > header.nameBytes || source.texture >= header.textureCount) {
+            close();
+            return false;
+        }
+        SourceStamp stamp = { std::string(names + source.nameOffset, source.nameLength), source.fileSize, source.modifiedTime };
+        sources.push_back(stamp);
+        TexturePlacement placement = {
+            source.texture, float2(source.uvOffset[0], source.uvOffset[1]), float2(source.uvScale[0], source.uvScale[1])
+        };
+        placements.push_back(placement);
+    }
+
+    for (uint32_t i = 0; i < header.textureCount; i++) {
+        CacheTexture const &entry = textureTable[i];
+        if (entry.format > uint32_t(TextureFormat::BC1) || size_t(entry.firstLevel) + entry.levelCount > header.levelCount) {
+            close();
+            return false;
+        }
+        CachedTexture texture;
+        texture.format = TextureFormat(entry.format);
+        for (uint32_t level = entry.firstLevel; level < entry.firstLevel + entry.levelCount; level++) {
+            CacheLevel const &levelEntry = levelTable[level];
+            if (levelEntry.offset > header.dataSize || levelEntry.size > header.dataSize - levelEntry.offset ||
+                levelEntry.size != getTextureLevelSize(texture.format, levelEntry.width, levelEntry.height)) {
+                close();
+                return false;
+            }
+            TextureLevel textureLevel = { levelEntry.width, levelEntry.height, size_t(levelEntry.offset), size_t(levelEntry.size) };
+            texture.levels.push_back(textureLevel);
+        }
+        textures.push_back(texture);
+    }
+
+    dataOffset = size_t(header.dataOffset);
+    return true;
+}
+
+void TextureCache::close() {
+    file.close();
+    settingsHash = 0;
+    dataOffset = 0;
+    sources.clear();
+    placements.clear();
+    textures.clear();
+}
+
+bool TextureCache::isUpToDate(std::vector<std::string> const &sourcePaths, TexturePipelineSettings const &settings) const {
+    if (!file.isOpen() || settingsHash != hashSettings(settings) || sources.size() != sourcePaths.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < sources.size(); i++) {
+        uint64_t size;
+        int64_t modifiedTime;
+        if (sources[i].path != sourcePaths[i] || !getFileStamp(sourcePaths[i], size, modifiedTime) ||
+            size != sources[i].size || modifiedTime != sources[i].modifiedTime) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TextureView TextureCache::getTexture(size_t index) const {
+    TextureView view = { textures[index].format, textures[index].levels, file.getData() + dataOffset };
+    return view;
+}
+
+TextureCache loadTextures(std::vector<std::string> const &sourcePaths, std::string const &cachePath,
+                          TexturePipelineSettings const &settings) {
+    TextureCache cache;
+    if (cache.open(cachePath) && cache.isUpToDate(sourcePaths, settings)) {
+        return cache;
+    }
+    // The old file has to be unmapped before it can be replaced on Windows
+    cache.close();
+
+    writeTextureCache(cachePath, sourcePaths, settings, processTextures(sourcePaths, settings));
+    if (!cache.open(cachePath)) {
+        throw std::runtime_error("Could not read back the texture cache file \"" + cachePath + "\"");
+    }
+    return cache;
+}
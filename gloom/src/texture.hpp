@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "floats.hpp"
+#include "mappedFile.hpp"
+
+enum class TextureFormat : uint32_t {
+    // Four bytes per pixel
+    RGBA8 = 0,
+    // 4x4 pixel blocks of eight bytes each, with the alpha channel dropped
+    BC1 = 1
+};
+
+// Where one mip level is found within the data of a texture
+struct TextureLevel {
+    unsigned int width;
+    unsigned int height;
+    size_t offset;
+    size_t size;
+};
+
+// A texture and its mip chain, largest level first. Rows are stored bottom row first, the way
+// glTexImage2D() expects them, so that texture coordinates from OBJ files can be used as they are.
+struct Texture {
+    std::string name;
+    TextureFormat format = TextureFormat::RGBA8;
+    std::vector<TextureLevel> levels;
+    std::vector<unsigned char> data;
+
+    unsigned char *getLevelData(size_t level) { return &data[levels[level].offset]; }
+    unsigned char const *getLevelData(size_t level) const { return &data[levels[level].offset]; }
+};
+
+// Size in bytes of a level of the given dimensions
+size_t getTextureLevelSize(TextureFormat format, unsigned int width, unsigned int height);
+
+// Decodes an image file into an RGBA8 texture with a single level. Any format stb_image
+// reads is accepted. Throws a std::runtime_error if the file cannot be decoded.
+Texture decodeTexture(std::string const &path);
+
+// Decodes several image files at once, spread over the threads used by parallelFor().
+// Throws a std::runtime_error naming the first file which failed.
+std::vector<Texture> decodeTextures(std::vector<std::string> const &paths);
+
+enum class MipFilter {
+    // Averages each 2x2 block of pixels. Fast, but somewhat blurry and prone to aliasing.
+    BOX,
+    // Kaiser windowed sinc over 6x6 pixels, which keeps the smaller levels sharper
+    KAISER
+};
+
+// Replaces the mip chain of an RGBA8 texture by one generated from its first level, down to
+// 1x1 pixels or until maxLevels levels, if that is not 0. Each level halves the dimensions,
+// rounding down. The colours are filtered as they are stored, without converting from sRGB.
+void generateMipChain(Texture &texture, MipFilter filter, unsigned int maxLevels = 0);
+
+// Generates the mip chains of several textures at once
+void generateMipChains(std::vector<Texture> &textures, MipFilter filter, unsigned int maxLevels = 0);
+
+// Compresses every level of an RGBA8 texture to BC1 (DXT1). The endpoints of each block are
+// taken from the corners of the bounding box of its colours, which is quick rather than optimal.
+Texture compressTextureBC1(Texture const &texture);
+
+// Where a source texture ended up after packing: atlas texture coordinates are found as
+// uv * uvScale + uvOffset.
+struct TexturePlacement {
+    unsigned int texture;
+    float2 uvOffset;
+    float2 uvScale;
+};
+
+struct TextureAtlasSettings {
+    // Textures of at most this many pixels along both sides are packed into atlases.
+    // 0 packs nothing.
+    unsigned int maxPackedSize = 128;
+    unsigned int atlasSize = 1024;
+    // Width of the border of repeated edge pixels around each packed texture. Placements are
+    // aligned to it, so mip levels stay free of their neighbours down to log2(padding) + 1 levels.
+    unsigned int padding = 4;
+};
+
+struct TextureAtlasSet {
+    std::vector<Texture> textures;
+    // Textures from this index onwards are atlases
+    size_t firstAtlas = 0;
+    // One per source texture, in the same order
+    std::vector<TexturePlacement> placements;
+};
+
+// Packs the small textures among the first levels of the given RGBA8 textures into atlases,
+// onto shelves of similar heights. Larger textures are passed through on their own.
+TextureAtlasSet packTextureAtlases(std::vector<Texture> textures, TextureAtlasSettings const &settings);
+
+// The number of mip levels an atlas keeps free of its neighbours with the given padding
+unsigned int getAtlasLevelCount(unsigned int padding);
+
+struct TexturePipelineSettings {
+    MipFilter mipFilter = MipFilter::KAISER;
+    bool compress = false;
+    TextureAtlasSettings atlases;
+};
+
+// A texture kept in a cache file, whose levels point into the mapped file
+struct TextureView {
+    TextureFormat format;
+    std::vector<TextureLevel> levels;
+    unsigned char const *data;
+
+    unsigned char const *getLevelData(size_t level) const { return data + levels[level].offset; }
+};
+
+// Textures processed by an earlier run, stored so that they can be used straight from a
+// memory mapping. The cache remembers the size and modification time of the source images
+// and the settings used, so that it can tell when it is out of date.
+//
+// The file consists of a header, tables of the sources, textures and levels, the source
+// names, and finally the data of all levels, each aligned to 16 bytes.
+class TextureCache {
+public:
+    // Returns false if the file does not exist or is not a valid cache file
+    bool open(std::string const &path);
+    void close();
+
+    // Whether the cache was made from exactly these files, unchanged since, with these settings
+    bool isUpToDate(std::vector<std::string> const &sourcePaths, TexturePipelineSettings const &settings) const;
+
+    size_t getTextureCount() const { return textures.size(); }
+    TextureView getTexture(size_t index) const;
+    size_t getSourceCount() const { return placements.size(); }
+    TexturePlacement getPlacement(size_t sourceIndex) const { return placements[sourceIndex]; }
+    size_t getSizeBytes() const { return file.getSize(); }
+
+private:
+    struct SourceStamp {
+        std::string path;
+        uint64_t size;
+        int64_t modifiedTime;
+    };
+    struct CachedTexture {
+        TextureFormat format;
+        std::vector<TextureLevel> levels;
+    };
+
+    MappedFile file;
+    uint64_t settingsHash = 0;
+    // Where the data of the levels starts within the file
+    size_t dataOffset = 0;
+    std::vector<SourceStamp> sources;
+    std::vector<TexturePlacement> placements;
+    std::vector<CachedTexture> textures;
+};
+
+// Writes the textures made from the given source images to a cache file, through a temporary
+// file so that a run interrupted halfway never leaves a broken cache behind.
+// Throws a std::runtime_error if the file cannot be written.
+void writeTextureCache(std::string const &path, std::vector<std::string> const &sourcePaths,
+                       TexturePipelineSettings const &settings, TextureAtlasSet const &atlasSet);
+
+// Decodes a list of image files, packs the small ones into atlases, generates the mip chains
+// and compresses them if asked to. Atlases always use the box filter, since the wider Kaiser
+// filter would reach across the padding into neighbouring textures.
+TextureAtlasSet processTextures(std::vector<std::string> const &sourcePaths, TexturePipelineSettings const &settings);
+
+// Runs the whole pipeline on a list of image files: decoding, atlas packing, mip generation and
+// compression. Returns the cache at cachePath, which is rebuilt first if it is out of date.
+TextureCache loadTextures(std::vector<std::string> const &sourcePaths, std::string const &cachePath,
+                          TexturePipelineSettings const &settings);
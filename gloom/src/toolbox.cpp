@@ -3,6 +3,11 @@
 #include <fstream>
 #define _USE_MATH_DEFINES
 #include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <ctime>
+#include <mutex>
+#include "parallel.hpp"
 #include "toolbox.hpp"
 
 Mesh generateChessboard(
@@ -11,75 +16,117 @@ Mesh generateChessboard(
         float tileWidth,     // Width and height of each tile, measured in units
         float4 tileColour1,  // Colours of the chessboard tiles.
         float4 tileColour2) {
-    std::vector<float4> vertices;
-    std::vector<float4> vertexColours;
-    std::vector<unsigned int> indices;
-
     unsigned int tileCount = width * height;
 
-    vertices.reserve(4 * tileCount);
-    vertexColours.reserve(4 * tileCount);
-    indices.reserve(6 * tileCount);
-
-    for(int x = 0; x < width; x++) {
-        for(int y = 0; y < height; y++) {
-            float leftX = (float(x) - 0.5f) * tileWidth;
-            float rightX = (float(x) + 0.5f) * tileWidth;
-            float bottomZ = (float(y) - 0.5f) * tileWidth;
-            float topZ = (float(y) + 0.5f) * tileWidth;
-
-            unsigned int baseIndex = unsigned(vertices.size());
-
-            indices.push_back(baseIndex + 0);
-            indices.push_back(baseIndex + 2);
-            indices.push_back(baseIndex + 1);
-            indices.push_back(baseIndex + 0);
-            indices.push_back(baseIndex + 3);
-            indices.push_back(baseIndex + 2);
-
-            vertices.push_back(float4(leftX, 0, bottomZ, 1));
-            vertices.push_back(float4(rightX, 0, bottomZ, 1));
-            vertices.push_back(float4(rightX, 0, topZ, 1));
-            vertices.push_back(float4(leftX, 0, topZ, 1));
-
-            bool tileColourType = ((x ^ y) & 1) == 1;
-
-            if(tileColourType) {
-                vertexColours.push_back(tileColour1);
-                vertexColours.push_back(tileColour1);
-                vertexColours.push_back(tileColour1);
-                vertexColours.push_back(tileColour1);
-            } else {
-                vertexColours.push_back(tileColour2);
-                vertexColours.push_back(tileColour2);
-                vertexColours.push_back(tileColour2);
-                vertexColours.push_back(tileColour2);
+    Mesh mesh("Chessboard terrain");
+    mesh.vertices.resize(4 * size_t(tileCount));
+    mesh.colours.resize(4 * size_t(tileCount));
+    mesh.indices.resize(6 * size_t(tileCount));
+    mesh.hasNormals = false;
+
+    // Each column of tiles has its own stretch of the arrays, so columns can be filled in parallel
+    size_t columnsPerPiece = std::max<size_t>(1, 16384 / std::max(1u, height));
+    parallelFor(0, width, columnsPerPiece, [&](size_t firstColumn, size_t lastColumn) {
+        for(unsigned int x = unsigned(firstColumn); x < lastColumn; x++) {
+            for(unsigned int y = 0; y < height; y++) {
+                float leftX = (float(x) - 0.5f) * tileWidth;
+                float rightX = (float(x) + 0.5f) * tileWidth;
+                float bottomZ = (float(y) - 0.5f) * tileWidth;
+                float topZ = (float(y) + 0.5f) * tileWidth;
+
+                size_t tile = size_t(x) * height + y;
+                unsigned int baseIndex = unsigned(4 * tile);
+
+                unsigned int *indices = &mesh.indices[6 * tile];
+                indices[0] = baseIndex + 0;
+                indices[1] = baseIndex + 2;
+                indices[2] = baseIndex + 1;
+                indices[3] = baseIndex + 0;
+                indices[4] = baseIndex + 3;
+                indices[5] = baseIndex + 2;
+
+                float4 *vertices = &mesh.vertices[4 * tile];
+                vertices[0] = float4(leftX, 0, bottomZ, 1);
+                vertices[1] = float4(rightX, 0, bottomZ, 1);
+                vertices[2] = float4(rightX, 0, topZ, 1);
+                vertices[3] = float4(leftX, 0, topZ, 1);
+
+                bool tileColourType = ((x ^ y) & 1) == 1;
+                float4 colour = tileColourType ? tileColour1 : tileColour2;
+                std::fill(&mesh.colours[4 * tile], &mesh.colours[4 * tile] + 4, colour);
             }
         }
+    });
+
+    return mesh;
+}
+
+BoundingSphere computeBoundingSphere(Mesh const &mesh) {
+    BoundingSphere sphere;
+    sphere.centre = float3(0, 0, 0);
+    sphere.radius = 0;
+
+    if (mesh.vertices.empty()) {
+        return sphere;
     }
 
-    Mesh mesh("Chessboard terrain");
-    mesh.vertices = vertices;
-    mesh.colours = vertexColours;
-    mesh.hasNormals = false;
-    mesh.indices = indices;
+    float3 minimum(mesh.vertices[0].x, mesh.vertices[0].y, mesh.vertices[0].z);
+    float3 maximum = minimum;
+    for (float4 const &vertex : mesh.vertices) {
+        minimum = float3(std::min(minimum.x, vertex.x), std::min(minimum.y, vertex.y), std::min(minimum.z, vertex.z));
+        maximum = float3(std::max(maximum.x, vertex.x), std::max(maximum.y, vertex.y), std::max(maximum.z, vertex.z));
+    }
 
-    return mesh;
+    sphere.centre = (minimum + maximum) * 0.5f;
+    for (float4 const &vertex : mesh.vertices) {
+        sphere.radius = std::max(sphere.radius, sphere.centre.distance(vertex.toFloat3()));
+    }
+    return sphere;
 }
 
-// The standard library's random number generator needs to be seeded in order to produce
-// different results every time the program is run. This should only happen once, so
-// we keep track here with a global variable whether this has happened previously.
-bool isRandomInitialised = false;
+// Every thread has a stream of its own, so no locking is needed to draw numbers. The seed is
+// shared, and seedRandom() bumps the generation so that the other threads pick up new streams.
+static std::mutex randomMutex;
+static uint64_t randomSeed = 0;
+static uint64_t nextRandomStream = 0;
+// Generation 0 means no seed has been chosen yet
+static std::atomic<unsigned int> randomGeneration(0);
+
+struct ThreadRandomStream {
+    RandomStream stream;
+    unsigned int generation = 0;
+};
+static thread_local ThreadRandomStream threadRandomStream;
+
+RandomStream &getThreadRandomStream() {
+    unsigned int generation = randomGeneration.load(std::memory_order_acquire);
+    if (generation == 0 || threadRandomStream.generation != generation) {
+        std::lock_guard<std::mutex> lock(randomMutex);
+        if (randomGeneration.load() == 0) {
+            randomSeed = uint64_t(time(0));
+            nextRandomStream = 0;
+            randomGeneration.store(1);
+        }
+        threadRandomStream.stream = RandomStream(randomSeed, nextRandomStream++);
+        threadRandomStream.generation = randomGeneration.load();
+    }
+    return threadRandomStream.stream;
+}
 
 float randomUniformFloat() {
-    if (!isRandomInitialised) {
-        // Initialise the random number generator using the current time as a seed
-        srand(static_cast <unsigned> (time(0)));
-        isRandomInitialised = true;
-    }
-    // rand() produces a random integer between 0 and RAND_MAX. This normalises it to a number between 0 and 1.
-    return static_cast <float> (rand()) / static_cast <float>(RAND_MAX);
+    return getThreadRandomStream().nextFloat();
+}
+
+// Using a known seed makes the sequence of random numbers the same every time, which
+// is what we want when replaying a recorded run.
+void seedRandom(unsigned int seed) {
+    std::lock_guard<std::mutex> lock(randomMutex);
+    randomSeed = seed;
+    nextRandomStream = 1;
+    unsigned int generation = randomGeneration.load() + 1;
+    randomGeneration.store(generation == 0 ? 1 : generation);
+    threadRandomStream.stream = RandomStream(randomSeed, 0);
+    threadRandomStream.generation = randomGeneration.load();
 }
 
 // In order to be able to calculate when the getTimeDeltaSeconds() function was last called, we need to know the point in time when that happened. This requires us to keep hold of that point in time.
@@ -103,6 +150,27 @@ double getTimeDeltaSeconds() {
     return timeDeltaSeconds;
 }
 
+Clock::Clock(std::string const &clockName) : name(clockName) {
+    reset();
+}
+
+void Clock::reset() {
+    previousTimePoint = std::chrono::steady_clock::now();
+}
+
+double Clock::getTimeDeltaSeconds() {
+    std::chrono::steady_clock::time_point currentTime = std::chrono::steady_clock::now();
+    long long timeDelta = std::chrono::duration_cast<std::chrono::nanoseconds>(currentTime - previousTimePoint).count();
+    previousTimePoint = currentTime;
+    return (double)timeDelta / 1000000000.0;
+}
+
+double Clock::peekTimeDeltaSeconds() const {
+    std::chrono::steady_clock::time_point currentTime = std::chrono::steady_clock::now();
+    long long timeDelta = std::chrono::duration_cast<std::chrono::nanoseconds>(currentTime - previousTimePoint).count();
+    return (double)timeDelta / 1000000000.0;
+}
+
 float toRadians(float angleDegrees) {
     return angleDegrees * (float(M_PI) / 180.0f);
 }
@@ -145,11 +213,18 @@ Path::Path(std::string const &coordinatesFile) {
     waypoints = readCoordinatesFile(coordinatesFile);
 }
 
+Path::Path(std::vector<int2> const &tileCoordinates) : waypoints(tileCoordinates) {}
+
 float2 Path::getCurrentWaypoint(float tileWidth) {
     int2 intWaypoint = waypoints.at(currentWaypoint);
     return float2(intWaypoint.x, intWaypoint.y) * tileWidth;
 }
 
+float2 Path::getWaypoint(unsigned int index, float tileWidth) const {
+    int2 intWaypoint = waypoints.at(index);
+    return float2(intWaypoint.x, intWaypoint.y) * tileWidth;
+}
+
 bool Path::hasWaypointBeenReached(float2 characterPosition, float tileWidth) {
     float2 currentWaypoint = getCurrentWaypoint(tileWidth);
 
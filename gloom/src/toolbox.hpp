@@ -1,17 +1,62 @@
 #pragma once
 
 #include <glm/mat4x4.hpp>
+#include <chrono>
+#include <string>
 #include "mesh.hpp"
+#include "random.hpp"
 
 // Generates a mesh containing a 3D object which looks like a chessboard.
 Mesh generateChessboard(unsigned int width, unsigned int height, float tileWidth, float4 tileColour1, float4 tileColour2);
 
-// Returns a random float between 0 and 1
+// A sphere enclosing all vertices of a mesh, in the mesh's own coordinate space.
+struct BoundingSphere {
+    float3 centre;
+    float radius;
+};
+
+// Computes a bounding sphere centred on the middle of the mesh's bounding box.
+BoundingSphere computeBoundingSphere(Mesh const &mesh);
+
+// Returns a random float between 0 and 1 (exclusive), from the calling thread's stream
 float randomUniformFloat();
 
+// Seeds the streams used by randomUniformFloat(). The calling thread gets stream 0 of the seed
+// right away, and every other thread the next stream index the first time it asks for a number.
+// Without a call to this function, the seed is taken from the current time.
+void seedRandom(unsigned int seed);
+
+// The random stream of the calling thread. Work spread over threads which has to come out the same
+// every run should instead draw a seed from here once, and give each piece its own RandomStream.
+RandomStream &getThreadRandomStream();
+
 // Return the amount of time elapsed since the LAST TIME this function was called, in seconds.
 double getTimeDeltaSeconds();
 
+// A named stopwatch working like getTimeDeltaSeconds(), except that each instance keeps
+// its own previous time point. This allows several independent clocks to run at once,
+// for instance one for each part of a frame.
+class Clock {
+private:
+    std::string name;
+    std::chrono::steady_clock::time_point previousTimePoint;
+
+public:
+    Clock(std::string const &clockName);
+
+    std::string const &getName() const { return name; }
+
+    // Restarts the clock without reporting the elapsed time.
+    void reset();
+
+    // Returns the amount of time elapsed since the last call to this function
+    // (or since the clock was created or reset), in seconds.
+    double getTimeDeltaSeconds();
+
+    // Same as getTimeDeltaSeconds(), but does not restart the clock.
+    double peekTimeDeltaSeconds() const;
+};
+
 // Converts an angle measured in degrees to radians.
 float toRadians(float angleDegrees);
 
@@ -29,10 +74,18 @@ public:
     // Constructor. Requires loading a coordinates text file from a specified path.
     Path(std::string const &coordinatesFile);
 
+    // Creates a path through the given tile coordinates.
+    Path(std::vector<int2> const &tileCoordinates);
+
     // Returns the coordinates of the current waypoint, scaled to the coordinate space
     // of the terrain.
     float2 getCurrentWaypoint(float tileWidth);
 
+    // Returns the coordinates of any waypoint, for characters which keep track of their own
+    // progress along the path.
+    float2 getWaypoint(unsigned int index, float tileWidth) const;
+    unsigned int getWaypointCount() const { return unsigned(waypoints.size()); }
+
     // Determines whether the character is close enough to move on to the next waypoint
     bool hasWaypointBeenReached(float2 characterPosition, float tileWidth);
 
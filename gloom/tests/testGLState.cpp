@@ -0,0 +1,247 @@
+// Checks GLStateCache and ProgramInterface against a table of mock OpenGL functions, which
+// record the calls passed on to them instead of needing a context.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "glState.hpp"
+
+static int failureCount = 0;
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+static void check(bool condition, char const *text, int line) {
+    if (!condition) {
+        fprintf(stderr, "testGLState.cpp:%d: failed: %s\n", line, text);
+        failureCount++;
+    }
+}
+
+// What the mock OpenGL has been asked to do
+struct MockGL {
+    unsigned int useProgramCalls;
+    unsigned int bindVertexArrayCalls;
+    unsigned int bindBufferCalls;
+    unsigned int uniformCalls;
+    GLuint program;
+    GLuint vertexArray;
+    GLenum lastBufferTarget;
+    GLuint lastBuffer;
+};
+static MockGL mock;
+
+// The mock program has a vec4 "tint" at location 3, an array of two matrices "bones" at
+// location 5, and one attribute, "position", at location 0
+struct MockVariable {
+    char const *name;
+    GLenum type;
+    GLint size;
+    GLint location;
+};
+static const MockVariable mockUniforms[] = { { "tint", GL_FLOAT_VEC4, 1, 3 }, { "bones[0]", GL_FLOAT_MAT4, 2, 5 } };
+static const MockVariable mockAttributes[] = { { "position", GL_FLOAT_VEC3, 1, 0 } };
+static const GLint mockUniformCount = 2;
+static const GLint mockAttributeCount = 1;
+static const GLint mockMaxNameLength = 16;
+
+static void APIENTRY mockUseProgram(GLuint program) {
+    mock.useProgramCalls++;
+    mock.program = program;
+}
+
+static void APIENTRY mockBindVertexArray(GLuint vertexArray) {
+    mock.bindVertexArrayCalls++;
+    mock.vertexArray = vertexArray;
+}
+
+static void APIENTRY mockBindBuffer(GLenum target, GLuint buffer) {
+    mock.bindBufferCalls++;
+    mock.lastBufferTarget = target;
+    mock.lastBuffer = buffer;
+}
+
+static void APIENTRY mockGetProgramiv(GLuint, GLenum name, GLint *value) {
+    switch (name) {
+        case GL_ACTIVE_UNIFORMS: *value = mockUniformCount; break;
+        case GL_ACTIVE_ATTRIBUTES: *value = mockAttributeCount; break;
+        case GL_ACTIVE_UNIFORM_MAX_LENGTH: case GL_ACTIVE_ATTRIBUTE_MAX_LENGTH: *value = mockMaxNameLength; break;
+        default: *value = 0; break;
+    }
+}
+
+static void describeVariable(MockVariable const &variable, GLsizei bufferSize, GLsizei *length, GLint *size, GLenum *type, GLchar *name) {
+    strncpy(name, variable.name, size_t(bufferSize));
+    name[bufferSize - 1] = '\0';
+    *length = GLsizei(strlen(name));
+    *size = variable.size;
+    *type = variable.type;
+}
+
+static void APIENTRY mockGetActiveUniform(GLuint, GLuint index, GLsizei bufferSize, GLsizei *length, GLint *size, GLenum *type, GLchar *name) {
+    describeVariable(mockUniforms[index], bufferSize, length, size, type, name);
+}
+
+static void APIENTRY mockGetActiveAttrib(GLuint, GLuint index, GLsizei bufferSize, GLsizei *length, GLint *size, GLenum *type, GLchar *name) {
+    describeVariable(mockAttributes[index], bufferSize, length, size, type, name);
+}
+
+static GLint findLocation(MockVariable const *variables, GLint count, GLchar const *name) {
+    for (GLint i = 0; i < count; i++) {
+        if (strcmp(variables[i].name, name) == 0) {
+            return variables[i].location;
+        }
+    }
+    return -1;
+}
+
+static GLint APIENTRY mockGetUniformLocation(GLuint, GLchar const *name) {
+    return findLocation(mockUniforms, mockUniformCount, name);
+}
+
+static GLint APIENTRY mockGetAttribLocation(GLuint, GLchar const *name) {
+    return findLocation(mockAttributes, mockAttributeCount, name);
+}
+
+static void APIENTRY mockUniform1i(GLint, GLint) { mock.uniformCalls++; }
+static void APIENTRY mockUniform1f(GLint, GLfloat) { mock.uniformCalls++; }
+static void APIENTRY mockUniform4fv(GLint, GLsizei, GLfloat const *) { mock.uniformCalls++; }
+static void APIENTRY mockUniformMatrix4fv(GLint, GLsizei, GLboolean, GLfloat const *) { mock.uniformCalls++; }
+
+static GLFunctions createMockFunctions() {
+    GLFunctions functions;
+    functions.useProgram = mockUseProgram;
+    functions.bindVertexArray = mockBindVertexArray;
+    functions.bindBuffer = mockBindBuffer;
+    functions.getProgramiv = mockGetProgramiv;
+    functions.getActiveUniform = mockGetActiveUniform;
+    functions.getActiveAttrib = mockGetActiveAttrib;
+    functions.getUniformLocation = mockGetUniformLocation;
+    functions.getAttribLocation = mockGetAttribLocation;
+    functions.uniform1i = mockUniform1i;
+    functions.uniform1f = mockUniform1f;
+    functions.uniform4fv = mockUniform4fv;
+    functions.uniformMatrix4fv = mockUniformMatrix4fv;
+    return functions;
+}
+
+static void testProgramBinding() {
+    mock = MockGL();
+    GLStateCache state(createMockFunctions());
+
+    state.useProgram(1);
+    state.useProgram(1);
+    state.useProgram(2);
+    state.useProgram(2);
+    CHECK(mock.useProgramCalls == 2);
+    CHECK(mock.program == 2);
+    CHECK(state.getCallCounts().issued == 2);
+    CHECK(state.getCallCounts().elided == 2);
+
+    // After being invalidated, the cache cannot know what OpenGL has bound
+    state.invalidate();
+    state.useProgram(2);
+    CHECK(mock.useProgramCalls == 3);
+}
+
+static void testBufferBinding() {
+    mock = MockGL();
+    GLStateCache state(createMockFunctions());
+
+    state.bindBuffer(GL_ARRAY_BUFFER, 7);
+    state.bindBuffer(GL_ARRAY_BUFFER, 7);
+    // Each target has a binding of its own
+    state.bindBuffer(GL_UNIFORM_BUFFER, 7);
+    state.bindBuffer(GL_ARRAY_BUFFER, 8);
+    CHECK(mock.bindBufferCalls == 3);
+    CHECK(state.getCallCounts().issued == 3);
+    CHECK(state.getCallCounts().elided == 1);
+
+    // Deleting a bound buffer binds 0 in its place
+    state.forgetBuffer(8);
+    state.bindBuffer(GL_ARRAY_BUFFER, 0);
+    CHECK(mock.bindBufferCalls == 3);
+    state.bindBuffer(GL_ARRAY_BUFFER, 8);
+    CHECK(mock.bindBufferCalls == 4);
+}
+
+static void testElementArrayFollowsVertexArray() {
+    mock = MockGL();
+    GLStateCache state(createMockFunctions());
+
+    state.bindVertexArray(1);
+    state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 10);
+    state.bindBuffer(GL_ARRAY_BUFFER, 20);
+    state.bindVertexArray(1);
+    state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 10);
+    CHECK(mock.bindVertexArrayCalls == 1);
+    CHECK(mock.bindBufferCalls == 2);
+
+    // The element array binding belongs to the vertex array, so a new vertex array has to
+    // have it bound again. The array buffer binding does not, and stays known.
+    state.bindVertexArray(2);
+    state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 10);
+    state.bindBuffer(GL_ARRAY_BUFFER, 20);
+    CHECK(mock.bindVertexArrayCalls == 2);
+    CHECK(mock.bindBufferCalls == 3);
+    CHECK(mock.lastBufferTarget == GL_ELEMENT_ARRAY_BUFFER && mock.lastBuffer == 10);
+
+    // So does deleting the bound vertex array, which binds vertex array 0
+    state.forgetVertexArray(2);
+    state.bindVertexArray(0);
+    state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 10);
+    CHECK(mock.bindVertexArrayCalls == 2);
+    CHECK(mock.bindBufferCalls == 4);
+
+    CHECK(state.getCallCounts().issued == 6);
+    CHECK(state.getCallCounts().elided == 4);
+}
+
+static void testUniforms() {
+    mock = MockGL();
+    GLStateCache state(createMockFunctions());
+    ProgramInterface program(state, 4);
+
+    GLint tint = program.getUniformLocation("tint");
+    GLint bones = program.getUniformLocation("bones");
+    CHECK(tint == 3);
+    CHECK(bones == 5);
+    CHECK(program.getUniformLocation("missing") == -1);
+    CHECK(program.getAttributeLocation("position") == 0);
+
+    // Setting a uniform makes its program current, once
+    program.setUniform(tint, float4(1, 0, 0, 1));
+    program.setUniform(tint, float4(1, 0, 0, 1));
+    CHECK(mock.useProgramCalls == 1);
+    CHECK(mock.program == 4);
+    CHECK(mock.uniformCalls == 1);
+
+    glm::mat4 matrices[2] = { glm::mat4(1), glm::mat4(2) };
+    program.setUniform(bones, matrices, 2);
+    program.setUniform(bones, matrices, 2);
+    matrices[1][3][0] = 5;
+    program.setUniform(bones, matrices, 2);
+    program.setUniform(tint, float4(0, 1, 0, 1));
+    CHECK(mock.uniformCalls == 4);
+
+    // Locations of -1 are ignored, and neither issued nor elided
+    program.setUniform(-1, 1.0f);
+    CHECK(mock.uniformCalls == 4);
+
+    // One program binding and four uploads were issued; three bindings and two uploads skipped
+    CHECK(state.getCallCounts().issued == 5);
+    CHECK(state.getCallCounts().elided == 5);
+}
+
+int main() {
+    testProgramBinding();
+    testBufferBinding();
+    testElementArrayFollowsVertexArray();
+    testUniforms();
+
+    if (failureCount > 0) {
+        fprintf(stderr, "%d checks failed\n", failureCount);
+        return EXIT_FAILURE;
+    }
+    printf("All GL state checks passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+// Checks that the OBJ loader keeps one normal for every vertex, whatever mix of face formats
+// a file uses.
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "OBJLoader.hpp"
+
+static int failureCount = 0;
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+static void check(bool condition, char const *text, int line) {
+    if (!condition) {
+        fprintf(stderr, "testOBJLoader.cpp:%d: failed: %s\n", line, text);
+        failureCount++;
+    }
+}
+
+// A quad and a triangle without normals, then a triangle with them: 12 vertices in all, since
+// the quad is split in two
+static const char mixedFaces[] =
+    "v 0 0 0\n"
+    "v 1 0 0\n"
+    "v 1 0 1\n"
+    "v 0 0 1\n"
+    "vn 0 1 0\n"
+    "o mixed\n"
+    "f 1 2 3 4\n"
+    "f 1 3 4\n"
+    "f 1//1 2//1 3//1\n";
+
+static void checkAttributesPerVertex(Mesh const &mesh) {
+    CHECK(mesh.vertices.size() == 12);
+    CHECK(mesh.normals.size() == mesh.vertices.size());
+    // None of the faces has texture coordinates, so the mesh has none
+    CHECK(!mesh.hasTextureCoordinates && mesh.textureCoordinates.empty());
+    CHECK(mesh.indices.size() == mesh.vertices.size());
+}
+
+static void testMixedFaces(std::string const &path) {
+    std::vector<Mesh> meshes = loadWavefront(path);
+    CHECK(meshes.size() == 1);
+    if (meshes.size() == 1) {
+        checkAttributesPerVertex(meshes[0]);
+        // The placeholders of the faces without normals come first, and stay zero
+        CHECK(meshes[0].normals[0] == float3(0, 0, 0));
+        CHECK(meshes[0].normals[11] == float3(0, 1, 0));
+    }
+
+    unsigned int streamedMeshes = 0;
+    streamWavefront(path, [&](Mesh &mesh) {
+        streamedMeshes++;
+        checkAttributesPerVertex(mesh);
+    });
+    CHECK(streamedMeshes == 1);
+}
+
+int main() {
+    std::string path = "test-mixed-faces.obj";
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << mixedFaces;
+    }
+
+    testMixedFaces(path);
+    std::remove(path.c_str());
+
+    if (failureCount > 0) {
+        fprintf(stderr, "%d checks failed\n", failureCount);
+        return EXIT_FAILURE;
+    }
+    printf("All OBJ loader checks passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,25 @@
+// Converts a scene described as text into the binary scene file gloom loads (see sceneFile.hpp).
+
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include "sceneFile.hpp"
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <scene description> <scene file>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        SceneDescription scene = parseSceneText(argv[1]);
+        writeSceneFile(argv[2], scene);
+        printf("%s: %zu nodes, %zu meshes\n", argv[2], scene.nodes.size(), scene.meshSources.size());
+    } catch (std::runtime_error const &error) {
+        fprintf(stderr, "%s\n", error.what());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}